@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha512_ce_glue.c - SHA-384/SHA-512 secure hash using ARMv8.2 Crypto
+ * Extensions
+ */
+
+#include <common.h>
+#include <asm/global_data.h>
+#include <asm/system.h>
+#include <linux/errno.h>
+#include <u-boot/sha512.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+extern void sha512_armv8_ce_process(uint64_t state[8], uint8_t const *src,
+				    uint32_t blocks);
+
+/*
+ * The SHA512 instructions are optional, so check that this CPU has them. The
+ * result is only cached once relocated, since .bss may not be writable
+ * before then; reading the ID register is cheap anyway.
+ */
+static bool sha512_ce_checked, sha512_ce;
+
+static bool sha512_ce_present(void)
+{
+	bool present;
+	u64 reg;
+
+	if (sha512_ce_checked)
+		return sha512_ce;
+
+	__asm__ volatile("mrs %0, ID_AA64ISAR0_EL1\n" : "=r" (reg));
+	present = (reg & ID_AA64ISAR0_EL1_SHA2) >= ID_AA64ISAR0_EL1_SHA2_512;
+	if (gd->flags & GD_FLG_RELOC) {
+		sha512_ce = present;
+		sha512_ce_checked = true;
+	}
+
+	return present;
+}
+
+int sha512_process_arch(sha512_context *ctx, const unsigned char *data,
+			unsigned int blocks)
+{
+	if (!sha512_ce_present())
+		return -ENOSYS;
+
+	if (blocks)
+		sha512_armv8_ce_process(ctx->state, data, blocks);
+
+	return 0;
+}
@@ -306,6 +306,11 @@ void invalidate_dcache_range(unsigned long start, unsigned long stop)
 {
 }
 
+int cpu_run_parallel(void (*func)(void *arg), void *args[], int count)
+{
+	return os_run_parallel(func, args, count);
+}
+
 /**
  * setup_auto_tree() - Set up a basic device tree to allow sandbox to work
  *
@@ -1014,6 +1014,62 @@ void os_set_time_offset(long offset)
 		       ENV_TIME_OFFSET);
 }
 
+/* Most threads to use in os_run_parallel() */
+#define OS_PARALLEL_MAX_THREADS	16
+
+struct os_parallel {
+	void (*func)(void *arg);
+	void **args;
+	int count;
+	int next;
+};
+
+static void *os_parallel_thread(void *data)
+{
+	struct os_parallel *par = data;
+	int i;
+
+	for (;;) {
+		i = __atomic_fetch_add(&par->next, 1, __ATOMIC_SEQ_CST);
+		if (i >= par->count)
+			break;
+		par->func(par->args[i]);
+	}
+
+	return NULL;
+}
+
+int os_run_parallel(void (*func)(void *arg), void *args[], int count)
+{
+	struct os_parallel par = {
+		.func	= func,
+		.args	= args,
+		.count	= count,
+	};
+	pthread_t threads[OS_PARALLEL_MAX_THREADS];
+	long cpus;
+	int nthreads, i;
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (cpus < 1)
+		cpus = 1;
+	nthreads = count < cpus ? count : cpus;
+	if (nthreads > OS_PARALLEL_MAX_THREADS)
+		nthreads = OS_PARALLEL_MAX_THREADS;
+
+	/* This thread does its share of the work too */
+	for (i = 0; i < nthreads - 1; i++) {
+		if (pthread_create(&threads[i], NULL, os_parallel_thread, &par))
+			break;
+	}
+	nthreads = i;
+	os_parallel_thread(&par);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	return 0;
+}
+
 void os_localtime(struct rtc_time *rt)
 {
 	time_t t = time(NULL);
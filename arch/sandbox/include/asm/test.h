@@ -150,6 +150,65 @@ int sandbox_pwm_get_config(struct udevice *dev, uint channel, uint *period_nsp,
  */
 void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask);
 
+/**
+ * sandbox_sf_get_read_count() - Get the number of read commands received
+ *
+ * @dev: SPI flash emulation device
+ * Return: number of read commands since the device was probed
+ */
+uint sandbox_sf_get_read_count(struct udevice *dev);
+
+/**
+ * sandbox_sf_refuse_octal_dtr() - Make the flash ignore requests for 8D-8D-8D
+ *
+ * This only has an effect on flashes which support Octal DTR mode.
+ *
+ * @dev: SPI flash emulation device
+ * @refuse: true to stay in 1S-1S-1S mode when asked to switch
+ */
+void sandbox_sf_refuse_octal_dtr(struct udevice *dev, bool refuse);
+
+/**
+ * sandbox_sf_get_octal_dtr() - Check if the flash is in 8D-8D-8D mode
+ *
+ * @dev: SPI flash emulation device
+ * Return: true if the flash expects commands in 8D-8D-8D mode
+ */
+bool sandbox_sf_get_octal_dtr(struct udevice *dev);
+
+/**
+ * sandbox_sf_set_octal_sfdp() - Choose what SFDP says about 8D-8D-8D mode
+ *
+ * This only has an effect on flashes which support Octal DTR mode. Both are
+ * advertised by default.
+ *
+ * @dev: SPI flash emulation device
+ * @soft_reset: true to advertise Software Reset
+ * @volatile_enable: true to advertise a volatile 8D-8D-8D enable bit
+ */
+void sandbox_sf_set_octal_sfdp(struct udevice *dev, bool soft_reset,
+			       bool volatile_enable);
+
+/**
+ * sandbox_mmc_get_cqe_stats() - Read back command-queue statistics
+ *
+ * @dev: MMC device to check
+ * @requestsp: Returns the number of cqe_request() calls so far
+ * @tasksp: Returns the total number of tasks queued so far
+ * @entriesp: Returns the number of times the card entered command queue mode
+ */
+void sandbox_mmc_get_cqe_stats(struct udevice *dev, int *requestsp,
+			       int *tasksp, int *entriesp);
+
+/**
+ * sandbox_mmc_set_cqe_fail() - Make the command queue engine fail
+ *
+ * @dev: MMC device to update
+ * @enable: true to fail requests to enable the engine
+ * @request: true to fail requests to run tasks
+ */
+void sandbox_mmc_set_cqe_fail(struct udevice *dev, bool enable, bool request);
+
 /**
  * sandbox_get_codec_params() - Read back codec parameters
  *
@@ -8,8 +8,10 @@
 #include <cpu_func.h>
 #include <debug_uart.h>
 #include <init.h>
+#include <asm/control_regs.h>
 #include <asm/cpu.h>
 #include <asm/global_data.h>
+#include <asm/processor-flags.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -39,8 +41,82 @@ int x86_mp_init(void)
 	return 0;
 }
 
+/* CPUID feature bits used for the SIMD extensions */
+#define CPUID1_ECX_SSSE3	BIT(9)
+#define CPUID1_ECX_SSE41	BIT(19)
+#define CPUID1_ECX_XSAVE	BIT(26)
+#define CPUID1_ECX_OSXSAVE	BIT(27)
+#define CPUID1_ECX_AVX		BIT(28)
+#define CPUID7_EBX_AVX2		BIT(5)
+#define CPUID7_EBX_SHA		BIT(29)
+
+/* State components in XCR0 */
+#define XSTATE_X87		BIT(0)
+#define XSTATE_SSE		BIT(1)
+#define XSTATE_YMM		BIT(2)
+
+static u64 xgetbv(u32 index)
+{
+	u32 eax, edx;
+
+	asm volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (index));
+
+	return eax | (u64)edx << 32;
+}
+
+static void xsetbv(u32 index, u64 value)
+{
+	asm volatile("xsetbv" : : "a" ((u32)value), "d" ((u32)(value >> 32)),
+		     "c" (index));
+}
+
+/*
+ * U-Boot is built without SSE, but enable it and AVX here so that functions
+ * built for them (e.g. the SHA256 code) can be used where the CPU has them
+ */
+static void x86_enable_simd(void)
+{
+	struct cpuid_result leaf1, leaf7 = { };
+	u64 ymm = XSTATE_SSE | XSTATE_YMM;
+	uint features = 0;
+
+	leaf1 = cpuid(1);
+	if (cpuid_eax(0) >= 7)
+		leaf7 = cpuid_ext(7, 0);
+
+	/* The firmware owns this when running as an EFI app */
+	if (!IS_ENABLED(CONFIG_EFI_APP)) {
+		write_cr4(read_cr4() | X86_CR4_OSFXSR | X86_CR4_OSXMMEXCPT);
+		if (leaf1.ecx & CPUID1_ECX_XSAVE) {
+			write_cr4(read_cr4() | X86_CR4_OSXSAVE);
+			xsetbv(0, XSTATE_X87 | XSTATE_SSE |
+			       (leaf1.ecx & CPUID1_ECX_AVX ? XSTATE_YMM : 0));
+			leaf1 = cpuid(1);
+		}
+	}
+
+	if (read_cr4() & X86_CR4_OSFXSR) {
+		if ((leaf7.ebx & CPUID7_EBX_SHA) &&
+		    (leaf1.ecx & CPUID1_ECX_SSSE3) &&
+		    (leaf1.ecx & CPUID1_ECX_SSE41))
+			features |= X86_SIMD_SHA;
+		if ((leaf7.ebx & CPUID7_EBX_AVX2) &&
+		    (leaf1.ecx & CPUID1_ECX_OSXSAVE) &&
+		    (xgetbv(0) & ymm) == ymm)
+			features |= X86_SIMD_AVX2;
+	}
+	gd->arch.simd_features = features;
+}
+
+uint x86_simd_features(void)
+{
+	return gd->arch.simd_features;
+}
+
 int x86_cpu_reinit_f(void)
 {
+	x86_enable_simd();
+
 	/* set the vendor to Intel so that native_calibrate_tsc() works */
 	gd->arch.x86_vendor = X86_VENDOR_INTEL;
 	gd->arch.has_mtrr = true;
@@ -55,6 +131,8 @@ int cpu_phys_address_size(void)
 
 int x86_cpu_init_f(void)
 {
+	x86_enable_simd();
+
 	return 0;
 }
 
@@ -298,4 +298,20 @@ u32 cpu_get_stepping(void);
  */
 int cpu_phys_address_size(void);
 
+/* SIMD extensions which are present and enabled, see x86_simd_features() */
+#define X86_SIMD_SHA	BIT(0)	/* SHA extensions, SSSE3 and SSE4.1 */
+#define X86_SIMD_AVX2	BIT(1)
+
+/**
+ * x86_simd_features() - Get the SIMD extensions which can be used
+ *
+ * U-Boot itself is built without SSE, but code which checks this can use SIMD
+ * instructions in functions built for them. This is only available in 64-bit
+ * U-Boot, which enables SSE and AVX, if present, while starting up. When
+ * running as an EFI app, the extensions enabled by the firmware are used.
+ *
+ * Return: X86_SIMD_... flags for the extensions which can be used
+ */
+uint x86_simd_features(void);
+
 #endif
@@ -92,6 +92,7 @@ struct arch_global_data {
 	uint8_t x86_model;
 	uint8_t x86_mask;
 	uint32_t x86_device;
+	uint8_t simd_features;		/* X86_SIMD_... flags */
 	uint64_t tsc_base;		/* Initial value returned by rdtsc() */
 	bool tsc_inited;		/* true if tsc is ready for use */
 	unsigned long clock_rate;	/* Clock rate of timer in Hz */
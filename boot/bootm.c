@@ -258,6 +258,9 @@ static inline void boot_start_lmb(struct bootm_headers *images) { }
 
 static int bootm_start(void)
 {
+#ifdef CONFIG_LMB
+	lmb_uninit(&images.lmb);
+#endif
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
 
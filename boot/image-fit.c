@@ -1294,6 +1294,131 @@ int calculate_hash(const void *data, int data_len, const char *name,
 	return 0;
 }
 
+#if !defined(USE_HOSTCC) && CONFIG_IS_ENABLED(HASH_PARALLEL)
+/*
+ * Hashes calculated together by fit_image_hash_prepare(), for use by
+ * fit_image_check_hash() until fit_image_hash_release() is called
+ */
+static struct hash_job *fit_hash_jobs;
+static int fit_hash_job_count;
+
+/* Adds a job for each hash of an image, or just counts them if @jobs is NULL */
+static int fit_image_hash_add_jobs(const void *fit, int image_noffset,
+				   struct hash_job *jobs)
+{
+	const void *data;
+	const char *algo;
+	size_t size;
+	int noffset;
+	int ignore;
+	int count = 0;
+
+	if (fit_image_get_data_and_size(fit, image_noffset, &data, &size))
+		return 0;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &algo))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+		if (jobs) {
+			jobs[count].algo_name = algo;
+			jobs[count].data = data;
+			jobs[count].size = size;
+		}
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * fit_image_hash_prepare() - Calculate the hashes of some images together
+ *
+ * This calculates all the hashes of the given images at once, so that they
+ * can be spread over several CPUs. It does nothing if there are fewer than two
+ * hashes, or if some hashes are already prepared.
+ *
+ * @fit: pointer to the FIT format image header
+ * @images: component image node offsets
+ * @count: number of images
+ * Return: true if the hashes were prepared and fit_image_hash_release() must be
+ * called, else false
+ */
+static bool fit_image_hash_prepare(const void *fit, const int *images,
+				   int count)
+{
+	int total = 0;
+	int i;
+
+	if (fit_hash_jobs)
+		return false;
+	for (i = 0; i < count; i++)
+		total += fit_image_hash_add_jobs(fit, images[i], NULL);
+	if (total < 2)
+		return false;
+
+	fit_hash_jobs = calloc(total, sizeof(*fit_hash_jobs));
+	if (!fit_hash_jobs)
+		return false;
+	for (i = 0; i < count; i++) {
+		fit_hash_job_count += fit_image_hash_add_jobs(fit, images[i],
+						fit_hash_jobs + fit_hash_job_count);
+	}
+	hash_calculate_jobs(fit_hash_jobs, fit_hash_job_count);
+
+	return true;
+}
+
+static void fit_image_hash_release(void)
+{
+	free(fit_hash_jobs);
+	fit_hash_jobs = NULL;
+	fit_hash_job_count = 0;
+}
+
+/* Gets a hash calculated by fit_image_hash_prepare(), returning 0 if found */
+static int fit_image_hash_lookup(const void *data, size_t size,
+				 const char *algo, uint8_t *value,
+				 int *value_len)
+{
+	struct hash_job *job;
+	int i;
+
+	for (i = 0; i < fit_hash_job_count; i++) {
+		job = &fit_hash_jobs[i];
+		if (job->data == data && job->size == size && !job->ret &&
+		    !strcmp(job->algo_name, algo)) {
+			memcpy(value, job->output, job->output_size);
+			*value_len = job->output_size;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+#else
+static bool fit_image_hash_prepare(const void *fit, const int *images,
+				   int count)
+{
+	return false;
+}
+
+static void fit_image_hash_release(void) {}
+
+static int fit_image_hash_lookup(const void *data, size_t size,
+				 const char *algo, uint8_t *value,
+				 int *value_len)
+{
+	return -ENOENT;
+}
+#endif
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 				size_t size, char **err_msgp)
 {
@@ -1326,7 +1451,8 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	if (fit_image_hash_lookup(data, size, algo, value, &value_len) &&
+	    calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1426,6 +1552,8 @@ int fit_image_verify(const void *fit, int image_noffset)
 	const void	*data;
 	size_t		size;
 	char		*err_msg = "";
+	bool		prepared;
+	int		ret;
 
 	if (IS_ENABLED(CONFIG_FIT_SIGNATURE) && strchr(name, '@')) {
 		/*
@@ -1441,8 +1569,14 @@ int fit_image_verify(const void *fit, int image_noffset)
 		goto err;
 	}
 
-	return fit_image_verify_with_data(fit, image_noffset, gd_fdt_blob(),
-					  data, size);
+	/* Calculate several hashes of the image together */
+	prepared = fit_image_hash_prepare(fit, &image_noffset, 1);
+	ret = fit_image_verify_with_data(fit, image_noffset, gd_fdt_blob(),
+					 data, size);
+	if (prepared)
+		fit_image_hash_release();
+
+	return ret;
 
 err:
 	printf("error!\n%s in '%s' image node\n", err_msg,
@@ -1467,6 +1601,9 @@ int fit_all_image_verify(const void *fit)
 	int noffset;
 	int ndepth;
 	int count;
+	int *images = NULL;
+	bool prepared = false;
+	int ret = 1;
 
 	/* Find images parent node offset */
 	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
@@ -1476,6 +1613,20 @@ int fit_all_image_verify(const void *fit)
 		return 0;
 	}
 
+	/* Calculate the hashes of all the images together */
+	if (CONFIG_IS_ENABLED(HASH_PARALLEL)) {
+		count = 0;
+		fdt_for_each_subnode(noffset, fit, images_noffset)
+			count++;
+		images = malloc(count * sizeof(*images));
+		if (images) {
+			count = 0;
+			fdt_for_each_subnode(noffset, fit, images_noffset)
+				images[count++] = noffset;
+			prepared = fit_image_hash_prepare(fit, images, count);
+		}
+	}
+
 	/* Process all image subnodes, check hashes for each */
 	printf("## Checking hash(es) for FIT Image at %08lx ...\n",
 	       (ulong)fit);
@@ -1492,12 +1643,18 @@ int fit_all_image_verify(const void *fit)
 			       fit_get_name(fit, noffset, NULL));
 			count++;
 
-			if (!fit_image_verify(fit, noffset))
-				return 0;
+			if (!fit_image_verify(fit, noffset)) {
+				ret = 0;
+				break;
+			}
 			printf("\n");
 		}
 	}
-	return 1;
+	if (prepared)
+		fit_image_hash_release();
+	free(images);
+
+	return ret;
 }
 
 static int fit_image_uncipher(const void *fit, int image_noffset,
@@ -539,6 +539,36 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return 0;
 }
 
+int image_decomp_stream(int comp, void *load_buf, ulong unc_len,
+			ulong buf_size,
+			long (*read)(void *priv, void *buf, ulong size),
+			void *priv, ulong *lenp)
+{
+	int ret = -EPROTONOSUPPORT;
+	void *buf;
+
+	*lenp = 0;
+	buf = malloc(buf_size);
+	if (!buf)
+		return -ENOMEM;
+
+	switch (comp) {
+	case IH_COMP_GZIP:
+		if (!tools_build() && CONFIG_IS_ENABLED(GZIP))
+			ret = gunzip_stream(load_buf, unc_len, buf, buf_size,
+					    read, priv, lenp);
+		break;
+	case IH_COMP_ZSTD:
+		if (!tools_build() && CONFIG_IS_ENABLED(ZSTD))
+			ret = zstd_decompress_read(load_buf, unc_len, buf,
+						   buf_size, read, priv, lenp);
+		break;
+	}
+	free(buf);
+
+	return ret;
+}
+
 const table_entry_t *get_table_entry(const table_entry_t *table, int id)
 {
 	for (; table->id >= 0; ++table) {
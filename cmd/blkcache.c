@@ -4,6 +4,7 @@
  * Author: Eric Nelson<eric@nelint.com>
  *
  */
+#include <blk.h>
 #include <command.h>
 #include <config.h>
 #include <common.h>
@@ -17,33 +18,74 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
+	       "evictions: %u\n"
 	       "entries: %u\n"
-	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "size: %lu\n"
+	       "max blocks/read: %u\n"
+	       "max size: %lu\n",
+	       stats.hits, stats.partial_hits, stats.misses, stats.evictions,
+	       stats.entries, stats.size, stats.max_blocks_per_entry,
+	       stats.max_size);
 	return 0;
 }
 
 static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 			  int argc, char *const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
+	unsigned blocks_per_read;
+	ulong max_size;
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
-	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	blocks_per_read = simple_strtoul(argv[1], 0, 0);
+	max_size = simple_strtoul(argv[2], 0, 0);
+	blkcache_configure(blocks_per_read, max_size);
+	printf("changed to max of %lu bytes, caching reads of up to %u blocks\n",
+	       max_size, blocks_per_read);
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+static int blkc_readahead(struct cmd_tbl *cmdtp, int flag,
+			  int argc, char *const argv[])
+{
+	struct blk_readahead_stats stats;
+	struct blk_desc *desc;
+	ulong max_size;
+
+	if (argc != 3 && argc != 4)
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_by_str(argv[1], argv[2], &desc) < 0)
+		return CMD_RET_FAILURE;
+
+	if (argc == 4) {
+		max_size = simple_strtoul(argv[3], NULL, 0);
+		if (blk_set_readahead(desc->bdev, max_size))
+			return CMD_RET_FAILURE;
+		return 0;
+	}
+
+	if (blk_get_readahead(desc->bdev, &max_size, &stats))
+		return CMD_RET_FAILURE;
+	printf("max size: %lu\n"
+	       "reads: %lu\n"
+	       "hits: %lu\n"
+	       "device reads: %lu\n",
+	       max_size, stats.reads, stats.hits, stats.dev_reads);
+
+	return 0;
+}
+#endif
+
 static struct cmd_tbl cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
 	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	U_BOOT_CMD_MKENT(readahead, 4, 0, blkc_readahead, "", ""),
+#endif
 };
 
 static int do_blkcache(struct cmd_tbl *cmdtp, int flag,
@@ -67,9 +109,13 @@ static int do_blkcache(struct cmd_tbl *cmdtp, int flag,
 }
 
 U_BOOT_CMD(
-	blkcache, 4, 0, do_blkcache,
+	blkcache, 5, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"blkcache configure <blocks> <size> "
+	"- set max blocks per cached read and max cache size in bytes\n"
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	"blkcache readahead <interface> <dev> [<size>] "
+	"- show and reset read-ahead statistics, or set max read-ahead size\n"
+#endif
 );
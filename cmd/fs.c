@@ -29,9 +29,10 @@ static int do_load_wrapper(struct cmd_tbl *cmdtp, int flag, int argc,
 	return do_load(cmdtp, flag, argc, argv, FS_TYPE_ANY);
 }
 
-U_BOOT_CMD(
-	load,	7,	0,	do_load_wrapper,
-	"load binary file from a filesystem",
+U_BOOT_LONGHELP(load,
+#ifdef CONFIG_FS_LOAD_DECOMP
+	"[-z] "
+#endif
 	"<interface> [<dev[:part]> [<addr> [<filename> [bytes [pos]]]]]\n"
 	"    - Load binary file 'filename' from partition 'part' on device\n"
 	"       type 'interface' instance 'dev' to address 'addr' in memory.\n"
@@ -39,6 +40,16 @@ U_BOOT_CMD(
 	"      If 'bytes' is 0 or omitted, the file is read until the end.\n"
 	"      'pos' gives the file byte position to start reading from.\n"
 	"      If 'pos' is 0 or omitted, the file is read from the start."
+#ifdef CONFIG_FS_LOAD_DECOMP
+	"\n"
+	"      With -z, a gzip or zstd compressed file is decompressed while\n"
+	"      it is read and 'bytes' limits the uncompressed size."
+#endif
+	);
+
+U_BOOT_CMD(
+	load,	8,	0,	do_load_wrapper,
+	"load binary file from a filesystem", load_help_text
 );
 
 static int do_save_wrapper(struct cmd_tbl *cmdtp, int flag, int argc,
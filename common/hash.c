@@ -12,6 +12,8 @@
 #ifndef USE_HOSTCC
 #include <common.h>
 #include <command.h>
+#include <cpu_func.h>
+#include <cyclic.h>
 #include <env.h>
 #include <log.h>
 #include <malloc.h>
@@ -79,6 +81,16 @@ static int __maybe_unused hash_update_sha256(struct hash_algo *algo, void *ctx,
 	return 0;
 }
 
+static int __maybe_unused hash_update_multi_sha256(struct hash_algo *algo,
+						   void *ctx[],
+						   const void *buf[],
+						   int count, uint size)
+{
+	sha256_update_multi((sha256_context **)ctx, (const uint8_t **)buf,
+			    count, size);
+	return 0;
+}
+
 static int __maybe_unused hash_finish_sha256(struct hash_algo *algo, void *ctx,
 					     void *dest_buf, int size)
 {
@@ -166,7 +178,7 @@ static int hash_finish_crc16_ccitt(struct hash_algo *algo, void *ctx,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint16_t *)dest_buf) = *((uint16_t *)ctx);
+	*((uint16_t *)dest_buf) = cpu_to_be16(*((uint16_t *)ctx));
 	free(ctx);
 	return 0;
 }
@@ -193,7 +205,7 @@ static int __maybe_unused hash_finish_crc32(struct hash_algo *algo, void *ctx,
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	*((uint32_t *)dest_buf) = cpu_to_be32(*((uint32_t *)ctx));
 	free(ctx);
 	return 0;
 }
@@ -250,6 +262,9 @@ static struct hash_algo hash_algo[] = {
 #else
 		.hash_init	= hash_init_sha256,
 		.hash_update	= hash_update_sha256,
+#if CONFIG_IS_ENABLED(HASH_PARALLEL) && IS_ENABLED(CONFIG_SHA256_X86_AVX2)
+		.hash_update_multi = hash_update_multi_sha256,
+#endif
 		.hash_finish	= hash_finish_sha256,
 #endif
 	},
@@ -403,6 +418,133 @@ int hash_block(const char *algo_name, const void *data, unsigned int len,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(HASH_PARALLEL)
+/* Hashes the data for a job in one go, without touching the watchdog */
+static void hash_job_update(void *arg)
+{
+	struct hash_job *job = arg;
+
+	job->ret = job->algo->hash_update(job->algo, job->ctx, job->data,
+					  job->size, 1);
+}
+#endif
+
+/* Hashes the data for a job, touching the watchdog after each chunk */
+static void hash_job_update_wd(struct hash_job *job)
+{
+	const uint8_t *data = job->data;
+	uint left = job->size;
+	uint chunk;
+
+	do {
+		chunk = min_t(uint, left, job->algo->chunk_size);
+		job->ret = job->algo->hash_update(job->algo, job->ctx, data,
+						  chunk, chunk == left);
+		data += chunk;
+		left -= chunk;
+		schedule();
+	} while (!job->ret && left);
+}
+
+#if CONFIG_IS_ENABLED(HASH_PARALLEL)
+/* Number of jobs which hash_jobs_update_multi() hashes together */
+#define HASH_MULTI_MAX	8
+
+/*
+ * Hashes jobs which use the same algorithm together, where the algorithm
+ * supports that, touching the watchdog after each chunk. Each group moves
+ * through its data in step, dropping jobs as they finish. Any jobs beyond
+ * HASH_MULTI_MAX form another group.
+ */
+static void hash_jobs_update_multi(struct hash_job **jobs, int count)
+{
+	struct hash_job *group[HASH_MULTI_MAX];
+	const void *buf[HASH_MULTI_MAX];
+	void *ctx[HASH_MULTI_MAX];
+	struct hash_algo *algo;
+	uint offset, chunk;
+	int i, j, n, ret;
+
+	for (i = 0; i < count; i++) {
+		algo = jobs[i]->algo;
+		if (jobs[i]->done || !algo->hash_update_multi)
+			continue;
+		for (j = i, n = 0; j < count && n < HASH_MULTI_MAX; j++) {
+			if (jobs[j]->algo == algo && !jobs[j]->done)
+				group[n++] = jobs[j];
+		}
+		if (n < 2)
+			continue;
+
+		for (offset = 0; n; offset += chunk) {
+			chunk = algo->chunk_size;
+			for (j = 0; j < n; j++) {
+				chunk = min_t(uint, chunk,
+					      group[j]->size - offset);
+				ctx[j] = group[j]->ctx;
+				buf[j] = group[j]->data + offset;
+			}
+			ret = algo->hash_update_multi(algo, ctx, buf, n, chunk);
+			schedule();
+
+			/* Drop jobs which are finished */
+			for (j = 0; j < n; j++) {
+				if (ret)
+					group[j]->ret = ret;
+				if (ret || group[j]->size == offset + chunk) {
+					group[j]->done = true;
+					group[j--] = group[--n];
+				}
+			}
+		}
+	}
+}
+#endif
+
+void hash_calculate_jobs(struct hash_job *jobs, int count)
+{
+	struct hash_job *job;
+	void **args = NULL;
+	int ret, i, n = 0;
+
+	if (CONFIG_IS_ENABLED(HASH_PARALLEL))
+		args = calloc(count, sizeof(*args));
+	for (i = 0; i < count; i++) {
+		job = &jobs[i];
+		job->ctx = NULL;
+		job->done = false;
+		job->ret = hash_progressive_lookup_algo(job->algo_name,
+							&job->algo);
+		if (!job->ret && job->algo->hash_init(job->algo, &job->ctx))
+			job->ret = -ENOMEM;
+		if (!job->ret && args)
+			args[n++] = job;
+	}
+
+	ret = -ENOSYS;
+#if CONFIG_IS_ENABLED(HASH_PARALLEL)
+	if (IS_ENABLED(CONFIG_HAVE_CPU_RUN_PARALLEL) && n > 1)
+		ret = cpu_run_parallel(hash_job_update, args, n);
+	if (ret && n > 1)
+		hash_jobs_update_multi((struct hash_job **)args, n);
+#endif
+	for (i = 0; i < count; i++) {
+		job = &jobs[i];
+		if (!job->ctx)
+			continue;
+		if (ret && !job->done)
+			hash_job_update_wd(job);
+
+		/* The context is freed by hash_update() on error */
+		if (job->ret || job->algo->hash_finish(job->algo, job->ctx,
+						       job->output,
+						       sizeof(job->output)))
+			job->ret = -EIO;
+		job->output_size = job->algo->digest_size;
+	}
+	free(args);
+}
+
 #if !defined(CONFIG_SPL_BUILD) && (defined(CONFIG_CMD_HASH) || \
 	defined(CONFIG_CMD_SHA1SUM) || defined(CONFIG_CMD_CRC32))
 /**
@@ -8,10 +8,13 @@
 
 #include <common.h>
 #include <blk.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
+#include <time.h>
+#include <asm/cache.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -318,6 +321,49 @@ int blk_show_device(enum uclass_id uclass_id, int devnum)
 	return 0;
 }
 
+/*
+ * Synchronous access must not overlap with asynchronous requests, since
+ * drivers generally share their hardware queue between the two
+ */
+static void blk_async_sync(struct udevice *dev)
+{
+	struct blk_uclass_priv *priv = dev_get_uclass_priv(dev);
+
+	if (CONFIG_IS_ENABLED(BLK_ASYNC) && priv && priv->inflight)
+		blk_drain(dev);
+}
+
+static struct blk_readahead *blk_get_readahead_priv(struct udevice *dev)
+{
+	struct blk_uclass_priv *priv = dev_get_uclass_priv(dev);
+
+	/* the device may be in use before it is probed */
+	return priv ? &priv->ra : NULL;
+}
+
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+static void blk_readahead_invalidate(struct udevice *dev)
+{
+	struct blk_readahead *ra = blk_get_readahead_priv(dev);
+
+	if (ra) {
+		ra->count = 0;
+		ra->seq = 0;
+	}
+}
+
+#else
+static inline void blk_readahead_invalidate(struct udevice *dev) {}
+#endif
+
+/* Incremented whenever the contents of a block device may have changed */
+static ulong blk_generation;
+
+ulong blk_get_generation(void)
+{
+	return blk_generation;
+}
+
 int blk_select_hwpart(struct udevice *dev, int hwpart)
 {
 	const struct blk_ops *ops = blk_get_ops(dev);
@@ -326,6 +372,8 @@ int blk_select_hwpart(struct udevice *dev, int hwpart)
 		return -ENOSYS;
 	if (!ops->select_hwpart)
 		return 0;
+	blk_readahead_invalidate(dev);
+	blk_generation++;
 
 	return ops->select_hwpart(dev, hwpart);
 }
@@ -428,18 +476,14 @@ static int blk_buffer_aligned(struct bounce_buffer *state)
 	return 1;	/* Default, any buffer is OK */
 }
 
-long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
+/* Read blocks from the device, using a bounce buffer if needed */
+static long blk_read_dev(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			 void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
-	ulong blks_read;
-
-	if (!ops->read)
-		return -ENOSYS;
-
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
-		return blkcnt;
+	struct blk_readahead *ra = blk_get_readahead_priv(dev);
+	long blks_read;
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -452,31 +496,176 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 		if (ret)
 			return ret;
 
-		blks_read = ops->read(dev, start, blkcnt, bbstate.state.bounce_buffer);
+		blks_read = ops->read(dev, start, blkcnt,
+				      bbstate.state.bounce_buffer);
 
 		bounce_buffer_stop(&bbstate.state);
 	} else {
 		blks_read = ops->read(dev, start, blkcnt, buf);
 	}
-
-	if (blks_read == blkcnt)
-		blkcache_fill(desc->uclass_id, desc->devnum, start, blkcnt,
-			      desc->blksz, buf);
+	if (CONFIG_IS_ENABLED(BLK_READAHEAD) && ra)
+		ra->stats.dev_reads++;
 
 	return blks_read;
 }
 
-long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
-	       const void *buf)
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+/*
+ * Number of back-to-back sequential reads needed before read-ahead starts,
+ * so that random access (e.g. directory lookups) goes straight to the device
+ */
+#define BLK_RA_TRIGGER		2
+
+int blk_set_readahead(struct udevice *dev, ulong max_size)
+{
+	struct blk_readahead *ra = blk_get_readahead_priv(dev);
+
+	if (!ra)
+		return -ENODEV;
+	blk_readahead_invalidate(dev);
+	free(ra->buf);
+	ra->buf = NULL;
+	ra->max_size = max_size;
+
+	return 0;
+}
+
+int blk_get_readahead(struct udevice *dev, ulong *max_sizep,
+		      struct blk_readahead_stats *stats)
+{
+	struct blk_readahead *ra = blk_get_readahead_priv(dev);
+
+	if (!ra)
+		return -ENODEV;
+	*max_sizep = ra->max_size;
+	if (stats) {
+		*stats = ra->stats;
+		memset(&ra->stats, '\0', sizeof(ra->stats));
+	}
+
+	return 0;
+}
+
+/*
+ * blk_read_ahead() - Read blocks, prefetching more if access is sequential
+ *
+ * Once a few reads have followed on from each other, a miss reads a window
+ * of blocks into the read-ahead buffer. The window doubles each time it is
+ * used, up to the maximum set for the device. Later reads are copied from
+ * that buffer instead of going to the device.
+ */
+static long blk_read_ahead(struct udevice *dev, lbaint_t start,
+			   lbaint_t blkcnt, void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	struct blk_readahead *ra = blk_get_readahead_priv(dev);
+	lbaint_t max_blks, done = 0, count;
+	long ret;
+
+	max_blks = ra ? ra->max_size / desc->blksz : 0;
+	if (!max_blks)
+		return blk_read_dev(dev, start, blkcnt, buf);
+
+	ra->stats.reads++;
+	if (start == ra->next && ra->window) {
+		ra->seq++;
+	} else {
+		ra->seq = 0;
+		ra->window = min_t(lbaint_t, max_blks,
+				   CONFIG_BLK_READAHEAD_MIN_SIZE / desc->blksz);
+	}
+	ra->next = start + blkcnt;
+
+	/* serve what we can from the read-ahead buffer */
+	if (ra->count && start >= ra->start &&
+	    start < ra->start + ra->count) {
+		done = min(blkcnt, ra->start + ra->count - start);
+		memcpy(buf, ra->buf + (start - ra->start) * desc->blksz,
+		       done * desc->blksz);
+		ra->stats.hits++;
+		if (done == blkcnt)
+			return blkcnt;
+	}
+	start += done;
+	buf += done * desc->blksz;
+	count = blkcnt - done;
+
+	/* read ahead, unless this is random access or already large enough */
+	if (ra->seq >= BLK_RA_TRIGGER && count < ra->window) {
+		lbaint_t window = min(ra->window, desc->lba - start);
+
+		if (!ra->buf)
+			ra->buf = memalign(ARCH_DMA_MINALIGN,
+					   max_blks * desc->blksz);
+		if (ra->buf && window > count) {
+			ra->count = 0;
+			ret = blk_read_dev(dev, start, window, ra->buf);
+			if (!IS_ERR_VALUE(ret) && ret >= count) {
+				log_debug("read-ahead: start " LBAF ", count %lx\n",
+					  start, ret);
+				ra->start = start;
+				ra->count = ret;
+				memcpy(buf, ra->buf, count * desc->blksz);
+				ra->window = min(ra->window * 2, max_blks);
+
+				return blkcnt;
+			}
+		}
+	}
+
+	ret = blk_read_dev(dev, start, count, buf);
+	if (ra->seq >= BLK_RA_TRIGGER)
+		ra->window = min(ra->window * 2, max_blks);
+	if (IS_ERR_VALUE(ret))
+		return done ? done : ret;
+
+	return done + ret;
+}
+#else
+static long blk_read_ahead(struct udevice *dev, lbaint_t start,
+			   lbaint_t blkcnt, void *buf)
+{
+	return blk_read_dev(dev, start, blkcnt, buf);
+}
+#endif /* BLK_READAHEAD */
+
+long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
-	long blks_written;
+	lbaint_t head, tail, count;
+	long blks_read;
 
-	if (!ops->write)
+	if (!ops->read)
 		return -ENOSYS;
 
-	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_async_sync(dev);
+
+	/* Only the blocks between the cached head and tail need reading */
+	head = blkcache_read_partial(desc->uclass_id, desc->devnum, start,
+				     blkcnt, desc->blksz, buf, &tail);
+	if (head == blkcnt)
+		return blkcnt;
+	count = blkcnt - head - tail;
+
+	blks_read = blk_read_ahead(dev, start + head, count,
+				   buf + head * desc->blksz);
+	if (blks_read != count)
+		return IS_ERR_VALUE(blks_read) ? blks_read : head + blks_read;
+
+	blkcache_fill(desc->uclass_id, desc->devnum, start, blkcnt,
+		      desc->blksz, buf);
+
+	return blkcnt;
+}
+
+/* Write blocks to the device, using a bounce buffer if needed */
+static long blk_write_dev(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt, const void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	long blks_written;
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -500,6 +689,23 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	return blks_written;
 }
 
+long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+	       const void *buf)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (!ops->write)
+		return -ENOSYS;
+
+	blk_async_sync(dev);
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_readahead_invalidate(dev);
+	blk_generation++;
+
+	return blk_write_dev(dev, start, blkcnt, buf);
+}
+
 long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
@@ -508,11 +714,176 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 	if (!ops->erase)
 		return -ENOSYS;
 
+	blk_async_sync(dev);
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_readahead_invalidate(dev);
+	blk_generation++;
 
 	return ops->erase(dev, start, blkcnt);
 }
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+/* Time to wait for asynchronous requests before giving up */
+#define BLK_ASYNC_TIMEOUT_MS	30000
+
+void blk_request_done(struct blk_request *req, long result)
+{
+	struct blk_uclass_priv *priv = dev_get_uclass_priv(req->dev);
+
+	req->result = result;
+	priv->inflight--;
+	list_add_tail(&req->sibling, &priv->done_list);
+}
+
+int blk_poll(struct udevice *dev)
+{
+	struct blk_uclass_priv *priv = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_request *req;
+	int ret;
+
+	if (!priv)
+		return -ENODEV;
+
+	if (priv->inflight && ops->poll) {
+		ret = ops->poll(dev);
+		if (ret < 0)
+			return log_msg_ret("pol", ret);
+	}
+
+	/* a callback may submit another request, which can complete here */
+	while (!list_empty(&priv->done_list)) {
+		req = list_first_entry(&priv->done_list, struct blk_request,
+				       sibling);
+		list_del(&req->sibling);
+		req->done = true;
+		if (req->complete)
+			req->complete(req);
+	}
+
+	return priv->inflight;
+}
+
+int blk_submit(struct blk_request *req)
+{
+	struct udevice *dev = req->dev;
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	struct blk_uclass_priv *priv = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	bool write = req->op == BLK_REQ_WRITE;
+	ulong start;
+	long result;
+	int ret;
+
+	if (!priv)
+		return -ENODEV;
+	if (write ? !ops->write : !ops->read)
+		return -ENOSYS;
+
+	req->done = false;
+	req->result = 0;
+	req->pending = 0;
+	req->error = 0;
+	if (write) {
+		blkcache_invalidate(desc->uclass_id, desc->devnum);
+		blk_readahead_invalidate(dev);
+		blk_generation++;
+	}
+
+	start = get_timer(0);
+	while (priv->inflight >= priv->queue_depth) {
+		ret = blk_poll(dev);
+		if (ret < 0)
+			return ret;
+		if (get_timer(start) > BLK_ASYNC_TIMEOUT_MS)
+			return log_msg_ret("ful", -ETIMEDOUT);
+		schedule();
+	}
+
+	ret = -ENOSYS;
+	if (ops->submit) {
+		priv->inflight++;
+		while (ret = ops->submit(dev, req), ret == -EAGAIN) {
+			/* the hardware queue is full, so wait for space */
+			if (ops->poll)
+				ops->poll(dev);
+			if (get_timer(start) > BLK_ASYNC_TIMEOUT_MS) {
+				ret = -ETIMEDOUT;
+				break;
+			}
+			schedule();
+		}
+		if (ret)
+			priv->inflight--;
+	}
+	if (ret != -ENOSYS)
+		return ret;
+
+	/* the driver's synchronous path expects its queue to be idle */
+	while (priv->inflight) {
+		if (ops->poll)
+			ops->poll(dev);
+		if (get_timer(start) > BLK_ASYNC_TIMEOUT_MS)
+			return log_msg_ret("idl", -ETIMEDOUT);
+		schedule();
+	}
+
+	/* carry out the request now; the callback still runs from blk_poll() */
+	priv->inflight++;
+	if (write)
+		result = blk_write_dev(dev, req->start, req->blkcnt, req->buf);
+	else
+		result = blk_read_dev(dev, req->start, req->blkcnt, req->buf);
+	blk_request_done(req, result);
+
+	return 0;
+}
+
+long blk_wait(struct blk_request *req)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+	while (!req->done) {
+		ret = blk_poll(req->dev);
+		if (ret < 0)
+			return ret;
+		if (!req->done && get_timer(start) > BLK_ASYNC_TIMEOUT_MS)
+			return log_msg_ret("wai", -ETIMEDOUT);
+		schedule();
+	}
+
+	return req->result;
+}
+
+int blk_drain(struct udevice *dev)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+	while (ret = blk_poll(dev), ret > 0) {
+		if (get_timer(start) > BLK_ASYNC_TIMEOUT_MS)
+			return log_msg_ret("drn", -ETIMEDOUT);
+		schedule();
+	}
+
+	return ret == -ENODEV ? 0 : ret;
+}
+
+int blk_set_queue_depth(struct udevice *dev, uint depth)
+{
+	struct blk_uclass_priv *priv = dev_get_uclass_priv(dev);
+
+	if (!priv)
+		return -ENODEV;
+	if (!depth)
+		return -EINVAL;
+	priv->queue_depth = depth;
+
+	return 0;
+}
+#endif /* BLK_ASYNC */
+
 ulong blk_dread(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
 		void *buffer)
 {
@@ -848,6 +1219,36 @@ static int blk_post_probe(struct udevice *dev)
 			debug("*** creating partitions failed\n");
 	}
 
+	if (CONFIG_IS_ENABLED(BLK_READAHEAD)) {
+		struct blk_readahead *ra = blk_get_readahead_priv(dev);
+
+		ra->max_size = CONFIG_IF_ENABLED_INT(BLK_READAHEAD,
+						     BLK_READAHEAD_SIZE);
+	}
+
+	if (CONFIG_IS_ENABLED(BLK_ASYNC)) {
+		struct blk_uclass_priv *priv = dev_get_uclass_priv(dev);
+
+		priv->queue_depth = CONFIG_IF_ENABLED_INT(BLK_ASYNC,
+							  BLK_ASYNC_QUEUE_DEPTH);
+		INIT_LIST_HEAD(&priv->done_list);
+	}
+
+	return 0;
+}
+
+static int blk_pre_remove(struct udevice *dev)
+{
+	blk_async_sync(dev);
+	blk_generation++;
+
+	if (CONFIG_IS_ENABLED(BLK_READAHEAD)) {
+		struct blk_readahead *ra = blk_get_readahead_priv(dev);
+
+		free(ra->buf);
+		ra->buf = NULL;
+	}
+
 	return 0;
 }
 
@@ -855,5 +1256,9 @@ UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
+#if CONFIG_IS_ENABLED(BLK_READAHEAD) || CONFIG_IS_ENABLED(BLK_ASYNC)
+	.per_device_auto	= sizeof(struct blk_uclass_priv),
+#endif
 };
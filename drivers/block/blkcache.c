@@ -13,35 +13,52 @@
 #include <linux/ctype.h>
 #include <linux/list.h>
 
+/*
+ * The cache holds individual blocks. Each one is found through a hash table
+ * keyed on (iftype, devnum, block) and is also kept on an LRU list, so that
+ * the least-recently used block can be dropped when the memory budget is
+ * reached.
+ */
+#define BLKCACHE_HASH_BITS	8
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
 struct block_cache_node {
+	struct hlist_node hn;
 	struct list_head lh;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t blk;
 	unsigned long blksz;
-	char *cache;
+	char cache[];
 };
 
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
 static LIST_HEAD(block_cache);
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_blocks_per_entry = CONFIG_BLOCK_CACHE_MAX_BLOCKS,
+	.max_size = CONFIG_BLOCK_CACHE_SIZE,
 };
 
+static uint cache_hash(int iftype, int devnum, lbaint_t blk)
+{
+	u64 key = (u64)blk ^ ((u64)iftype << 56) ^ ((u64)devnum << 48);
+
+	/* fold to 32 bits and use the golden-ratio multiplier */
+	return ((u32)(key ^ (key >> 32)) * 0x9e370001U) >>
+		(32 - BLKCACHE_HASH_BITS);
+}
+
 static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+					   lbaint_t blk, unsigned long blksz)
 {
+	struct hlist_head *head;
 	struct block_cache_node *node;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+	head = &block_cache_hash[cache_hash(iftype, devnum, blk)];
+	hlist_for_each_entry(node, head, hn) {
+		if (node->blk == blk && node->devnum == devnum &&
+		    node->iftype == iftype && node->blksz == blksz) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
 				list_del(&node->lh);
@@ -49,120 +66,181 @@ static struct block_cache_node *cache_find(int iftype, int devnum,
 			}
 			return node;
 		}
-	return 0;
+	}
+
+	return NULL;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+static void cache_drop(struct block_cache_node *node)
+{
+	hlist_del(&node->hn);
+	list_del(&node->lh);
+	_stats.entries--;
+	_stats.size -= node->blksz;
+	free(node);
+}
+
+/* Copy the cached block @blk to @buffer, returning true on a hit */
+static bool cache_copy(int iftype, int devnum, lbaint_t blk,
+		       unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
+	struct block_cache_node *node;
+
+	node = cache_find(iftype, devnum, blk, blksz);
+	if (!node)
+		return false;
+	memcpy(buffer, node->cache, blksz);
+
+	return true;
+}
+
+lbaint_t blkcache_read_partial(int iftype, int devnum,
+			       lbaint_t start, lbaint_t blkcnt,
+			       unsigned long blksz, void *buffer,
+			       lbaint_t *tailp)
+{
+	char *buf = buffer;
+	lbaint_t head, tail;
+
+	*tailp = 0;
+	if (!_stats.entries) {
+		++_stats.misses;
+		return 0;
+	}
+
+	for (head = 0; head < blkcnt; head++) {
+		if (!cache_copy(iftype, devnum, start + head, blksz,
+				buf + head * blksz))
+			break;
+	}
+	if (head == blkcnt) {
 		debug("hit: start " LBAF ", count " LBAFU "\n",
 		      start, blkcnt);
 		++_stats.hits;
-		return 1;
+		return head;
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	/* the block at @head is missing, so look at the end of the request */
+	for (tail = 0; tail < blkcnt - head - 1; tail++) {
+		lbaint_t blk = blkcnt - tail - 1;
+
+		if (!cache_copy(iftype, devnum, start + blk, blksz,
+				buf + blk * blksz))
+			break;
+	}
+
+	if (head || tail) {
+		debug("partial: start " LBAF ", count " LBAFU ", head " LBAFU
+		      ", tail " LBAFU "\n", start, blkcnt, head, tail);
+		++_stats.partial_hits;
+	} else {
+		debug("miss: start " LBAF ", count " LBAFU "\n",
+		      start, blkcnt);
+		++_stats.misses;
+	}
+	*tailp = tail;
+
+	return head;
+}
+
+int blkcache_read(int iftype, int devnum,
+		  lbaint_t start, lbaint_t blkcnt,
+		  unsigned long blksz, void *buffer)
+{
+	lbaint_t tail;
+
+	return blkcache_read_partial(iftype, devnum, start, blkcnt, blksz,
+				     buffer, &tail) == blkcnt;
 }
 
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
+	const char *buf = buffer;
 	struct block_cache_node *node;
+	struct hlist_head *head;
+	lbaint_t i;
 
 	/* don't cache big stuff */
 	if (blkcnt > _stats.max_blocks_per_entry)
 		return;
 
-	if (_stats.max_entries == 0)
+	if (blksz > _stats.max_size)
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
+	debug("fill: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+
+	for (i = 0; i < blkcnt; i++, buf += blksz) {
+		lbaint_t blk = start + i;
+
+		node = cache_find(iftype, devnum, blk, blksz);
+		if (node) {
+			memcpy(node->cache, buf, blksz);
+			continue;
 		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
+		while (_stats.size + blksz > _stats.max_size) {
+			/* pop LRU */
+			node = list_last_entry(&block_cache,
+					       struct block_cache_node, lh);
+			debug("drop: blk " LBAF "\n", node->blk);
+			cache_drop(node);
+			_stats.evictions++;
 		}
-	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+		node = malloc(sizeof(*node) + blksz);
+		if (!node)
+			return;
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+		node->iftype = iftype;
+		node->devnum = devnum;
+		node->blk = blk;
+		node->blksz = blksz;
+		memcpy(node->cache, buf, blksz);
+		head = &block_cache_hash[cache_hash(iftype, devnum, blk)];
+		hlist_add_head(&node->hn, head);
+		list_add(&node->lh, &block_cache);
+		_stats.entries++;
+		_stats.size += blksz;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if (iftype == -1 ||
-		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
+		    (node->iftype == iftype && node->devnum == devnum))
+			cache_drop(node);
 	}
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, ulong size)
 {
 	/* invalidate cache if there is a change */
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
+	    (size != _stats.max_size))
 		blkcache_invalidate(-1, 0);
 
 	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	_stats.max_size = size;
 
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
 {
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
+	_stats.partial_hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_free(void)
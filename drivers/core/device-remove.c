@@ -232,9 +232,14 @@ int device_remove(struct udevice *dev, uint flags)
 		return ret;
 	}
 
-	ret = uclass_pre_remove_device(dev);
-	if (ret)
-		return ret;
+	/* The uclass has not seen a device whose probe is still waiting */
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_LATER) {
+		device_probe_later_cancel(dev);
+	} else {
+		ret = uclass_pre_remove_device(dev);
+		if (ret)
+			return ret;
+	}
 
 	if (drv->remove) {
 		ret = drv->remove(dev);
@@ -10,8 +10,10 @@
 
 #include <common.h>
 #include <cpu_func.h>
+#include <cyclic.h>
 #include <event.h>
 #include <log.h>
+#include <time.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <clk.h>
@@ -478,6 +480,47 @@ static int device_get_dma_constraints(struct udevice *dev)
 	return 0;
 }
 
+/**
+ * device_probe_finish() - Finish probing a device
+ *
+ * This tells the uclass about a device once its driver's probe() method has
+ * finished, and removes the device again on error.
+ *
+ * @dev: Pointer to device being probed
+ * Return: 0 if OK, -ve on error
+ */
+static int device_probe_finish(struct udevice *dev)
+{
+	int ret;
+
+	ret = uclass_post_probe_device(dev);
+	if (ret)
+		goto fail;
+
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL) {
+		ret = pinctrl_select_state(dev, "default");
+		if (ret && ret != -ENOSYS)
+			log_debug("Device '%s' failed to configure default pinctrl: %d (%s)\n",
+				  dev->name, ret, errno_str(ret));
+	}
+
+	ret = device_notify(dev, EVT_DM_POST_PROBE);
+	if (ret)
+		goto fail;
+
+	return 0;
+fail:
+	if (device_remove(dev, DM_REMOVE_NORMAL)) {
+		dm_warn("%s: Device '%s' failed to remove on error path\n",
+			__func__, dev->name);
+	}
+	dev_bic_flags(dev, DM_FLAG_ACTIVATED);
+
+	device_free(dev);
+
+	return ret;
+}
+
 int device_probe(struct udevice *dev)
 {
 	const struct driver *drv;
@@ -486,6 +529,9 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_LATER)
+		return device_probe_later_wait(dev);
+
 	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
 		return 0;
 
@@ -586,28 +632,11 @@ int device_probe(struct udevice *dev)
 			goto fail;
 	}
 
-	ret = uclass_post_probe_device(dev);
-	if (ret)
-		goto fail_uclass;
-
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL) {
-		ret = pinctrl_select_state(dev, "default");
-		if (ret && ret != -ENOSYS)
-			log_debug("Device '%s' failed to configure default pinctrl: %d (%s)\n",
-				  dev->name, ret, errno_str(ret));
-	}
-
-	ret = device_notify(dev, EVT_DM_POST_PROBE);
-	if (ret)
-		goto fail_event;
+	/* The driver has called device_probe_later() */
+	if (dev_get_flags(dev) & DM_FLAG_PROBE_LATER)
+		return 0;
 
-	return 0;
-fail_event:
-fail_uclass:
-	if (device_remove(dev, DM_REMOVE_NORMAL)) {
-		dm_warn("%s: Device '%s' failed to remove on error path\n",
-			__func__, dev->name);
-	}
+	return device_probe_finish(dev);
 fail:
 	dev_bic_flags(dev, DM_FLAG_ACTIVATED);
 
@@ -616,6 +645,190 @@ fail:
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(DM_PROBE_LATER)
+/**
+ * struct probe_later - A device whose probe is waiting to finish
+ *
+ * @sibling: Next entry in probe_later_list
+ * @dev: Device being probed
+ * @poll: Function to check whether the device is ready
+ * @start: Time when the wait started, from get_timer()
+ * @timeout_ms: Time allowed for the wait
+ * @round: Last call to device_probe_later_poll() which checked this entry
+ */
+struct probe_later {
+	struct list_head sibling;
+	struct udevice *dev;
+	int (*poll)(struct udevice *dev);
+	ulong start;
+	ulong timeout_ms;
+	uint round;
+};
+
+static LIST_HEAD(probe_later_list);
+
+/* Number of calls to device_probe_later_poll() */
+static uint probe_later_round;
+
+/* Number of device_probe_later_begin() calls not yet ended */
+static int probe_later_depth;
+
+static struct probe_later *probe_later_find(struct udevice *dev)
+{
+	struct probe_later *entry;
+
+	list_for_each_entry(entry, &probe_later_list, sibling) {
+		if (entry->dev == dev)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Returns -EAGAIN if the device is still waiting, else the result */
+static int probe_later_check(struct probe_later *entry)
+{
+	int ret;
+
+	ret = entry->poll(entry->dev);
+	if (ret == -EAGAIN && get_timer(entry->start) > entry->timeout_ms)
+		ret = -ETIMEDOUT;
+
+	return ret;
+}
+
+/* Finishes probing a device once it is ready, or drops it on error */
+static int probe_later_done(struct probe_later *entry, int ret)
+{
+	struct udevice *dev = entry->dev;
+
+	list_del(&entry->sibling);
+	free(entry);
+
+	if (ret) {
+		dm_warn("%s: Device '%s' failed to finish probing: %d\n",
+			__func__, dev->name, ret);
+		if (device_remove(dev, DM_REMOVE_NORMAL)) {
+			dm_warn("%s: Device '%s' failed to remove on error path\n",
+				__func__, dev->name);
+		}
+		dev_bic_flags(dev, DM_FLAG_PROBE_LATER | DM_FLAG_ACTIVATED);
+		device_free(dev);
+
+		return ret;
+	}
+	dev_bic_flags(dev, DM_FLAG_PROBE_LATER);
+
+	return device_probe_finish(dev);
+}
+
+void device_probe_later_begin(void)
+{
+	if (gd->flags & GD_FLG_RELOC)
+		probe_later_depth++;
+}
+
+void device_probe_later_end(void)
+{
+	if (!(gd->flags & GD_FLG_RELOC) || !probe_later_depth)
+		return;
+
+	if (--probe_later_depth)
+		return;
+	while (!list_empty(&probe_later_list)) {
+		device_probe_later_poll();
+		schedule();
+	}
+}
+
+void device_probe_later_poll(void)
+{
+	struct probe_later *entry;
+	int ret;
+
+	probe_later_round++;
+restart:
+	list_for_each_entry(entry, &probe_later_list, sibling) {
+		if (entry->round == probe_later_round)
+			continue;
+		entry->round = probe_later_round;
+		ret = probe_later_check(entry);
+		if (ret != -EAGAIN) {
+			probe_later_done(entry, ret);
+
+			/* Finishing the probe may have changed the list */
+			goto restart;
+		}
+	}
+}
+
+int device_probe_later_wait(struct udevice *dev)
+{
+	struct probe_later *entry;
+	int ret;
+
+	entry = probe_later_find(dev);
+	if (!entry) {
+		dev_bic_flags(dev, DM_FLAG_PROBE_LATER);
+		return 0;
+	}
+	for (;;) {
+		ret = probe_later_check(entry);
+		if (ret != -EAGAIN)
+			return probe_later_done(entry, ret);
+		schedule();
+	}
+}
+
+void device_probe_later_cancel(struct udevice *dev)
+{
+	struct probe_later *entry;
+
+	entry = probe_later_find(dev);
+	if (entry) {
+		list_del(&entry->sibling);
+		free(entry);
+	}
+	dev_bic_flags(dev, DM_FLAG_PROBE_LATER);
+}
+#endif
+
+int device_probe_later(struct udevice *dev, int (*poll)(struct udevice *dev),
+		       ulong timeout_ms)
+{
+	ulong start = get_timer(0);
+	int ret;
+
+#if CONFIG_IS_ENABLED(DM_PROBE_LATER)
+	if ((gd->flags & GD_FLG_RELOC) && probe_later_depth) {
+		struct probe_later *entry;
+
+		entry = malloc(sizeof(*entry));
+		if (entry) {
+			entry->dev = dev;
+			entry->poll = poll;
+			entry->start = start;
+			entry->timeout_ms = timeout_ms;
+			entry->round = probe_later_round;
+			list_add_tail(&entry->sibling, &probe_later_list);
+			dev_or_flags(dev, DM_FLAG_PROBE_LATER);
+
+			return 0;
+		}
+	}
+#endif
+
+	/* Nothing else can run, so wait here */
+	for (;;) {
+		ret = poll(dev);
+		if (ret != -EAGAIN)
+			return ret;
+		if (get_timer(start) > timeout_ms)
+			return -ETIMEDOUT;
+		schedule();
+	}
+}
+
 void *dev_get_plat(const struct udevice *dev)
 {
 	if (!dev) {
@@ -1144,6 +1357,7 @@ int device_set_name(struct udevice *dev, const char *name)
 	if (!name)
 		return -ENOMEM;
 	dev->name = name;
+	uclass_index_update(dev);
 	device_set_name_alloced(dev);
 
 	return 0;
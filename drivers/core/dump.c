@@ -356,4 +356,8 @@ void dm_dump_mem(struct dm_stats *stats)
 	/* Drop the device name */
 	printf("Drop device name (not SRAM): %x (%d)\n", stats->dev_name_size,
 	       stats->dev_name_size);
+	printf("\n");
+
+	printf("Phandle lookups: %x, found in table: %x\n",
+	       stats->phandle_lookups, stats->phandle_hits);
 }
@@ -18,7 +18,12 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -181,11 +186,166 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct compat_index_entry - slot in the hash table of compatible strings
+ *
+ * @hash: hash of the compatible string, 0 if the slot is empty
+ * @drv: index of the driver in the driver linker list
+ * @id: index of the string in the of_match table of the driver
+ */
+struct compat_index_entry {
+	u32 hash;
+	u16 drv;
+	u16 id;
+};
+
+static struct compat_index_entry *compat_index;
+static uint compat_index_mask;
+static bool compat_index_failed;
+
+static u32 compat_hash(const char *compat)
+{
+	u32 hash = 2166136261U;
+
+	while (*compat)
+		hash = (hash ^ (u8)*compat++) * 16777619U;
+
+	return hash ?: 1;
+}
+
+static const char *compat_index_str(const struct compat_index_entry *ent)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+
+	return driver[ent->drv].of_match[ent->id].compatible;
+}
+
+/*
+ * Build a hash table mapping each compatible string to the first driver in
+ * the linker list which matches it, which is the one the linear scan finds
+ */
+static int compat_index_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_index_entry *ent;
+	uint count = 0, size, slot;
+	u32 hash;
+	int i;
+
+	for (i = 0; i < n_ents; i++) {
+		for (id = driver[i].of_match; id && id->compatible; id++)
+			count++;
+	}
+	if (n_ents > U16_MAX || !count)
+		return -E2BIG;
+
+	/* Keep the table at most half full so that probe chains are short */
+	size = roundup_pow_of_two(count * 2);
+	compat_index = calloc(size, sizeof(*compat_index));
+	if (!compat_index)
+		return -ENOMEM;
+	compat_index_mask = size - 1;
+
+	for (i = 0; i < n_ents; i++) {
+		for (id = driver[i].of_match; id && id->compatible; id++) {
+			hash = compat_hash(id->compatible);
+			for (slot = hash & compat_index_mask;
+			     compat_index[slot].hash;
+			     slot = (slot + 1) & compat_index_mask) {
+				ent = &compat_index[slot];
+				if (ent->hash == hash &&
+				    !strcmp(compat_index_str(ent), id->compatible))
+					break;
+			}
+			ent = &compat_index[slot];
+			if (ent->hash)
+				continue;
+			ent->hash = hash;
+			ent->drv = i;
+			ent->id = id - driver[i].of_match;
+		}
+	}
+	log_debug("Indexed %u compatible strings in %u slots\n", count, size);
+
+	return 0;
+}
+
+/**
+ * compat_index_find() - Look up a compatible string in the index
+ *
+ * The index is built on first use after relocation, when memory is plentiful.
+ * Before that, or if it cannot be built, the caller must scan the drivers.
+ *
+ * @compat: Compatible string to look up
+ * @drvp: Returns the matching driver, or NULL if none
+ * @idp: Returns the matching entry in the driver's of_match table
+ * Return: true if the index was used, false if there is none
+ */
+static bool compat_index_find(const char *compat, struct driver **drvp,
+			      const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	struct compat_index_entry *ent;
+	uint slot;
+	u32 hash;
+
+	if (!(gd->flags & GD_FLG_RELOC))
+		return false;
+	if (!compat_index) {
+		if (compat_index_failed)
+			return false;
+		if (compat_index_build()) {
+			compat_index_failed = true;
+			return false;
+		}
+	}
+
+	*drvp = NULL;
+	hash = compat_hash(compat);
+	for (slot = hash & compat_index_mask; compat_index[slot].hash;
+	     slot = (slot + 1) & compat_index_mask) {
+		ent = &compat_index[slot];
+		if (ent->hash == hash && !strcmp(compat_index_str(ent), compat)) {
+			*drvp = &driver[ent->drv];
+			*idp = &(*drvp)->of_match[ent->id];
+			break;
+		}
+	}
+
+	return true;
+}
+#else
+static bool compat_index_find(const char *compat, struct driver **drvp,
+			      const struct udevice_id **idp)
+{
+	return false;
+}
+#endif
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+	if (compat_index_find(compat, &entry, idp))
+		return entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -223,20 +383,16 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
+		if (drv) {
+			entry = drv;
+			if (drv->of_match &&
+			    driver_check_compatible(drv->of_match, &id, compat))
+				continue;
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			if (!entry)
+				continue;
 		}
-		if (entry == driver + n_ents)
-			continue;
 
 		if (pre_reloc_only) {
 			if (!ofnode_pre_reloc(node) &&
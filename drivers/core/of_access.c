@@ -29,6 +29,7 @@
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/list.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -445,19 +446,139 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 	return np;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+/**
+ * struct of_phandle_table - Nodes of a live tree, indexed by phandle
+ *
+ * @sibling: Next table in the list
+ * @root: Root node of the tree
+ * @count: Number of entries in @nodes, one more than the largest phandle
+ * @nodes: Node with each phandle, or NULL if none
+ */
+struct of_phandle_table {
+	struct list_head sibling;
+	struct device_node *root;
+	uint count;
+	struct device_node *nodes[];
+};
+
+static LIST_HEAD(of_phandle_tables);
+static uint of_phandle_lookups;
+static uint of_phandle_hits;
+
+int of_phandle_table_build(struct device_node *root)
+{
+	struct of_phandle_table *table;
+	struct device_node *np;
+	uint max = 0, count = 0;
+
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->phandle) {
+			max = max_t(uint, max, np->phandle);
+			count++;
+		}
+	}
+
+	/* dtc numbers phandles from 1, so only skip unusually sparse ones */
+	if (!count || max > 4 * count + 16)
+		return 0;
+
+	table = calloc(1, sizeof(*table) + (max + 1) * sizeof(np));
+	if (!table)
+		return -ENOMEM;
+	table->root = root;
+	table->count = max + 1;
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->phandle && !table->nodes[np->phandle])
+			table->nodes[np->phandle] = np;
+	}
+	list_add(&table->sibling, &of_phandle_tables);
+
+	return 0;
+}
+
+void of_phandle_table_free(struct device_node *root)
+{
+	struct of_phandle_table *table;
+
+	list_for_each_entry(table, &of_phandle_tables, sibling) {
+		if (table->root == root) {
+			list_del(&table->sibling);
+			free(table);
+			return;
+		}
+	}
+}
+
+void of_phandle_stats(uint *lookupsp, uint *hitsp)
+{
+	*lookupsp = of_phandle_lookups;
+	*hitsp = of_phandle_hits;
+}
+
+static struct of_phandle_table *of_phandle_table_get(struct device_node *root)
+{
+	struct of_phandle_table *table;
+
+	if (!root)
+		root = gd->of_root;
+	list_for_each_entry(table, &of_phandle_tables, sibling) {
+		if (table->root == root)
+			return table;
+	}
+
+	return NULL;
+}
+
+/* Clears the entries of @np and the nodes below it, which are being removed */
+static void of_phandle_table_remove(struct of_phandle_table *table,
+				    struct device_node *np)
+{
+	struct device_node *child;
+
+	if (np->phandle && np->phandle < table->count &&
+	    table->nodes[np->phandle] == np)
+		table->nodes[np->phandle] = NULL;
+	__for_each_child_of_node(np, child)
+		of_phandle_table_remove(table, child);
+}
+#endif
+
 struct device_node *of_find_node_by_phandle(struct device_node *root,
 					    phandle handle)
 {
+	__maybe_unused struct of_phandle_table *table = NULL;
 	struct device_node *np;
 
 	if (!handle)
 		return NULL;
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+	/*
+	 * The table may be out of date if the tree has been changed, so check
+	 * the node and fall back to a walk if needed
+	 */
+	of_phandle_lookups++;
+	table = of_phandle_table_get(root);
+	if (table && handle < table->count) {
+		np = table->nodes[handle];
+		if (np && np->phandle == handle) {
+			of_phandle_hits++;
+			return np;
+		}
+	}
+#endif
+
 	for_each_of_allnodes_from(root, np)
 		if (np->phandle == handle)
 			break;
 	(void)of_node_get(np);
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+	if (np && table && handle < table->count)
+		table->nodes[handle] = np;
+#endif
+
 	return np;
 }
 
@@ -1074,6 +1195,7 @@ int of_remove_property(struct device_node *np, struct property *prop)
 int of_remove_node(struct device_node *to_remove)
 {
 	struct device_node *parent = to_remove->parent;
+	__maybe_unused struct of_phandle_table *table;
 	struct device_node *np, *prev;
 
 	if (!parent)
@@ -1093,6 +1215,15 @@ int of_remove_node(struct device_node *to_remove)
 	else
 		parent->child = np->sibling;
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+	/* The removed nodes must not be found by their phandles any more */
+	while (parent->parent)
+		parent = parent->parent;
+	table = of_phandle_table_get(parent);
+	if (table)
+		of_phandle_table_remove(table, to_remove);
+#endif
+
 	/*
 	 * don't free it, since if this is an unflattened tree, all the memory
 	 * was alloced in one block; this pointer will be somewhere in the
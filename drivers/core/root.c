@@ -118,8 +118,10 @@ int dm_init(bool of_live)
 					  &DM_ROOT_NON_CONST);
 		if (ret)
 			return ret;
-		if (CONFIG_IS_ENABLED(OF_CONTROL))
+		if (CONFIG_IS_ENABLED(OF_CONTROL)) {
 			dev_set_ofnode(DM_ROOT_NON_CONST, ofnode_root());
+			uclass_index_update(DM_ROOT_NON_CONST);
+		}
 		ret = device_probe(DM_ROOT_NON_CONST);
 		if (ret)
 			return ret;
@@ -296,6 +298,9 @@ static int dm_probe_devices(struct udevice *dev, bool pre_reloc_only)
 		ret = device_probe(dev);
 		if (ret)
 			return ret;
+
+		/* Finish any earlier probes which have stopped waiting */
+		device_probe_later_poll();
 	}
 
 probe_children:
@@ -420,6 +425,11 @@ void dm_get_mem(struct dm_stats *stats)
 	dev_collect_stats(stats, gd->dm_root);
 	uclass_collect_stats(stats);
 	dev_tag_collect_stats(stats);
+	if (of_live_active())
+		of_phandle_stats(&stats->phandle_lookups, &stats->phandle_hits);
+	else
+		fdtdec_phandle_stats(&stats->phandle_lookups,
+				     &stats->phandle_hits);
 
 	stats->total_size = stats->dev_size + stats->uc_size +
 		stats->attach_size_total + stats->uc_attach_size +
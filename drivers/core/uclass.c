@@ -13,6 +13,7 @@
 #include <errno.h>
 #include <log.h>
 #include <malloc.h>
+#include <linux/log2.h>
 #include <asm/global_data.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
@@ -42,6 +43,219 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+/* Number of devices a uclass must have before it is indexed */
+#define UCLASS_INDEX_MIN_DEVS	8
+
+static uint uclass_index_name_hash(const char *name, int len)
+{
+	uint hash = 2166136261U;
+
+	while (len--)
+		hash = (hash ^ (u8)*name++) * 16777619U;
+
+	return hash;
+}
+
+static uint uclass_index_node_hash(ofnode node)
+{
+	u64 val = node.of_offset;
+	uint hash;
+
+	/* Node pointers are aligned, so mix the upper bits into the lower */
+	hash = (uint)(val ^ (val >> 32)) * 0x9e3779b9U;
+
+	return hash ^ (hash >> 16);
+}
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+static bool uclass_indexed(struct uclass *uc)
+{
+	return uc->index_;
+}
+
+static struct udevice *uclass_index_first(struct uclass *uc,
+					  enum uclass_index_t idx, uint hash)
+{
+	return uc->index_[idx * (uc->index_mask_ + 1) +
+			  (hash & uc->index_mask_)];
+}
+
+static struct udevice *uclass_index_next(struct udevice *dev,
+					 enum uclass_index_t idx)
+{
+	return dev->index_next_[idx];
+}
+
+/* Returns true if @dev has a value to be looked up through table @idx */
+static bool uclass_index_has(struct udevice *dev, enum uclass_index_t idx)
+{
+	switch (idx) {
+	case UCLASS_INDEX_SEQ:
+		return dev->seq_ != -1;
+	case UCLASS_INDEX_NAME:
+		return dev->name;
+	case UCLASS_INDEX_NODE:
+		return dev_has_ofnode(dev);
+	default:
+		return false;
+	}
+}
+
+/* Works out the hash of the value of @dev which is looked up in table @idx */
+static uint uclass_index_hash(struct udevice *dev, enum uclass_index_t idx)
+{
+	uint hash;
+
+	switch (idx) {
+	case UCLASS_INDEX_SEQ:
+		/* Sequence numbers are mostly small and dense */
+		hash = dev->seq_;
+		break;
+	case UCLASS_INDEX_NAME:
+		hash = uclass_index_name_hash(dev->name, strlen(dev->name));
+		break;
+	default:
+		hash = uclass_index_node_hash(dev_ofnode(dev));
+		break;
+	}
+
+	return hash;
+}
+
+static struct udevice **uclass_index_bucket(struct uclass *uc, uint hash,
+					    enum uclass_index_t idx)
+{
+	return &uc->index_[idx * (uc->index_mask_ + 1) +
+			   (hash & uc->index_mask_)];
+}
+
+static void uclass_index_insert(struct uclass *uc, struct udevice *dev)
+{
+	struct udevice **linkp;
+	int idx;
+
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++) {
+		if (!uclass_index_has(dev, idx))
+			continue;
+
+		/*
+		 * Keep each chain in bind order, so that a lookup finds the
+		 * same device as walking the list of devices would
+		 */
+		dev->index_hash_[idx] = uclass_index_hash(dev, idx);
+		linkp = uclass_index_bucket(uc, dev->index_hash_[idx], idx);
+		while (*linkp && (*linkp)->index_order_ < dev->index_order_)
+			linkp = &(*linkp)->index_next_[idx];
+		dev->index_next_[idx] = *linkp;
+		*linkp = dev;
+	}
+}
+
+/*
+ * Removes @dev from the index. The hashes from when it was inserted are used,
+ * since its values may have changed since then.
+ */
+static void uclass_index_remove(struct uclass *uc, struct udevice *dev)
+{
+	struct udevice **linkp;
+	int idx;
+
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++) {
+		linkp = uclass_index_bucket(uc, dev->index_hash_[idx], idx);
+		while (*linkp && *linkp != dev)
+			linkp = &(*linkp)->index_next_[idx];
+		if (*linkp)
+			*linkp = dev->index_next_[idx];
+	}
+}
+
+static void uclass_index_free(struct uclass *uc)
+{
+	free(uc->index_);
+	uc->index_ = NULL;
+}
+
+/*
+ * Builds the index with @buckets hash buckets per table from the list of
+ * devices. If there is not enough memory, the uclass is left without an index
+ * and lookups walk the list instead.
+ */
+static void uclass_index_build(struct uclass *uc, uint buckets)
+{
+	struct udevice *dev;
+
+	uclass_index_free(uc);
+	uc->index_ = calloc(UCLASS_INDEX_COUNT * buckets, sizeof(*uc->index_));
+	if (!uc->index_)
+		return;
+	uc->index_mask_ = buckets - 1;
+	uc->index_order_ = 0;
+	uclass_foreach_dev(dev, uc) {
+		dev->index_order_ = ++uc->index_order_;
+		uclass_index_insert(uc, dev);
+	}
+}
+
+/* Adds a device which was just bound, growing the index as needed */
+static void uclass_index_bind(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	uc->dev_count_++;
+	if (!(gd->flags & GD_FLG_RELOC) ||
+	    uc->dev_count_ < UCLASS_INDEX_MIN_DEVS)
+		return;
+
+	if (uc->index_ && uc->dev_count_ <= 2 * (uc->index_mask_ + 1)) {
+		dev->index_order_ = ++uc->index_order_;
+		uclass_index_insert(uc, dev);
+	} else {
+		uclass_index_build(uc, roundup_pow_of_two(uc->dev_count_));
+	}
+}
+
+static void uclass_index_unbind(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	uc->dev_count_--;
+	if (uc->index_ && dev->index_order_)
+		uclass_index_remove(uc, dev);
+	dev->index_order_ = 0;
+}
+
+void uclass_index_update(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+
+	if (uc && uc->index_ && dev->index_order_) {
+		uclass_index_remove(uc, dev);
+		uclass_index_insert(uc, dev);
+	}
+}
+#else
+static bool uclass_indexed(struct uclass *uc)
+{
+	return false;
+}
+
+static struct udevice *uclass_index_first(struct uclass *uc,
+					  enum uclass_index_t idx, uint hash)
+{
+	return NULL;
+}
+
+static struct udevice *uclass_index_next(struct udevice *dev,
+					 enum uclass_index_t idx)
+{
+	return NULL;
+}
+
+static void uclass_index_free(struct uclass *uc) {}
+static void uclass_index_bind(struct udevice *dev) {}
+static void uclass_index_unbind(struct udevice *dev) {}
+#endif
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -137,6 +351,7 @@ int uclass_destroy(struct uclass *uc)
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto)
 		free(uclass_get_priv(uc));
+	uclass_index_free(uc);
 	free(uc);
 
 	return 0;
@@ -288,6 +503,20 @@ int uclass_find_device_by_namelen(enum uclass_id id, const char *name, int len,
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc)) {
+		for (dev = uclass_index_first(uc, UCLASS_INDEX_NAME,
+					      uclass_index_name_hash(name, len));
+		     dev; dev = uclass_index_next(dev, UCLASS_INDEX_NAME)) {
+			if (!strncmp(dev->name, name, len) &&
+			    strlen(dev->name) == len) {
+				*devp = dev;
+				return 0;
+			}
+		}
+
+		return -ENODEV;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		if (!strncmp(dev->name, name, len) &&
 		    strlen(dev->name) == len) {
@@ -342,6 +571,18 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq, struct udevice **devp)
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc)) {
+		for (dev = uclass_index_first(uc, UCLASS_INDEX_SEQ, seq); dev;
+		     dev = uclass_index_next(dev, UCLASS_INDEX_SEQ)) {
+			if (dev->seq_ == seq) {
+				*devp = dev;
+				return 0;
+			}
+		}
+
+		return -ENODEV;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		log_debug("   - %d '%s'\n", dev->seq_, dev->name);
 		if (dev->seq_ == seq) {
@@ -394,6 +635,19 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	if (uclass_indexed(uc)) {
+		for (dev = uclass_index_first(uc, UCLASS_INDEX_NODE,
+					      uclass_index_node_hash(node));
+		     dev; dev = uclass_index_next(dev, UCLASS_INDEX_NODE)) {
+			if (ofnode_equal(dev_ofnode(dev), node)) {
+				*devp = dev;
+				goto done;
+			}
+		}
+		ret = -ENODEV;
+		goto done;
+	}
+
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -694,6 +948,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_bind(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -708,6 +963,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_index_unbind(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -731,6 +987,7 @@ int uclass_pre_unbind_device(struct udevice *dev)
 
 int uclass_unbind_device(struct udevice *dev)
 {
+	uclass_index_unbind(dev);
 	list_del(&dev->uclass_node);
 
 	return 0;
@@ -296,6 +296,7 @@ static int apple_dart_remove(struct udevice *dev)
 			writel(0, priv->base + DART_TTBR(priv, sid, i));
 	}
 	priv->flush_tlb(priv);
+	lmb_uninit(&priv->lmb);
 
 	return 0;
 }
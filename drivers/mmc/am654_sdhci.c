@@ -24,6 +24,9 @@
 #define SLOTTYPE_MASK		GENMASK(31, 30)
 #define SLOTTYPE_EMBEDDED	BIT(30)
 
+/* Command queue engine, in the same register space as the host */
+#define AM654_SDHCI_CQE_BASE_ADDR	0x200
+
 /* PHY Registers */
 #define PHY_CTRL1	0x100
 #define PHY_CTRL2	0x104
@@ -411,10 +414,43 @@ static int am654_sdhci_execute_tuning(struct mmc *mmc, u8 opcode)
 
 	return 0;
 }
+
+/* The result of tuning is the input tap delay */
+static int am654_sdhci_get_tuning(struct mmc *mmc, u32 *tuningp)
+{
+	struct am654_sdhci_plat *plat = dev_get_plat(mmc->dev);
+	u32 val;
+	int ret;
+
+	ret = regmap_read(plat->base, PHY_CTRL4, &val);
+	if (ret)
+		return ret;
+	if (!(val & ITAPDLYENA_MASK))
+		return -ENOENT;
+	*tuningp = (val & ITAPDLYSEL_MASK) >> ITAPDLYSEL_SHIFT;
+
+	return 0;
+}
+
+static int am654_sdhci_set_tuning(struct mmc *mmc, u32 tuning)
+{
+	struct am654_sdhci_plat *plat = dev_get_plat(mmc->dev);
+
+	if (tuning >= ITAP_MAX)
+		return -EINVAL;
+
+	regmap_update_bits(plat->base, PHY_CTRL4, ITAPDLYENA_MASK,
+			   1 << ITAPDLYENA_SHIFT);
+	am654_sdhci_write_itapdly(plat, tuning);
+
+	return 0;
+}
 #endif
 const struct sdhci_ops am654_sdhci_ops = {
 #ifdef MMC_SUPPORTS_TUNING
 	.platform_execute_tuning = am654_sdhci_execute_tuning,
+	.platform_get_tuning	= am654_sdhci_get_tuning,
+	.platform_set_tuning	= am654_sdhci_set_tuning,
 #endif
 	.deferred_probe		= am654_sdhci_deferred_probe,
 	.set_ios_post		= &am654_sdhci_set_ios_post,
@@ -458,6 +494,8 @@ static int j721e_4bit_sdhci_set_ios_post(struct sdhci_host *host)
 const struct sdhci_ops j721e_4bit_sdhci_ops = {
 #ifdef MMC_SUPPORTS_TUNING
 	.platform_execute_tuning = am654_sdhci_execute_tuning,
+	.platform_get_tuning	= am654_sdhci_get_tuning,
+	.platform_set_tuning	= am654_sdhci_set_tuning,
 #endif
 	.deferred_probe		= am654_sdhci_deferred_probe,
 	.set_ios_post		= &j721e_4bit_sdhci_set_ios_post,
@@ -560,6 +598,13 @@ static int am654_sdhci_probe(struct udevice *dev)
 	if (ret)
 		return ret;
 
+	if (CONFIG_IS_ENABLED(MMC_SDHCI_CQHCI)) {
+		ret = sdhci_cqhci_init(cfg, host, host->ioaddr +
+				       AM654_SDHCI_CQE_BASE_ADDR);
+		if (ret)
+			return ret;
+	}
+
 	/* Update ops based on SoC revision */
 	soc = soc_device_match(am654_sdhci_soc_attr);
 	if (soc && soc->data) {
@@ -53,6 +53,13 @@ static int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 
 int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 {
+	int ret;
+
+	/* The card only accepts queued tasks while in command queue mode */
+	ret = mmc_cqe_off(mmc);
+	if (ret)
+		return ret;
+
 	return dm_mmc_send_cmd(mmc->dev, cmd, data);
 }
 
@@ -126,6 +133,24 @@ int mmc_execute_tuning(struct mmc *mmc, uint opcode)
 {
 	return dm_mmc_execute_tuning(mmc->dev, opcode);
 }
+
+int mmc_get_tuning(struct mmc *mmc, u32 *tuningp)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->get_tuning)
+		return -ENOSYS;
+	return ops->get_tuning(mmc->dev, tuningp);
+}
+
+int mmc_set_tuning(struct mmc *mmc, u32 tuning)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	if (!ops->set_tuning)
+		return -ENOSYS;
+	return ops->set_tuning(mmc->dev, tuning);
+}
 #endif
 
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
@@ -160,6 +185,48 @@ int mmc_hs400_prepare_ddr(struct mmc *mmc)
 	return dm_mmc_hs400_prepare_ddr(mmc->dev);
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+bool mmc_cqe_supported(struct mmc *mmc)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(mmc->dev);
+
+	return ops->cqe_enable && ops->cqe_request &&
+	       mmc->host_caps & MMC_CAP_CQE;
+}
+
+static int dm_mmc_cqe_enable(struct udevice *dev, bool enable)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->cqe_enable)
+		return -ENOSYS;
+
+	return ops->cqe_enable(dev, enable);
+}
+
+int mmc_cqe_enable(struct mmc *mmc, bool enable)
+{
+	return dm_mmc_cqe_enable(mmc->dev, enable);
+}
+
+static int dm_mmc_cqe_request(struct udevice *dev, bool write,
+			      struct mmc_cqe_task *tasks, int count)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->cqe_request)
+		return -ENOSYS;
+
+	return ops->cqe_request(dev, write, tasks, count);
+}
+
+int mmc_cqe_request(struct mmc *mmc, bool write, struct mmc_cqe_task *tasks,
+		    int count)
+{
+	return dm_mmc_cqe_request(mmc->dev, write, tasks, count);
+}
+#endif
+
 static int dm_mmc_host_power_cycle(struct udevice *dev)
 {
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
@@ -360,8 +427,17 @@ void mmc_do_preinit(void)
 
 		m->user_speed_mode = MMC_MODES_END;  /* Initialising user set speed mode */
 
-		if (m->preinit)
+		/*
+		 * Power up eMMCs, which cannot be removed, in the background.
+		 * Other devices are only started early if asked for.
+		 */
+		if (CONFIG_IS_ENABLED(MMC_INIT_CYCLIC) &&
+		    (m->preinit || m->cfg->host_caps & MMC_CAP_NONREMOVABLE)) {
+			if (!m->has_init && !m->init_in_progress)
+				mmc_start_init_cyclic(m);
+		} else if (m->preinit) {
 			mmc_start_init(m);
+		}
 	}
 }
 
@@ -542,9 +618,24 @@ U_BOOT_DRIVER(mmc_blk) = {
 #endif /* CONFIG_BLK */
 
 
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+static int mmc_pre_remove(struct udevice *dev)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	if (mmc)
+		mmc_stop_init_cyclic(mmc);
+
+	return 0;
+}
+#endif
+
 UCLASS_DRIVER(mmc) = {
 	.id		= UCLASS_MMC,
 	.name		= "mmc",
 	.flags		= DM_UC_FLAG_SEQ_ALIAS,
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+	.pre_remove	= mmc_pre_remove,
+#endif
 	.per_device_auto	= sizeof(struct mmc_uclass_priv),
 };
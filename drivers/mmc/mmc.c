@@ -11,9 +11,11 @@
 #include <common.h>
 #include <blk.h>
 #include <command.h>
+#include <cyclic.h>
 #include <dm.h>
 #include <log.h>
 #include <dm/device-internal.h>
+#include <env.h>
 #include <errno.h>
 #include <mmc.h>
 #include <part.h>
@@ -25,11 +27,15 @@
 #include <memalign.h>
 #include <linux/list.h>
 #include <div64.h>
+#include <u-boot/crc.h>
 #include "mmc_private.h"
 
 #define DEFAULT_CMD6_TIMEOUT_MS  500
+/* interval for polling the OCR while a card powers up in the background */
+#define MMC_INIT_CYCLIC_US	1000
 
 static int mmc_set_signal_voltage(struct mmc *mmc, uint signal_voltage);
+static int __mmc_start_init(struct mmc *mmc, bool quiet);
 
 #if !CONFIG_IS_ENABLED(DM_MMC)
 
@@ -467,6 +473,94 @@ static int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+static int mmc_cqe_on(struct mmc *mmc)
+{
+	int err;
+
+	if (mmc->cmdq_en)
+		return 0;
+
+	/* The card must be in command queue mode before the host is */
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN,
+			 EXT_CSD_CMDQ_MODE_ENABLED);
+	if (err)
+		return err;
+
+	err = mmc_cqe_enable(mmc, true);
+	if (err) {
+		mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 0);
+		return err;
+	}
+	mmc->cmdq_en = true;
+
+	return 0;
+}
+
+int mmc_cqe_off(struct mmc *mmc)
+{
+	int err;
+
+	if (!mmc->cmdq_en)
+		return 0;
+
+	/* Clear this first, since leaving needs a normal command */
+	mmc->cmdq_en = false;
+	err = mmc_cqe_enable(mmc, false);
+	if (err)
+		return err;
+
+	return mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_CMDQ_MODE_EN, 0);
+}
+
+int mmc_cqe_transfer(struct mmc *mmc, bool write, lbaint_t start,
+		     lbaint_t blkcnt, void *buf, uint b_max)
+{
+	struct mmc_cqe_task tasks[MMC_CQE_MAX_DEPTH];
+	uint task_max = min_t(uint, b_max, MMC_CQE_MAX_BLKCNT);
+	int count, err;
+
+	/*
+	 * There is nothing to gain unless more than one task is needed.
+	 * Leave out-of-range transfers to the normal path, which reports them.
+	 */
+	if (!mmc->cmdq_depth || blkcnt <= task_max ||
+	    start + blkcnt > mmc_get_blk_desc(mmc)->lba)
+		return -ENOSYS;
+
+	err = mmc_cqe_on(mmc);
+	if (err) {
+		/* Normal transfers still work, so stick to those */
+		pr_debug("%s: Cannot enable command queue: %d\n", __func__,
+			 err);
+		mmc->cmdq_depth = 0;
+		return err;
+	}
+
+	while (blkcnt) {
+		for (count = 0; blkcnt && count < mmc->cmdq_depth; count++) {
+			struct mmc_cqe_task *task = &tasks[count];
+
+			task->start = start;
+			task->blkcnt = min_t(lbaint_t, blkcnt, task_max);
+			task->buf = buf;
+			start += task->blkcnt;
+			blkcnt -= task->blkcnt;
+			buf += task->blkcnt * MMC_MAX_BLOCK_LEN;
+		}
+		err = mmc_cqe_request(mmc, write, tasks, count);
+		if (err) {
+			pr_debug("%s: Command queue request failed: %d\n",
+				 __func__, err);
+			mmc_cqe_off(mmc);
+			return err;
+		}
+	}
+
+	return 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *dst)
 #else
@@ -505,13 +599,17 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		return 0;
 	}
 
+	b_max = mmc_get_b_max(mmc, dst, blkcnt);
+
+	/* Anything the command queue does not manage goes the normal way */
+	if (!mmc_cqe_transfer(mmc, false, start, blkcnt, dst, b_max))
+		return blkcnt;
+
 	if (mmc_set_blocklen(mmc, mmc->read_bl_len)) {
 		pr_debug("%s: Failed to set blocklen\n", __func__);
 		return 0;
 	}
 
-	b_max = mmc_get_b_max(mmc, dst, blkcnt);
-
 	do {
 		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
 		if (mmc_read_blocks(mmc, dst, start, cur) != cur) {
@@ -710,6 +808,15 @@ static int mmc_send_op_cond_iter(struct mmc *mmc, int use_arg)
 	return 0;
 }
 
+static bool mmc_op_cond_in_background(struct mmc *mmc)
+{
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+	return mmc->init_cyclic;
+#else
+	return false;
+#endif
+}
+
 static int mmc_send_op_cond(struct mmc *mmc)
 {
 	int err, i;
@@ -730,6 +837,10 @@ static int mmc_send_op_cond(struct mmc *mmc)
 		if (mmc->ocr & OCR_BUSY)
 			break;
 
+		/* leave the rest of the power-up to mmc_op_cond_cyclic() */
+		if (i && mmc_op_cond_in_background(mmc))
+			break;
+
 		if (get_timer(start) > timeout)
 			return -ETIMEDOUT;
 		udelay(100);
@@ -738,6 +849,51 @@ static int mmc_send_op_cond(struct mmc *mmc)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+/* Poll the card once per call until it has finished powering up */
+static void mmc_op_cond_cyclic(void *ctx)
+{
+	struct mmc *mmc = ctx;
+
+	if (!mmc->init_in_progress || !mmc->op_cond_pending ||
+	    (mmc->ocr & OCR_BUSY) || get_timer(mmc->op_cond_start) > 1000)
+		return;
+
+	/* on error, mmc_complete_op_cond() starts again from CMD0 */
+	mmc_send_op_cond_iter(mmc, 1);
+}
+
+int mmc_start_init_cyclic(struct mmc *mmc)
+{
+	char name[30];
+	int err;
+
+	mmc_stop_init_cyclic(mmc);
+	snprintf(name, sizeof(name), "mmc_init_%s", mmc->dev->name);
+	mmc->op_cond_start = get_timer(0);
+	mmc->init_cyclic = cyclic_register(mmc_op_cond_cyclic,
+					   MMC_INIT_CYCLIC_US, name, mmc);
+
+	/*
+	 * without the cyclic function, this waits for the card as normal. An
+	 * empty slot is not an error here, since nothing has asked for it.
+	 */
+	err = __mmc_start_init(mmc, true);
+	if (err)
+		mmc_stop_init_cyclic(mmc);
+
+	return err;
+}
+
+void mmc_stop_init_cyclic(struct mmc *mmc)
+{
+	if (mmc->init_cyclic) {
+		cyclic_unregister(mmc->init_cyclic);
+		mmc->init_cyclic = NULL;
+	}
+}
+#endif
+
 static int mmc_complete_op_cond(struct mmc *mmc)
 {
 	struct mmc_cmd cmd;
@@ -2012,6 +2168,38 @@ static const struct ext_csd_bus_width {
 	{MMC_MODE_1BIT, false, EXT_CSD_BUS_WIDTH_1},
 };
 
+#ifdef MMC_SUPPORTS_TUNING
+/*
+ * mmc_tune() - Tune the host for the bus mode which has just been selected
+ *
+ * With MMC_MODE_CACHE, a tuning result taken from the mode record is restored
+ * if possible. Otherwise the result of tuning is kept so it can be recorded.
+ */
+static int mmc_tune(struct mmc *mmc, uint opcode)
+{
+#if CONFIG_IS_ENABLED(MMC_MODE_CACHE)
+	int err;
+
+	if (mmc->restore_tuning) {
+		mmc->restore_tuning = false;
+		err = mmc_set_tuning(mmc, mmc->tuning);
+		if (!err)
+			return 0;
+		pr_debug("cannot restore tuning : %d\n", err);
+	}
+	mmc->tuned = false;
+	err = mmc_execute_tuning(mmc, opcode);
+	if (err)
+		return err;
+	mmc->tuned = !mmc_get_tuning(mmc, &mmc->tuning);
+
+	return 0;
+#else
+	return mmc_execute_tuning(mmc, opcode);
+#endif
+}
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
 static int mmc_select_hs400(struct mmc *mmc)
 {
@@ -2028,7 +2216,7 @@ static int mmc_select_hs400(struct mmc *mmc)
 
 	/* execute tuning if needed */
 	mmc->hs400_tuning = 1;
-	err = mmc_execute_tuning(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
+	err = mmc_tune(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
 	mmc->hs400_tuning = 0;
 	if (err) {
 		debug("tuning failed\n");
@@ -2112,52 +2300,17 @@ static int mmc_select_hs400es(struct mmc *mmc)
 	    ecbv++) \
 		if ((ddr == ecbv->is_ddr) && (caps & ecbv->cap))
 
-static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
+/*
+ * mmc_try_modes() - Try each bus mode and width in @card_caps in turn
+ *
+ * Return: 0 once a mode is working, -ve on error if none is
+ */
+static int mmc_try_modes(struct mmc *mmc, uint card_caps)
 {
-	int err = 0;
+	int err = -ENOTSUPP;
 	const struct mode_width_tuning *mwt;
 	const struct ext_csd_bus_width *ecbw;
 
-#ifdef DEBUG
-	mmc_dump_capabilities("mmc", card_caps);
-	mmc_dump_capabilities("host", mmc->host_caps);
-#endif
-
-	if (mmc_host_is_spi(mmc)) {
-		mmc_set_bus_width(mmc, 1);
-		mmc_select_mode(mmc, MMC_LEGACY);
-		mmc_set_clock(mmc, mmc->tran_speed, MMC_CLK_ENABLE);
-		return 0;
-	}
-
-	/* Restrict card's capabilities by what the host can do */
-	card_caps &= mmc->host_caps;
-
-	/* Only version 4 of MMC supports wider bus widths */
-	if (mmc->version < MMC_VERSION_4)
-		return 0;
-
-	if (!mmc->ext_csd) {
-		pr_debug("No ext_csd found!\n"); /* this should enver happen */
-		return -ENOTSUPP;
-	}
-
-#if CONFIG_IS_ENABLED(MMC_HS200_SUPPORT) || \
-    CONFIG_IS_ENABLED(MMC_HS400_SUPPORT) || \
-    CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
-	/*
-	 * In case the eMMC is in HS200/HS400 mode, downgrade to HS mode
-	 * before doing anything else, since a transition from either of
-	 * the HS200/HS400 mode directly to legacy mode is not supported.
-	 */
-	if (mmc->selected_mode == MMC_HS_200 ||
-	    mmc->selected_mode == MMC_HS_400 ||
-	    mmc->selected_mode == MMC_HS_400_ES)
-		mmc_set_card_speed(mmc, MMC_HS, true);
-	else
-#endif
-		mmc_set_clock(mmc, mmc->legacy_speed, MMC_CLK_ENABLE);
-
 	for_each_mmc_mode_by_pref(card_caps, mwt) {
 		for_each_supported_width(card_caps & mwt->widths,
 					 mmc_is_mode_ddr(mwt->mode), ecbw) {
@@ -2221,8 +2374,7 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 
 				/* execute tuning if needed */
 				if (mwt->tuning) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
+					err = mmc_tune(mmc, mwt->tuning);
 					if (err) {
 						pr_debug("tuning failed : %d\n", err);
 						goto error;
@@ -2246,6 +2398,245 @@ error:
 		}
 	}
 
+	return err;
+}
+
+#if CONFIG_IS_ENABLED(MMC_MODE_CACHE)
+/*
+ * The bus mode which worked last time is kept in a struct mmc_mode_rec in
+ * block CONFIG_MMC_MODE_CACHE_SECTOR of the user area. It is read with the
+ * card still in legacy mode, so it is available however early the device is
+ * started. The capabilities shared by card and host are part of the record,
+ * so that it is ignored if either has changed.
+ */
+static int mmc_mode_rec_xfer(struct mmc *mmc, struct mmc_mode_rec *rec,
+			     bool write)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, MMC_MAX_BLOCK_LEN);
+	lbaint_t blk = CONFIG_MMC_MODE_CACHE_SECTOR;
+	struct mmc_data data;
+	struct mmc_cmd cmd;
+	int err;
+
+	cmd.cmdidx = write ? MMC_CMD_WRITE_SINGLE_BLOCK :
+		MMC_CMD_READ_SINGLE_BLOCK;
+	cmd.cmdarg = mmc->high_capacity ? blk : blk * MMC_MAX_BLOCK_LEN;
+	cmd.resp_type = MMC_RSP_R1;
+	data.blocks = 1;
+	data.blocksize = MMC_MAX_BLOCK_LEN;
+
+	if (write) {
+		memset(buf, '\0', MMC_MAX_BLOCK_LEN);
+		memcpy(buf, rec, sizeof(*rec));
+		data.src = (const char *)buf;
+		data.flags = MMC_DATA_WRITE;
+	} else {
+		data.dest = (char *)buf;
+		data.flags = MMC_DATA_READ;
+	}
+	err = mmc_send_cmd(mmc, &cmd, &data);
+	if (err)
+		return err;
+	if (write)
+		return mmc_poll_for_busy(mmc, 1000);
+	memcpy(rec, buf, sizeof(*rec));
+
+	return 0;
+}
+
+static u32 mmc_mode_rec_crc(const struct mmc_mode_rec *rec)
+{
+	return crc32(0, (const uchar *)rec, offsetof(struct mmc_mode_rec, crc));
+}
+
+/**
+ * mmc_mode_cache_get() - Get the bus mode and width which worked last time
+ *
+ * If the record holds a tuning result, it is set up to be restored instead of
+ * tuning again.
+ *
+ * @mmc:	MMC device
+ * @caps:	Capabilities shared by the card and the host
+ * @rec:	Returns the record as read from the card
+ * Return: @caps restricted to the recorded bus mode and width, or 0 if there
+ *	is no usable record
+ */
+static uint mmc_mode_cache_get(struct mmc *mmc, uint caps,
+			       struct mmc_mode_rec *rec)
+{
+	uint mode, width_cap;
+	int err;
+
+	mmc->tuned = false;
+	err = mmc_mode_rec_xfer(mmc, rec, false);
+	if (err) {
+		pr_debug("cannot read mode record : %d\n", err);
+		memset(rec, '\0', sizeof(*rec));
+		return 0;
+	}
+	if (le32_to_cpu(rec->magic) != MMC_MODE_REC_MAGIC ||
+	    le32_to_cpu(rec->crc) != mmc_mode_rec_crc(rec) ||
+	    le32_to_cpu(rec->caps) != caps || rec->mode >= MMC_MODES_END)
+		return 0;
+
+	mode = rec->mode;
+	switch (rec->width) {
+	case 1:
+		width_cap = MMC_MODE_1BIT;
+		break;
+	case 4:
+		width_cap = MMC_MODE_4BIT;
+		break;
+	case 8:
+		width_cap = MMC_MODE_8BIT;
+		break;
+	default:
+		return 0;
+	}
+	if (!(caps & MMC_CAP(mode)) || !(caps & width_cap))
+		return 0;
+
+	mmc->tuning = le32_to_cpu(rec->tuning);
+	mmc->restore_tuning = rec->tuned;
+
+	return MMC_CAP(mode) | width_cap;
+}
+
+/**
+ * mmc_mode_cache_set() - Record the bus mode and width currently in use
+ *
+ * The block is only written if the record changes.
+ *
+ * @mmc:	MMC device
+ * @caps:	Capabilities shared by the card and the host
+ * @old:	Record read from the card by mmc_mode_cache_get()
+ */
+static void mmc_mode_cache_set(struct mmc *mmc, uint caps,
+			       const struct mmc_mode_rec *old)
+{
+	struct mmc_mode_rec rec;
+	int err;
+
+	memset(&rec, '\0', sizeof(rec));
+	rec.magic = cpu_to_le32(MMC_MODE_REC_MAGIC);
+	rec.caps = cpu_to_le32(caps);
+	rec.mode = mmc->selected_mode;
+	rec.width = mmc->bus_width;
+	if (mmc->tuned) {
+		rec.tuned = 1;
+		rec.tuning = cpu_to_le32(mmc->tuning);
+	}
+	rec.crc = cpu_to_le32(mmc_mode_rec_crc(&rec));
+	if (!memcmp(&rec, old, sizeof(rec)))
+		return;
+
+	err = mmc_mode_rec_xfer(mmc, &rec, true);
+	if (err)
+		pr_debug("cannot write mode record : %d\n", err);
+}
+
+/**
+ * mmc_mode_cache_try() - Try the bus mode and width which worked last time
+ *
+ * @mmc:	MMC device
+ * @caps:	Capabilities shared by the card and the host
+ * @rec:	Returns the record as read from the card
+ * Return: 0 if the recorded mode is working, -ve if there is no usable record
+ *	or the mode did not work
+ */
+static int mmc_mode_cache_try(struct mmc *mmc, uint caps,
+			      struct mmc_mode_rec *rec)
+{
+	uint cached_caps;
+	int err;
+
+	cached_caps = mmc_mode_cache_get(mmc, caps, rec);
+	if (!cached_caps)
+		return -ENOENT;
+
+	err = mmc_try_modes(mmc, cached_caps);
+	mmc->restore_tuning = false;
+	if (err)
+		pr_debug("cached mode failed : %d\n", err);
+
+	return err;
+}
+#else
+static inline int mmc_mode_cache_try(struct mmc *mmc, uint caps,
+				     struct mmc_mode_rec *rec)
+{
+	return -ENOSYS;
+}
+
+static inline void mmc_mode_cache_set(struct mmc *mmc, uint caps,
+				      const struct mmc_mode_rec *old)
+{
+}
+#endif
+
+/*
+ * mmc_select_mode_and_width() - Select the fastest bus mode and width
+ *
+ * @use_cache is only set just after the card has been reset, when it is known
+ * to be accessing its user area, where the mode record is kept.
+ */
+static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps,
+				     bool use_cache)
+{
+	struct mmc_mode_rec rec;
+	int err;
+
+#ifdef DEBUG
+	mmc_dump_capabilities("mmc", card_caps);
+	mmc_dump_capabilities("host", mmc->host_caps);
+#endif
+
+	if (mmc_host_is_spi(mmc)) {
+		mmc_set_bus_width(mmc, 1);
+		mmc_select_mode(mmc, MMC_LEGACY);
+		mmc_set_clock(mmc, mmc->tran_speed, MMC_CLK_ENABLE);
+		return 0;
+	}
+
+	/* Restrict card's capabilities by what the host can do */
+	card_caps &= mmc->host_caps;
+
+	/* Only version 4 of MMC supports wider bus widths */
+	if (mmc->version < MMC_VERSION_4)
+		return 0;
+
+	if (!mmc->ext_csd) {
+		pr_debug("No ext_csd found!\n"); /* this should enver happen */
+		return -ENOTSUPP;
+	}
+
+#if CONFIG_IS_ENABLED(MMC_HS200_SUPPORT) || \
+    CONFIG_IS_ENABLED(MMC_HS400_SUPPORT) || \
+    CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
+	/*
+	 * In case the eMMC is in HS200/HS400 mode, downgrade to HS mode
+	 * before doing anything else, since a transition from either of
+	 * the HS200/HS400 mode directly to legacy mode is not supported.
+	 */
+	if (mmc->selected_mode == MMC_HS_200 ||
+	    mmc->selected_mode == MMC_HS_400 ||
+	    mmc->selected_mode == MMC_HS_400_ES)
+		mmc_set_card_speed(mmc, MMC_HS, true);
+	else
+#endif
+		mmc_set_clock(mmc, mmc->legacy_speed, MMC_CLK_ENABLE);
+
+	/* The mode which worked last time is likely to work again */
+	if (use_cache && !mmc_mode_cache_try(mmc, card_caps, &rec))
+		return 0;
+
+	err = mmc_try_modes(mmc, card_caps);
+	if (!err) {
+		if (use_cache)
+			mmc_mode_cache_set(mmc, card_caps, &rec);
+		return 0;
+	}
+
 	pr_err("unable to select a mode : %d\n", err);
 
 	return -ENOTSUPP;
@@ -2454,6 +2845,20 @@ static int mmc_startup_v4(struct mmc *mmc)
 	mmc->can_trim =
 		!!(ext_csd[EXT_CSD_SEC_FEATURE] & EXT_CSD_SEC_FEATURE_TRIM_EN);
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	/*
+	 * Command queueing needs eMMC 5.1 and a host with a command queue
+	 * engine. Task addresses are always in blocks, so leave it to
+	 * high-capacity cards.
+	 */
+	mmc->cmdq_depth = 0;
+	if (mmc->version >= MMC_VERSION_5_1 && mmc->high_capacity &&
+	    (ext_csd[EXT_CSD_CMDQ_SUPPORT] & EXT_CSD_CMDQ_SUPPORTED) &&
+	    mmc_cqe_supported(mmc))
+		mmc->cmdq_depth = (ext_csd[EXT_CSD_CMDQ_DEPTH] &
+				   EXT_CSD_CMDQ_DEPTH_MASK) + 1;
+#endif
+
 	return 0;
 error:
 	if (mmc->ext_csd) {
@@ -2646,7 +3051,7 @@ static int mmc_startup(struct mmc *mmc)
 		err = mmc_get_capabilities(mmc);
 		if (err)
 			return err;
-		err = mmc_select_mode_and_width(mmc, mmc->card_caps);
+		err = mmc_select_mode_and_width(mmc, mmc->card_caps, true);
 	}
 #endif
 	if (err)
@@ -2911,11 +3316,14 @@ retry:
 	return err;
 }
 
-int mmc_start_init(struct mmc *mmc)
+static int __mmc_start_init(struct mmc *mmc, bool quiet)
 {
 	bool no_card;
 	int err = 0;
 
+	/* A card left in command queue mode would ignore the reset */
+	mmc_cqe_off(mmc);
+
 	/*
 	 * all hosts are capable of 1 bit bus-width and able to use the legacy
 	 * timings.
@@ -2955,12 +3363,13 @@ int mmc_start_init(struct mmc *mmc)
 	if (no_card) {
 		mmc->has_init = 0;
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
-		pr_err("MMC: no card present\n");
+		if (!quiet)
+			pr_err("MMC: no card present\n");
 #endif
 		return -ENOMEDIUM;
 	}
 
-	err = mmc_get_op_cond(mmc, false);
+	err = mmc_get_op_cond(mmc, quiet);
 
 	if (!err)
 		mmc->init_in_progress = 1;
@@ -2968,10 +3377,17 @@ int mmc_start_init(struct mmc *mmc)
 	return err;
 }
 
+int mmc_start_init(struct mmc *mmc)
+{
+	return __mmc_start_init(mmc, false);
+}
+
 static int mmc_complete_init(struct mmc *mmc)
 {
 	int err = 0;
 
+	/* the card must not be polled while it is being set up */
+	mmc_stop_init_cyclic(mmc);
 	mmc->init_in_progress = 0;
 	if (mmc->op_cond_pending)
 		err = mmc_complete_op_cond(mmc);
@@ -3031,7 +3447,7 @@ int mmc_deinit(struct mmc *mmc)
 		caps_filtered = mmc->card_caps &
 			~(MMC_CAP(MMC_HS_200) | MMC_CAP(MMC_HS_400) | MMC_CAP(MMC_HS_400_ES));
 
-		return mmc_select_mode_and_width(mmc, caps_filtered);
+		return mmc_select_mode_and_width(mmc, caps_filtered, false);
 	}
 }
 #endif
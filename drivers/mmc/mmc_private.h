@@ -25,6 +25,83 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+/**
+ * mmc_cqe_transfer() - Transfer blocks using the command queue
+ *
+ * The transfer is split into tasks of up to @b_max blocks which are queued
+ * on the host's command queue engine, as many at a time as the card allows.
+ * The card is left in command queue mode afterwards, so that the next large
+ * transfer does not have to switch again. Sending any other command takes
+ * it out of that mode first, see mmc_cqe_off().
+ *
+ * If the card cannot be switched to command queue mode, queueing is turned
+ * off for it until it is initialised again.
+ *
+ * @mmc:	MMC device
+ * @write:	true to write to the card, false to read from it
+ * @start:	First block to transfer
+ * @blkcnt:	Number of blocks to transfer
+ * @buf:	Buffer to read into or write from
+ * @b_max:	Maximum number of blocks the host can transfer in one go
+ * Return: 0 if OK, -ENOSYS if the command queue is not used for this
+ *	transfer, other -ve value on error. In all error cases the card is
+ *	out of command queue mode and the caller should use normal transfers.
+ */
+int mmc_cqe_transfer(struct mmc *mmc, bool write, lbaint_t start,
+		     lbaint_t blkcnt, void *buf, uint b_max);
+
+/**
+ * mmc_cqe_off() - Take the card and host out of command queue mode
+ *
+ * This does nothing unless a previous transfer left them in that mode.
+ *
+ * @mmc:	MMC device
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_cqe_off(struct mmc *mmc);
+#else
+static inline int mmc_cqe_transfer(struct mmc *mmc, bool write,
+				   lbaint_t start, lbaint_t blkcnt, void *buf,
+				   uint b_max)
+{
+	return -ENOSYS;
+}
+
+static inline int mmc_cqe_off(struct mmc *mmc)
+{
+	return 0;
+}
+#endif
+
+#define MMC_MODE_REC_MAGIC	0x45444f4d	/* "MODE" */
+
+/**
+ * struct mmc_mode_rec - Record of the eMMC bus mode which worked last time
+ *
+ * With MMC_MODE_CACHE this is kept at the start of block
+ * CONFIG_MMC_MODE_CACHE_SECTOR in the user area. Fields are little-endian.
+ *
+ * @magic:	MMC_MODE_REC_MAGIC
+ * @caps:	Capabilities shared by card and host when the record was made
+ * @mode:	Bus mode (enum bus_mode)
+ * @width:	Bus width in bits
+ * @tuned:	1 if @tuning holds the host's tuning result for @mode
+ * @reserved:	Always 0
+ * @tuning:	Host-specific tuning result, see mmc_get_tuning()
+ * @crc:	CRC32 of the fields above
+ */
+struct mmc_mode_rec {
+	__le32 magic;
+	__le32 caps;
+	u8 mode;
+	u8 width;
+	u8 tuned;
+	u8 reserved;
+	__le32 tuning;
+	__le32 crc;
+};
+
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 
 #if CONFIG_IS_ENABLED(BLK)
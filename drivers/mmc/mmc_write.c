@@ -219,6 +219,11 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	if (err < 0)
 		return 0;
 
+	/* Anything the command queue does not manage goes the normal way */
+	if (!mmc_cqe_transfer(mmc, true, start, blkcnt, (void *)src,
+			      mmc->cfg->b_max))
+		return blkcnt;
+
 	if (mmc_set_blocklen(mmc, mmc->write_bl_len))
 		return 0;
 
@@ -13,11 +13,13 @@
 #include <mmc.h>
 #include <os.h>
 #include <asm/test.h>
+#include <asm/unaligned.h>
 
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
 	const char *fname;
+	bool emmc;	/* emulate an eMMC 5.1 device instead of an SD card */
 };
 
 #define MMC_CMULT		8 /* 8 because the card is high-capacity */
@@ -27,48 +29,98 @@ struct sandbox_mmc_plat {
 /* Granularity of priv->csize - this is 1MB */
 #define SIZE_MULTIPLE		((1 << (MMC_CMULT + 2)) * MMC_BL_LEN)
 
+/* Emulated eMMC: command-queue depth and maximum blocks per transfer */
+#define EMMC_CMDQ_DEPTH		8
+#define EMMC_B_MAX		64
+/* Emulated eMMC: number of CMD1s after CMD0 for which the card stays busy */
+#define EMMC_POWER_UP_POLLS	4
+
 struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	u8 ext_csd[MMC_MAX_BLOCK_LEN];	/* eMMC only */
+	bool cqe_enabled;
+	int cqe_requests;	/* number of cqe_request() calls */
+	int cqe_tasks;		/* total number of tasks queued */
+	int cmdq_entries;	/* times the card entered command queue mode */
+	bool cqe_fail_enable;	/* fail cqe_enable() requests to enable */
+	bool cqe_fail_request;	/* fail cqe_request() */
+	int power_up_polls;	/* CMD1s received since the last CMD0 */
 };
 
 /**
- * sandbox_mmc_send_cmd() - Emulate SD commands
+ * sandbox_mmc_send_cmd() - Emulate SD / eMMC commands
  *
- * This emulate an SD card version 2. Single-block reads result in zero data.
- * Multiple-block reads return a test string.
+ * This emulate an SD card version 2, or an eMMC 5.1 device with the
+ * 'sandbox,emmc' property. Reads and writes access the backing buffer.
  */
 static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 				struct mmc_data *data)
 {
+	struct sandbox_mmc_plat *plat = dev_get_plat(dev);
 	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
 	static ulong erase_start, erase_end;
 
+	/* The card can only be accessed via the queue when the CQE is on */
+	if (priv->cqe_enabled)
+		return -EBUSY;
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		memset(cmd->response, '\0', sizeof(cmd->response));
 		break;
 	case SD_CMD_SEND_RELATIVE_ADDR:
 		cmd->response[0] = 0 << 16; /* mmc->rca */
+		break;
 	case MMC_CMD_GO_IDLE_STATE:
+		priv->power_up_polls = 0;
 		break;
 	case SD_CMD_SEND_IF_COND:
+		/* this is MMC_CMD_SEND_EXT_CSD on eMMC */
+		if (plat->emmc) {
+			if (!data)
+				return -ETIMEDOUT;
+			memcpy(data->dest, priv->ext_csd, MMC_MAX_BLOCK_LEN);
+			break;
+		}
 		cmd->response[0] = 0xaa;
 		break;
+	case MMC_CMD_SEND_OP_COND:
+		/* an eMMC takes a few polls to power up after a reset */
+		if (plat->emmc && priv->power_up_polls < EMMC_POWER_UP_POLLS) {
+			priv->power_up_polls++;
+			cmd->response[0] = OCR_HCS;
+			break;
+		}
+		cmd->response[0] = OCR_BUSY | OCR_HCS;
+		break;
 	case MMC_CMD_SEND_STATUS:
 		cmd->response[0] = MMC_STATUS_RDY_FOR_DATA;
+		if (plat->emmc)
+			cmd->response[0] |= MMC_STATE_TRANS;
 		break;
 	case MMC_CMD_SELECT_CARD:
 		break;
 	case MMC_CMD_SEND_CSD:
-		cmd->response[0] = 0;
+		cmd->response[0] = plat->emmc ? 4 << 26 : 0; /* eMMC spec 4 */
 		cmd->response[1] = (MMC_BL_LEN_SHIFT << 16) |
 				   ((priv->csize >> 16) & 0x3f);
 		cmd->response[2] = (priv->csize & 0xffff) << 16;
-		cmd->response[3] = 0;
+		cmd->response[3] = plat->emmc ? MMC_BL_LEN_SHIFT << 22 : 0;
 		break;
 	case SD_CMD_SWITCH_FUNC: {
+		/* this is MMC_CMD_SWITCH on eMMC */
+		if (plat->emmc) {
+			int index = (cmd->cmdarg >> 16) & 0xff;
+			int value = (cmd->cmdarg >> 8) & 0xff;
+
+			if (index == EXT_CSD_CMDQ_MODE_EN && value &&
+			    !priv->ext_csd[index])
+				priv->cmdq_entries++;
+			priv->ext_csd[index] = value;
+			break;
+		}
 		if (!data)
 			break;
 		u32 *resp = (u32 *)data->dest;
@@ -80,20 +132,26 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	}
 	case MMC_CMD_READ_SINGLE_BLOCK:
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
+		if (priv->ext_csd[EXT_CSD_CMDQ_MODE_EN])
+			return -EPERM;
 		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
 		       data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_WRITE_SINGLE_BLOCK:
 	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
+		if (priv->ext_csd[EXT_CSD_CMDQ_MODE_EN])
+			return -EPERM;
 		memcpy(&priv->buf[cmd->cmdarg * data->blocksize], data->src,
 		       data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
 		break;
 	case SD_CMD_ERASE_WR_BLK_START:
+	case MMC_CMD_ERASE_GROUP_START:
 		erase_start = cmd->cmdarg;
 		break;
 	case SD_CMD_ERASE_WR_BLK_END:
+	case MMC_CMD_ERASE_GROUP_END:
 		erase_end = cmd->cmdarg;
 		break;
 #if CONFIG_IS_ENABLED(MMC_WRITE)
@@ -111,6 +169,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		cmd->response[2] = 0;
 		break;
 	case MMC_CMD_APP_CMD:
+		if (plat->emmc)
+			return -ETIMEDOUT;
 		break;
 	case MMC_CMD_SET_BLOCKLEN:
 		debug("block len %d\n", cmd->cmdarg);
@@ -139,10 +199,78 @@ static int sandbox_mmc_get_cd(struct udevice *dev)
 	return 1;
 }
 
+#if CONFIG_IS_ENABLED(MMC_CQE)
+static int sandbox_mmc_cqe_enable(struct udevice *dev, bool enable)
+{
+	struct sandbox_mmc_plat *plat = dev_get_plat(dev);
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	if (!plat->emmc)
+		return -ENOSYS;
+	if (enable && !priv->ext_csd[EXT_CSD_CMDQ_MODE_EN])
+		return -EPERM;
+	if (enable && priv->cqe_fail_enable)
+		return -EIO;
+	priv->cqe_enabled = enable;
+
+	return 0;
+}
+
+static int sandbox_mmc_cqe_request(struct udevice *dev, bool write,
+				   struct mmc_cqe_task *tasks, int count)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	int i;
+
+	if (!priv->cqe_enabled || count > EMMC_CMDQ_DEPTH ||
+	    priv->cqe_fail_request)
+		return -EIO;
+	for (i = 0; i < count; i++) {
+		struct mmc_cqe_task *task = &tasks[i];
+		char *ptr = &priv->buf[task->start * MMC_MAX_BLOCK_LEN];
+		uint size = task->blkcnt * MMC_MAX_BLOCK_LEN;
+
+		if (task->blkcnt > EMMC_B_MAX ||
+		    task->start * MMC_MAX_BLOCK_LEN + size > priv->size)
+			return -EINVAL;
+		if (write)
+			memcpy(ptr, task->buf, size);
+		else
+			memcpy(task->buf, ptr, size);
+	}
+	priv->cqe_requests++;
+	priv->cqe_tasks += count;
+
+	return 0;
+}
+
+void sandbox_mmc_get_cqe_stats(struct udevice *dev, int *requestsp,
+			       int *tasksp, int *entriesp)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	*requestsp = priv->cqe_requests;
+	*tasksp = priv->cqe_tasks;
+	*entriesp = priv->cmdq_entries;
+}
+
+void sandbox_mmc_set_cqe_fail(struct udevice *dev, bool enable, bool request)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->cqe_fail_enable = enable;
+	priv->cqe_fail_request = request;
+}
+#endif
+
 static const struct dm_mmc_ops sandbox_mmc_ops = {
 	.send_cmd = sandbox_mmc_send_cmd,
 	.set_ios = sandbox_mmc_set_ios,
 	.get_cd = sandbox_mmc_get_cd,
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	.cqe_enable = sandbox_mmc_cqe_enable,
+	.cqe_request = sandbox_mmc_cqe_request,
+#endif
 };
 
 static int sandbox_mmc_of_to_plat(struct udevice *dev)
@@ -191,6 +319,18 @@ static int sandbox_mmc_probe(struct udevice *dev)
 		}
 	}
 
+	if (plat->emmc) {
+		u8 *ext_csd = priv->ext_csd;
+
+		ext_csd[EXT_CSD_REV] = 8;	/* eMMC 5.1 */
+		ext_csd[EXT_CSD_CARD_TYPE] = EXT_CSD_CARD_TYPE_26 |
+					     EXT_CSD_CARD_TYPE_52;
+		put_unaligned_le32(priv->size / MMC_MAX_BLOCK_LEN,
+				   &ext_csd[EXT_CSD_SEC_CNT]);
+		ext_csd[EXT_CSD_CMDQ_SUPPORT] = EXT_CSD_CMDQ_SUPPORTED;
+		ext_csd[EXT_CSD_CMDQ_DEPTH] = EMMC_CMDQ_DEPTH - 1;
+	}
+
 	return mmc_init(&plat->mmc);
 }
 
@@ -219,6 +359,13 @@ static int sandbox_mmc_bind(struct udevice *dev)
 	cfg->f_max = 52000000;
 	cfg->b_max = U32_MAX;
 
+	/* Use small transfers so that the command queue gets several tasks */
+	plat->emmc = dev_read_bool(dev, "sandbox,emmc");
+	if (plat->emmc) {
+		cfg->b_max = EMMC_B_MAX;
+		cfg->host_caps |= MMC_CAP_CQE;
+	}
+
 	return mmc_bind(dev, &plat->mmc, cfg);
 }
 
@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Command Queue Host Controller Interface (CQHCI) for SDHCI hosts
+ *
+ * Tasks are placed in the task descriptor list, started through the
+ * doorbell and then polled for in the task completion register. There is
+ * no direct command slot: anything other than reads and writes is sent
+ * with the engine turned off.
+ *
+ * Based on the Linux driver drivers/mmc/host/cqhci-core.c
+ */
+
+#include <common.h>
+#include <cpu_func.h>
+#include <log.h>
+#include <malloc.h>
+#include <mmc.h>
+#include <sdhci.h>
+#include <time.h>
+#include <asm/cache.h>
+#include <asm/io.h>
+#include <linux/bitops.h>
+#include <linux/dma-mapping.h>
+#include <linux/iopoll.h>
+#include <linux/sizes.h>
+
+#define CQHCI_VER		0x00
+#define CQHCI_CFG		0x08
+#define  CQHCI_DCMD		BIT(12)
+#define  CQHCI_TASK_DESC_SZ	BIT(8)
+#define  CQHCI_ENABLE		BIT(0)
+#define CQHCI_CTL		0x0c
+#define  CQHCI_CLEAR_ALL_TASKS	BIT(8)
+#define  CQHCI_HALT		BIT(0)
+#define CQHCI_IS		0x10
+#define CQHCI_ISTE		0x14
+#define CQHCI_ISGE		0x18
+#define  CQHCI_IS_TCC		BIT(1)
+#define  CQHCI_IS_RED		BIT(2)
+#define  CQHCI_IS_GCE		BIT(4)
+#define  CQHCI_IS_ICCE		BIT(5)
+#define  CQHCI_IS_ERROR		(CQHCI_IS_RED | CQHCI_IS_GCE | CQHCI_IS_ICCE)
+#define CQHCI_TDLBA		0x20
+#define CQHCI_TDLBAU		0x24
+#define CQHCI_TDBR		0x28
+#define CQHCI_TCN		0x2c
+#define CQHCI_SSC2		0x44
+#define CQHCI_TERRI		0x54
+
+/* Descriptor fields */
+#define CQHCI_VALID		BIT(0)
+#define CQHCI_END		BIT(1)
+#define CQHCI_INT		BIT(2)
+#define CQHCI_ACT_TRAN		(0x4 << 3)
+#define CQHCI_ACT_TASK		(0x5 << 3)
+#define CQHCI_ACT_LINK		(0x6 << 3)
+#define CQHCI_DATA_DIR_READ	BIT(12)
+#define CQHCI_BLK_COUNT(x)	((u64)(x) << 16)
+#define CQHCI_BLK_ADDR(x)	((u64)(x) << 32)
+#define CQHCI_DAT_LENGTH(x)	((x) << 16)
+
+/* 64-bit DMA addresses need 128-bit descriptors */
+#ifdef CONFIG_DMA_ADDR_T_64BIT
+#define CQHCI_DESC_LEN		16
+#else
+#define CQHCI_DESC_LEN		8
+#endif
+/* Each slot holds a task descriptor then a link to its transfer list */
+#define CQHCI_SLOT_LEN		(2 * CQHCI_DESC_LEN)
+#define CQHCI_NUM_SLOTS		32
+#define CQHCI_TDL_LEN		(CQHCI_NUM_SLOTS * CQHCI_SLOT_LEN)
+
+/* Keep each transfer descriptor to a whole number of blocks */
+#define CQHCI_MAX_SEG_LEN	SZ_32K
+
+#define CQHCI_HALT_TIMEOUT_US	100000
+/* Time allowed for the next task to complete */
+#define CQHCI_TASK_TIMEOUT_MS	10000
+
+static inline u32 cqhci_readl(struct sdhci_host *host, int reg)
+{
+	return readl(host->cqe_ioaddr + reg);
+}
+
+static inline void cqhci_writel(struct sdhci_host *host, u32 val, int reg)
+{
+	writel(val, host->cqe_ioaddr + reg);
+}
+
+static void cqhci_set_desc(void *desc, u32 attr, dma_addr_t addr)
+{
+	u32 *ptr = desc;
+
+	ptr[0] = cpu_to_le32(attr);
+	ptr[1] = cpu_to_le32(lower_32_bits(addr));
+	if (CQHCI_DESC_LEN > 8) {
+		ptr[2] = cpu_to_le32(upper_32_bits(addr));
+		ptr[3] = 0;
+	}
+}
+
+static void cqhci_set_task_desc(void *desc, bool write,
+				struct mmc_cqe_task *task)
+{
+	u64 *ptr = desc;
+
+	ptr[0] = cpu_to_le64(CQHCI_VALID | CQHCI_END | CQHCI_INT |
+			     CQHCI_ACT_TASK |
+			     (write ? 0 : CQHCI_DATA_DIR_READ) |
+			     CQHCI_BLK_COUNT(task->blkcnt) |
+			     CQHCI_BLK_ADDR(task->start));
+	if (CQHCI_DESC_LEN > 8)
+		ptr[1] = 0;
+}
+
+static int cqhci_halt(struct sdhci_host *host)
+{
+	u32 ctl;
+
+	cqhci_writel(host, cqhci_readl(host, CQHCI_CTL) | CQHCI_HALT,
+		     CQHCI_CTL);
+
+	return readl_poll_timeout(host->cqe_ioaddr + CQHCI_CTL, ctl,
+				  ctl & CQHCI_HALT, CQHCI_HALT_TIMEOUT_US);
+}
+
+/* Drop whatever was queued after an error, leaving the engine halted */
+static void cqhci_recover(struct sdhci_host *host)
+{
+	u32 ctl;
+
+	log_debug("%s: task error %#x, status %#x\n", host->name,
+		  cqhci_readl(host, CQHCI_TERRI),
+		  sdhci_readl(host, SDHCI_INT_STATUS));
+	if (cqhci_halt(host))
+		log_debug("%s: cannot halt command queue\n", host->name);
+
+	cqhci_writel(host, CQHCI_HALT | CQHCI_CLEAR_ALL_TASKS, CQHCI_CTL);
+	readl_poll_timeout(host->cqe_ioaddr + CQHCI_CTL, ctl,
+			   !(ctl & CQHCI_CLEAR_ALL_TASKS),
+			   CQHCI_HALT_TIMEOUT_US);
+	cqhci_writel(host, cqhci_readl(host, CQHCI_TCN), CQHCI_TCN);
+	cqhci_writel(host, cqhci_readl(host, CQHCI_IS), CQHCI_IS);
+	sdhci_reset(host, SDHCI_RESET_CMD | SDHCI_RESET_DATA);
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+}
+
+static int cqhci_on(struct sdhci_host *host)
+{
+	struct mmc *mmc = host->mmc;
+	dma_addr_t tdl = (dma_addr_t)host->cqe_desc;
+	u32 cfg;
+	u8 ctrl;
+
+	/* The engine moves data with ADMA2-style transfer descriptors */
+	ctrl = sdhci_readb(host, SDHCI_HOST_CONTROL);
+	ctrl &= ~SDHCI_CTRL_DMA_MASK;
+	ctrl |= CQHCI_DESC_LEN > 8 ? SDHCI_CTRL_ADMA64 : SDHCI_CTRL_ADMA32;
+	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
+	sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
+					    MMC_MAX_BLOCK_LEN),
+		     SDHCI_BLOCK_SIZE);
+	sdhci_writeb(host, 0xe, SDHCI_TIMEOUT_CONTROL);
+
+	/* Completion is polled, so no interrupts are signalled */
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_CQE | SDHCI_INT_ERROR_MASK,
+		     SDHCI_INT_ENABLE);
+
+	cfg = cqhci_readl(host, CQHCI_CFG);
+	if (cfg & CQHCI_ENABLE) {
+		cfg &= ~CQHCI_ENABLE;
+		cqhci_writel(host, cfg, CQHCI_CFG);
+	}
+	cfg &= ~(CQHCI_DCMD | CQHCI_TASK_DESC_SZ);
+	if (CQHCI_DESC_LEN > 8)
+		cfg |= CQHCI_TASK_DESC_SZ;
+	cqhci_writel(host, cfg, CQHCI_CFG);
+
+	cqhci_writel(host, lower_32_bits(tdl), CQHCI_TDLBA);
+	cqhci_writel(host, upper_32_bits(tdl), CQHCI_TDLBAU);
+	/* The engine polls the card with CMD13, which needs its address */
+	cqhci_writel(host, mmc->rca, CQHCI_SSC2);
+
+	cqhci_writel(host, cqhci_readl(host, CQHCI_IS), CQHCI_IS);
+	cqhci_writel(host, CQHCI_IS_TCC | CQHCI_IS_ERROR, CQHCI_ISTE);
+	cqhci_writel(host, 0, CQHCI_ISGE);
+
+	cqhci_writel(host, cfg | CQHCI_ENABLE, CQHCI_CFG);
+	if (cqhci_readl(host, CQHCI_CTL) & CQHCI_HALT)
+		cqhci_writel(host, 0, CQHCI_CTL);
+
+	return 0;
+}
+
+static int cqhci_off(struct sdhci_host *host)
+{
+	int ret;
+
+	ret = cqhci_halt(host);
+	cqhci_writel(host, cqhci_readl(host, CQHCI_CFG) & ~CQHCI_ENABLE,
+		     CQHCI_CFG);
+	cqhci_writel(host, 0, CQHCI_ISTE);
+
+	/* Back to what sdhci_init() set up for normal commands */
+	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
+	sdhci_writel(host, SDHCI_INT_DATA_MASK | SDHCI_INT_CMD_MASK,
+		     SDHCI_INT_ENABLE);
+
+	return ret;
+}
+
+int sdhci_cqe_enable(struct udevice *dev, bool enable)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (!host->cqe_ioaddr)
+		return -ENOSYS;
+
+	return enable ? cqhci_on(host) : cqhci_off(host);
+}
+
+static int cqhci_wait(struct sdhci_host *host, u32 mask)
+{
+	ulong start = get_timer(0);
+	u32 done = 0, status, tcn;
+
+	while (done != mask) {
+		status = cqhci_readl(host, CQHCI_IS);
+		if (status & CQHCI_IS_ERROR ||
+		    sdhci_readl(host, SDHCI_INT_STATUS) & SDHCI_INT_ERROR_MASK)
+			return -EIO;
+
+		tcn = cqhci_readl(host, CQHCI_TCN);
+		if (tcn) {
+			cqhci_writel(host, tcn, CQHCI_TCN);
+			cqhci_writel(host, status, CQHCI_IS);
+			done |= tcn;
+			start = get_timer(0);
+		} else if (get_timer(start) > CQHCI_TASK_TIMEOUT_MS) {
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
+int sdhci_cqe_request(struct udevice *dev, bool write,
+		      struct mmc_cqe_task *tasks, int count)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+	enum dma_data_direction dir = write ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	dma_addr_t addr[CQHCI_NUM_SLOTS];
+	uint ndesc = 0, trans_len, len, off, seg;
+	void *trans, *desc, *slot;
+	int i, ret;
+
+	if (!host->cqe_ioaddr || count > CQHCI_NUM_SLOTS)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++)
+		ndesc += DIV_ROUND_UP(tasks[i].blkcnt * MMC_MAX_BLOCK_LEN,
+				      CQHCI_MAX_SEG_LEN);
+	trans_len = ALIGN(ndesc * CQHCI_DESC_LEN, ARCH_DMA_MINALIGN);
+	trans = memalign(ARCH_DMA_MINALIGN, trans_len);
+	if (!trans)
+		return -ENOMEM;
+
+	desc = trans;
+	for (i = 0; i < count; i++) {
+		len = tasks[i].blkcnt * MMC_MAX_BLOCK_LEN;
+		addr[i] = dma_map_single(tasks[i].buf, len, dir);
+
+		slot = host->cqe_desc + i * CQHCI_SLOT_LEN;
+		cqhci_set_task_desc(slot, write, &tasks[i]);
+		cqhci_set_desc(slot + CQHCI_DESC_LEN,
+			       CQHCI_VALID | CQHCI_ACT_LINK,
+			       (dma_addr_t)desc);
+
+		for (off = 0; off < len; off += seg) {
+			seg = min_t(uint, len - off, CQHCI_MAX_SEG_LEN);
+			cqhci_set_desc(desc, CQHCI_VALID | CQHCI_ACT_TRAN |
+				       (off + seg == len ? CQHCI_END : 0) |
+				       CQHCI_DAT_LENGTH(seg), addr[i] + off);
+			desc += CQHCI_DESC_LEN;
+		}
+	}
+	flush_dcache_range((ulong)host->cqe_desc,
+			   (ulong)host->cqe_desc + CQHCI_TDL_LEN);
+	flush_dcache_range((ulong)trans, (ulong)trans + trans_len);
+
+	cqhci_writel(host, GENMASK(count - 1, 0), CQHCI_TDBR);
+	ret = cqhci_wait(host, GENMASK(count - 1, 0));
+	if (ret)
+		cqhci_recover(host);
+
+	for (i = 0; i < count; i++)
+		dma_unmap_single(addr[i], tasks[i].blkcnt * MMC_MAX_BLOCK_LEN,
+				 dir);
+	free(trans);
+
+	return ret;
+}
+
+int sdhci_cqhci_init(struct mmc_config *cfg, struct sdhci_host *host,
+		     void *ioaddr)
+{
+	host->cqe_desc = memalign(max(ARCH_DMA_MINALIGN, SZ_1K),
+				  CQHCI_TDL_LEN);
+	if (!host->cqe_desc)
+		return -ENOMEM;
+	memset(host->cqe_desc, '\0', CQHCI_TDL_LEN);
+
+	host->cqe_ioaddr = ioaddr;
+	cfg->host_caps |= MMC_CAP_CQE;
+	log_debug("%s: CQHCI version %#x\n", host->name,
+		  cqhci_readl(host, CQHCI_VER));
+
+	return 0;
+}
@@ -23,7 +23,7 @@
 #include <phys2bus.h>
 #include <power/regulator.h>
 
-static void sdhci_reset(struct sdhci_host *host, u8 mask)
+void sdhci_reset(struct sdhci_host *host, u8 mask)
 {
 	unsigned long timeout;
 
@@ -368,6 +368,28 @@ static int sdhci_execute_tuning(struct udevice *dev, uint opcode)
 	}
 	return 0;
 }
+
+static int sdhci_get_tuning(struct udevice *dev, u32 *tuningp)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (host->ops && host->ops->platform_get_tuning)
+		return host->ops->platform_get_tuning(mmc, tuningp);
+
+	return -ENOSYS;
+}
+
+static int sdhci_set_tuning(struct udevice *dev, u32 tuning)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (host->ops && host->ops->platform_set_tuning)
+		return host->ops->platform_set_tuning(mmc, tuning);
+
+	return -ENOSYS;
+}
 #endif
 int sdhci_set_clock(struct mmc *mmc, unsigned int clock)
 {
@@ -850,11 +872,17 @@ const struct dm_mmc_ops sdhci_ops = {
 	.deferred_probe	= sdhci_deferred_probe,
 #ifdef MMC_SUPPORTS_TUNING
 	.execute_tuning	= sdhci_execute_tuning,
+	.get_tuning	= sdhci_get_tuning,
+	.set_tuning	= sdhci_set_tuning,
 #endif
 	.wait_dat0	= sdhci_wait_dat0,
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 	.set_enhanced_strobe = sdhci_set_enhanced_strobe,
 #endif
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQHCI)
+	.cqe_enable	= sdhci_cqe_enable,
+	.cqe_request	= sdhci_cqe_request,
+#endif
 };
 #else
 static const struct mmc_ops sdhci_ops = {
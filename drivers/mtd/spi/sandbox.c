@@ -15,6 +15,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <spi.h>
+#include <spi-mem.h>
 #include <os.h>
 
 #include <spi_flash.h>
@@ -64,6 +65,25 @@ static const char *sandbox_sf_state_name(enum sandbox_sf_state state)
 
 #define IDCODE_LEN 3
 
+/*
+ * Flashes which support 8D-8D-8D mode describe themselves with SFDP: a
+ * header followed by the Basic Flash Parameter Table, the xSPI Profile 1.0
+ * table and the Status, Control and Configuration Register map. Offsets and
+ * lengths are in double words.
+ */
+#define SF_SFDP_BFPT		8
+#define SF_SFDP_BFPT_LEN	20
+#define SF_SFDP_PROFILE1	(SF_SFDP_BFPT + SF_SFDP_BFPT_LEN)
+#define SF_SFDP_PROFILE1_LEN	5
+#define SF_SFDP_SCCR		(SF_SFDP_PROFILE1 + SF_SFDP_PROFILE1_LEN)
+#define SF_SFDP_SCCR_LEN	28
+#define SF_SFDP_LEN		(SF_SFDP_SCCR + SF_SFDP_SCCR_LEN)
+
+/* Dummy cycles of 8D-8D-8D reads, which is also what SFDP advertises */
+#define SF_OCTAL_DTR_DUMMY	20
+/* Dummy cycles of Read Status Register in 8D-8D-8D mode */
+#define SF_OCTAL_DTR_RDSR_DUMMY	4
+
 /* Used to quickly bulk erase backing store */
 static u8 sandbox_sf_0xff[0x1000];
 
@@ -94,6 +114,22 @@ struct sandbox_spi_flash {
 	const struct flash_info *data;
 	/* The file on disk to serv up data from */
 	int fd;
+	/* Number of read commands received */
+	uint read_count;
+	/* Whether the flash has been switched to 8D-8D-8D mode */
+	bool octal_dtr;
+	/* Whether the flash ignores requests to switch to 8D-8D-8D mode */
+	bool octal_dtr_refused;
+	/* Whether SFDP leaves out Software Reset */
+	bool sfdp_no_soft_reset;
+	/* Whether SFDP leaves out the volatile 8D-8D-8D enable bit */
+	bool sfdp_no_volatile_enable;
+	/* Whether the last command was Software Reset Enable */
+	bool reset_enabled;
+	/* Dummy cycles needed by 8D-8D-8D reads */
+	uint dummy_cycles;
+	/* SFDP table, for flashes which support 8D-8D-8D mode */
+	u32 sfdp[SF_SFDP_LEN];
 };
 
 struct sandbox_spi_flash_plat_data {
@@ -111,6 +147,93 @@ void sandbox_sf_set_block_protect(struct udevice *dev, int bp_mask)
 	sbsf->status |= bp_mask << STAT_BP_SHIFT;
 }
 
+uint sandbox_sf_get_read_count(struct udevice *dev)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	return sbsf->read_count;
+}
+
+void sandbox_sf_refuse_octal_dtr(struct udevice *dev, bool refuse)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	sbsf->octal_dtr_refused = refuse;
+}
+
+bool sandbox_sf_get_octal_dtr(struct udevice *dev)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	return sbsf->octal_dtr;
+}
+
+static void sandbox_sf_sfdp_param(u32 *header, u16 id, uint ptp, uint len)
+{
+	/* ID LSB, revision 1.0 and length */
+	header[0] = (id & 0xff) | 1 << 16 | len << 24;
+	/* Table pointer in bytes and ID MSB */
+	header[1] = ptp * sizeof(u32) | (u32)(id >> 8) << 24;
+}
+
+static void sandbox_sf_init_sfdp(struct sandbox_spi_flash *sbsf)
+{
+	const struct flash_info *data = sbsf->data;
+	u32 *sfdp = sbsf->sfdp;
+	u32 *bfpt = sfdp + SF_SFDP_BFPT;
+	u32 *profile1 = sfdp + SF_SFDP_PROFILE1;
+	u32 *sccr = sfdp + SF_SFDP_SCCR;
+	int i;
+
+	memset(sfdp, '\0', sizeof(sbsf->sfdp));
+	/* "SFDP", revision 1.0, three parameter headers (0-based count) */
+	sfdp[0] = 0x50444653;
+	sfdp[1] = 1 << 8 | 2 << 16 | 0xffU << 24;
+	sandbox_sf_sfdp_param(&sfdp[2], 0xff00, SF_SFDP_BFPT,
+			      SF_SFDP_BFPT_LEN);
+	sandbox_sf_sfdp_param(&sfdp[4], 0xff05, SF_SFDP_PROFILE1,
+			      SF_SFDP_PROFILE1_LEN);
+	sandbox_sf_sfdp_param(&sfdp[6], 0xff87, SF_SFDP_SCCR,
+			      SF_SFDP_SCCR_LEN);
+
+	/* 3 or 4 address bytes, no other single data rate read than 1-1-1 */
+	bfpt[0] = 1 << 17 | SPINOR_OP_BE_4K << 8 | 1;
+	/* Density in bits, minus one */
+	bfpt[1] = data->sector_size * data->n_sectors * 8 - 1;
+	/* Erase type 1 is 4KiB */
+	bfpt[7] = SPINOR_OP_BE_4K << 8 | 12;
+	/* 256-byte pages */
+	bfpt[10] = 8 << 4;
+	/* Software Reset with 66h/99h */
+	if (!sbsf->sfdp_no_soft_reset)
+		bfpt[15] = 1 << 12;
+	/* 8D-8D-8D opcodes are followed by their inverse */
+	bfpt[17] = 1 << 29;
+
+	/* Read opcode, Read Status Register takes 4 address bytes */
+	profile1[0] = SPINOR_OP_MXIC_DTR_RD << 8 | 1 << 29;
+	/* Dummy cycles at 200MHz */
+	profile1[3] = SF_OCTAL_DTR_DUMMY << 7;
+
+	/* 8D-8D-8D mode is enabled through a volatile register */
+	if (!sbsf->sfdp_no_volatile_enable)
+		sccr[21] = BIT(31);
+
+	for (i = 0; i < SF_SFDP_LEN; i++)
+		sfdp[i] = cpu_to_le32(sfdp[i]);
+}
+
+void sandbox_sf_set_octal_sfdp(struct udevice *dev, bool soft_reset,
+			       bool volatile_enable)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	sbsf->sfdp_no_soft_reset = !soft_reset;
+	sbsf->sfdp_no_volatile_enable = !volatile_enable;
+	if (sbsf->data->flags & SPI_NOR_OCTAL_DTR_READ)
+		sandbox_sf_init_sfdp(sbsf);
+}
+
 /**
  * This is a very strange probe function. If it has platform data (which may
  * have come from the device tree) then this function gets the filename and
@@ -182,6 +305,11 @@ static int sandbox_sf_probe(struct udevice *dev)
 	sbsf->data = data;
 	sbsf->cs = cs;
 
+	if (data->flags & SPI_NOR_OCTAL_DTR_READ) {
+		sbsf->dummy_cycles = SF_OCTAL_DTR_DUMMY;
+		sandbox_sf_init_sfdp(sbsf);
+	}
+
 	return 0;
 
  error:
@@ -250,6 +378,9 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 		sbsf->pad_addr_bytes = 1;
 		fallthrough;
 	case SPINOR_OP_READ:
+		sbsf->read_count++;
+		sbsf->state = SF_ADDR;
+		break;
 	case SPINOR_OP_PP:
 		sbsf->state = SF_ADDR;
 		break;
@@ -499,6 +630,213 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 	return pos == bytes ? 0 : -EIO;
 }
 
+/* Tell whether an operation is sent with the protocol the flash expects */
+static bool sandbox_sf_op_in_mode(struct sandbox_spi_flash *sbsf,
+				  const struct spi_mem_op *op)
+{
+	if (!sbsf->octal_dtr)
+		return op->cmd.buswidth == 1 && !op->cmd.dtr;
+
+	if (op->cmd.buswidth != 8 || !op->cmd.dtr || op->cmd.nbytes != 2 ||
+	    (op->cmd.opcode & 0xff) != (u8)~(op->cmd.opcode >> 8))
+		return false;
+	if (op->addr.nbytes && (op->addr.buswidth != 8 || !op->addr.dtr))
+		return false;
+	if (op->dummy.nbytes && (op->dummy.buswidth != 8 || !op->dummy.dtr))
+		return false;
+	if (op->data.nbytes && (op->data.buswidth != 8 || !op->data.dtr))
+		return false;
+
+	return true;
+}
+
+static int sandbox_sf_read_sfdp(struct sandbox_spi_flash *sbsf,
+				const struct spi_mem_op *op)
+{
+	const u8 *sfdp = (const u8 *)sbsf->sfdp;
+	u8 *buf = op->data.buf.in;
+	uint i, off;
+
+	if (op->data.dir != SPI_MEM_DATA_IN)
+		return -EIO;
+
+	for (i = 0; i < op->data.nbytes; i++) {
+		off = op->addr.val + i;
+		buf[i] = off < sizeof(sbsf->sfdp) ? sfdp[off] : 0xff;
+	}
+
+	return 0;
+}
+
+/* Macronix Configuration Register 2 holds the protocol and dummy cycles */
+static int sandbox_sf_write_cr2(struct sandbox_spi_flash *sbsf,
+				const struct spi_mem_op *op)
+{
+	u8 val;
+
+	if (op->addr.nbytes != 4 || op->data.dir != SPI_MEM_DATA_OUT ||
+	    !op->data.nbytes)
+		return -EIO;
+
+	if (!(sbsf->status & STAT_WEL)) {
+		puts("sandbox_sf: write enable not set before CR2 write\n");
+		return -EIO;
+	}
+	sbsf->status &= ~STAT_WEL;
+
+	val = *(const u8 *)op->data.buf.out;
+	switch (op->addr.val) {
+	case SPINOR_REG_MXIC_CR2_MODE:
+		if (sbsf->octal_dtr_refused) {
+			log_content(" octal DTR mode refused\n");
+			break;
+		}
+		sbsf->octal_dtr = val & SPINOR_REG_MXIC_OPI_DTR_EN;
+		break;
+	case SPINOR_REG_MXIC_CR2_DC:
+		/* From 20 cycles down to 6, in steps of 2 */
+		sbsf->dummy_cycles = SF_OCTAL_DTR_DUMMY - 2 * (val & 7);
+		break;
+	}
+
+	return 0;
+}
+
+static int sandbox_sf_op_data(struct sandbox_spi_flash *sbsf,
+			      const struct spi_mem_op *op)
+{
+	ssize_t ret;
+
+	if (os_lseek(sbsf->fd, op->addr.val, OS_SEEK_SET) < 0) {
+		puts("sandbox_sf: os_lseek() failed");
+		return -EIO;
+	}
+
+	if (op->data.dir == SPI_MEM_DATA_IN)
+		ret = os_read(sbsf->fd, op->data.buf.in, op->data.nbytes);
+	else
+		ret = os_write(sbsf->fd, op->data.buf.out, op->data.nbytes);
+
+	return ret == op->data.nbytes ? 0 : -EIO;
+}
+
+static int sandbox_sf_exec_octal_dtr(struct sandbox_spi_flash *sbsf,
+				     u8 opcode, const struct spi_mem_op *op)
+{
+	int ret;
+
+	switch (opcode) {
+	case SPINOR_OP_RDSR:
+		if (op->addr.nbytes != 4 ||
+		    op->dummy.nbytes != 2 * SF_OCTAL_DTR_RDSR_DUMMY)
+			break;
+		memset(op->data.buf.in, sbsf->status, op->data.nbytes);
+		return 0;
+	case SPINOR_OP_WREN:
+		sbsf->status |= STAT_WEL;
+		return 0;
+	case SPINOR_OP_WRDI:
+		sbsf->status &= ~STAT_WEL;
+		return 0;
+	case SPINOR_OP_MXIC_DTR_RD:
+		if (op->addr.nbytes != 4 ||
+		    op->dummy.nbytes != 2 * sbsf->dummy_cycles)
+			break;
+		sbsf->read_count++;
+		return sandbox_sf_op_data(sbsf, op);
+	case SPINOR_OP_PP:
+	case SPINOR_OP_PP_4B:
+		if (!(sbsf->status & STAT_WEL)) {
+			puts("sandbox_sf: write enable not set before write\n");
+			return -EIO;
+		}
+		sbsf->status &= ~STAT_WEL;
+		return sandbox_sf_op_data(sbsf, op);
+	case SPINOR_OP_BE_4K:
+	case SPINOR_OP_BE_4K_4B:
+		if (!(sbsf->status & STAT_WEL)) {
+			puts("sandbox_sf: write enable not set before erase\n");
+			return -EIO;
+		}
+		sbsf->status &= ~STAT_WEL;
+		if (op->addr.val & ((4 << 10) - 1)) {
+			log_content(" sector erase: needs align:%#x, but we got %#llx\n",
+				    4 << 10, op->addr.val);
+			return 0;
+		}
+		if (os_lseek(sbsf->fd, op->addr.val, OS_SEEK_SET) < 0) {
+			puts("sandbox_sf: os_lseek() failed");
+			return -EIO;
+		}
+		ret = sandbox_erase_part(sbsf, 4 << 10);
+		if (ret)
+			log_content("sandbox_sf: Erase failed\n");
+		return 0;
+	default:
+		log_content(" cmd unknown: %#x\n", opcode);
+		return -EIO;
+	}
+
+	/* Wrong address bytes or dummy cycles, so the data is garbage */
+	log_content(" cmd %#x: bad address bytes or dummy cycles\n", opcode);
+	if (op->data.dir == SPI_MEM_DATA_IN)
+		sandbox_spi_tristate(op->data.buf.in, op->data.nbytes);
+
+	return 0;
+}
+
+static int sandbox_sf_exec_op(struct udevice *dev, const struct spi_mem_op *op)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+	bool reset_enabled;
+	u8 opcode;
+
+	/* Other flashes are fine with the byte stream of xfer() */
+	if (!(sbsf->data->flags & SPI_NOR_OCTAL_DTR_READ))
+		return -ENOTSUPP;
+
+	if (!sandbox_sf_op_in_mode(sbsf, op)) {
+		/*
+		 * The flash cannot decode an operation sent with another
+		 * protocol, so it does nothing and the data lines float.
+		 */
+		log_content("sandbox_sf: op %#x not understood in %s mode\n",
+			    op->cmd.opcode, sbsf->octal_dtr ? "8D-8D-8D" :
+			    "1S-1S-1S");
+		if (op->data.dir == SPI_MEM_DATA_IN)
+			sandbox_spi_tristate(op->data.buf.in, op->data.nbytes);
+		return 0;
+	}
+
+	opcode = sbsf->octal_dtr ? op->cmd.opcode >> 8 : op->cmd.opcode;
+	reset_enabled = sbsf->reset_enabled;
+	sbsf->reset_enabled = false;
+
+	switch (opcode) {
+	case SPINOR_OP_SRSTEN:
+		sbsf->reset_enabled = true;
+		return 0;
+	case SPINOR_OP_SRST:
+		if (reset_enabled) {
+			log_content(" software reset\n");
+			sbsf->octal_dtr = false;
+			sbsf->dummy_cycles = SF_OCTAL_DTR_DUMMY;
+			sbsf->status &= ~STAT_WEL;
+		}
+		return 0;
+	case SPINOR_OP_RDSFDP:
+		return sandbox_sf_read_sfdp(sbsf, op);
+	case SPINOR_OP_WR_CR2:
+		return sandbox_sf_write_cr2(sbsf, op);
+	}
+
+	/* Everything else in 1S-1S-1S mode goes through xfer() */
+	if (!sbsf->octal_dtr)
+		return -ENOTSUPP;
+
+	return sandbox_sf_exec_octal_dtr(sbsf, opcode, op);
+}
+
 int sandbox_sf_of_to_plat(struct udevice *dev)
 {
 	struct sandbox_spi_flash_plat_data *pdata = dev_get_plat(dev);
@@ -516,6 +854,7 @@ int sandbox_sf_of_to_plat(struct udevice *dev)
 
 static const struct dm_spi_emul_ops sandbox_sf_emul_ops = {
 	.xfer          = sandbox_sf_xfer,
+	.exec_op       = sandbox_sf_exec_op,
 };
 
 #ifdef CONFIG_SPI_FLASH
@@ -12,6 +12,7 @@
 #include <common.h>
 #include <display_options.h>
 #include <log.h>
+#include <memalign.h>
 #include <watchdog.h>
 #include <dm.h>
 #include <dm/device_compat.h>
@@ -214,6 +215,9 @@ struct spi_nor_fixups {
 
 #define SPI_NOR_SRST_SLEEP_LEN			200
 
+/* How long to wait for the flash to answer after switching to 8D-8D-8D */
+#define SPI_NOR_OCTAL_DTR_READY_JIFFIES		(HZ / 10)
+
 /**
  * spi_nor_get_cmd_ext() - Get the command opcode extension based on the
  *			   extension type.
@@ -461,6 +465,78 @@ static ssize_t spi_nor_write_data(struct spi_nor *nor, loff_t to, size_t len,
 	return op.data.nbytes;
 }
 
+#if CONFIG_IS_ENABLED(SPI_FLASH_READ_CACHE)
+/* Drop the cached data, since the flash contents are about to change */
+static void spi_nor_rcache_invalidate(struct spi_nor *nor)
+{
+	nor->rcache.valid = 0;
+}
+
+/*
+ * Serve a read smaller than a cache line from the read cache, reading the
+ * whole line from the flash on a miss. Larger reads go straight to the flash.
+ * This returns less than @len if the read crosses the end of a line.
+ */
+static ssize_t spi_nor_read_cached(struct spi_nor *nor, loff_t from,
+				   size_t len, u_char *buf)
+{
+	struct spi_nor_rcache *rc = &nor->rcache;
+	loff_t addr = from & ~(loff_t)(SPI_NOR_RCACHE_LINE_SIZE - 1);
+	size_t offset = from - addr;
+	size_t done;
+	ssize_t ret;
+	u_char *line;
+	int i;
+
+	if (len >= SPI_NOR_RCACHE_LINE_SIZE)
+		return nor->read(nor, from, len, buf);
+
+	if (!rc->buf) {
+		rc->buf = malloc_cache_aligned(SPI_NOR_RCACHE_LINES *
+					       SPI_NOR_RCACHE_LINE_SIZE);
+		if (!rc->buf)
+			return nor->read(nor, from, len, buf);
+	}
+
+	for (i = 0; i < SPI_NOR_RCACHE_LINES; i++) {
+		if ((rc->valid & BIT(i)) && rc->addr[i] == addr)
+			break;
+	}
+	line = rc->buf + i * SPI_NOR_RCACHE_LINE_SIZE;
+
+	if (i == SPI_NOR_RCACHE_LINES) {
+		i = rc->next;
+		rc->next = (i + 1) % SPI_NOR_RCACHE_LINES;
+		rc->valid &= ~BIT(i);
+		line = rc->buf + i * SPI_NOR_RCACHE_LINE_SIZE;
+		for (done = 0; done < SPI_NOR_RCACHE_LINE_SIZE; done += ret) {
+			ret = nor->read(nor, addr + done,
+					SPI_NOR_RCACHE_LINE_SIZE - done,
+					line + done);
+			if (ret <= 0)
+				return ret;
+		}
+		rc->addr[i] = addr;
+		rc->valid |= BIT(i);
+	}
+
+	len = min(len, SPI_NOR_RCACHE_LINE_SIZE - offset);
+	memcpy(buf, line + offset, len);
+
+	return len;
+}
+#else
+static inline void spi_nor_rcache_invalidate(struct spi_nor *nor)
+{
+}
+
+static inline ssize_t spi_nor_read_cached(struct spi_nor *nor, loff_t from,
+					  size_t len, u_char *buf)
+{
+	return nor->read(nor, from, len, buf);
+}
+#endif
+
 /*
  * Read the status register, returning its value in the location
  * Return the status register value.
@@ -996,6 +1072,8 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	dev_dbg(nor->dev, "at 0x%llx, len %lld\n", (long long)instr->addr,
 		(long long)instr->len);
 
+	spi_nor_rcache_invalidate(nor);
+
 	div_u64_rem(instr->len, mtd->erasesize, &rem);
 	if (rem) {
 		ret = -EINVAL;
@@ -1465,7 +1543,7 @@ static int spi_nor_read(struct mtd_info *mtd, loff_t from, size_t len,
 			read_len = remain_len;
 #endif
 
-		ret = nor->read(nor, addr, read_len, buf);
+		ret = spi_nor_read_cached(nor, addr, read_len, buf);
 		if (ret == 0) {
 			/* We shouldn't see 0-length reads */
 			ret = -EIO;
@@ -1695,6 +1773,7 @@ static int sst_write(struct mtd_info *mtd, loff_t to, size_t len,
 	int ret;
 
 	dev_dbg(nor->dev, "to 0x%08x, len %zd\n", (u32)to, len);
+	spi_nor_rcache_invalidate(nor);
 	if (spi->mode & SPI_TX_BYTE)
 		return sst_write_byteprogram(nor, to, len, retlen, buf);
 
@@ -1778,6 +1857,7 @@ static int spi_nor_write(struct mtd_info *mtd, loff_t to, size_t len,
 #endif
 
 	dev_dbg(nor->dev, "to 0x%08x, len %zd\n", (u32)to, len);
+	spi_nor_rcache_invalidate(nor);
 
 	for (i = 0; i < len; ) {
 		ssize_t written;
@@ -2557,6 +2637,13 @@ static int spi_nor_parse_profile1(struct spi_nor *nor,
 	/* Round up to an even value to avoid tripping controllers up. */
 	dummy = ROUND_UP_TO(dummy, 2);
 
+	/*
+	 * The xSPI profile 1.0 table is only there on flashes that speak
+	 * 8D-8D-8D, and Page Program is mandatory in that mode.
+	 */
+	params->hwcaps.mask |= SNOR_HWCAPS_READ_8_8_8_DTR |
+			       SNOR_HWCAPS_PP_8_8_8_DTR;
+
 	/* Update the fast read settings. */
 	spi_nor_set_read_settings(&params->reads[SNOR_CMD_READ_8_8_8_DTR],
 				  0, dummy, opcode,
@@ -3010,7 +3097,7 @@ static int spi_nor_check_readop(struct spi_nor *nor,
 
 	op.dummy.nbytes = (read->num_mode_clocks + read->num_wait_states) *
 			  op.dummy.buswidth / 8;
-	if (spi_nor_protocol_is_dtr(nor->read_proto))
+	if (spi_nor_protocol_is_dtr(read->proto))
 		op.dummy.nbytes *= 2;
 
 	return spi_nor_check_op(nor, &op);
@@ -3816,24 +3903,40 @@ static struct spi_nor_fixups macronix_octal_fixups = {
 };
 #endif /* CONFIG_SPI_FLASH_MACRONIX */
 
+/**
+ * spi_nor_can_octal_dtr() - check if the flash can be switched to 8D-8D-8D
+ * @nor:	pointer to a 'struct spi_nor'
+ *
+ * 8D-8D-8D is a stateful mode: the flash must be told to switch, and then
+ * every command has to be sent that way. That needs a vendor hook and a
+ * volatile enable bit, so that a reset brings the flash back to 1S-1S-1S.
+ *
+ * Return: true if the switch can be done, false otherwise.
+ */
+static bool spi_nor_can_octal_dtr(struct spi_nor *nor)
+{
+	return nor->octal_dtr_enable &&
+	       nor->flags & SNOR_F_IO_MODE_EN_VOLATILE;
+}
+
 /** spi_nor_octal_dtr_enable() - enable Octal DTR I/O if needed
  * @nor:                 pointer to a 'struct spi_nor'
  *
+ * Switch the flash to 8D-8D-8D if that is what was selected for reads and
+ * writes, then check that the flash answers in its new mode.
+ *
  * Return: 0 on success, -errno otherwise.
  */
 static int spi_nor_octal_dtr_enable(struct spi_nor *nor)
 {
 	int ret;
 
-	if (!nor->octal_dtr_enable)
-		return 0;
-
-	if (!(nor->read_proto == SNOR_PROTO_8_8_8_DTR &&
-	      nor->write_proto == SNOR_PROTO_8_8_8_DTR))
+	if (nor->read_proto != SNOR_PROTO_8_8_8_DTR &&
+	    nor->write_proto != SNOR_PROTO_8_8_8_DTR)
 		return 0;
 
-	if (!(nor->flags & SNOR_F_IO_MODE_EN_VOLATILE))
-		return 0;
+	if (nor->read_proto != nor->write_proto || !spi_nor_can_octal_dtr(nor))
+		return -EOPNOTSUPP;
 
 	ret = nor->octal_dtr_enable(nor);
 	if (ret)
@@ -3841,7 +3944,12 @@ static int spi_nor_octal_dtr_enable(struct spi_nor *nor)
 
 	nor->reg_proto = SNOR_PROTO_8_8_8_DTR;
 
-	return 0;
+	/*
+	 * A flash that did not follow us cannot decode 8D-8D-8D commands and
+	 * leaves the bus floating, which reads as busy forever.
+	 */
+	return spi_nor_wait_till_ready_with_timeout(nor,
+						    SPI_NOR_OCTAL_DTR_READY_JIFFIES);
 }
 
 static int spi_nor_init(struct spi_nor *nor)
@@ -3956,6 +4064,12 @@ out:
 
 int spi_nor_remove(struct spi_nor *nor)
 {
+#if CONFIG_IS_ENABLED(SPI_FLASH_READ_CACHE)
+	free(nor->rcache.buf);
+	nor->rcache.buf = NULL;
+	nor->rcache.valid = 0;
+#endif
+
 #ifdef CONFIG_SPI_FLASH_SOFT_RESET
 	if (nor->info->flags & SPI_NOR_OCTAL_DTR_READ &&
 	    nor->flags & SNOR_F_SOFT_RESET)
@@ -4006,12 +4120,105 @@ void spi_nor_set_fixups(struct spi_nor *nor)
 #endif /* SPI_FLASH_MACRONIX */
 }
 
+static int spi_nor_set_addr_width(struct spi_nor *nor,
+				  const struct flash_info *info)
+{
+	struct mtd_info *mtd = &nor->mtd;
+	int ret __maybe_unused;
+
+	if (spi_nor_protocol_is_dtr(nor->read_proto)) {
+		 /* Always use 4-byte addresses in DTR mode. */
+		nor->addr_width = 4;
+	} else if (nor->addr_width) {
+		/* already configured from SFDP */
+	} else if (info->addr_width) {
+		nor->addr_width = info->addr_width;
+	} else {
+		nor->addr_width = 3;
+	}
+
+	if (nor->addr_width == 3 && mtd->size > SZ_16M) {
+#ifndef CONFIG_SPI_FLASH_BAR
+		/* enable 4-byte addressing if the device exceeds 16MiB */
+		nor->addr_width = 4;
+		if (JEDEC_MFR(info) == SNOR_MFR_SPANSION ||
+		    info->flags & SPI_NOR_4B_OPCODES)
+			spi_nor_set_4byte_opcodes(nor, info);
+#else
+	/* Configure the BAR - discover bank cmds and read current bank */
+	nor->addr_width = 3;
+	ret = read_bar(nor, info);
+	if (ret < 0)
+		return ret;
+#endif
+	}
+
+	if (nor->addr_width > SPI_NOR_MAX_ADDR_WIDTH) {
+		dev_dbg(nor->dev, "address width is too large: %u\n",
+			nor->addr_width);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * spi_nor_octal_dtr_fallback() - carry on without 8D-8D-8D
+ * @nor:	the spi_nor structure
+ * @info:	the flash being set up
+ * @params:	flash parameters, with the 8D-8D-8D capabilities still set
+ *
+ * Called when the switch to 8D-8D-8D failed. Bring the flash back to
+ * 1S-1S-1S if it might have switched, then select the fastest protocol left
+ * and initialize the flash again.
+ *
+ * A flash which was told to switch but did not answer in time may still be
+ * in 8D-8D-8D. Without a software reset there is no way to tell it to go
+ * back, and talking to it in 1S-1S-1S could be misread as other commands,
+ * so give up instead.
+ *
+ * Return: 0 for success, -errno for failure.
+ */
+static int spi_nor_octal_dtr_fallback(struct spi_nor *nor,
+				      const struct flash_info *info,
+				      struct spi_nor_flash_parameter *params)
+{
+	int ret;
+
+	if (nor->reg_proto == SNOR_PROTO_8_8_8_DTR) {
+		ret = -EOPNOTSUPP;
+#ifdef CONFIG_SPI_FLASH_SOFT_RESET
+		if (nor->flags & SNOR_F_SOFT_RESET)
+			ret = spi_nor_soft_reset(nor);
+#endif
+		if (ret) {
+			dev_err(nor->dev, "cannot reset flash to 1S-1S-1S (err=%d)\n",
+				ret);
+			return ret;
+		}
+	}
+	nor->reg_proto = SNOR_PROTO_1_1_1;
+	params->hwcaps.mask &= ~(SNOR_HWCAPS_READ_8_8_8_DTR |
+				 SNOR_HWCAPS_PP_8_8_8_DTR);
+
+	ret = spi_nor_setup(nor, info, params);
+	if (ret)
+		return ret;
+
+	ret = spi_nor_set_addr_width(nor, info);
+	if (ret)
+		return ret;
+
+	return spi_nor_init(nor);
+}
+
 int spi_nor_scan(struct spi_nor *nor)
 {
 	struct spi_nor_flash_parameter params;
 	const struct flash_info *info = NULL;
 	struct mtd_info *mtd = &nor->mtd;
 	struct spi_slave *spi = nor->spi;
+	u8 sfdp_addr_width;
 	int ret;
 	int cfi_mtd_nb = 0;
 
@@ -4129,6 +4336,14 @@ int spi_nor_scan(struct spi_nor *nor)
 	if ((info->flags & SPI_NOR_NO_FR) || (spi->mode & SPI_RX_SLOW))
 		params.hwcaps.mask &= ~SNOR_HWCAPS_READ_FAST;
 
+	/*
+	 * SFDP may advertise 8D-8D-8D, for instance with an xSPI profile 1.0
+	 * table, on a flash we do not know how to switch.
+	 */
+	if (!spi_nor_can_octal_dtr(nor))
+		params.hwcaps.mask &= ~(SNOR_HWCAPS_READ_8_8_8_DTR |
+					SNOR_HWCAPS_PP_8_8_8_DTR);
+
 	/*
 	 * Configure the SPI memory:
 	 * - select op codes for (Fast) Read, Page Program and Sector Erase.
@@ -4136,50 +4351,31 @@ int spi_nor_scan(struct spi_nor *nor)
 	 * - set the SPI protocols for register and memory accesses.
 	 * - set the Quad Enable bit if needed (required by SPI x-y-4 protos).
 	 */
+	sfdp_addr_width = nor->addr_width;
 	ret = spi_nor_setup(nor, info, &params);
 	if (ret)
 		return ret;
 
-	if (spi_nor_protocol_is_dtr(nor->read_proto)) {
-		 /* Always use 4-byte addresses in DTR mode. */
-		nor->addr_width = 4;
-	} else if (nor->addr_width) {
-		/* already configured from SFDP */
-	} else if (info->addr_width) {
-		nor->addr_width = info->addr_width;
-	} else {
-		nor->addr_width = 3;
-	}
-
-	if (nor->addr_width == 3 && mtd->size > SZ_16M) {
-#ifndef CONFIG_SPI_FLASH_BAR
-		/* enable 4-byte addressing if the device exceeds 16MiB */
-		nor->addr_width = 4;
-		if (JEDEC_MFR(info) == SNOR_MFR_SPANSION ||
-		    info->flags & SPI_NOR_4B_OPCODES)
-			spi_nor_set_4byte_opcodes(nor, info);
-#else
-	/* Configure the BAR - discover bank cmds and read current bank */
-	nor->addr_width = 3;
-	ret = read_bar(nor, info);
-	if (ret < 0)
+	ret = spi_nor_set_addr_width(nor, info);
+	if (ret)
 		return ret;
-#endif
-	}
 
-	if (nor->addr_width > SPI_NOR_MAX_ADDR_WIDTH) {
-		dev_dbg(nor->dev, "address width is too large: %u\n",
-			nor->addr_width);
-		return -EINVAL;
-	}
+	/* Needed as soon as the flash is switched to 8D-8D-8D. */
+	nor->rdsr_dummy = params.rdsr_dummy;
+	nor->rdsr_addr_nbytes = params.rdsr_addr_nbytes;
 
 	/* Send all the required SPI flash commands to initialize device */
 	ret = spi_nor_init(nor);
+	if (ret && (spi_nor_protocol_is_dtr(nor->read_proto) ||
+		    spi_nor_protocol_is_dtr(nor->write_proto))) {
+		dev_warn(nor->dev, "failed to enable Octal DTR mode (err=%d)\n",
+			 ret);
+		nor->addr_width = sfdp_addr_width;
+		ret = spi_nor_octal_dtr_fallback(nor, info, &params);
+	}
 	if (ret)
 		return ret;
 
-	nor->rdsr_dummy = params.rdsr_dummy;
-	nor->rdsr_addr_nbytes = params.rdsr_addr_nbytes;
 	nor->name = info->name;
 	nor->size = mtd->size;
 	nor->erase_size = mtd->erasesize;
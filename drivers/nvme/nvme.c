@@ -18,7 +18,11 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+#define NVME_Q_DEPTH		(NVME_ASYNC_CMDS + 1)
+#else
 #define NVME_Q_DEPTH		2
+#endif
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
@@ -45,8 +49,12 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/*
+ * Set up the PRP list for a transfer in *@poolp, which holds *@entry_nump
+ * entries and is reallocated if it is too small
+ */
+static int nvme_setup_prps(struct nvme_dev *dev, u64 **poolp, u32 *entry_nump,
+			   u64 *prp2, int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
@@ -74,21 +82,22 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	nprps = DIV_ROUND_UP(length, page_size);
 	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
+	if (nprps > *entry_nump) {
+		free(*poolp);
 		/*
 		 * Always increase in increments of pages.  It doesn't waste
 		 * much memory and reduces the number of allocations.
 		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
+		*poolp = memalign(page_size, num_pages * page_size);
+		if (!*poolp) {
+			*entry_nump = 0;
 			printf("Error: malloc prp_pool fail\n");
 			return -ENOMEM;
 		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
+		*entry_nump = num_pages * (prps_per_page - 1) + 1;
 	}
 
-	prp_pool = dev->prp_pool;
+	prp_pool = *poolp;
 	i = 0;
 	while (nprps) {
 		if ((i == (prps_per_page - 1)) && nprps > 1) {
@@ -101,10 +110,9 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)*poolp;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   num_pages * page_size);
+	flush_dcache_range((ulong)*poolp, (ulong)*poolp + num_pages * page_size);
 
 	return 0;
 }
@@ -742,6 +750,20 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
+static void nvme_init_rw_cmd(struct nvme_ns *ns, struct nvme_command *c,
+			     bool read)
+{
+	c->rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
+	c->rw.flags = 0;
+	c->rw.nsid = cpu_to_le32(ns->ns_id);
+	c->rw.control = 0;
+	c->rw.dsmgmt = 0;
+	c->rw.reftag = 0;
+	c->rw.apptag = 0;
+	c->rw.appmask = 0;
+	c->rw.metadata = 0;
+}
+
 static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			 lbaint_t blkcnt, void *buffer, bool read)
 {
@@ -762,15 +784,7 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
+	nvme_init_rw_cmd(ns, &c, read);
 
 	while (total_lbas) {
 		if (total_lbas < lbas) {
@@ -780,8 +794,8 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 			total_lbas -= lbas;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
+		if (nvme_setup_prps(dev, &dev->prp_pool, &dev->prp_entry_num,
+				    &prp2, lbas << ns->lba_shift, temp_buffer))
 			return -EIO;
 		c.rw.slba = cpu_to_le64(slba);
 		slba += lbas;
@@ -815,9 +829,150 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 	return nvme_blk_rw(udev, blknr, blkcnt, (void *)buffer, false);
 }
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+static int nvme_blk_submit(struct udevice *udev, struct blk_request *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_ops *ops = (struct nvme_ops *)dev->udev->driver->ops;
+	bool read = req->op == BLK_REQ_READ;
+	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
+	uint max_cmds = min(nvmeq->q_depth - 1, NVME_ASYNC_CMDS);
+	struct nvme_async_cmd *acmd;
+	uintptr_t buffer = (uintptr_t)req->buf;
+	lbaint_t left = req->blkcnt;
+	u64 slba = req->start;
+	uint ncmds, i;
+	u64 prp2;
+	u32 len;
+	int ret;
+
+	/* controllers with their own queue hooks expect one command at once */
+	if (ops && ops->submit_cmd)
+		return -ENOSYS;
+
+	ncmds = DIV_ROUND_UP(req->blkcnt, lbas);
+	if (ncmds > max_cmds)
+		return -ENOSYS;
+	if (dev->async_inflight + ncmds > max_cmds)
+		return -EAGAIN;
+	if (!ncmds) {
+		blk_request_done(req, 0);
+		return 0;
+	}
+
+	flush_dcache_range(buffer, buffer + (req->blkcnt << ns->lba_shift));
+
+	/* claim the slots and set up every PRP list before starting any */
+	req->pending = 0;
+	for (i = 0; left; i++) {
+		acmd = &dev->async[i];
+		if (acmd->req)
+			continue;
+		if (left < lbas)
+			lbas = left;
+		len = lbas << ns->lba_shift;
+		ret = nvme_setup_prps(dev, &acmd->prp_pool,
+				      &acmd->prp_entry_num, &prp2, len, buffer);
+		if (ret)
+			goto err;
+		nvme_init_rw_cmd(ns, &acmd->cmd, read);
+		acmd->cmd.rw.command_id = cpu_to_le16(i);
+		acmd->cmd.rw.slba = cpu_to_le64(slba);
+		acmd->cmd.rw.length = cpu_to_le16(lbas - 1);
+		acmd->cmd.rw.prp1 = cpu_to_le64(buffer);
+		acmd->cmd.rw.prp2 = cpu_to_le64(prp2);
+		acmd->req = req;
+		acmd->buf = buffer;
+		acmd->len = len;
+		req->pending++;
+		slba += lbas;
+		buffer += len;
+		left -= lbas;
+	}
+
+	for (i = 0; i < max_cmds; i++) {
+		if (dev->async[i].req == req)
+			nvme_submit_cmd(nvmeq, &dev->async[i].cmd);
+	}
+	dev->async_inflight += ncmds;
+
+	return 0;
+
+err:
+	for (i = 0; i < max_cmds; i++) {
+		if (dev->async[i].req == req)
+			dev->async[i].req = NULL;
+	}
+
+	return ret;
+}
+
+static int nvme_blk_poll(struct udevice *udev)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	struct nvme_async_cmd *acmd;
+	struct blk_request *req;
+	int completed = 0;
+	u16 status, id;
+
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase)
+			break;
+
+		id = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		if (id >= NVME_ASYNC_CMDS || !dev->async[id].req) {
+			printf("ERROR: unexpected command id %x\n", id);
+			continue;
+		}
+
+		acmd = &dev->async[id];
+		req = acmd->req;
+		acmd->req = NULL;
+		dev->async_inflight--;
+		status >>= 1;
+		if (status) {
+			printf("ERROR: status = %x, command id = %x\n", status,
+			       id);
+			req->error = -EIO;
+		} else if (req->op == BLK_REQ_READ) {
+			invalidate_dcache_range(acmd->buf,
+						acmd->buf + acmd->len);
+		}
+		if (!--req->pending) {
+			blk_request_done(req, req->error ? req->error :
+					 (long)req->blkcnt);
+			completed++;
+		}
+	}
+
+	if (head != nvmeq->cq_head || phase != nvmeq->cq_phase) {
+		writel(head, nvmeq->q_db + dev->db_stride);
+		nvmeq->cq_head = head;
+		nvmeq->cq_phase = phase;
+	}
+
+	return completed;
+}
+#endif
+
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	.submit	= nvme_blk_submit,
+	.poll	= nvme_blk_poll,
+#endif
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
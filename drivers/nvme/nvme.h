@@ -594,6 +594,22 @@ enum {
 	NVME_CSTS_SHST_MASK	= 3 << 2,
 };
 
+/* Number of I/O commands that can be in flight through blk_submit() */
+#define NVME_ASYNC_CMDS		15
+
+/*
+ * An I/O command issued on behalf of an asynchronous block request. Large
+ * requests are split into several commands, each with its own PRP list.
+ */
+struct nvme_async_cmd {
+	struct blk_request *req;
+	struct nvme_command cmd;
+	ulong buf;
+	u32 len;
+	u64 *prp_pool;
+	u32 prp_entry_num;
+};
+
 /* Represents an NVM Express device. Each nvme_dev is a PCI function. */
 struct nvme_dev {
 	struct udevice *udev;
@@ -621,6 +637,10 @@ struct nvme_dev {
 	u64 *prp_pool;
 	u32 prp_entry_num;
 	u32 nn;
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	struct nvme_async_cmd async[NVME_ASYNC_CMDS];
+	uint async_inflight;
+#endif
 };
 
 /* Admin queue and a single I/O queue. */
@@ -15,6 +15,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <spi.h>
+#include <spi-mem.h>
 #include <spi_flash.h>
 #include <os.h>
 
@@ -62,26 +63,12 @@ uint sandbox_spi_get_mode(struct udevice *dev)
 	return priv->mode;
 }
 
-static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
-			    const void *dout, void *din, unsigned long flags)
+static int sandbox_spi_find_emul(struct udevice *slave, struct udevice **emulp)
 {
 	struct udevice *bus = slave->parent;
 	struct sandbox_state *state = state_get_current();
-	struct dm_spi_emul_ops *ops;
-	struct udevice *emul;
-	uint bytes = bitlen / 8, i;
-	int ret;
 	uint busnum, cs;
-
-	if (bitlen == 0)
-		return 0;
-
-	/* we can only do 8 bit transfers */
-	if (bitlen % 8) {
-		printf("sandbox_spi: xfer: invalid bitlen size %u; needs to be 8bit\n",
-		       bitlen);
-		return -EINVAL;
-	}
+	int ret;
 
 	busnum = dev_seq(bus);
 	cs = spi_chip_select(slave);
@@ -91,13 +78,35 @@ static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
 		       busnum, cs);
 		return -ENOENT;
 	}
-	ret = sandbox_spi_get_emul(state, bus, slave, &emul);
+	ret = sandbox_spi_get_emul(state, bus, slave, emulp);
 	if (ret) {
 		printf("%s: busnum=%u, cs=%u: no emulation available (err=%d)\n",
 		       __func__, busnum, cs, ret);
 		return -ENOENT;
 	}
-	ret = device_probe(emul);
+
+	return device_probe(*emulp);
+}
+
+static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
+			    const void *dout, void *din, unsigned long flags)
+{
+	struct dm_spi_emul_ops *ops;
+	struct udevice *emul;
+	uint bytes = bitlen / 8, i;
+	int ret;
+
+	if (bitlen == 0)
+		return 0;
+
+	/* we can only do 8 bit transfers */
+	if (bitlen % 8) {
+		printf("sandbox_spi: xfer: invalid bitlen size %u; needs to be 8bit\n",
+		       bitlen);
+		return -EINVAL;
+	}
+
+	ret = sandbox_spi_find_emul(slave, &emul);
 	if (ret)
 		return ret;
 
@@ -115,6 +124,45 @@ static int sandbox_spi_xfer(struct udevice *slave, unsigned int bitlen,
 	return ret;
 }
 
+#ifdef CONFIG_SPI_MEM
+static bool sandbox_spi_supports_op(struct spi_slave *slave,
+				    const struct spi_mem_op *op)
+{
+	if (op->cmd.dtr)
+		return spi_mem_dtr_supports_op(slave, op);
+
+	return spi_mem_default_supports_op(slave, op);
+}
+
+/*
+ * Let the emulation see whole operations, so it can tell the protocol they
+ * are sent with. It returns -ENOTSUPP for those which are fine as a byte
+ * stream, and spi-mem then sends them through sandbox_spi_xfer().
+ */
+static int sandbox_spi_exec_op(struct spi_slave *slave,
+			       const struct spi_mem_op *op)
+{
+	struct dm_spi_emul_ops *ops;
+	struct udevice *emul;
+	int ret;
+
+	ret = sandbox_spi_find_emul(slave->dev, &emul);
+	if (ret)
+		return ret;
+
+	ops = spi_emul_get_ops(emul);
+	if (!ops->exec_op)
+		return -ENOTSUPP;
+
+	return ops->exec_op(emul, op);
+}
+
+static const struct spi_controller_mem_ops sandbox_spi_mem_ops = {
+	.supports_op	= sandbox_spi_supports_op,
+	.exec_op	= sandbox_spi_exec_op,
+};
+#endif
+
 static int sandbox_spi_set_speed(struct udevice *bus, uint speed)
 {
 	struct sandbox_spi_priv *priv = dev_get_priv(bus);
@@ -159,6 +207,9 @@ static const struct dm_spi_ops sandbox_spi_ops = {
 	.set_mode	= sandbox_spi_set_mode,
 	.cs_info	= sandbox_cs_info,
 	.get_mmap	= sandbox_spi_get_mmap,
+#ifdef CONFIG_SPI_MEM
+	.mem_ops	= &sandbox_spi_mem_ops,
+#endif
 };
 
 static const struct udevice_id sandbox_spi_ids[] = {
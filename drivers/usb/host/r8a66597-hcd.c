@@ -9,6 +9,7 @@
 #include <console.h>
 #include <dm.h>
 #include <log.h>
+#include <time.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <dm/device_compat.h>
@@ -790,6 +791,50 @@ static int r8a66597_usb_of_to_plat(struct udevice *dev)
 	return 0;
 }
 
+/* Steps of the probe which are waited for after it returns */
+enum {
+	R8A66597_PROBE_RESET,
+	R8A66597_PROBE_ATTACH,
+	R8A66597_PROBE_POWER,
+};
+
+/*
+ * Finish the probe without holding up other devices: wait for the controller
+ * reset, then up to a second for a device to be attached, then for the port
+ * power to settle
+ */
+static int r8a66597_usb_probe_poll(struct udevice *dev)
+{
+	struct r8a66597 *priv = dev_get_priv(dev);
+
+	switch (priv->probe_step) {
+	case R8A66597_PROBE_RESET:
+		if (get_timer(priv->probe_start) < 100)
+			return -EAGAIN;
+		enable_controller(priv);
+		r8a66597_port_power(priv, 0, 1);
+		priv->probe_step = R8A66597_PROBE_ATTACH;
+		priv->probe_start = get_timer(0);
+		fallthrough;
+	case R8A66597_PROBE_ATTACH:
+		/* check usb device */
+		if (r8a66597_read(priv, INTSTS1) & ATTCH)
+			check_usb_device_connecting(priv);
+		else if (get_timer(priv->probe_start) < 1000)
+			return -EAGAIN;
+		else
+			printf("%s timeout.\n", __func__);
+		priv->probe_step = R8A66597_PROBE_POWER;
+		priv->probe_start = get_timer(0);
+		fallthrough;
+	case R8A66597_PROBE_POWER:
+		if (get_timer(priv->probe_start) < 50)
+			return -EAGAIN;
+	}
+
+	return 0;
+}
+
 static int r8a66597_usb_probe(struct udevice *dev)
 {
 	struct r8a66597 *priv = dev_get_priv(dev);
@@ -816,17 +861,10 @@ static int r8a66597_usb_probe(struct udevice *dev)
 	}
 
 	disable_controller(priv);
-	mdelay(100);
-
-	enable_controller(priv);
-	r8a66597_port_power(priv, 0, 1);
+	priv->probe_step = R8A66597_PROBE_RESET;
+	priv->probe_start = get_timer(0);
 
-	/* check usb device */
-	check_usb_device_connecting(priv);
-
-	mdelay(50);
-
-	return 0;
+	return device_probe_later(dev, r8a66597_usb_probe_poll, 5000);
 }
 
 static int r8a66597_usb_remove(struct udevice *dev)
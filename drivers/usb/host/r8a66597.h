@@ -398,6 +398,8 @@ struct r8a66597 {
 	u16 speed;	/* HSMODE or FSMODE or LSMODE */
 	unsigned char rh_devnum;
 	struct udevice *vbus_supply;
+	ulong probe_start;	/* start of the current step of the probe */
+	int probe_step;		/* step of the probe being waited for */
 };
 
 static inline u16 r8a66597_read(struct r8a66597 *r8a66597, unsigned long offset)
@@ -305,6 +305,8 @@ int usb_init(void)
 
 	uc_priv = uclass_get_priv(uc);
 
+	/* Let the controllers power up together */
+	device_probe_later_begin();
 	uclass_foreach_dev(bus, uc) {
 		/* init low_level USB */
 		printf("Bus %s: ", bus->name);
@@ -346,6 +348,7 @@ int usb_init(void)
 		controllers_initialized++;
 		usb_started = true;
 	}
+	device_probe_later_end();
 
 	/*
 	 * lowlevel init done, now scan the bus for devices i.e. search HUBs
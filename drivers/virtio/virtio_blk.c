@@ -15,26 +15,45 @@
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/* Maximum number of asynchronous requests in flight */
+#define VIRTIO_BLK_MAX_ASYNC	16
+
+/**
+ * struct virtio_blk_slot - an asynchronous request in flight
+ *
+ * @out_hdr: Request header, which is also the head of the descriptor chain
+ * @status: Status written by the device
+ * @req: Block request being carried out, or NULL if the slot is free
+ */
+struct virtio_blk_slot {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	struct blk_request *req;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	struct virtio_blk_slot slots[VIRTIO_BLK_MAX_ASYNC];
+#endif
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+/* Add a descriptor chain for a request to the virtqueue */
+static int virtio_blk_add_req(struct udevice *dev,
+			      struct virtio_blk_outhdr *out_hdr, u8 *status,
+			      u64 sector, lbaint_t blkcnt, void *buffer,
+			      u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	unsigned int num_out = 0, num_in = 0;
 	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
-
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
+	struct virtio_sg hdr_sg = { out_hdr, sizeof(*out_hdr) };
 	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	struct virtio_sg status_sg = { status, sizeof(*status) };
+
+	out_hdr->type = cpu_to_virtio32(dev, type);
+	out_hdr->ioprio = 0;
+	out_hdr->sector = cpu_to_virtio64(dev, sector);
 
 	sgs[num_out++] = &hdr_sg;
 
@@ -47,7 +66,19 @@ static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
 	log_debug("dev=%s, active=%d, priv=%p, priv->vq=%p\n", dev->name,
 		  device_active(dev), priv, priv->vq);
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
+	return virtqueue_add(priv->vq, sgs, num_out, num_in);
+}
+
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	int ret;
+
+	ret = virtio_blk_add_req(dev, &out_hdr, &status, sector, blkcnt,
+				 buffer, type);
 	if (ret)
 		return ret;
 
@@ -76,6 +107,67 @@ static ulong virtio_blk_write(struct udevice *dev, lbaint_t start,
 				 VIRTIO_BLK_T_OUT);
 }
 
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+static int virtio_blk_submit(struct udevice *dev, struct blk_request *req)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_slot *slot;
+	int i, ret;
+
+	/*
+	 * With bounce buffers, the completed chain cannot be matched back
+	 * to its slot, so let the uclass handle the request synchronously
+	 */
+	if (priv->vq->vring.bouncebufs)
+		return -ENOSYS;
+
+	for (i = 0, slot = priv->slots; i < VIRTIO_BLK_MAX_ASYNC; i++, slot++) {
+		if (!slot->req)
+			break;
+	}
+	if (i == VIRTIO_BLK_MAX_ASYNC)
+		return -EAGAIN;
+
+	ret = virtio_blk_add_req(dev, &slot->out_hdr, &slot->status,
+				 req->start, req->blkcnt, req->buf,
+				 req->op == BLK_REQ_WRITE ? VIRTIO_BLK_T_OUT :
+				 VIRTIO_BLK_T_IN);
+	if (ret == -ENOSPC)
+		return -EAGAIN;
+	if (ret)
+		return ret;
+	slot->req = req;
+	virtqueue_kick(priv->vq);
+
+	return 0;
+}
+
+static int virtio_blk_poll(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_slot *slot;
+	struct blk_request *req;
+	void *hdr;
+	int count = 0;
+
+	while ((hdr = virtqueue_get_buf(priv->vq, NULL))) {
+		slot = container_of(hdr, struct virtio_blk_slot, out_hdr);
+		if (slot < priv->slots ||
+		    slot >= priv->slots + VIRTIO_BLK_MAX_ASYNC || !slot->req) {
+			log_err("unexpected buffer %p\n", hdr);
+			return -EFAULT;
+		}
+		req = slot->req;
+		slot->req = NULL;
+		blk_request_done(req, slot->status == VIRTIO_BLK_S_OK ?
+				 req->blkcnt : -EIO);
+		count++;
+	}
+
+	return count;
+}
+#endif
+
 static int virtio_blk_bind(struct udevice *dev)
 {
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(dev->parent);
@@ -132,6 +224,10 @@ static int virtio_blk_probe(struct udevice *dev)
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	.submit	= virtio_blk_submit,
+	.poll	= virtio_blk_poll,
+#endif
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
@@ -1530,17 +1530,26 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+/*
+ * Find the leaf of the extent tree which covers @fileblock. Index and leaf
+ * blocks are read into @cache, which has @ncache entries: the block for
+ * each level goes in its own entry, with the deepest levels sharing the last
+ * one.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
-	(struct ext2_data *data, struct ext_block_cache *cache,
+	(struct ext2_data *data, struct ext_block_cache *cache, int ncache,
 		struct ext4_extent_header *ext_block,
 		uint32_t fileblock, int log2_blksz)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
+	int level = 0;
 	int i;
 
 	while (1) {
+		struct ext_block_cache *c;
+
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
 		if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC)
@@ -1565,9 +1574,11 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 		block <<= log2_blksz;
-		if (!ext_cache_read(cache, (lbaint_t)block, blksz))
+		c = &cache[min(level, ncache - 1)];
+		if (!ext_cache_read(c, (lbaint_t)block, blksz))
 			return NULL;
-		ext_block = (struct ext4_extent_header *)cache->buf;
+		ext_block = (struct ext4_extent_header *)c->buf;
+		level++;
 	}
 }
 
@@ -1647,6 +1658,69 @@ int ext4fs_read_inode(struct ext2_data *data, int ino, struct ext2_inode *inode)
 	return 1;
 }
 
+/**
+ * ext4fs_map_extent() - Map a file block through the extent tree
+ *
+ * @inode: Inode of the file, which must use extents
+ * @fileblock: File block to look up
+ * @cache: Blocks of the tree read by earlier lookups
+ * @blknrp: Returns the filesystem block holding @fileblock, or 0 if it is in a
+ *	hole or an unwritten extent, so reads as zeroes
+ * Return: number of file blocks starting at @fileblock which are contiguous
+ *	on the device (or are all zeroes), or -ve on error
+ */
+long ext4fs_map_extent(struct ext2_inode *inode, uint32_t fileblock,
+		       struct ext_extent_cache *cache,
+		       unsigned long long *blknrp)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	int log2_blksz;
+	int i;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, cache->level,
+					    EXT4_EXT_MAX_DEPTH,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	*blknrp = 0;
+	extent = (struct ext4_extent *)(ext_block + 1);
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		uint32_t startblock = le32_to_cpu(extent[i].ee_block);
+		uint32_t count = le16_to_cpu(extent[i].ee_len);
+		bool unwritten = false;
+
+		if (count > EXT4_EXT_INIT_MAX_LEN) {
+			count -= EXT4_EXT_INIT_MAX_LEN;
+			unwritten = true;
+		}
+
+		/* a hole up to the start of this extent */
+		if (startblock > fileblock)
+			return startblock - fileblock;
+
+		if (fileblock - startblock < count) {
+			if (!unwritten) {
+				*blknrp = le16_to_cpu(extent[i].ee_start_hi);
+				*blknrp = (*blknrp << 32) +
+					le32_to_cpu(extent[i].ee_start_lo) +
+					fileblock - startblock;
+			}
+			return startblock + count - fileblock;
+		}
+	}
+
+	/* a hole whose length is not known without looking at the next leaf */
+	return 1;
+}
+
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache)
 {
@@ -1677,7 +1751,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			ext_cache_init(c);
 		}
 		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, c,
+			ext4fs_get_extent_block(ext4fs_root, c, 1,
 						(struct ext4_extent_header *)
 						inode->b.blocks.dir_blocks,
 						fileblock, log2_blksz);
@@ -2346,7 +2420,11 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* the filesystem may have been kept mounted since the last open */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -29,6 +29,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <uuid.h>
+#include <linux/sizes.h>
 
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
@@ -44,6 +45,60 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/*
+ * Read a file which uses extents. Each extent, or the part of it which is
+ * wanted, is read from the device with a single request straight into @buf,
+ * so large files are loaded with a few large reads. Holes and unwritten
+ * extents are filled with zeroes.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node, loff_t pos,
+			       loff_t len, char *buf)
+{
+	struct ext_filesystem *fs = get_fs();
+	int log2blksz = fs->dev_desc->log2blksz;
+	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
+	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
+	/* ext4fs_devread() takes an int length */
+	long max_blocks = SZ_1G / blocksize;
+	struct ext_extent_cache cache;
+	uint32_t fileblock;
+	int skip, ret = 0;
+
+	fileblock = lldiv(pos, blocksize);
+	skip = pos - (loff_t)fileblock * blocksize;
+	ext_extent_cache_init(&cache);
+	while (len) {
+		unsigned long long blknr;
+		loff_t size;
+		long count;
+
+		count = ext4fs_map_extent(&node->inode, fileblock, &cache,
+					  &blknr);
+		if (count <= 0) {
+			ret = -1;
+			break;
+		}
+		count = min(count, max_blocks);
+		size = min((loff_t)count * blocksize - skip, len);
+		if (blknr) {
+			if (!ext4fs_devread((lbaint_t)blknr << log2_fs_blocksize,
+					    skip, size, buf)) {
+				ret = -1;
+				break;
+			}
+		} else {
+			memset(buf, '\0', size);
+		}
+		buf += size;
+		len -= size;
+		fileblock += count;
+		skip = 0;
+	}
+	ext_extent_cache_fini(&cache);
+
+	return ret;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -69,17 +124,22 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	short status;
 	struct ext_block_cache cache;
 
-	ext_cache_init(&cache);
-
 	/* Adjust len so it we can't read past the end of the file. */
 	if (len + pos > filesize)
 		len = (filesize - pos);
 
-	if (blocksize <= 0 || len <= 0) {
-		ext_cache_fini(&cache);
+	if (blocksize <= 0 || len <= 0)
 		return -1;
+
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		if (ext4fs_read_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
 	}
 
+	ext_cache_init(&cache);
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
@@ -302,3 +362,19 @@ int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size)
 	cache->size = size;
 	return 1;
 }
+
+void ext_extent_cache_init(struct ext_extent_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < EXT4_EXT_MAX_DEPTH; i++)
+		ext_cache_init(&cache->level[i]);
+}
+
+void ext_extent_cache_fini(struct ext_extent_cache *cache)
+{
+	int i;
+
+	for (i = 0; i < EXT4_EXT_MAX_DEPTH; i++)
+		ext_cache_fini(&cache->level[i]);
+}
@@ -69,6 +69,8 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, struct disk_partition *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	/* a filesystem kept mounted may be using the FAT state */
+	fs_drop_mount();
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
@@ -162,6 +164,85 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+/* SPL and TPL use the SPL setting, as fs/Makefile builds them with SPL_FS_FAT */
+#ifdef CONFIG_SPL_BUILD
+#define FAT_CACHE_WINDOWS	CONFIG_SPL_FS_FAT_CACHE_WINDOWS
+#else
+#define FAT_CACHE_WINDOWS	CONFIG_FS_FAT_CACHE_WINDOWS
+#endif
+
+/* A run of consecutive clusters in a file */
+struct fat_extent {
+	__u32 clust;
+	__u32 count;
+};
+
+/*
+ * struct fat_cache - FAT windows and file map kept while a partition is
+ * mounted
+ *
+ * @buf:	FAT_CACHE_WINDOWS buffers of FATBUFSIZE bytes
+ * @size:	size of @buf in bytes
+ * @num:	FAT window held by each buffer, -1 if none
+ * @used:	time of last use of each buffer, to find the oldest
+ * @clock:	incremented on every lookup
+ * @start:	first cluster of the file in @ext, 0 if none
+ * @nclust:	number of clusters of that file mapped in @ext
+ * @count:	number of runs in @ext
+ * @alloc:	number of runs allocated in @ext
+ * @ext:	runs of consecutive clusters
+ */
+struct fat_cache {
+	__u8 *buf;
+	uint size;
+	int num[FAT_CACHE_WINDOWS];
+	uint used[FAT_CACHE_WINDOWS];
+	uint clock;
+	__u32 start;
+	__u32 nclust;
+	int count;
+	int alloc;
+	struct fat_extent *ext;
+};
+
+/*
+ * Return the buffer holding FAT window @bufnum, reading it into the least
+ * recently used buffer if needed. Returns NULL on error.
+ */
+static __u8 *fat_cache_window(fsdata *mydata, __u32 bufnum)
+{
+	struct fat_cache *cache = mydata->cache;
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	__u8 *bufptr;
+	int i, oldest = 0;
+
+	cache->clock++;
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		if (cache->num[i] == bufnum) {
+			cache->used[i] = cache->clock;
+			return cache->buf + i * FATBUFSIZE;
+		}
+		if (cache->used[i] < cache->used[oldest])
+			oldest = i;
+	}
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > mydata->fatlength)
+		getsize = mydata->fatlength - startblock;
+
+	bufptr = cache->buf + oldest * FATBUFSIZE;
+	cache->num[oldest] = -1;
+	if (disk_read(mydata->fat_sect + startblock, getsize, bufptr) < 0) {
+		debug("Error reading FAT blocks\n");
+		return NULL;
+	}
+	cache->num[oldest] = bufnum;
+	cache->used[oldest] = cache->clock;
+
+	return bufptr;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -171,6 +252,7 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	__u32 bufnum;
 	__u32 offset, off8;
 	__u32 ret = 0x00;
+	__u8 *fatbuf;
 
 	if (CHECK_CLUST(entry, mydata->fatsize)) {
 		log_err("Invalid FAT entry: %#08x\n", entry);
@@ -199,8 +281,13 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	debug("FAT%d: entry: 0x%08x = %d, offset: 0x%04x = %d\n",
 	       mydata->fatsize, entry, entry, offset, offset);
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
+	fatbuf = mydata->fatbuf;
+	if (mydata->cache) {
+		fatbuf = fat_cache_window(mydata, bufnum);
+		if (!fatbuf)
+			return ret;
+	} else if (bufnum != mydata->fatbufnum) {
+		/* Read a new block of FAT entries into the cache. */
 		__u32 getsize = FATBUFBLOCKS;
 		__u8 *bufptr = mydata->fatbuf;
 		__u32 fatlength = mydata->fatlength;
@@ -226,15 +313,15 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)fatbuf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)fatbuf)[offset]);
 		break;
 	case 12:
 		off8 = (offset * 3) / 2;
 		/* fatbut + off8 may be unaligned, read in byte granularity */
-		ret = mydata->fatbuf[off8] + (mydata->fatbuf[off8 + 1] << 8);
+		ret = fatbuf[off8] + (fatbuf[off8 + 1] << 8);
 
 		if (offset & 0x1)
 			ret >>= 4;
@@ -309,6 +396,61 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Make sure that the cluster runs of the file starting at cluster @start cover
+ * at least @nclust clusters. They are kept for the next read of the same file.
+ * Return 0 on success, -1 on error.
+ */
+static int fat_map_file(fsdata *mydata, __u32 start, __u32 nclust)
+{
+	struct fat_cache *cache = mydata->cache;
+	struct fat_extent *ext;
+	__u32 clust;
+
+	if (cache->start != start) {
+		cache->start = start;
+		cache->nclust = 0;
+		cache->count = 0;
+	}
+
+	while (cache->nclust < nclust) {
+		if (cache->count) {
+			ext = &cache->ext[cache->count - 1];
+			clust = get_fatent(mydata, ext->clust + ext->count - 1);
+			if (CHECK_CLUST(clust, mydata->fatsize)) {
+				debug("curclust: 0x%x\n", clust);
+				printf("Invalid FAT entry\n");
+				return -1;
+			}
+			if (clust == ext->clust + ext->count) {
+				ext->count++;
+				cache->nclust++;
+				continue;
+			}
+		} else {
+			clust = start;
+		}
+
+		if (cache->count == cache->alloc) {
+			int alloc = max(cache->alloc * 2, 16);
+
+			ext = realloc(cache->ext, alloc * sizeof(*ext));
+			if (!ext) {
+				debug("Error: allocating file map\n");
+				return -1;
+			}
+			cache->ext = ext;
+			cache->alloc = alloc;
+		}
+		ext = &cache->ext[cache->count++];
+		ext->clust = clust;
+		ext->count = 1;
+		cache->nclust++;
+	}
+
+	return 0;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -316,6 +458,8 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * into 'buffer'. Update the number of bytes read in *gotsize or return -1 on
  * fatal errors.
  *
+ * Each run of consecutive clusters is read from the device in one go.
+ *
  * @mydata:	file system description
  * @dentprt:	directory entry pointer
  * @pos:	position from where to read
@@ -329,8 +473,8 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extent *ext;
+	__u32 skip, clust, count, offset;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -346,26 +490,22 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	/* both fit in 32 bits, since they are within the file */
+	if (fat_map_file(mydata, START(dentptr),
+			 DIV_ROUND_UP((__u32)filesize, bytesperclust)))
+		return -1;
 
 	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize += bytesperclust;
-	}
-
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+	skip = (__u32)pos / bytesperclust;
+	offset = (__u32)pos % bytesperclust;
+	filesize -= (loff_t)skip * bytesperclust;
+	for (ext = mydata->cache->ext; skip >= ext->count; ext++)
+		skip -= ext->count;
+	clust = ext->clust + skip;
+	count = ext->count - skip;
 
 	/* align to beginning of next cluster if any */
-	if (pos) {
+	if (offset) {
 		__u8 *tmp_buffer;
 
 		actsize = min(filesize, (loff_t)bytesperclust);
@@ -375,72 +515,39 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return -1;
 		}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		if (get_cluster(mydata, clust, tmp_buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			free(tmp_buffer);
 			return -1;
 		}
 		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
+		actsize -= offset;
+		memcpy(buffer, tmp_buffer + offset, actsize);
 		free(tmp_buffer);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
 		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
+		clust++;
+		count--;
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
-				return -1;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
+	while (filesize) {
+		if (!count) {
+			ext++;
+			clust = ext->clust;
+			count = ext->count;
 		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		actsize = min(filesize, (loff_t)count * bytesperclust);
+		if (get_cluster(mydata, clust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		count = 0;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -686,6 +793,7 @@ static int get_fs_info(fsdata *mydata)
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
+	mydata->cache = NULL;
 	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
@@ -705,6 +813,89 @@ static int get_fs_info(fsdata *mydata)
 	return 0;
 }
 
+/*
+ * Filesystem data for the partition last read, with its FAT cache. It is kept
+ * between calls until the partition changes or a block device is written.
+ */
+static struct {
+	fsdata data;
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	ulong gen;
+	bool valid;
+} fat_mnt;
+
+/**
+ * fat_mount() - get the filesystem data for the current partition
+ *
+ * The boot sector is only parsed again if the partition has changed or a
+ * block device was written since the last call. Without driver model, writes
+ * cannot be tracked, so it is parsed every time. The cache memory is kept and
+ * reused for the next partition.
+ *
+ * Return: filesystem data, or NULL on error
+ */
+static fsdata *fat_mount(void)
+{
+	fsdata *mydata = &fat_mnt.data;
+	struct fat_cache *cache = mydata->cache;
+	uint size;
+	int i;
+
+	if (CONFIG_IS_ENABLED(BLK) && fat_mnt.valid && fat_mnt.dev == cur_dev &&
+	    fat_mnt.part_start == cur_part_info.start &&
+	    fat_mnt.gen == blk_get_generation())
+		return mydata;
+
+	memset(&fat_mnt, '\0', sizeof(fat_mnt));
+	if (get_fs_info(mydata))
+		goto err;
+
+	/* the FAT windows in the cache take the place of fatbuf */
+	free(mydata->fatbuf);
+	mydata->fatbuf = NULL;
+	if (!cache) {
+		cache = calloc(1, sizeof(*cache));
+		if (!cache)
+			goto err;
+	}
+	mydata->cache = cache;
+
+	/* the sector size, and so the window size, may differ */
+	size = FAT_CACHE_WINDOWS * FATBUFSIZE;
+	if (cache->size != size) {
+		free(cache->buf);
+		cache->size = 0;
+		cache->buf = malloc_cache_aligned(size);
+		if (!cache->buf)
+			goto err;
+		cache->size = size;
+	}
+	for (i = 0; i < FAT_CACHE_WINDOWS; i++) {
+		cache->num[i] = -1;
+		cache->used[i] = 0;
+	}
+	cache->clock = 0;
+	cache->start = 0;
+	cache->nclust = 0;
+	cache->count = 0;
+
+	fat_mnt.dev = cur_dev;
+	fat_mnt.part_start = cur_part_info.start;
+	if (CONFIG_IS_ENABLED(BLK))
+		fat_mnt.gen = blk_get_generation();
+	fat_mnt.valid = true;
+
+	return mydata;
+
+err:
+	free(mydata->fatbuf);
+	memset(&fat_mnt, '\0', sizeof(fat_mnt));
+	fat_mnt.data.cache = cache;
+
+	return NULL;
+}
+
 /**
  * struct fat_itr - directory iterator, to simplify filesystem traversal
  *
@@ -790,6 +981,19 @@ struct fat_itr {
 
 static int fat_itr_isdir(fat_itr *itr);
 
+/* Set up an iterator to start at the root directory of @fsdata */
+static void fat_itr_start(fat_itr *itr, fsdata *fsdata)
+{
+	itr->fsdata = fsdata;
+	itr->start_clust = fsdata->root_cluster;
+	itr->clust = fsdata->root_cluster;
+	itr->next_clust = fsdata->root_cluster;
+	itr->dent = NULL;
+	itr->remaining = 0;
+	itr->last_cluster = 0;
+	itr->is_root = 1;
+}
+
 /**
  * fat_itr_root() - initialize an iterator to start at the root
  * directory
@@ -803,14 +1007,28 @@ static int fat_itr_root(fat_itr *itr, fsdata *fsdata)
 	if (get_fs_info(fsdata))
 		return -ENXIO;
 
-	itr->fsdata = fsdata;
-	itr->start_clust = fsdata->root_cluster;
-	itr->clust = fsdata->root_cluster;
-	itr->next_clust = fsdata->root_cluster;
-	itr->dent = NULL;
-	itr->remaining = 0;
-	itr->last_cluster = 0;
-	itr->is_root = 1;
+	fat_itr_start(itr, fsdata);
+
+	return 0;
+}
+
+/**
+ * fat_itr_mount() - initialize an iterator to start at the root
+ * directory, using the filesystem data kept by fat_mount()
+ *
+ * This is for read-only operations which complete before returning.
+ *
+ * @itr: iterator to initialize
+ * Return: 0 on success, else -errno
+ */
+static int fat_itr_mount(fat_itr *itr)
+{
+	fsdata *fsdata = fat_mount();
+
+	if (!fsdata)
+		return -ENXIO;
+
+	fat_itr_start(itr, fsdata);
 
 	return 0;
 }
@@ -1226,19 +1444,17 @@ int file_fat_detectfs(void)
 
 int fat_exists(const char *filename)
 {
-	fsdata fsdata;
 	fat_itr *itr;
 	int ret;
 
 	itr = malloc_cache_aligned(sizeof(fat_itr));
 	if (!itr)
 		return 0;
-	ret = fat_itr_root(itr, &fsdata);
+	ret = fat_itr_mount(itr);
 	if (ret)
 		goto out;
 
 	ret = fat_itr_resolve(itr, filename, TYPE_ANY);
-	free(fsdata.fatbuf);
 out:
 	free(itr);
 	return ret == 0;
@@ -1268,14 +1484,13 @@ static void __maybe_unused fat2rtc(u16 date, u16 time, struct rtc_time *tm)
 
 int fat_size(const char *filename, loff_t *size)
 {
-	fsdata fsdata;
 	fat_itr *itr;
 	int ret;
 
 	itr = malloc_cache_aligned(sizeof(fat_itr));
 	if (!itr)
 		return -ENOMEM;
-	ret = fat_itr_root(itr, &fsdata);
+	ret = fat_itr_mount(itr);
 	if (ret)
 		goto out_free_itr;
 
@@ -1285,19 +1500,16 @@ int fat_size(const char *filename, loff_t *size)
 		 * Directories don't have size, but fs_size() is not
 		 * expected to fail if passed a directory path:
 		 */
-		free(fsdata.fatbuf);
-		ret = fat_itr_root(itr, &fsdata);
+		ret = fat_itr_mount(itr);
 		if (ret)
 			goto out_free_itr;
 		ret = fat_itr_resolve(itr, filename, TYPE_DIR);
 		if (!ret)
 			*size = 0;
-		goto out_free_both;
+		goto out_free_itr;
 	}
 
 	*size = FAT2CPU32(itr->dent->size);
-out_free_both:
-	free(fsdata.fatbuf);
 out_free_itr:
 	free(itr);
 	return ret;
@@ -1306,30 +1518,27 @@ out_free_itr:
 int fat_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		  loff_t *actread)
 {
-	fsdata fsdata;
 	fat_itr *itr;
 	int ret;
 
 	itr = malloc_cache_aligned(sizeof(fat_itr));
 	if (!itr)
 		return -ENOMEM;
-	ret = fat_itr_root(itr, &fsdata);
+	ret = fat_itr_mount(itr);
 	if (ret)
 		goto out_free_itr;
 
 	ret = fat_itr_resolve(itr, filename, TYPE_FILE);
 	if (ret)
-		goto out_free_both;
+		goto out_free_itr;
 
 	debug("reading %s at pos %llu\n", filename, offset);
 
 	/* For saving default max clustersize memory allocated to malloc pool */
 	dir_entry *dentptr = itr->dent;
 
-	ret = get_contents(&fsdata, dentptr, offset, buf, len, actread);
+	ret = get_contents(itr->fsdata, dentptr, offset, buf, len, actread);
 
-out_free_both:
-	free(fsdata.fatbuf);
 out_free_itr:
 	free(itr);
 	return ret;
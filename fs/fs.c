@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <common.h>
 #include <env.h>
+#include <image.h>
 #include <lmb.h>
 #include <log.h>
 #include <malloc.h>
@@ -154,6 +155,11 @@ struct fstype_info {
 	 * filesystem.
 	 */
 	bool null_dev_desc_ok;
+	/*
+	 * Can the filesystem stay mounted after fs_close(), for use by the
+	 * next command on the same partition? See CONFIG_FS_MOUNT_CACHE
+	 */
+	bool keep_mounted;
 	int (*probe)(struct blk_desc *fs_dev_desc,
 		     struct disk_partition *fs_partition);
 	int (*ls)(const char *dirname);
@@ -190,6 +196,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_FAT,
 		.name = "fat",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = fat_set_blk_dev,
 		.close = fat_close,
 		.ls = fs_ls_generic,
@@ -218,6 +225,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_EXT,
 		.name = "ext4",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = ext4fs_probe,
 		.close = ext4fs_close,
 		.ls = ext4fs_ls,
@@ -322,6 +330,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_SQUASHFS,
 		.name = "squashfs",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = sqfs_probe,
 		.opendir = sqfs_opendir,
 		.readdir = sqfs_readdir,
@@ -343,6 +352,7 @@ static struct fstype_info fstypes[] = {
 		.fstype = FS_TYPE_EROFS,
 		.name = "erofs",
 		.null_dev_desc_ok = false,
+		.keep_mounted = true,
 		.probe = erofs_probe,
 		.opendir = erofs_opendir,
 		.readdir = erofs_readdir,
@@ -418,6 +428,87 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/*
+ * The partition last probed. If @fstype is not FS_TYPE_ANY, its filesystem
+ * was left mounted by fs_close(). The block-device generation is recorded
+ * when probing, so that the mount is dropped if a block device is written
+ * or removed after that.
+ */
+static struct {
+	int fstype;
+	struct blk_desc *desc;
+	lbaint_t start;
+	lbaint_t size;
+	ulong gen;
+} fs_mnt;
+
+void fs_drop_mount(void)
+{
+	if (fs_mnt.fstype != FS_TYPE_ANY) {
+		fs_get_info(fs_mnt.fstype)->close();
+		fs_mnt.fstype = FS_TYPE_ANY;
+	}
+}
+
+/*
+ * Use the filesystem kept mounted if it is on the current partition and of
+ * type @fstype (or FS_TYPE_ANY), else unmount it
+ */
+static bool fs_use_mount(int fstype, int part)
+{
+	if (fs_mnt.fstype == FS_TYPE_ANY)
+		return false;
+
+	if (fs_mnt.desc != fs_dev_desc ||
+	    fs_mnt.start != fs_partition.start ||
+	    fs_mnt.size != fs_partition.size ||
+	    fs_mnt.gen != blk_get_generation() ||
+	    (fstype != FS_TYPE_ANY && fstype != fs_mnt.fstype)) {
+		fs_drop_mount();
+		return false;
+	}
+
+	fs_type = fs_mnt.fstype;
+	fs_dev_part = part;
+	fs_mnt.fstype = FS_TYPE_ANY;
+
+	return true;
+}
+
+static void fs_probed(void)
+{
+	fs_mnt.desc = fs_dev_desc;
+	fs_mnt.start = fs_partition.start;
+	fs_mnt.size = fs_partition.size;
+	fs_mnt.gen = blk_get_generation();
+}
+
+/* Keep the current filesystem mounted if possible, returning true if so */
+static bool fs_keep_mount(struct fstype_info *info)
+{
+	if (!info->keep_mounted || fs_mnt.gen != blk_get_generation())
+		return false;
+	fs_mnt.fstype = fs_type;
+
+	return true;
+}
+#else
+static bool fs_use_mount(int fstype, int part)
+{
+	return false;
+}
+
+static void fs_probed(void)
+{
+}
+
+static bool fs_keep_mount(struct fstype_info *info)
+{
+	return false;
+}
+#endif
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -428,6 +519,9 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_use_mount(fstype, part))
+		return 0;
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -439,6 +533,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_probed();
 			return 0;
 		}
 	}
@@ -460,10 +555,14 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
+	if (fs_use_mount(FS_TYPE_ANY, part))
+		return 0;
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
 			fs_type = info->fstype;
 			fs_dev_part = part;
+			fs_probed();
 			return 0;
 		}
 	}
@@ -475,7 +574,8 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	if (!fs_keep_mount(info))
+		info->close();
 
 	fs_type = FS_TYPE_ANY;
 }
@@ -553,11 +653,12 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+	ret = lmb_alloc_addr(&lmb, addr, read_len) == addr ? 0 : -ENOSPC;
+	lmb_uninit(&lmb);
+	if (ret)
+		log_err("** Reading file would overwrite reserved memory **\n");
 
-	log_err("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
@@ -598,6 +699,113 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	return _fs_read(filename, addr, offset, len, 0, actread);
 }
 
+#if IS_ENABLED(CONFIG_FS_LOAD_DECOMP)
+struct fs_decomp_priv {
+	struct fstype_info *info;
+	const char *filename;
+	loff_t pos;
+	loff_t size;
+};
+
+static long fs_decomp_read(void *priv, void *buf, ulong size)
+{
+	struct fs_decomp_priv *dp = priv;
+	loff_t actread;
+	int ret;
+
+	/* A length of 0 would read the whole file */
+	size = min_t(loff_t, size, dp->size - dp->pos);
+	if (!size)
+		return 0;
+	ret = dp->info->read(dp->filename, buf, dp->pos, size, &actread);
+	if (ret)
+		return ret < 0 ? ret : -EIO;
+	dp->pos += actread;
+
+	return actread;
+}
+
+/* Find how much may be written at @addr without overwriting reserved memory */
+static ulong fs_decomp_space(ulong addr)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	ulong size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+	size = lmb_get_free_size(&lmb, addr);
+	lmb_uninit(&lmb);
+
+	return size;
+#else
+	return gd->ram_top > addr ? gd->ram_top - addr : 0;
+#endif
+}
+
+int fs_read_decomp(const char *filename, ulong addr, loff_t offset,
+		   loff_t len, loff_t *actread, loff_t *comp_size)
+{
+	struct fs_decomp_priv dp;
+	unsigned char magic[2];
+	ulong space, unc_len;
+	loff_t got;
+	void *buf;
+	int comp;
+	int ret;
+
+	dp.info = fs_get_info(fs_type);
+	dp.filename = filename;
+	dp.pos = offset;
+	ret = dp.info->size(filename, &dp.size);
+	if (ret)
+		goto out;
+	if (offset >= dp.size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	space = fs_decomp_space(addr);
+	if (len && len < space)
+		space = len;
+
+	ret = dp.info->read(filename, magic, offset, sizeof(magic), &got);
+	if (ret)
+		goto out;
+	comp = image_decomp_type(magic, got);
+
+	buf = map_sysmem(addr, space);
+	if (comp == IH_COMP_NONE) {
+		if (dp.size - offset > space) {
+			ret = -ENOSPC;
+		} else {
+			ret = dp.info->read(filename, buf, offset,
+					    dp.size - offset, &got);
+			dp.pos += got;
+			unc_len = got;
+		}
+	} else {
+		ret = image_decomp_stream(comp, buf, space,
+					  CONFIG_FS_LOAD_DECOMP_BUF_SIZE,
+					  fs_decomp_read, &dp, &unc_len);
+		if (ret == -EPROTONOSUPPORT)
+			log_err("** Cannot decompress %s data while loading **\n",
+				genimg_get_comp_name(comp));
+	}
+	unmap_sysmem(buf);
+	if (ret == -ENOSPC)
+		log_err("** Uncompressed file is larger than %lx bytes **\n",
+			space);
+	if (!ret) {
+		*actread = unc_len;
+		*comp_size = dp.pos - offset;
+	}
+out:
+	fs_close();
+
+	return ret;
+}
+#endif
+
 int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	     loff_t *actwrite)
 {
@@ -740,10 +948,18 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 	loff_t bytes;
 	loff_t pos;
 	loff_t len_read;
+	loff_t comp_size;
+	bool decomp = false;
 	int ret;
 	unsigned long time;
 	char *ep;
 
+	if (IS_ENABLED(CONFIG_FS_LOAD_DECOMP) && argc > 1 &&
+	    !strcmp(argv[1], "-z")) {
+		decomp = true;
+		argc--;
+		argv++;
+	}
 	if (argc < 2)
 		return CMD_RET_USAGE;
 	if (argc > 7)
@@ -784,7 +1000,11 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 		pos = 0;
 
 	time = get_timer(0);
-	ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
+	if (decomp)
+		ret = fs_read_decomp(filename, addr, pos, bytes, &len_read,
+				     &comp_size);
+	else
+		ret = _fs_read(filename, addr, pos, bytes, 1, &len_read);
 	time = get_timer(time);
 	if (ret < 0) {
 		log_err("Failed to load '%s'\n", filename);
@@ -795,7 +1015,11 @@ int do_load(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[],
 			(argc > 4) ? argv[4] : "", map_sysmem(addr, 0),
 			len_read);
 
-	printf("%llu bytes read in %lu ms", len_read, time);
+	if (decomp)
+		printf("%llu bytes read, %llu uncompressed in %lu ms",
+		       comp_size, len_read, time);
+	else
+		printf("%llu bytes read in %lu ms", len_read, time);
 	if (time > 0) {
 		puts(" (");
 		print_size(div_u64(len_read, time) * 1000, "/s");
@@ -93,27 +93,14 @@ static int sqfs_calc_n_blks(__le64 start, __le64 end, u64 *offset)
 	return DIV_ROUND_UP(table_size + *offset, ctxt.cur_dev->blksz);
 }
 
-/*
- * Retrieves fragment block entry and returns true if the fragment block is
- * compressed
- */
-static int sqfs_frag_lookup(u32 inode_fragment_index,
-			    struct squashfs_fragment_block_entry *e)
+/* Reads the fragment index table, if that has not been done yet */
+static int sqfs_read_frag_table(void)
 {
-	u64 start, end, exp_tbl, n_blks, src_len, table_offset, start_block;
-	unsigned char *metadata_buffer, *metadata, *table;
-	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	unsigned long dest_len;
-	int block, offset, ret;
-	u16 header;
-
-	metadata_buffer = NULL;
-	entries = NULL;
-	table = NULL;
+	u64 start, end, exp_tbl, n_blks;
 
-	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
-		return -EINVAL;
+	if (ctxt.frag_table)
+		return 0;
 
 	start = get_unaligned_le64(&sblk->fragment_table_start);
 	end = get_unaligned_le64(&sblk->id_table_start);
@@ -123,84 +110,119 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		end = exp_tbl;
 
 	n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
-				  cpu_to_le64(end), &table_offset);
+				  cpu_to_le64(end), &ctxt.frag_table_offset);
 
 	start /= ctxt.cur_dev->blksz;
 
 	/* Allocate a proper sized buffer to store the fragment index table */
-	table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!table) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	ctxt.frag_table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!ctxt.frag_table)
+		return -ENOMEM;
 
-	if (sqfs_disk_read(start, n_blks, table) < 0) {
-		ret = -EINVAL;
-		goto out;
+	if (sqfs_disk_read(start, n_blks, ctxt.frag_table) < 0) {
+		free(ctxt.frag_table);
+		ctxt.frag_table = NULL;
+		return -EINVAL;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+	return 0;
+}
 
-	/*
-	 * Get the start offset of the metadata block that contains the right
-	 * fragment block entry
-	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+/*
+ * Returns the decompressed metadata block at device offset @start_block, which
+ * ends before @table_end, from the cache or else from the device.
+ */
+static void *sqfs_get_metablock(u64 start_block, __le64 table_end)
+{
+	unsigned char *metadata_buffer, *metadata, *data;
+	u64 start, n_blks, src_len, table_offset;
+	unsigned long dest_len;
+	u32 size;
+	u16 header;
+	int ret;
+
+	data = sqfs_cache_find(&ctxt, start_block, &size);
+	if (data)
+		return data;
 
 	start = start_block / ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
-				  sblk->fragment_table_start, &table_offset);
+	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block), table_end,
+				  &table_offset);
 
 	metadata_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!metadata_buffer) {
-		ret = -ENOMEM;
-		goto out;
-	}
+	if (!metadata_buffer)
+		return NULL;
 
-	if (sqfs_disk_read(start, n_blks, metadata_buffer) < 0) {
-		ret = -EINVAL;
+	if (sqfs_disk_read(start, n_blks, metadata_buffer) < 0)
 		goto out;
-	}
 
 	/* Every metadata block starts with a 16-bit header */
 	header = get_unaligned_le16(metadata_buffer + table_offset);
 	metadata = metadata_buffer + table_offset + SQFS_HEADER_SIZE;
+	src_len = SQFS_METADATA_SIZE(header);
 
-	if (!metadata || !header) {
-		ret = -ENOMEM;
+	if (!header || src_len > SQFS_METADATA_BLOCK_SIZE)
 		goto out;
-	}
 
-	entries = malloc(SQFS_METADATA_BLOCK_SIZE);
-	if (!entries) {
-		ret = -ENOMEM;
+	data = sqfs_cache_add(&ctxt, start_block, SQFS_METADATA_BLOCK_SIZE);
+	if (!data)
 		goto out;
-	}
 
 	if (SQFS_COMPRESSED_METADATA(header)) {
-		src_len = SQFS_METADATA_SIZE(header);
 		dest_len = SQFS_METADATA_BLOCK_SIZE;
-		ret = sqfs_decompress(&ctxt, entries, &dest_len, metadata,
+		ret = sqfs_decompress(&ctxt, data, &dest_len, metadata,
 				      src_len);
 		if (ret) {
-			ret = -EINVAL;
-			goto out;
+			sqfs_cache_drop(&ctxt, data);
+			data = NULL;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		memcpy(data, metadata, src_len);
 	}
 
-	*e = entries[offset];
-	ret = SQFS_COMPRESSED_BLOCK(e->size);
-
 out:
-	free(entries);
 	free(metadata_buffer);
-	free(table);
 
-	return ret;
+	return data;
+}
+
+/*
+ * Retrieves fragment block entry and returns true if the fragment block is
+ * compressed
+ */
+static int sqfs_frag_lookup(u32 inode_fragment_index,
+			    struct squashfs_fragment_block_entry *e)
+{
+	struct squashfs_fragment_block_entry *entries;
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	int block, offset, ret;
+	u64 start_block;
+
+	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
+		return -EINVAL;
+
+	ret = sqfs_read_frag_table();
+	if (ret)
+		return ret;
+
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
+	/*
+	 * Get the start offset of the metadata block that contains the right
+	 * fragment block entry
+	 */
+	start_block = get_unaligned_le64(ctxt.frag_table +
+					 ctxt.frag_table_offset +
+					 block * sizeof(u64));
+
+	entries = sqfs_get_metablock(start_block, sblk->fragment_table_start);
+	if (!entries)
+		return -EINVAL;
+
+	*e = entries[offset];
+
+	return SQFS_COMPRESSED_BLOCK(e->size);
 }
 
 /*
@@ -443,6 +465,82 @@ static char *sqfs_resolve_symlink(struct squashfs_symlink_inode *sym,
 	return resolved;
 }
 
+/*
+ * Decompresses the metadata blocks of the directory table holding the @size
+ * bytes at @offset into it, if not done yet. Returns @offset, or a negative
+ * value on error.
+ */
+static int sqfs_load_dir_table(int offset, u32 size)
+{
+	unsigned char *src_table, *dest;
+	unsigned long dest_len;
+	int j, first, last, ret;
+	bool compressed;
+	u32 src_len;
+
+	if (offset < 0)
+		return offset;
+
+	first = offset / SQFS_METADATA_BLOCK_SIZE;
+	last = (offset + size - 1) / SQFS_METADATA_BLOCK_SIZE;
+	if (first >= ctxt.dir_count)
+		return -EINVAL;
+	if (last >= ctxt.dir_count)
+		last = ctxt.dir_count - 1;
+
+	for (j = first; j <= last; j++) {
+		u32 src_offset = ctxt.dir_src_offset;
+
+		if (ctxt.dir_loaded[j])
+			continue;
+
+		if (j)
+			src_offset += ctxt.dir_pos[j - 1];
+		ret = sqfs_read_metablock(ctxt.dir_src, src_offset,
+					  &compressed, &src_len);
+		if (ret)
+			return ret;
+
+		src_table = ctxt.dir_src + src_offset + SQFS_HEADER_SIZE;
+		dest = ctxt.dir_table + j * SQFS_METADATA_BLOCK_SIZE;
+		if (compressed) {
+			dest_len = SQFS_METADATA_BLOCK_SIZE;
+			ret = sqfs_decompress(&ctxt, dest, &dest_len,
+					      src_table, src_len);
+			if (ret)
+				return -EINVAL;
+		} else {
+			memcpy(dest, src_table, src_len);
+		}
+		ctxt.dir_loaded[j] = true;
+	}
+
+	return offset;
+}
+
+/*
+ * Makes sure the listing of directory @dir_i is decompressed and returns its
+ * offset into the directory table, or a negative value on error
+ */
+static int sqfs_load_dir(void *dir_i, u32 *m_list, int m_count)
+{
+	struct squashfs_base_inode *base = dir_i;
+	struct squashfs_ldir_inode *ldir;
+	struct squashfs_dir_inode *dir;
+	u32 size;
+
+	if (get_unaligned_le16(&base->inode_type) == SQFS_LDIR_TYPE) {
+		ldir = dir_i;
+		size = get_unaligned_le32(&ldir->file_size);
+	} else {
+		dir = dir_i;
+		size = get_unaligned_le16(&dir->file_size);
+	}
+
+	return sqfs_load_dir_table(sqfs_dir_offset(dir_i, m_list, m_count),
+				   size);
+}
+
 /*
  * m_list contains each metadata block's position, and m_count is the number of
  * elements of m_list. Those metadata blocks come from the compressed directory
@@ -477,7 +575,9 @@ static int sqfs_search_dir(struct squashfs_dir_stream *dirs, char **token_list,
 	ldir = (struct squashfs_ldir_inode *)table;
 
 	/* get directory offset in directory table */
-	offset = sqfs_dir_offset(table, m_list, m_count);
+	offset = sqfs_load_dir(table, m_list, m_count);
+	if (offset < 0)
+		return -EINVAL;
 	dirs->table = &dirs->dir_table[offset];
 
 	/* Setup directory header */
@@ -598,7 +698,13 @@ static int sqfs_search_dir(struct squashfs_dir_stream *dirs, char **token_list,
 			ldir = (struct squashfs_ldir_inode *)table;
 
 		/* Get dir. offset into the directory table */
-		offset = sqfs_dir_offset(table, m_list, m_count);
+		offset = sqfs_load_dir(table, m_list, m_count);
+		if (offset < 0) {
+			free(dirs->entry);
+			dirs->entry = NULL;
+			ret = -EINVAL;
+			goto out;
+		}
 		dirs->table = &dirs->dir_table[offset];
 
 		/* Copy directory header */
@@ -622,7 +728,11 @@ static int sqfs_search_dir(struct squashfs_dir_stream *dirs, char **token_list,
 		dirs->entry = NULL;
 	}
 
-	offset = sqfs_dir_offset(table, m_list, m_count);
+	offset = sqfs_load_dir(table, m_list, m_count);
+	if (offset < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
 	dirs->table = &dirs->dir_table[offset];
 
 	if (get_unaligned_le16(&dir->inode_type) == SQFS_DIR_TYPE)
@@ -778,18 +888,23 @@ free_itb:
 	return ret;
 }
 
-static int sqfs_read_directory_table(unsigned char **dir_table, u32 **pos_list)
+/*
+ * Reads the compressed directory table and finds its metadata blocks. They are
+ * only decompressed by sqfs_load_dir() when a directory stored in them is
+ * looked up. Returns the number of metadata blocks, or -1 on error.
+ */
+static int sqfs_read_directory_table(void)
 {
 	u64 start, n_blks, table_offset, table_size;
 	struct squashfs_super_block *sblk = ctxt.sblk;
-	int j, ret = 0, metablks_count = -1;
-	unsigned char *src_table, *dtb;
-	u32 src_len, dest_offset = 0;
-	unsigned long dest_len = 0;
+	int ret = 0, metablks_count = -1;
+	unsigned char *dtb;
 	bool compressed;
+	u32 src_len;
+
+	if (ctxt.dir_table)
+		return ctxt.dir_count;
 
-	*dir_table = NULL;
-	*pos_list = NULL;
 	/* DIRECTORY TABLE */
 	table_size = get_unaligned_le64(&sblk->fragment_table_start) -
 		get_unaligned_le64(&sblk->directory_table_start);
@@ -816,75 +931,44 @@ static int sqfs_read_directory_table(unsigned char **dir_table, u32 **pos_list)
 	if (metablks_count < 1)
 		goto out;
 
-	*dir_table = malloc(metablks_count * SQFS_METADATA_BLOCK_SIZE);
-	if (!*dir_table)
-		goto out;
-
-	*pos_list = malloc(metablks_count * sizeof(u32));
-	if (!*pos_list)
+	ctxt.dir_table = malloc(metablks_count * SQFS_METADATA_BLOCK_SIZE);
+	ctxt.dir_pos = malloc(metablks_count * sizeof(u32));
+	ctxt.dir_loaded = calloc(metablks_count, sizeof(bool));
+	if (!ctxt.dir_table || !ctxt.dir_pos || !ctxt.dir_loaded) {
+		metablks_count = -1;
 		goto out;
+	}
 
-	ret = sqfs_get_metablk_pos(*pos_list, dtb, table_offset,
+	ret = sqfs_get_metablk_pos(ctxt.dir_pos, dtb, table_offset,
 				   metablks_count);
 	if (ret) {
 		metablks_count = -1;
 		goto out;
 	}
 
-	src_table = dtb + table_offset + SQFS_HEADER_SIZE;
-
-	/* Extract compressed Directory table */
-	dest_offset = 0;
-	for (j = 0; j < metablks_count; j++) {
-		sqfs_read_metablock(dtb, table_offset, &compressed, &src_len);
-		if (compressed) {
-			dest_len = SQFS_METADATA_BLOCK_SIZE;
-			ret = sqfs_decompress(&ctxt, *dir_table +
-					      (j * SQFS_METADATA_BLOCK_SIZE),
-					      &dest_len, src_table, src_len);
-			if (ret) {
-				metablks_count = -1;
-				goto out;
-			}
-
-			if (dest_len < SQFS_METADATA_BLOCK_SIZE) {
-				dest_offset += dest_len;
-				break;
-			}
-
-			dest_offset += dest_len;
-		} else {
-			memcpy(*dir_table + (j * SQFS_METADATA_BLOCK_SIZE),
-			       src_table, src_len);
-		}
-
-		/*
-		 * Offsets to the decompression destination, to the metadata
-		 * buffer 'dtb' and to the decompression source, respectively.
-		 */
-		table_offset += src_len + SQFS_HEADER_SIZE;
-		src_table += src_len + SQFS_HEADER_SIZE;
-	}
+	ctxt.dir_src = dtb;
+	ctxt.dir_src_offset = table_offset;
+	ctxt.dir_count = metablks_count;
 
 out:
 	if (metablks_count < 1) {
-		free(*dir_table);
-		free(*pos_list);
-		*dir_table = NULL;
-		*pos_list = NULL;
+		free(ctxt.dir_table);
+		free(ctxt.dir_pos);
+		free(ctxt.dir_loaded);
+		ctxt.dir_table = NULL;
+		ctxt.dir_pos = NULL;
+		ctxt.dir_loaded = NULL;
+		free(dtb);
 	}
-	free(dtb);
 
 	return metablks_count;
 }
 
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
 	int j, token_count = 0, ret = 0, metablks_count;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -897,13 +981,16 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
-	if (ret) {
-		ret = -EINVAL;
-		goto out;
+	/* The tables are kept in the context until sqfs_close() */
+	if (!ctxt.inode_table) {
+		ret = sqfs_read_inode_table(&ctxt.inode_table);
+		if (ret) {
+			ret = -EINVAL;
+			goto out;
+		}
 	}
 
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
+	metablks_count = sqfs_read_directory_table();
 	if (metablks_count < 1) {
 		ret = -EINVAL;
 		goto out;
@@ -936,9 +1023,9 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
+	dirs->inode_table = ctxt.inode_table;
+	dirs->dir_table = ctxt.dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count, ctxt.dir_pos,
 			      metablks_count);
 	if (ret)
 		goto out;
@@ -963,10 +1050,9 @@ out:
 	for (j = 0; j < token_count; j++)
 		free(token_list[j]);
 	free(token_list);
-	free(pos_list);
 	free(path);
 	if (ret) {
-		free(inode_table);
+		free(dirs->dir_header);
 		free(dirs);
 	}
 
@@ -1088,11 +1174,30 @@ int sqfs_readdir(struct fs_dir_stream *fs_dirs, struct fs_dirent **dentp)
 	return 0;
 }
 
+/* Frees the tables and blocks kept since the filesystem was probed */
+static void sqfs_free_tables(void)
+{
+	free(ctxt.inode_table);
+	free(ctxt.dir_table);
+	free(ctxt.dir_src);
+	free(ctxt.dir_pos);
+	free(ctxt.dir_loaded);
+	free(ctxt.frag_table);
+	ctxt.inode_table = NULL;
+	ctxt.dir_table = NULL;
+	ctxt.dir_src = NULL;
+	ctxt.dir_pos = NULL;
+	ctxt.dir_loaded = NULL;
+	ctxt.frag_table = NULL;
+	sqfs_cache_free(&ctxt);
+}
+
 int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition)
 {
 	struct squashfs_super_block *sblk;
 	int ret;
 
+	sqfs_free_tables();
 	ctxt.cur_dev = fs_dev_desc;
 	ctxt.cur_part_info = *fs_partition;
 
@@ -1317,11 +1422,64 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 	return datablk_count;
 }
 
+/*
+ * Returns the fragment block described by @e, decompressed if @comp is true.
+ * It is only read from the device if it is not in the cache.
+ */
+static char *sqfs_get_fragment(struct squashfs_fragment_block_entry *e,
+			       bool comp)
+{
+	struct squashfs_super_block *sblk = ctxt.sblk;
+	u64 start, n_blks, table_size, table_offset;
+	char *fragment, *fragment_block;
+	unsigned long dest_len;
+	u32 size;
+	int ret;
+
+	fragment_block = sqfs_cache_find(&ctxt, e->start, &size);
+	if (fragment_block)
+		return fragment_block;
+
+	start = lldiv(e->start, ctxt.cur_dev->blksz);
+	table_size = SQFS_BLOCK_SIZE(e->size);
+	table_offset = e->start - (start * ctxt.cur_dev->blksz);
+	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
+
+	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!fragment)
+		return NULL;
+
+	ret = sqfs_disk_read(start, n_blks, fragment);
+	if (ret < 0)
+		goto out;
+
+	dest_len = comp ? get_unaligned_le32(&sblk->block_size) : table_size;
+	fragment_block = sqfs_cache_add(&ctxt, e->start, dest_len);
+	if (!fragment_block)
+		goto out;
+
+	if (comp) {
+		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
+				      fragment + table_offset, e->size);
+		if (ret) {
+			sqfs_cache_drop(&ctxt, fragment_block);
+			fragment_block = NULL;
+		}
+	} else {
+		memcpy(fragment_block, fragment + table_offset, table_size);
+	}
+
+out:
+	free(fragment);
+
+	return fragment_block;
+}
+
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
 	char *dir = NULL, *fragment_block, *datablock = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
+	char *file = NULL, *resolved, *data;
 	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
 	int ret, j, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
@@ -1526,53 +1684,17 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		goto out;
 	}
 
-	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-	if (!fragment) {
-		ret = -ENOMEM;
+	fragment_block = sqfs_get_fragment(&frag_entry, finfo.comp);
+	if (!fragment_block) {
+		ret = -EINVAL;
 		goto out;
 	}
 
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
-		goto out;
-
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-	}
+	memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
+	*actread = finfo.size;
+	ret = 0;
 
 out:
-	free(fragment);
 	free(datablock);
 	free(file);
 	free(dir);
@@ -1711,6 +1833,7 @@ free_strings:
 
 void sqfs_close(void)
 {
+	sqfs_free_tables();
 	sqfs_decompressor_cleanup(&ctxt);
 	free(ctxt.sblk);
 	ctxt.sblk = NULL;
@@ -1725,8 +1848,6 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 		return;
 
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
-	free(sqfs_dirs->inode_table);
-	free(sqfs_dirs->dir_table);
 	free(sqfs_dirs->dir_header);
 	free(sqfs_dirs);
 }
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * sqfs_cache.c: cache of decompressed SquashFS blocks
+ *
+ * Metadata and fragment blocks are kept after being decompressed, keyed on
+ * their position on the device, so that reading several files which share a
+ * fragment or a fragment table block only decompresses it once. The least
+ * recently used blocks are dropped to stay within
+ * CONFIG_FS_SQUASHFS_CACHE_SIZE.
+ */
+
+#include <linux/list.h>
+#include <linux/types.h>
+#include <malloc.h>
+
+#include "sqfs_filesystem.h"
+
+#define SQFS_CACHE_SIZE	(CONFIG_FS_SQUASHFS_CACHE_SIZE * 1024)
+
+struct sqfs_cache_entry {
+	struct list_head sibling;
+	u64 pos;
+	u32 size;
+	unsigned char data[] __aligned(8);
+};
+
+static void sqfs_cache_free_entry(struct squashfs_ctxt *ctxt,
+				  struct sqfs_cache_entry *entry)
+{
+	list_del(&entry->sibling);
+	ctxt->cache_size -= entry->size;
+	free(entry);
+}
+
+/*
+ * Returns the block cached for device position @pos and sets @sizep to its
+ * size, or returns NULL if there is none.
+ */
+void *sqfs_cache_find(struct squashfs_ctxt *ctxt, u64 pos, u32 *sizep)
+{
+	struct sqfs_cache_entry *entry;
+
+	if (!ctxt->cache.next)
+		return NULL;
+
+	list_for_each_entry(entry, &ctxt->cache, sibling) {
+		if (entry->pos == pos) {
+			list_move(&entry->sibling, &ctxt->cache);
+			*sizep = entry->size;
+			return entry->data;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Adds an entry of @size bytes for device position @pos and returns the
+ * buffer for the caller to fill in, or NULL if out of memory. Old entries are
+ * dropped to make room, though the new one is always added. The buffer stays
+ * valid until the next call to sqfs_cache_add().
+ */
+void *sqfs_cache_add(struct squashfs_ctxt *ctxt, u64 pos, u32 size)
+{
+	struct sqfs_cache_entry *entry;
+
+	if (!ctxt->cache.next)
+		INIT_LIST_HEAD(&ctxt->cache);
+
+	while (!list_empty(&ctxt->cache) &&
+	       ctxt->cache_size + size > SQFS_CACHE_SIZE) {
+		entry = list_last_entry(&ctxt->cache, struct sqfs_cache_entry,
+					sibling);
+		sqfs_cache_free_entry(ctxt, entry);
+	}
+
+	entry = malloc(sizeof(*entry) + size);
+	if (!entry)
+		return NULL;
+
+	entry->pos = pos;
+	entry->size = size;
+	list_add(&entry->sibling, &ctxt->cache);
+	ctxt->cache_size += size;
+
+	return entry->data;
+}
+
+/* Drops an entry returned by sqfs_cache_add() which could not be filled in */
+void sqfs_cache_drop(struct squashfs_ctxt *ctxt, void *data)
+{
+	sqfs_cache_free_entry(ctxt, container_of(data, struct sqfs_cache_entry,
+						 data));
+}
+
+void sqfs_cache_free(struct squashfs_ctxt *ctxt)
+{
+	struct sqfs_cache_entry *entry, *next;
+
+	if (!ctxt->cache.next)
+		return;
+
+	list_for_each_entry_safe(entry, next, &ctxt->cache, sibling)
+		sqfs_cache_free_entry(ctxt, entry);
+}
@@ -11,6 +11,7 @@
 #include <asm/unaligned.h>
 #include <fs.h>
 #include <part.h>
+#include <linux/list.h>
 #include <stdint.h>
 
 #define SQFS_MAGIC_NUMBER 0x73717368
@@ -78,6 +79,27 @@ struct squashfs_ctxt {
 #if IS_ENABLED(CONFIG_ZSTD)
 	void *zstd_workspace;
 #endif
+	/*
+	 * Tables kept until the filesystem is closed. The inode table is
+	 * decompressed as a whole the first time it is needed. The directory
+	 * table is decompressed one metadata block at a time, as directories
+	 * are looked up: 'dir_src' holds the compressed table, 'dir_pos' the
+	 * position of each metadata block in it and 'dir_loaded' whether the
+	 * block has been decompressed into 'dir_table' yet.
+	 */
+	unsigned char *inode_table;
+	unsigned char *dir_table;
+	unsigned char *dir_src;
+	u32 dir_src_offset;
+	u32 *dir_pos;
+	bool *dir_loaded;
+	int dir_count;
+	/* Fragment index table, read the first time a fragment is looked up */
+	unsigned char *frag_table;
+	u64 frag_table_offset;
+	/* Decompressed metadata and fragment blocks, most recently used first */
+	struct list_head cache;
+	size_t cache_size;
 };
 
 struct squashfs_directory_index {
@@ -272,7 +294,7 @@ struct squashfs_dir_stream {
 	struct squashfs_ldir_inode i_ldir;
 	/*
 	 * References to the tables' beginnings. They are assigned in
-	 * sqfs_opendir() and freed in sqfs_closedir().
+	 * sqfs_opendir() and belong to the squashfs context.
 	 */
 	unsigned char *inode_table;
 	unsigned char *dir_table;
@@ -305,4 +327,12 @@ bool sqfs_is_empty_dir(void *dir_i);
 
 bool sqfs_is_dir(u16 type);
 
+void *sqfs_cache_find(struct squashfs_ctxt *ctxt, u64 pos, u32 *sizep);
+
+void *sqfs_cache_add(struct squashfs_ctxt *ctxt, u64 pos, u32 size);
+
+void sqfs_cache_drop(struct squashfs_ctxt *ctxt, void *data);
+
+void sqfs_cache_free(struct squashfs_ctxt *ctxt);
+
 #endif /* SQFS_FILESYSTEM_H */
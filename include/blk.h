@@ -10,6 +10,7 @@
 #include <bouncebuf.h>
 #include <dm/uclass-id.h>
 #include <efi.h>
+#include <linux/list.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -124,6 +125,28 @@ int blkcache_read(int iftype, int dev,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer);
 
+/**
+ * blkcache_read_partial() - read the cached blocks at each end of a request
+ *
+ * This copies the run of cached blocks at the start of the request, and if
+ * that does not cover the whole request, the run of cached blocks at the end.
+ * The caller only needs to read the blocks between them from the device.
+ *
+ * @iftype: uclass_id_x for type of device
+ * @dev: device index of particular type
+ * @start: starting block number
+ * @blkcnt: number of blocks to read
+ * @blksz: size in bytes of each block
+ * @buffer: buffer to contain cached data
+ * @tailp: returns the number of blocks copied to the end of @buffer
+ * Return: number of blocks copied to the start of @buffer. This is @blkcnt
+ * if the whole request was served from the cache
+ */
+lbaint_t blkcache_read_partial(int iftype, int dev,
+			       lbaint_t start, lbaint_t blkcnt,
+			       unsigned long blksz, void *buffer,
+			       lbaint_t *tailp);
+
 /**
  * blkcache_fill() - make data read from a block device available
  * to the block cache
@@ -152,20 +175,23 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - maximum number of blocks in a read which is cached
+ * @param size - maximum number of bytes of block data held in the cache
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, ulong size);
 
 /*
  * statistics of the block cache
  */
 struct block_cache_stats {
 	unsigned hits;
+	unsigned partial_hits;	/* requests served partly from the cache */
 	unsigned misses;
-	unsigned entries; /* current entry count */
+	unsigned evictions;	/* blocks dropped to stay within max_size */
+	unsigned entries; /* current number of cached blocks */
 	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	ulong size;		/* bytes of block data currently cached */
+	ulong max_size;
 };
 
 /**
@@ -187,6 +213,16 @@ static inline int blkcache_read(int iftype, int dev,
 	return 0;
 }
 
+static inline lbaint_t blkcache_read_partial(int iftype, int dev,
+					     lbaint_t start, lbaint_t blkcnt,
+					     unsigned long blksz, void *buffer,
+					     lbaint_t *tailp)
+{
+	*tailp = 0;
+
+	return 0;
+}
+
 static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
@@ -200,6 +236,55 @@ static inline void blkcache_free(void) {}
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
+/**
+ * enum blk_req_op - Operation carried out by an asynchronous block request
+ *
+ * @BLK_REQ_READ: Read blocks from the device
+ * @BLK_REQ_WRITE: Write blocks to the device
+ */
+enum blk_req_op {
+	BLK_REQ_READ,
+	BLK_REQ_WRITE,
+};
+
+/**
+ * struct blk_request - An asynchronous block-device request
+ *
+ * The caller fills in the fields from @dev to @priv and passes the request to
+ * blk_submit(). The request must stay valid until it completes.
+ *
+ * @dev: Block device to access
+ * @op: Operation to carry out
+ * @start: Start block number
+ * @blkcnt: Number of blocks to transfer
+ * @buf: Buffer to read into or write from
+ * @complete: Called from blk_poll() when the request completes, or NULL
+ * @priv: Private data for the caller, e.g. for use by @complete
+ * @result: Number of blocks transferred, or -ve error number. Valid once
+ *	@done is true
+ * @done: true once the request has completed
+ * @sibling: Used by the uclass to queue completed requests
+ * @pending: Used by drivers which split a request into several operations,
+ *	to count those still in flight
+ * @error: Used by drivers to record an error in one of those operations
+ */
+struct blk_request {
+	struct udevice *dev;
+	enum blk_req_op op;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buf;
+	void (*complete)(struct blk_request *req);
+	void *priv;
+
+	long result;
+	bool done;
+
+	struct list_head sibling;
+	uint pending;
+	int error;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -276,6 +361,35 @@ struct blk_ops {
 	 */
 	int (*buffer_aligned)(struct udevice *dev, struct bounce_buffer *state);
 #endif	/* CONFIG_BOUNCE_BUFFER */
+
+#if CONFIG_IS_ENABLED(BLK_ASYNC)
+	/**
+	 * submit() - start an asynchronous read or write
+	 *
+	 * This queues the request with the hardware and returns without
+	 * waiting for it. When the transfer finishes, the driver's poll()
+	 * method must call blk_request_done().
+	 *
+	 * @dev:	Block device to access
+	 * @req:	Request to start
+	 * @return 0 if OK, -EAGAIN if the hardware queue is full (the uclass
+	 * then polls for completions and tries again), -ENOSYS if the
+	 * request cannot be handled asynchronously (the uclass then carries
+	 * it out synchronously), other -ve on error
+	 */
+	int (*submit)(struct udevice *dev, struct blk_request *req);
+
+	/**
+	 * poll() - check for completed asynchronous requests
+	 *
+	 * This must not block. It calls blk_request_done() for each request
+	 * which has completed.
+	 *
+	 * @dev:	Block device to check
+	 * @return number of requests completed, or -ve on error
+	 */
+	int (*poll)(struct udevice *dev);
+#endif
 };
 
 /*
@@ -317,6 +431,153 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 	       const void *buffer);
 
+/**
+ * struct blk_readahead_stats - read-ahead statistics for a block device
+ *
+ * @reads: Number of reads which reached the read-ahead layer
+ * @hits: Number of those reads which were (partly) served from the
+ *	read-ahead buffer
+ * @dev_reads: Number of reads sent to the device
+ */
+struct blk_readahead_stats {
+	ulong reads;
+	ulong hits;
+	ulong dev_reads;
+};
+
+/**
+ * struct blk_readahead - read-ahead state of a block device
+ *
+ * This is the uclass-private data of a block device, when
+ * CONFIG_BLK_READAHEAD is enabled.
+ *
+ * @buf: Buffer holding the prefetched blocks, allocated on first use
+ * @start: First block held in @buf
+ * @count: Number of valid blocks in @buf, 0 if none
+ * @next: Block which would be read next by a sequential reader
+ * @seq: Number of sequential reads seen in a row
+ * @window: Number of blocks to read on the next read-ahead
+ * @max_size: Maximum read-ahead size in bytes, 0 if disabled
+ * @stats: Statistics since they were last read
+ */
+struct blk_readahead {
+	void *buf;
+	lbaint_t start;
+	lbaint_t count;
+	lbaint_t next;
+	uint seq;
+	lbaint_t window;
+	ulong max_size;
+	struct blk_readahead_stats stats;
+};
+
+/**
+ * struct blk_uclass_priv - uclass-private data of a block device
+ *
+ * This is only allocated if CONFIG_BLK_READAHEAD or CONFIG_BLK_ASYNC is
+ * enabled.
+ *
+ * @ra: Read-ahead state
+ * @inflight: Number of asynchronous requests submitted to the driver and not
+ *	yet completed
+ * @queue_depth: Maximum value of @inflight
+ * @done_list: Completed asynchronous requests whose callbacks have not yet
+ *	been called
+ */
+struct blk_uclass_priv {
+	struct blk_readahead ra;
+	uint inflight;
+	uint queue_depth;
+	struct list_head done_list;
+};
+
+/**
+ * blk_set_readahead() - Set the maximum read-ahead size of a block device
+ *
+ * Any data already read ahead is discarded.
+ *
+ * @dev: Block device (must be probed)
+ * @max_size: Maximum number of bytes to read ahead, 0 to disable read-ahead
+ * Return: 0 if OK, -ENODEV if read-ahead is not available
+ */
+int blk_set_readahead(struct udevice *dev, ulong max_size);
+
+/**
+ * blk_get_readahead() - Get the read-ahead settings of a block device
+ *
+ * @dev: Block device (must be probed)
+ * @max_sizep: Returns the maximum read-ahead size in bytes
+ * @stats: Returns the read-ahead statistics, which are then reset. May be
+ *	NULL
+ * Return: 0 if OK, -ENODEV if read-ahead is not available
+ */
+int blk_get_readahead(struct udevice *dev, ulong *max_sizep,
+		      struct blk_readahead_stats *stats);
+
+/**
+ * blk_submit() - Start an asynchronous block-device request
+ *
+ * If the driver supports asynchronous I/O, this queues the request and
+ * returns straight away. Otherwise the transfer is carried out before
+ * returning. In both cases, the request's callback is called from a later
+ * blk_poll() or blk_wait() on the device.
+ *
+ * If the device already has its maximum number of requests in flight, this
+ * waits for one of them to complete first.
+ *
+ * @req: Request to submit
+ * Return: 0 if OK, -ve on error (the request is not queued)
+ */
+int blk_submit(struct blk_request *req);
+
+/**
+ * blk_poll() - Process completed asynchronous requests on a block device
+ *
+ * This calls the callback of each request which has completed.
+ *
+ * @dev: Block device to check
+ * Return: number of requests still in flight, or -ve on error
+ */
+int blk_poll(struct udevice *dev);
+
+/**
+ * blk_wait() - Wait for an asynchronous request to complete
+ *
+ * @req: Request to wait for
+ * Return: number of blocks transferred, or -ve on error (-ETIMEDOUT if the
+ * request did not complete in time)
+ */
+long blk_wait(struct blk_request *req);
+
+/**
+ * blk_drain() - Wait for all asynchronous requests on a device to complete
+ *
+ * @dev: Block device to wait for
+ * Return: 0 if OK, -ETIMEDOUT if requests are still in flight
+ */
+int blk_drain(struct udevice *dev);
+
+/**
+ * blk_set_queue_depth() - Set the number of requests a device can have in
+ * flight
+ *
+ * @dev: Block device (must be probed)
+ * @depth: Maximum number of requests in flight, at least 1
+ * Return: 0 if OK, -EINVAL if @depth is 0, -ENODEV if asynchronous I/O is not
+ * available
+ */
+int blk_set_queue_depth(struct udevice *dev, uint depth);
+
+/**
+ * blk_request_done() - Mark an asynchronous request as completed
+ *
+ * This is called by block drivers from their poll() method.
+ *
+ * @req: Request which has completed
+ * @result: Number of blocks transferred, or -ve error number
+ */
+void blk_request_done(struct blk_request *req, long result);
+
 /**
  * blk_erase() - Erase part of a block device
  *
@@ -466,6 +727,17 @@ int blk_next_free_devnum(enum uclass_id uclass_id);
  */
 int blk_select_hwpart(struct udevice *dev, int hwpart);
 
+/**
+ * blk_get_generation() - Get the generation count of the block devices
+ *
+ * The count changes whenever any block device is written, erased or removed,
+ * or has its hardware partition changed. Filesystems can record it along with
+ * state they cache from a device, and drop that state once it changes.
+ *
+ * Return: current generation count
+ */
+ulong blk_get_generation(void);
+
 /**
  * blk_find_from_parent() - find a block device by looking up its parent
  *
@@ -571,6 +843,11 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
+static inline ulong blk_get_generation(void)
+{
+	return 0;
+}
+
 /**
  * struct blk_driver - Driver for block interface types
  *
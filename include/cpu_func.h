@@ -52,6 +52,23 @@ int checkcpu(void);
 void smp_set_core_boot_addr(unsigned long addr, int corenr);
 void smp_kick_all_cpus(void);
 
+/**
+ * cpu_run_parallel() - Call a function for each of several arguments at once
+ *
+ * The calls are spread over the available CPUs and run in any order. They
+ * may only touch memory which belongs to their argument, so must not use
+ * malloc(), the console, global data or drivers. This function returns when
+ * all calls have finished.
+ *
+ * This is only available when the architecture selects HAVE_CPU_RUN_PARALLEL.
+ *
+ * @func: Function to call
+ * @args: Argument for each call
+ * @count: Number of calls
+ * Return: 0 if OK, -ve on error, in which case @func is not called
+ */
+int cpu_run_parallel(void (*func)(void *arg), void *args[], int count);
+
 int icache_status(void);
 void icache_enable(void);
 void icache_disable(void);
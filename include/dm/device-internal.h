@@ -192,6 +192,56 @@ int device_of_to_plat(struct udevice *dev);
  */
 int device_probe(struct udevice *dev);
 
+#if CONFIG_IS_ENABLED(DM_PROBE_LATER)
+/**
+ * device_probe_later_begin() - Start letting probes finish later
+ *
+ * Until device_probe_later_end() is called, device_probe_later() adds the
+ * device to a list of waiting probes instead of waiting for it.
+ */
+void device_probe_later_begin(void);
+
+/**
+ * device_probe_later_end() - Wait for all probes to finish
+ *
+ * This waits for each device in the list of waiting probes to be ready, or to
+ * time out.
+ */
+void device_probe_later_end(void);
+
+/**
+ * device_probe_later_poll() - Finish probing devices which are ready
+ *
+ * This checks each device in the list of waiting probes once, finishing the
+ * probe of those which are ready.
+ */
+void device_probe_later_poll(void);
+
+/**
+ * device_probe_later_wait() - Wait for a device's probe to finish
+ *
+ * @dev: Device with DM_FLAG_PROBE_LATER set
+ * Return: 0 if OK, -ve if the device failed to finish probing
+ */
+int device_probe_later_wait(struct udevice *dev);
+
+/**
+ * device_probe_later_cancel() - Stop waiting for a device's probe
+ *
+ * This is called when the device is removed. It drops the device from the
+ * list of waiting probes and clears DM_FLAG_PROBE_LATER.
+ *
+ * @dev: Device with DM_FLAG_PROBE_LATER set
+ */
+void device_probe_later_cancel(struct udevice *dev);
+#else
+static inline void device_probe_later_begin(void) {}
+static inline void device_probe_later_end(void) {}
+static inline void device_probe_later_poll(void) {}
+static inline int device_probe_later_wait(struct udevice *dev) { return 0; }
+static inline void device_probe_later_cancel(struct udevice *dev) {}
+#endif
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
@@ -84,6 +84,9 @@ struct driver_info;
 /* Device must be probed after it was bound */
 #define DM_FLAG_PROBE_AFTER_BIND	(1 << 15)
 
+/* Device probe is waiting to finish, see device_probe_later() */
+#define DM_FLAG_PROBE_LATER		(1 << 16)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -112,6 +115,24 @@ enum {
 	DM_REMOVE_NO_PD		= 1 << 1,
 };
 
+/**
+ * enum uclass_index_t - Hash tables kept by a uclass to find its devices
+ *
+ * See CONFIG_DM_UCLASS_INDEX
+ *
+ * @UCLASS_INDEX_SEQ: Devices by sequence number
+ * @UCLASS_INDEX_NAME: Devices by name
+ * @UCLASS_INDEX_NODE: Devices by device tree node
+ * @UCLASS_INDEX_COUNT: Number of hash tables
+ */
+enum uclass_index_t {
+	UCLASS_INDEX_SEQ,
+	UCLASS_INDEX_NAME,
+	UCLASS_INDEX_NODE,
+
+	UCLASS_INDEX_COUNT,
+};
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -166,6 +187,13 @@ enum {
  * @dma_offset: Offset between the physical address space (CPU's) and the
  *		device's bus address space
  * @iommu: IOMMU device associated with this device
+ * @index_next_: Next device in each hash chain of the uclass index, see
+ *	enum uclass_index_t (do not access outside driver model)
+ * @index_order_: Position of this device in its uclass, used to keep the hash
+ *	chains in bind order (do not access outside driver model)
+ * @index_hash_: Hash of the value in each table of the uclass index when the
+ *	device was added to it, so that it can be removed after the value
+ *	changes (do not access outside driver model)
  */
 struct udevice {
 	const struct driver *driver;
@@ -198,6 +226,11 @@ struct udevice {
 #if CONFIG_IS_ENABLED(IOMMU)
 	struct udevice *iommu;
 #endif
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct udevice *index_next_[UCLASS_INDEX_COUNT];
+	uint index_order_;
+	uint index_hash_[UCLASS_INDEX_COUNT];
+#endif
 };
 
 static inline int dm_udevice_size(void)
@@ -266,8 +299,12 @@ static inline __attribute_const__ ofnode dev_ofnode(const struct udevice *dev)
 #endif
 }
 
-/* Returns non-zero if the device is active (probed and not removed) */
-#define device_active(dev)	(dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+/*
+ * Returns non-zero if the device is active (probed and not removed). A device
+ * whose probe is waiting to finish is not active yet.
+ */
+#define device_active(dev)	((dev_get_flags(dev) & (DM_FLAG_ACTIVATED | \
+				 DM_FLAG_PROBE_LATER)) == DM_FLAG_ACTIVATED)
 
 #if CONFIG_IS_ENABLED(DM_DMA)
 #define dev_set_dma_offset(_dev, _offset)	_dev->dma_offset = _offset
@@ -930,6 +967,31 @@ bool device_has_active_children(const struct udevice *dev);
  */
 bool device_is_last_sibling(const struct udevice *dev);
 
+/**
+ * device_probe_later() - Let a device's probe finish later
+ *
+ * This may be called by a probe() method which has started something slow,
+ * such as a regulator ramp, a PHY link or a card initialising. The probe()
+ * method then returns 0. Other devices are probed while this one waits.
+ * @poll is called from time to time until it returns something other than
+ * -EAGAIN. Only then does the uclass see the device, through its post_probe()
+ * method. Anything calling device_probe() on the device in the meantime waits
+ * until it is done. If @poll fails or times out, the device is removed.
+ *
+ * Outside dm_init_and_scan() and before relocation, there is nothing else to
+ * do, so this just waits for @poll.
+ *
+ * @dev:	Device being probed
+ * @poll:	Function to check whether the device is ready. It returns 0
+ *		when it is, -EAGAIN if not yet, other -ve on error. It must not
+ *		probe @dev
+ * @timeout_ms:	Time to wait for @poll to succeed
+ * Return: 0 if OK (which may mean that the device is still waiting), -ETIMEDOUT
+ *	if @poll did not succeed in time, other -ve on error
+ */
+int device_probe_later(struct udevice *dev, int (*poll)(struct udevice *dev),
+		       ulong timeout_ms);
+
 /**
  * device_set_name() - set the name of a device
  *
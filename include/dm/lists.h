@@ -12,6 +12,8 @@
 #include <dm/ofnode.h>
 #include <dm/uclass-id.h>
 
+struct udevice_id;
+
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
  *
@@ -45,6 +47,19 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * This finds the first driver in the linker list with @compat in its of_match
+ * table, which is the driver lists_bind_fdt() binds for that string.
+ *
+ * @compat: Compatible string to look up
+ * @idp: Returns the matching entry in the driver's of_match table
+ * Return: driver found, or NULL if none
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
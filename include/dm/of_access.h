@@ -255,6 +255,52 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 					       const char *propname,
 					       const void *propval,
 					       int proplen);
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+/**
+ * of_phandle_table_build() - Build a table of the phandles in a live tree
+ *
+ * This lets of_find_node_by_phandle() find a node without walking the tree.
+ * The table is checked on each use, so it does not need updating when the
+ * tree is changed, except that of_remove_node() clears the entries of the
+ * nodes it removes. No table is built if the tree has no phandles or they are
+ * very sparse.
+ *
+ * @root:	root node of the tree
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int of_phandle_table_build(struct device_node *root);
+
+/**
+ * of_phandle_table_free() - Free the phandle table of a live tree
+ *
+ * This must be called before the tree is freed.
+ *
+ * @root:	root node of the tree
+ */
+void of_phandle_table_free(struct device_node *root);
+
+/**
+ * of_phandle_stats() - Get stats on looking up phandles in live trees
+ *
+ * @lookupsp:	returns the number of calls to of_find_node_by_phandle()
+ * @hitsp:	returns how many of those used a phandle table
+ */
+void of_phandle_stats(uint *lookupsp, uint *hitsp);
+#else
+static inline int of_phandle_table_build(struct device_node *root)
+{
+	return 0;
+}
+
+static inline void of_phandle_table_free(struct device_node *root) {}
+
+static inline void of_phandle_stats(uint *lookupsp, uint *hitsp)
+{
+	*lookupsp = 0;
+	*hitsp = 0;
+}
+#endif
+
 /**
  * of_find_node_by_phandle() - Find a node given a phandle
  *
@@ -34,6 +34,8 @@ extern struct list_head uclass_head;
  * @attach_size_total: Total number of bytes of attached data
  * @attach_count: Number of devices with attached, for each type
  * @attach_size: Total number of bytes of attached data, for each type
+ * @phandle_lookups: Number of phandle lookups which could use a phandle table
+ * @phandle_hits: Number of those lookups which did not need to search the tree
  */
 struct dm_stats {
 	int total_size;
@@ -50,6 +52,8 @@ struct dm_stats {
 	int attach_size_total;
 	int attach_count[DM_TAG_ATTACH_COUNT];
 	int attach_size[DM_TAG_ATTACH_COUNT];
+	uint phandle_lookups;
+	uint phandle_hits;
 };
 
 /**
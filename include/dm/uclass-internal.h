@@ -93,6 +93,21 @@ void uclass_set_priv(struct uclass *uc, void *priv);
  */
 int uclass_find_next_free_seq(struct uclass *uc);
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/**
+ * uclass_index_update() - Update the uclass index for a changed device
+ *
+ * This must be called after changing the sequence number, name (or the string
+ * it points to) or device tree node of a bound device, so that it can be found
+ * by its new values. Nothing is done if the device is not bound.
+ *
+ * @dev:	Device which was changed
+ */
+void uclass_index_update(struct udevice *dev);
+#else
+static inline void uclass_index_update(struct udevice *dev) {}
+#endif
+
 /**
  * uclass_get_device_tail() - handle the end of a get_device call
  *
@@ -30,12 +30,27 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @dev_count_: Number of devices in this uclass (do not access outside driver
+ *	model)
+ * @index_order_: Order of the most recently bound device, see
+ *	&udevice.index_order_ (do not access outside driver model)
+ * @index_mask_: Number of hash buckets in each table of the index, minus one
+ *	(do not access outside driver model)
+ * @index_: Hash tables of devices, UCLASS_INDEX_COUNT blocks of
+ *	@index_mask_ + 1 buckets, or NULL if not indexed. See
+ *	CONFIG_DM_UCLASS_INDEX (do not access outside driver model)
  */
 struct uclass {
 	void *priv_;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	uint dev_count_;
+	uint index_order_;
+	uint index_mask_;
+	struct udevice **index_;
+#endif
 };
 
 struct driver;
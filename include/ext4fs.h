@@ -34,6 +34,8 @@ struct disk_partition;
 #define EXT4_TOPDIR_FL		0x00020000 /* Top of directory hierarchies*/
 #define EXT4_EXTENTS_FL		0x00080000 /* Inode uses extents */
 #define EXT4_EXT_MAGIC			0xf30a
+#define EXT4_EXT_MAX_DEPTH		5 /* Deepest possible extent tree */
+#define EXT4_EXT_INIT_MAX_LEN		32768 /* Longer extents are unwritten */
 #define EXT4_FEATURE_RO_COMPAT_GDT_CSUM	0x0010
 #define EXT4_FEATURE_RO_COMPAT_METADATA_CSUM 0x0400
 #define EXT4_FEATURE_INCOMPAT_EXTENTS	0x0040
@@ -126,6 +128,19 @@ struct ext_block_cache {
 	int size;
 };
 
+/**
+ * struct ext_extent_cache - blocks on the last path through an extent tree
+ *
+ * Keeping one block for each level of the tree means that looking up the
+ * next extent of a file only reads from the device when it moves to a
+ * different index or leaf block.
+ *
+ * @level: block read at each level below the root held in the inode
+ */
+struct ext_extent_cache {
+	struct ext_block_cache level[EXT4_EXT_MAX_DEPTH];
+};
+
 extern struct ext2_data *ext4fs_root;
 extern struct ext2fs_node *ext4fs_file;
 
@@ -158,6 +173,9 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+long ext4fs_map_extent(struct ext2_inode *inode, uint32_t fileblock,
+		       struct ext_extent_cache *cache,
+		       unsigned long long *blknrp);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
@@ -167,4 +185,6 @@ int ext4fs_uuid(char *uuid_str);
 void ext_cache_init(struct ext_block_cache *cache);
 void ext_cache_fini(struct ext_block_cache *cache);
 int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size);
+void ext_extent_cache_init(struct ext_extent_cache *cache);
+void ext_extent_cache_fini(struct ext_extent_cache *cache);
 #endif
@@ -155,6 +155,8 @@ typedef struct dir_slot {
 	__u8	name11_12[4];	/* Last 2 characters in name */
 } dir_slot;
 
+struct fat_cache;
+
 /*
  * Private filesystem parameters
  *
@@ -176,6 +178,7 @@ typedef struct {
 	__u32	root_cluster;	/* First cluster of root dir for FAT32 */
 	u32	total_sect;	/* Number of sectors */
 	int	fats;		/* Number of FATs */
+	struct fat_cache *cache; /* FAT windows and file map, NULL if unused */
 } fsdata;
 
 struct fat_itr;
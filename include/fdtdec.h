@@ -691,6 +691,42 @@ int fdtdec_get_chosen_node(const void *blob, const char *name);
  */
 const char *fdtdec_get_compatible(enum fdt_compat_id id);
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+/**
+ * fdtdec_node_offset_by_phandle() - Find the node with a given phandle
+ *
+ * This is the same as fdt_node_offset_by_phandle() except that, after
+ * relocation, lookups in the control FDT go through a table of phandles
+ * which is built on first use. Table entries are checked on each use, so they
+ * stay correct when the tree is written.
+ *
+ * @blob:	FDT blob
+ * @phandle:	phandle to look for
+ * Return: node offset if found, -ve FDT error code on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * fdtdec_phandle_stats() - Get stats on looking up phandles in the control FDT
+ *
+ * @lookupsp:	returns the number of lookups which could use the table
+ * @hitsp:	returns how many of those were found in the table
+ */
+void fdtdec_phandle_stats(uint *lookupsp, uint *hitsp);
+#else
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline void fdtdec_phandle_stats(uint *lookupsp, uint *hitsp)
+{
+	*lookupsp = 0;
+	*hitsp = 0;
+}
+#endif
+
 /* Look up a phandle and follow it to its node. Then return the offset
  * of that node.
  *
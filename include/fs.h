@@ -78,6 +78,20 @@ void fs_set_type(int type);
  */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
 
+/**
+ * fs_drop_mount() - Unmount a filesystem kept by the mount cache
+ *
+ * With CONFIG_FS_MOUNT_CACHE, fs_close() may leave the filesystem mounted
+ * for use by a later command. This unmounts it. It must be called by code
+ * which uses a filesystem driver directly, rather than through this layer,
+ * since that changes the state of the driver.
+ */
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+void fs_drop_mount(void);
+#else
+static inline void fs_drop_mount(void) {}
+#endif
+
 /**
  * fs_close() - Unset current block device and partition
  *
@@ -150,6 +164,28 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/**
+ * fs_read_decomp() - read and decompress a file from the partition previously
+ * set by fs_set_blk_dev()
+ *
+ * A gzip or zstd compressed file is read in chunks of
+ * CONFIG_FS_LOAD_DECOMP_BUF_SIZE bytes, each of which is decompressed before
+ * the next is read. Other files are read as they are.
+ *
+ * @filename:	full path of the file to read from
+ * @addr:	address of the buffer to write the uncompressed data to
+ * @offset:	offset in the file from where to start reading
+ * @len:	maximum number of uncompressed bytes, or 0 for no limit other
+ *		than the free memory at @addr
+ * @actread:	returns the number of uncompressed bytes
+ * @comp_size:	returns the number of bytes read from the file
+ * Return:	0 if OK, -ENOSPC if the uncompressed data does not fit,
+ *		-EPROTONOSUPPORT if the file uses another compression, other
+ *		-ve on error
+ */
+int fs_read_decomp(const char *filename, ulong addr, loff_t offset,
+		   loff_t len, loff_t *actread, loff_t *comp_size);
+
 /**
  * fs_write() - write file to the partition previously set by fs_set_blk_dev()
  *
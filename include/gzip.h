@@ -31,6 +31,27 @@ int gzip_parse_header(const unsigned char *src, unsigned long len);
  */
 int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 
+/**
+ * gunzip_stream() - Decompress gzipped data while reading it
+ *
+ * The compressed data is read in chunks into @buf and each chunk is
+ * decompressed before the next is read. The CRC in the gzip trailer is checked.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @buf: Buffer to read compressed data into
+ * @buf_size: Size of @buf
+ * @read: Reads up to @size bytes of compressed data into @buf, returning the
+ *	number of bytes read, 0 at the end of the data or -ve on error
+ * @priv: Private data passed to @read
+ * @lenp: Returns length of uncompressed data
+ * Return: 0 if OK, -ENOSPC if @dstlen is too small, -EIO if the data is
+ * corrupt or ends early, other -ve error from @read
+ */
+int gunzip_stream(void *dst, ulong dstlen, void *buf, ulong buf_size,
+		  long (*read)(void *priv, void *buf, ulong size), void *priv,
+		  ulong *lenp);
+
 /**
  * zunzip() - Uncompress blocks compressed with zlib without headers
  *
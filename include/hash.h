@@ -66,6 +66,24 @@ struct hash_algo {
 	 */
 	int (*hash_update)(struct hash_algo *algo, void *ctx, const void *buf,
 			   unsigned int size, int is_last);
+	/*
+	 * hash_update_multi: Perform hashing on several buffers together
+	 *
+	 * This is optional. It has the same effect as calling hash_update()
+	 * for each context in turn, but allows the algorithm to process the
+	 * buffers at the same time. The contexts are freed by this function
+	 * if an error occurs.
+	 *
+	 * @algo: Pointer to the hash_algo struct
+	 * @ctx: Contexts for hashing, one for each buffer
+	 * @buf: Buffers being hashed
+	 * @count: Number of buffers
+	 * @size: Size of each buffer
+	 * @return 0 if ok, -1 on error
+	 */
+	int (*hash_update_multi)(struct hash_algo *algo, void *ctx[],
+				 const void *buf[], int count,
+				 unsigned int size);
 	/*
 	 * hash_finish: Write the hash result to the given buffer
 	 *
@@ -120,6 +138,47 @@ int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size);
 
+/**
+ * struct hash_job - A hash to calculate with hash_calculate_jobs()
+ *
+ * @algo_name:		Hash algorithm to use
+ * @data:		Data to hash
+ * @size:		Length of data to hash in bytes
+ * @output:		Returns the hash value
+ * @output_size:	Returns the number of bytes used in @output
+ * @ret:		Returns 0 if OK, -EPROTONOSUPPORT if the algorithm is
+ *			not available for progressive hashing, other -ve on
+ *			error
+ * @algo:		Algorithm being used (internal)
+ * @ctx:		Hashing context (internal)
+ * @done:		true once the data has been hashed (internal)
+ */
+struct hash_job {
+	const char *algo_name;
+	const void *data;
+	uint size;
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	int output_size;
+	int ret;
+	struct hash_algo *algo;
+	void *ctx;
+	bool done;
+};
+
+/**
+ * hash_calculate_jobs() - Calculate several hashes, in parallel if possible
+ *
+ * With CONFIG_HASH_PARALLEL, the hashes are calculated at the same time using
+ * cpu_run_parallel() where the architecture provides it. Otherwise, hashes
+ * which use an algorithm that can process several buffers together are
+ * calculated that way, and the rest one after the other. The result of each
+ * is in its @ret member.
+ *
+ * @jobs:	Hashes to calculate
+ * @count:	Number of hashes
+ */
+void hash_calculate_jobs(struct hash_job *jobs, int count);
+
 #endif /* !USE_HOSTCC */
 
 /**
@@ -1021,6 +1021,31 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+/**
+ * image_decomp_stream() - decompress an image while reading it
+ *
+ * The compressed image is read through @read in chunks of up to @buf_size
+ * bytes, each of which is decompressed before the next is read. This avoids
+ * holding the whole compressed image in memory. Only gzip and zstd are
+ * supported.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load_buf:	Place to decompress to
+ * @unc_len:	Available space for decompression
+ * @buf_size:	Size of the buffer to allocate for compressed data
+ * @read:	Reads up to @size bytes of the compressed image into @buf,
+ *		returning the number of bytes read, 0 at the end of the image
+ *		or -ve on error
+ * @priv:	Private data passed to @read
+ * @lenp:	Returns the number of uncompressed bytes
+ * Return: 0 if OK, -EPROTONOSUPPORT if @comp cannot be decompressed this way,
+ * -ENOSPC if @unc_len is too small, other -ve on error
+ */
+int image_decomp_stream(int comp, void *load_buf, ulong unc_len,
+			ulong buf_size,
+			long (*read)(void *priv, void *buf, ulong size),
+			void *priv, ulong *lenp);
+
 /**
  * Set up properties in the FDT
  *
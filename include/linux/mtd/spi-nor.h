@@ -480,6 +480,24 @@ struct spi_flash {
 #define spi_flash spi_nor
 #endif
 
+#define SPI_NOR_RCACHE_LINES		4
+#define SPI_NOR_RCACHE_LINE_SIZE	256
+
+/**
+ * struct spi_nor_rcache - Cache of recently read flash data
+ * @buf:	SPI_NOR_RCACHE_LINES lines of SPI_NOR_RCACHE_LINE_SIZE bytes,
+ *		allocated on first use
+ * @addr:	flash offset of each line
+ * @valid:	bitmask of the lines which hold valid data
+ * @next:	line to replace on the next miss
+ */
+struct spi_nor_rcache {
+	u8 *buf;
+	loff_t addr[SPI_NOR_RCACHE_LINES];
+	u8 valid;
+	u8 next;
+};
+
 /**
  * struct spi_nor - Structure for defining a the SPI NOR layer
  * @mtd:		point to a mtd_info structure
@@ -530,6 +548,7 @@ struct spi_flash {
  * @octal_dtr_enable:	[FLASH-SPECIFIC] enables SPI NOR octal DTR mode.
  * @ready:		[FLASH-SPECIFIC] check if the flash is ready
  * @dirmap:		pointers to struct spi_mem_dirmap_desc for reads/writes.
+ * @rcache:		cache of recently read data, dropped on write/erase
  * @priv:		the private data
  */
 struct spi_nor {
@@ -585,6 +604,9 @@ struct spi_nor {
 		struct spi_mem_dirmap_desc *rdesc;
 		struct spi_mem_dirmap_desc *wdesc;
 	} dirmap;
+#if CONFIG_IS_ENABLED(SPI_FLASH_READ_CACHE)
+	struct spi_nor_rcache	rcache;
+#endif
 
 	void *priv;
 	char mtd_name[MTD_NAME_SIZE(MTD_DEV_TYPE_NOR)];
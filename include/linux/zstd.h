@@ -455,4 +455,27 @@ struct abuf;
  */
 int zstd_decompress(struct abuf *in, struct abuf *out);
 
+/**
+ * zstd_decompress_read() - Decompress Zstandard data while reading it
+ *
+ * The compressed data is read in chunks into @buf and each chunk is
+ * decompressed before the next is read. Besides @buf, a workspace as large as
+ * the window size of the frame is needed.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @buf: Buffer to read compressed data into
+ * @buf_size: Size of @buf
+ * @read: Reads up to @size bytes of compressed data into @buf, returning the
+ *	number of bytes read, 0 at the end of the data or -ve on error
+ * @priv: Private data passed to @read
+ * @lenp: Returns length of uncompressed data
+ * Return: 0 if OK, -ENOSPC if @dstlen is too small, -EINVAL if the data is
+ * corrupt or ends early, other -ve on error
+ */
+int zstd_decompress_read(void *dst, unsigned long dstlen, void *buf,
+			 unsigned long buf_size,
+			 long (*read)(void *priv, void *buf, unsigned long size),
+			 void *priv, unsigned long *lenp);
+
 #endif  /* LINUX_ZSTD_H */
@@ -40,34 +40,36 @@ struct lmb_property {
  * all the #if test are done with CONFIG_LMB_USE_MAX_REGIONS (boolean)
  *
  * case 1. CONFIG_LMB_USE_MAX_REGIONS is defined (legacy mode)
- *         => CONFIG_LMB_MAX_REGIONS is used to configure the region size,
- *         directly in the array lmb_region.region[], with the same
- *         configuration for memory and reserved regions.
+ *         => CONFIG_LMB_MAX_REGIONS is used to configure the initial number
+ *         of regions, with the same configuration for memory and reserved
+ *         regions.
  *
- * case 2. CONFIG_LMB_USE_MAX_REGIONS is not defined, the size of each
- *         region is configurated *independently* with
+ * case 2. CONFIG_LMB_USE_MAX_REGIONS is not defined, the initial number of
+ *         regions is configurated *independently* with
  *         => CONFIG_LMB_MEMORY_REGIONS: struct lmb.memory_regions
  *         => CONFIG_LMB_RESERVED_REGIONS: struct lmb.reserved_regions
- *         lmb_region.region is only a pointer to the correct buffer,
- *         initialized in lmb_init(). This configuration is useful to manage
- *         more reserved memory regions with CONFIG_LMB_RESERVED_REGIONS.
+ *
+ * In both cases lmb_region.region points to the array in struct lmb after
+ * lmb_init(). If more regions are needed, they are moved to a larger array
+ * allocated with malloc(), which is released by lmb_uninit().
  */
 
 /**
  * struct lmb_region - Description of a set of region.
  *
+ * The regions are kept sorted by base address and do not overlap, so they
+ * can be searched with a binary search.
+ *
  * @cnt: Number of regions.
- * @max: Size of the region array, max value of cnt.
+ * @max: Size of the region array, max value of cnt before it must grow.
+ * @allocated: true if @region was allocated with malloc()
  * @region: Array of the region properties
  */
 struct lmb_region {
 	unsigned long cnt;
 	unsigned long max;
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	struct lmb_property region[CONFIG_LMB_MAX_REGIONS];
-#else
+	bool allocated;
 	struct lmb_property *region;
-#endif
 };
 
 /**
@@ -80,19 +82,35 @@ struct lmb_region {
  *
  * @memory: Description of memory regions.
  * @reserved: Description of reserved regions.
- * @memory_regions: Array of the memory regions (statically allocated)
- * @reserved_regions: Array of the reserved regions (statically allocated)
+ * @memory_regions: Initial array of the memory regions (statically allocated)
+ * @reserved_regions: Initial array of the reserved regions (statically
+ *	allocated)
  */
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
-#if !IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
+#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
+	struct lmb_property memory_regions[CONFIG_LMB_MAX_REGIONS];
+	struct lmb_property reserved_regions[CONFIG_LMB_MAX_REGIONS];
+#else
 	struct lmb_property memory_regions[CONFIG_LMB_MEMORY_REGIONS];
 	struct lmb_property reserved_regions[CONFIG_LMB_RESERVED_REGIONS];
 #endif
 };
 
 void lmb_init(struct lmb *lmb);
+
+/**
+ * lmb_uninit() - Release memory allocated for a logical memory block handle
+ *
+ * This frees any region arrays which were allocated because the initial
+ * arrays in struct lmb were too small. It must be called before an lmb
+ * struct goes out of scope or is initialised again. It is safe to call on an
+ * lmb struct which is zeroed.
+ *
+ * @lmb:	the logical memory block struct
+ */
+void lmb_uninit(struct lmb *lmb);
 void lmb_init_and_reserve(struct lmb *lmb, struct bd_info *bd, void *fdt_blob);
 void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				phys_size_t size, void *fdt_blob);
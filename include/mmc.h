@@ -17,6 +17,7 @@
 #include <part.h>
 
 struct bd_info;
+struct cyclic_info;
 
 #if CONFIG_IS_ENABLED(MMC_HS200_SUPPORT)
 #define MMC_SUPPORTS_TUNING
@@ -74,6 +75,7 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+#define MMC_CAP_CQE		BIT(17)	/* host has a command queue engine */
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -213,6 +215,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 /*
  * EXT_CSD fields
  */
+#define EXT_CSD_CMDQ_MODE_EN		15	/* R/W */
 #define EXT_CSD_ENH_START_ADDR		136	/* R/W */
 #define EXT_CSD_ENH_SIZE_MULT		140	/* R/W */
 #define EXT_CSD_GP_SIZE_MULT		143	/* R/W */
@@ -243,6 +246,8 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_BOOT_MULT		226	/* RO */
 #define EXT_CSD_SEC_FEATURE		231	/* RO */
 #define EXT_CSD_GENERIC_CMD6_TIME       248     /* RO */
+#define EXT_CSD_CMDQ_DEPTH		307	/* RO */
+#define EXT_CSD_CMDQ_SUPPORT		308	/* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
 
 /*
@@ -298,6 +303,10 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_EXTRACT_BOOT_PART(x)		(((x) >> 3) & 0x7)
 #define EXT_CSD_EXTRACT_PARTITION_ACCESS(x)	((x) & 0x7)
 
+#define EXT_CSD_CMDQ_MODE_ENABLED	BIT(0)
+#define EXT_CSD_CMDQ_SUPPORTED		BIT(0)
+#define EXT_CSD_CMDQ_DEPTH_MASK		GENMASK(4, 0)
+
 #define EXT_CSD_BOOT_BUS_WIDTH_MODE(x)	(x << 3)
 #define EXT_CSD_BOOT_BUS_WIDTH_RESET(x)	(x << 2)
 #define EXT_CSD_BOOT_BUS_WIDTH_WIDTH(x)	(x)
@@ -429,6 +438,25 @@ struct mmc_data {
 	uint blocksize;
 };
 
+/* Maximum number of tasks in an eMMC command queue */
+#define MMC_CQE_MAX_DEPTH	32
+
+/* Maximum number of blocks in a single task (CMD44 has a 16-bit count) */
+#define MMC_CQE_MAX_BLKCNT	0xffff
+
+/**
+ * struct mmc_cqe_task - a read or write task for the command queue engine
+ *
+ * @start:	First block to transfer
+ * @blkcnt:	Number of blocks to transfer, at most MMC_CQE_MAX_BLKCNT
+ * @buf:	Buffer to read into or write from
+ */
+struct mmc_cqe_task {
+	lbaint_t start;
+	uint blkcnt;
+	void *buf;
+};
+
 /* forward decl. */
 struct mmc;
 
@@ -494,6 +522,27 @@ struct dm_mmc_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*execute_tuning)(struct udevice *dev, uint opcode);
+
+	/**
+	 * get_tuning() - Get the result of the last tuning
+	 *
+	 * This allows the tuning to be restored with set_tuning() when the
+	 * same bus mode is selected again, e.g. on the next boot.
+	 *
+	 * @dev:	Device to check
+	 * @tuningp:	Returns a host-specific value describing the tuning
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_tuning)(struct udevice *dev, u32 *tuningp);
+
+	/**
+	 * set_tuning() - Restore a tuning result instead of tuning again
+	 *
+	 * @dev:	Device to update
+	 * @tuning:	Value obtained from get_tuning()
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_tuning)(struct udevice *dev, u32 tuning);
 #endif
 
 	/**
@@ -542,6 +591,37 @@ struct dm_mmc_ops {
 	 * @return 0 if success, -ve on error
 	 */
 	int (*hs400_prepare_ddr)(struct udevice *dev);
+
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	/**
+	 * cqe_enable() - enable or disable the command queue engine
+	 *
+	 * This is called after the card has been switched into command
+	 * queue mode, and before it is switched back out of it. While the
+	 * engine is enabled, the card is only accessed via cqe_request().
+	 * It is only used if the host sets MMC_CAP_CQE.
+	 *
+	 * @dev:	Device to update
+	 * @enable:	true to enable the engine, false to disable it
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*cqe_enable)(struct udevice *dev, bool enable);
+
+	/**
+	 * cqe_request() - queue a set of tasks and wait for them to finish
+	 *
+	 * Each task uses its own task slot, so the card is free to execute
+	 * them in any order.
+	 *
+	 * @dev:	Device to use
+	 * @write:	true to write to the card, false to read from it
+	 * @tasks:	Tasks to queue
+	 * @count:	Number of tasks, at most the queue depth of the card
+	 * @return 0 if all tasks completed, -ve on error
+	 */
+	int (*cqe_request)(struct udevice *dev, bool write,
+			   struct mmc_cqe_task *tasks, int count);
+#endif
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -551,6 +631,8 @@ int mmc_set_ios(struct mmc *mmc);
 int mmc_getcd(struct mmc *mmc);
 int mmc_getwp(struct mmc *mmc);
 int mmc_execute_tuning(struct mmc *mmc, uint opcode);
+int mmc_get_tuning(struct mmc *mmc, u32 *tuningp);
+int mmc_set_tuning(struct mmc *mmc, u32 tuning);
 int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us);
 int mmc_set_enhanced_strobe(struct mmc *mmc);
 int mmc_host_power_cycle(struct mmc *mmc);
@@ -559,6 +641,10 @@ int mmc_reinit(struct mmc *mmc);
 int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt);
 int mmc_hs400_prepare_ddr(struct mmc *mmc);
 int mmc_send_stop_transmission(struct mmc *mmc, bool write);
+bool mmc_cqe_supported(struct mmc *mmc);
+int mmc_cqe_enable(struct mmc *mmc, bool enable);
+int mmc_cqe_request(struct mmc *mmc, bool write, struct mmc_cqe_task *tasks,
+		    int count);
 
 #else
 struct mmc_ops {
@@ -737,6 +823,19 @@ struct mmc {
 				  */
 	u32 quirks;
 	u8 hs400_tuning;
+#if CONFIG_IS_ENABLED(MMC_MODE_CACHE)
+	u32 tuning;		/* last tuning result, see mmc_get_tuning() */
+	bool tuned;		/* @tuning holds the result of the last tuning */
+	bool restore_tuning;	/* restore @tuning rather than tuning again */
+#endif
+#if CONFIG_IS_ENABLED(MMC_CQE)
+	u8 cmdq_depth;		/* command queue depth, 0 if not in use */
+	bool cmdq_en;		/* card and host are in command queue mode */
+#endif
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+	struct cyclic_info *init_cyclic; /* polls OCR while the card powers up */
+	ulong op_cond_start;	/* time when power-up polling started */
+#endif
 
 	enum bus_mode user_speed_mode; /* input speed mode from user */
 };
@@ -932,6 +1031,35 @@ int mmc_get_op_cond(struct mmc *mmc, bool quiet);
  */
 int mmc_start_init(struct mmc *mmc);
 
+/**
+ * mmc_start_init_cyclic() - Start device initialization in the background
+ *
+ * This works like mmc_start_init() but does not wait for the card to leave
+ * its power-up state. Instead the OCR is polled by a cyclic function, so the
+ * card powers up while other work is done. A later mmc_init() stops the
+ * polling and completes the initialization, waiting only if the card is
+ * still busy.
+ *
+ * @mmc:	Pointer to a MMC device struct
+ * Return: 0 on success, <0 on error
+ */
+int mmc_start_init_cyclic(struct mmc *mmc);
+
+/**
+ * mmc_stop_init_cyclic() - Stop background polling started for a device
+ *
+ * This does nothing if mmc_start_init_cyclic() is not in progress.
+ *
+ * @mmc:	Pointer to a MMC device struct
+ */
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+void mmc_stop_init_cyclic(struct mmc *mmc);
+#else
+static inline void mmc_stop_init_cyclic(struct mmc *mmc)
+{
+}
+#endif
+
 /**
  * Set preinit flag of mmc device.
  *
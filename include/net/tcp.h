@@ -5,6 +5,8 @@
  * Copyright 2017 Duncan Hare, All rights reserved.
  */
 
+#include <linux/log2.h>
+
 #define TCP_ACTIVITY 127		/* Number of packets received   */
 					/* before console progress mark */
 /**
@@ -68,8 +70,19 @@ struct ip_tcp_hdr {
  * TCP header options, Seq, MSS, and SACK
  */
 
-#define TCP_SACK 32			/* Number of packets analyzed   */
-					/* on leading edge of stream    */
+#define TCP_MSS		1460		/* Max segment size		*/
+
+/* Receive window, which may be larger than the 16-bit window field */
+#define TCP_RX_WINDOW	CONFIG_PROT_TCP_RX_WINDOW
+/* Window scale shift needed to advertise TCP_RX_WINDOW */
+#define TCP_SCALE	(TCP_RX_WINDOW > 0xffff ? \
+			 ilog2(TCP_RX_WINDOW >> 16) + 1 : 0)
+
+/*
+ * Number of packets analyzed on leading edge of stream: enough for two
+ * windows, since the first missing packet may be well into the array
+ */
+#define TCP_SACK	(2 * ((TCP_RX_WINDOW + TCP_MSS - 1) / TCP_MSS))
 
 #define TCP_O_END	0x00		/* End of option list		*/
 #define TCP_1_NOP	0x01		/* Single padding NOP		*/
@@ -85,8 +98,6 @@ struct ip_tcp_hdr {
 #define TCP_OPT_LEN_6	0x06
 #define TCP_OPT_LEN_8	0x08
 #define TCP_OPT_LEN_A	0x0a		/* Timestamp Length		*/
-#define TCP_MSS		1460		/* Max segment size		*/
-#define TCP_SCALE	0x01		/* Scale			*/
 
 /**
  * struct tcp_mss - TCP option structure for MSS (Max segment size)
@@ -279,6 +290,16 @@ enum tcp_state {
 
 enum tcp_state tcp_get_tcp_state(void);
 void tcp_set_tcp_state(enum tcp_state new_state);
+
+/**
+ * tcp_get_ack_edge() - get the end of the data received in order
+ *
+ * Data up to this sequence number has been received without holes. This is
+ * what is acknowledged to the remote end while the connection is established.
+ *
+ * Return: sequence number following the data received in order
+ */
+u32 tcp_get_ack_edge(void);
 int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 		       u8 action, u32 tcp_seq_num, u32 tcp_ack_num);
 
@@ -290,7 +311,9 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
  * @sport: source TCP port
  * @tcp_seq_num: TCP sequential number
  * @tcp_ack_num: TCP acknowledgment number
- * @action: TCP action (SYN, ACK, FIN, etc)
+ * @action: TCP action (SYN, ACK, FIN, etc), TCP_RST if the remote end reset
+ *	the connection, which has already set the net loop state to
+ *	NETLOOP_FAIL
  * @len: packet length
  */
 typedef void rxhand_tcp(uchar *pkt, u16 dport,
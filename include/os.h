@@ -548,4 +548,16 @@ long os_get_time_offset(void);
  */
 void os_set_time_offset(long offset);
 
+/**
+ * os_run_parallel() - Call a function for each of several arguments at once
+ *
+ * The calls are spread over host threads, up to one for each host CPU.
+ *
+ * @func:	Function to call
+ * @args:	Argument for each call
+ * @count:	Number of calls
+ * Return:	0
+ */
+int os_run_parallel(void (*func)(void *arg), void *args[], int count);
+
 #endif
@@ -124,6 +124,7 @@
 #define  SDHCI_INT_CARD_INSERT	BIT(6)
 #define  SDHCI_INT_CARD_REMOVE	BIT(7)
 #define  SDHCI_INT_CARD_INT	BIT(8)
+#define  SDHCI_INT_CQE		BIT(14)
 #define  SDHCI_INT_ERROR	BIT(15)
 #define  SDHCI_INT_TIMEOUT	BIT(16)
 #define  SDHCI_INT_CRC		BIT(17)
@@ -275,6 +276,9 @@ struct sdhci_ops {
 	int	(*set_ios_post)(struct sdhci_host *host);
 	void	(*set_clock)(struct sdhci_host *host, u32 div);
 	int (*platform_execute_tuning)(struct mmc *host, u8 opcode);
+	/* Get and restore the tuning result, see dm_mmc_ops.get_tuning() */
+	int (*platform_get_tuning)(struct mmc *mmc, u32 *tuningp);
+	int (*platform_set_tuning)(struct mmc *mmc, u32 tuning);
 	int (*set_delay)(struct sdhci_host *host);
 	/* Callback function to set DLL clock configuration */
 	int (*config_dll)(struct sdhci_host *host, u32 clock, bool enable);
@@ -356,6 +360,10 @@ struct sdhci_host {
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
 #endif
+#if CONFIG_IS_ENABLED(MMC_SDHCI_CQHCI)
+	void *cqe_ioaddr;	/* CQHCI registers, NULL if not set up */
+	void *cqe_desc;		/* CQHCI task descriptor list */
+#endif
 };
 
 #ifdef CONFIG_MMC_SDHCI_IO_ACCESSORS
@@ -508,6 +516,7 @@ int add_sdhci(struct sdhci_host *host, u32 f_max, u32 f_min);
 #endif /* !CONFIG_BLK */
 
 void sdhci_set_uhs_timing(struct sdhci_host *host);
+void sdhci_reset(struct sdhci_host *host, u8 mask);
 #ifdef CONFIG_DM_MMC
 /* Export the operations to drivers */
 int sdhci_probe(struct udevice *dev);
@@ -530,4 +539,23 @@ struct sdhci_adma_desc *sdhci_adma_init(void);
 void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
 			      struct mmc_data *data, dma_addr_t addr);
 
+/**
+ * sdhci_cqhci_init() - Set up the command queue engine of an SDHCI host
+ *
+ * Call this from the probe function of a host which has a Command Queue
+ * Host Controller Interface, after sdhci_setup_cfg(). Large transfers to
+ * eMMC devices which support command queueing then go through the engine.
+ *
+ * @cfg:	MMC configuration, updated with MMC_CAP_CQE
+ * @host:	SDHCI host structure
+ * @ioaddr:	Address of the CQHCI registers
+ * Return: 0 if OK, -ve on error
+ */
+int sdhci_cqhci_init(struct mmc_config *cfg, struct sdhci_host *host,
+		     void *ioaddr);
+
+int sdhci_cqe_enable(struct udevice *dev, bool enable);
+int sdhci_cqe_request(struct udevice *dev, bool write,
+		      struct mmc_cqe_task *tasks, int count);
+
 #endif /* __SDHCI_HW_H */
@@ -522,6 +522,8 @@ struct dm_spi_ops {
 			uint *map_sizep, uint *offsetp);
 };
 
+struct spi_mem_op;
+
 struct dm_spi_emul_ops {
 	/**
 	 * SPI transfer
@@ -549,6 +551,21 @@ struct dm_spi_emul_ops {
 	 */
 	int (*xfer)(struct udevice *slave, unsigned int bitlen,
 		    const void *dout, void *din, unsigned long flags);
+
+	/**
+	 * Execute a SPI memory operation (optional)
+	 *
+	 * Unlike xfer(), this tells the device the bus width and transfer
+	 * rate of each phase, which it needs to emulate stateful modes such
+	 * as 8D-8D-8D.
+	 *
+	 * @slave:	The SPI slave which will be executing the operation.
+	 * @op:		The operation to execute.
+	 *
+	 * Returns: 0 on success, -ENOTSUPP to have the operation sent through
+	 * xfer() instead, other -ve value on failure
+	 */
+	int (*exec_op)(struct udevice *slave, const struct spi_mem_op *op);
 };
 
 /**
@@ -85,6 +85,43 @@ uint32_t crc32_wd(uint32_t crc, const unsigned char *buf, uint len,
  */
 uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 
+/**
+ * enum crc32_method - Ways of calculating CRC32
+ *
+ * crc32() uses the fastest which is available
+ *
+ * @CRC32_METHOD_TABLE: Look up a table for each byte
+ * @CRC32_METHOD_SLICE8: Look up eight tables for each eight bytes
+ * @CRC32_METHOD_ARM64: Use the ARMv8 CRC32 instructions
+ * @CRC32_METHOD_PCLMUL: Use the x86 PCLMULQDQ instruction
+ * @CRC32_METHOD_COUNT: Number of methods
+ */
+enum crc32_method {
+	CRC32_METHOD_TABLE,
+	CRC32_METHOD_SLICE8,
+	CRC32_METHOD_ARM64,
+	CRC32_METHOD_PCLMUL,
+
+	CRC32_METHOD_COUNT,
+};
+
+/**
+ * crc32_method_calc() - Calculate the CRC32 of a block using a given method
+ *
+ * This is the same as crc32_no_comp() but allows the method to be chosen, so
+ * that the methods can be checked against each other.
+ *
+ * @method:	Method to use
+ * @crc:	Input crc to chain from a previous calculation (use 0 to start
+ *		a new calculation)
+ * @buf:	Bytes to checksum
+ * @len:	Number of bytes to checksum
+ * @crcp:	Returns the checksum
+ * Return: 0 if OK, -ENOSYS if the method is not available
+ */
+int crc32_method_calc(enum crc32_method method, uint32_t crc, const void *buf,
+		      uint len, uint32_t *crcp);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -19,6 +19,56 @@ void sha256_starts(sha256_context * ctx);
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length);
 void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 
+/**
+ * sha256_update_multi() - Add the same amount of data to several contexts
+ *
+ * This gives the same result as calling sha256_update() on each context in
+ * turn. With CONFIG_SHA256_X86_AVX2, whole blocks are hashed for up to eight
+ * contexts at once on CPUs which have AVX2 but not the SHA extensions.
+ *
+ * @ctx:	Contexts to update
+ * @input:	Data to add to each context
+ * @count:	Number of contexts
+ * @length:	Number of bytes to add to each context
+ */
+void sha256_update_multi(sha256_context *ctx[], const uint8_t *input[],
+			 int count, uint32_t length);
+
+/**
+ * enum sha256_method - Ways of processing SHA256 blocks
+ *
+ * sha256_update() and sha256_update_multi() use the fastest which is
+ * available
+ *
+ * @SHA256_METHOD_GENERIC: Generic C code, one block at a time
+ * @SHA256_METHOD_SHANI: Use the x86 SHA extensions
+ * @SHA256_METHOD_AVX2: Use AVX2 to process eight streams at once
+ * @SHA256_METHOD_COUNT: Number of methods
+ */
+enum sha256_method {
+	SHA256_METHOD_GENERIC,
+	SHA256_METHOD_SHANI,
+	SHA256_METHOD_AVX2,
+
+	SHA256_METHOD_COUNT,
+};
+
+/**
+ * sha256_method_process() - Process whole blocks using a given method
+ *
+ * This adds blocks to the state of each context without updating its length
+ * or buffer, so that the methods can be checked against each other.
+ *
+ * @method:	Method to use
+ * @ctx:	Contexts to update
+ * @data:	Blocks to process for each context
+ * @count:	Number of contexts
+ * @blocks:	Number of 64-byte blocks to process for each context
+ * Return: 0 if OK, -ENOSYS if the method is not available
+ */
+int sha256_method_process(enum sha256_method method, sha256_context *ctx[],
+			  const uint8_t *data[], int count, unsigned int blocks);
+
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
@@ -12,9 +12,67 @@
 
 #include <compiler.h>
 
+/* Bit-reflected Castagnoli polynomial, which some CPUs can calculate */
+#define CRC32C_POLY	0x82f63b78
+
+#ifdef CONFIG_ARM64_CRC32
+static uint32_t crc32c_hw(uint32_t crc, const char *data, int length)
+{
+	while (length && ((ulong)data & 7)) {
+		crc = __builtin_aarch64_crc32cb(crc, *data++);
+		length--;
+	}
+	for (; length >= 8; length -= 8, data += 8)
+		crc = __builtin_aarch64_crc32cx(crc, *(const uint64_t *)data);
+	while (length--)
+		crc = __builtin_aarch64_crc32cb(crc, *data++);
+
+	return crc;
+}
+
+static bool crc32c_have_hw(void)
+{
+	return true;
+}
+#elif defined(CONFIG_CRC32_X86_SIMD) && defined(__x86_64__)
+static __attribute__((target("sse4.2"))) uint32_t
+crc32c_hw(uint32_t crc, const char *data, int length)
+{
+	uint64_t val;
+
+	for (; length >= 8; length -= 8, data += 8) {
+		memcpy(&val, data, sizeof(val));
+		crc = __builtin_ia32_crc32di(crc, val);
+	}
+	while (length--)
+		crc = __builtin_ia32_crc32qi(crc, *data++);
+
+	return crc;
+}
+
+static bool crc32c_have_hw(void)
+{
+	return __builtin_cpu_supports("sse4.2");
+}
+#else
+static uint32_t crc32c_hw(uint32_t crc, const char *data, int length)
+{
+	return crc;
+}
+
+static bool crc32c_have_hw(void)
+{
+	return false;
+}
+#endif
+
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table)
 {
+	/* The CPU can only be used if the table is for the right polynomial */
+	if (crc32c_table[128] == CRC32C_POLY && crc32c_have_hw())
+		return crc32c_hw(crc, data, length);
+
 	while (length--)
 		crc = crc32c_table[(u8)(crc ^ *data++)] ^ (crc >> 8);
 
@@ -636,6 +636,87 @@ int fdtdec_check_fdt(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_TABLE)
+/* Offsets of the nodes in phandle_blob, indexed by phandle, or -1 if none */
+static const void *phandle_blob;
+static int *phandle_offsets;
+static uint phandle_count;
+static uint phandle_lookups;
+static uint phandle_hits;
+
+static void fdtdec_phandle_table_build(const void *blob)
+{
+	uint32_t phandle, max = 0;
+	uint count = 0;
+	int node;
+
+	free(phandle_offsets);
+	phandle_offsets = NULL;
+	phandle_count = 0;
+	phandle_blob = blob;
+
+	for (node = fdt_next_node(blob, -1, NULL); node >= 0;
+	     node = fdt_next_node(blob, node, NULL)) {
+		phandle = fdt_get_phandle(blob, node);
+		if (phandle) {
+			max = max(max, phandle);
+			count++;
+		}
+	}
+
+	/* dtc numbers phandles from 1, so only skip unusually sparse ones */
+	if (!count || max > 4 * count + 16)
+		return;
+	phandle_offsets = malloc((max + 1) * sizeof(int));
+	if (!phandle_offsets)
+		return;
+	memset(phandle_offsets, '\xff', (max + 1) * sizeof(int));
+	phandle_count = max + 1;
+
+	for (node = fdt_next_node(blob, -1, NULL); node >= 0;
+	     node = fdt_next_node(blob, node, NULL)) {
+		phandle = fdt_get_phandle(blob, node);
+		if (phandle && phandle_offsets[phandle] < 0)
+			phandle_offsets[phandle] = node;
+	}
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	int node;
+
+	if (!(gd->flags & GD_FLG_RELOC) || blob != gd->fdt_blob)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	if (blob != phandle_blob)
+		fdtdec_phandle_table_build(blob);
+
+	/*
+	 * Offsets change when the tree is written, so check the node and fall
+	 * back to a search if needed
+	 */
+	phandle_lookups++;
+	if (phandle && phandle < phandle_count) {
+		node = phandle_offsets[phandle];
+		if (node >= 0 && fdt_get_phandle(blob, node) == phandle) {
+			phandle_hits++;
+			return node;
+		}
+	}
+	node = fdt_node_offset_by_phandle(blob, phandle);
+	if (node >= 0 && phandle < phandle_count)
+		phandle_offsets[phandle] = node;
+
+	return node;
+}
+
+void fdtdec_phandle_stats(uint *lookupsp, uint *hitsp)
+{
+	*lookupsp = phandle_lookups;
+	*hitsp = phandle_hits;
+}
+#endif
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -646,7 +727,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -777,8 +858,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (node < 0) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1500,7 +1581,7 @@ int fdtdec_get_carveout(const void *blob, const char *node,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = fdtdec_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
@@ -8,6 +8,7 @@
 #include <command.h>
 #include <console.h>
 #include <div64.h>
+#include <errno.h>
 #include <gzip.h>
 #include <image.h>
 #include <malloc.h>
@@ -81,6 +82,57 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+int gunzip_stream(void *dst, ulong dstlen, void *buf, ulong buf_size,
+		  long (*read)(void *priv, void *buf, ulong size), void *priv,
+		  ulong *lenp)
+{
+	z_stream s;
+	long len;
+	int ret;
+	int r;
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+
+	/* Let zlib parse the gzip header and check the CRC in the trailer */
+	r = inflateInit2(&s, 16 + MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		return -EIO;
+	}
+	s.avail_in = 0;
+	s.next_out = dst;
+	s.avail_out = dstlen;
+	ret = 0;
+	do {
+		if (!s.avail_in) {
+			len = read(priv, buf, buf_size);
+			if (len <= 0) {
+				/* the input ended before the stream did */
+				ret = len ? len : -EIO;
+				break;
+			}
+			s.next_in = buf;
+			s.avail_in = len;
+		}
+		r = inflate(&s, Z_NO_FLUSH);
+		schedule();
+	} while (r == Z_OK);
+
+	if (!ret && r != Z_STREAM_END) {
+		if (r == Z_BUF_ERROR && !s.avail_out) {
+			ret = -ENOSPC;
+		} else {
+			printf("Error: inflate() returned %d\n", r);
+			ret = -EIO;
+		}
+	}
+	*lenp = s.next_out - (unsigned char *)dst;
+	inflateEnd(&s);
+
+	return ret;
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(ulong expectedsize)
@@ -62,89 +62,95 @@ static long lmb_addrs_overlap(phys_addr_t base1, phys_size_t size1,
 	return ((base1 <= base2_end) && (base2 <= base1_end));
 }
 
-static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
-			       phys_addr_t base2, phys_size_t size2)
+/**
+ * lmb_region_find() - Find the last region which starts at or below an address
+ *
+ * The regions are sorted by base address, so use a binary search.
+ *
+ * @rgn:	region set to search
+ * @addr:	address to look for
+ * Return:	index of the region, or -1 if all regions start above @addr
+ */
+static long lmb_region_find(struct lmb_region *rgn, phys_addr_t addr)
 {
-	if (base2 == base1 + size1)
-		return 1;
-	else if (base1 == base2 + size2)
-		return -1;
+	unsigned long lo = 0, hi = rgn->cnt;
 
-	return 0;
-}
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
 
-static long lmb_regions_overlap(struct lmb_region *rgn, unsigned long r1,
-				unsigned long r2)
-{
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+		if (rgn->region[mid].base <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-	return lmb_addrs_overlap(base1, size1, base2, size2);
-}
-static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
-{
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+	return (long)lo - 1;
 }
 
-static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+/**
+ * lmb_region_grow() - Make room for more regions
+ *
+ * The regions start off in the array in struct lmb. When that is full, move
+ * them to an array twice the size, allocated with malloc().
+ *
+ * @rgn:	region set to grow
+ * Return:	0 if OK, -ENOMEM if there is no memory
+ */
+static int lmb_region_grow(struct lmb_region *rgn)
 {
-	unsigned long i;
+	unsigned long max = rgn->max ? rgn->max * 2 : 8;
+	struct lmb_property *region;
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-		rgn->region[i].flags = rgn->region[i + 1].flags;
+	region = malloc(max * sizeof(*region));
+	if (!region) {
+		log_err("lmb: no memory for %lu regions\n", max);
+		return -ENOMEM;
 	}
-	rgn->cnt--;
+	memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+	if (rgn->allocated)
+		free(rgn->region);
+	rgn->region = region;
+	rgn->max = max;
+	rgn->allocated = true;
+
+	return 0;
 }
 
-/* Assumption: base addr of region 1 < base addr of region 2 */
-static void lmb_coalesce_regions(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
+static void lmb_region_uninit(struct lmb_region *rgn)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
-	lmb_remove_region(rgn, r2);
+	if (rgn->allocated)
+		free(rgn->region);
+	rgn->region = NULL;
+	rgn->allocated = false;
+	rgn->cnt = 0;
+	rgn->max = 0;
 }
 
-/*Assumption : base addr of region 1 < base addr of region 2*/
-static void lmb_fix_over_lap_regions(struct lmb_region *rgn, unsigned long r1,
-				     unsigned long r2)
+static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
-
-	if (base1 + size1 > base2 + size2) {
-		printf("This will not be a case any time\n");
-		return;
-	}
-	rgn->region[r1].size = base2 + size2 - base1;
-	lmb_remove_region(rgn, r2);
+	memmove(&rgn->region[r], &rgn->region[r + 1],
+		(rgn->cnt - r - 1) * sizeof(*rgn->region));
+	rgn->cnt--;
 }
 
 void lmb_init(struct lmb *lmb)
 {
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	lmb->memory.max = CONFIG_LMB_MAX_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_MAX_REGIONS;
-#else
-	lmb->memory.max = CONFIG_LMB_MEMORY_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_RESERVED_REGIONS;
+	lmb->memory.max = ARRAY_SIZE(lmb->memory_regions);
+	lmb->reserved.max = ARRAY_SIZE(lmb->reserved_regions);
 	lmb->memory.region = lmb->memory_regions;
 	lmb->reserved.region = lmb->reserved_regions;
-#endif
+	lmb->memory.allocated = false;
+	lmb->reserved.allocated = false;
 	lmb->memory.cnt = 0;
 	lmb->reserved.cnt = 0;
 }
 
+void lmb_uninit(struct lmb *lmb)
+{
+	lmb_region_uninit(&lmb->memory);
+	lmb_region_uninit(&lmb->reserved);
+}
+
 void arch_lmb_reserve_generic(struct lmb *lmb, ulong sp, ulong end, ulong align)
 {
 	ulong bank_end;
@@ -252,12 +258,49 @@ void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 	lmb_reserve_common(lmb, fdt_blob);
 }
 
-/* This routine called with relocation disabled. */
+/* Return the index of the first region overlapping (base, size), or -1 */
+static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
+				phys_size_t size)
+{
+	long i;
+
+	/*
+	 * Since the regions are sorted and do not overlap, only the last one
+	 * starting at or below @base and the one after it can be the first to
+	 * overlap
+	 */
+	for (i = max(lmb_region_find(rgn, base), 0L);
+	     i < rgn->cnt && rgn->region[i].base <= base + size - 1; i++) {
+		phys_addr_t rgnbase = rgn->region[i].base;
+		phys_size_t rgnsize = rgn->region[i].size;
+
+		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
+			return i;
+	}
+
+	return -1;
+}
+
+/* Return the address of the last byte of a region */
+static phys_addr_t lmb_region_end(struct lmb_region *rgn, long r)
+{
+	return rgn->region[r].base + rgn->region[r].size - 1;
+}
+
+/*
+ * This routine called with relocation disabled.
+ *
+ * The regions are looked up by bisection, so they must stay sorted and must
+ * never overlap. A new region may only overlap existing ones if it follows on
+ * from a region with the same flags and all those it overlaps have the same
+ * flags too. Then they are all merged into one.
+ */
 static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 				 phys_size_t size, enum lmb_flags flags)
 {
-	unsigned long coalesced = 0;
-	long adjacent, i;
+	phys_addr_t end = base + size - 1;
+	phys_addr_t new_base = base, new_end = end;
+	long first, last, prev, next, i;
 
 	if (rgn->cnt == 0) {
 		rgn->region[0].base = base;
@@ -267,77 +310,71 @@ static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 		return 0;
 	}
 
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		phys_size_t rgnflags = rgn->region[i].flags;
-		phys_addr_t end = base + size - 1;
-		phys_addr_t rgnend = rgnbase + rgnsize - 1;
-		if (rgnbase <= base && end <= rgnend) {
-			if (flags == rgnflags)
-				/* Already have this region, so we're done */
-				return 0;
-			else
-				return -1; /* regions with new flags */
-		}
+	first = lmb_overlaps_region(rgn, base, size);
+	if (first >= 0 && rgn->region[first].base <= base &&
+	    end <= lmb_region_end(rgn, first)) {
+		if (flags == rgn->region[first].flags)
+			/* Already have this region, so we're done */
+			return 0;
+		else
+			return -1; /* regions with new flags */
+	}
 
-		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
-		if (adjacent > 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (adjacent < 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
-			/* regions overlap */
+	/* The region which ends just before this one, if it can be merged */
+	prev = base ? lmb_region_find(rgn, base - 1) : -1;
+	if (prev >= 0 && (lmb_region_end(rgn, prev) != base - 1 ||
+			  rgn->region[prev].flags != flags))
+		prev = -1;
+
+	if (first >= 0) {
+		/* regions overlap */
+		if (prev < 0)
 			return -1;
+		last = lmb_region_find(rgn, end);
+		for (i = first; i <= last; i++) {
+			if (rgn->region[i].flags != flags)
+				return -1;
 		}
+		new_end = max(end, lmb_region_end(rgn, last));
+	} else {
+		last = prev;
+	}
+	if (prev >= 0) {
+		first = prev;
+		new_base = rgn->region[prev].base;
 	}
 
-	if (i < rgn->cnt - 1 && rgn->region[i].flags == rgn->region[i + 1].flags)  {
-		if (lmb_regions_adjacent(rgn, i, i + 1)) {
-			lmb_coalesce_regions(rgn, i, i + 1);
-			coalesced++;
-		} else if (lmb_regions_overlap(rgn, i, i + 1)) {
-			/* fix overlapping area */
-			lmb_fix_over_lap_regions(rgn, i, i + 1);
-			coalesced++;
-		}
+	/* The region which starts just after, if it can be merged */
+	next = new_end + 1 ? lmb_region_find(rgn, new_end + 1) : -1;
+	if (next >= 0 && rgn->region[next].base == new_end + 1 &&
+	    rgn->region[next].flags == flags) {
+		if (first < 0)
+			first = next;
+		last = next;
+		new_end = lmb_region_end(rgn, next);
 	}
 
-	if (coalesced)
-		return coalesced;
-	if (rgn->cnt >= rgn->max)
-		return -1;
+	if (first >= 0) {
+		rgn->region[first].base = new_base;
+		rgn->region[first].size = new_end - new_base + 1;
+		memmove(&rgn->region[first + 1], &rgn->region[last + 1],
+			(rgn->cnt - last - 1) * sizeof(*rgn->region));
+		rgn->cnt -= last - first;
 
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-			rgn->region[i + 1].flags = rgn->region[i].flags;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			rgn->region[i + 1].flags = flags;
-			break;
-		}
+		/* Number of existing regions the new one was merged with */
+		return last - first + 1;
 	}
 
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->region[0].flags = flags;
-	}
+	if (rgn->cnt >= rgn->max && lmb_region_grow(rgn))
+		return -1;
 
+	/* Couldn't coalesce the LMB, so add it to the sorted table. */
+	i = lmb_region_find(rgn, base) + 1;
+	memmove(&rgn->region[i + 1], &rgn->region[i],
+		(rgn->cnt - i) * sizeof(*rgn->region));
+	rgn->region[i].base = base;
+	rgn->region[i].size = size;
+	rgn->region[i].flags = flags;
 	rgn->cnt++;
 
 	return 0;
@@ -367,16 +404,14 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	rgnbegin = rgnend = 0; /* supress gcc warnings */
 
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	i = lmb_region_find(rgn, base);
+	if (i < 0)
+		return -1;
+	rgnbegin = rgn->region[i].base;
+	rgnend = rgnbegin + rgn->region[i].size - 1;
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
@@ -420,21 +455,6 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	return lmb_reserve_flags(lmb, base, size, LMB_NONE);
 }
 
-static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
-				phys_size_t size)
-{
-	unsigned long i;
-
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
-
-	return (i < rgn->cnt) ? i : -1;
-}
-
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
 {
 	return lmb_alloc_base(lmb, size, align, LMB_ALLOC_ANYWHERE);
@@ -528,22 +548,20 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 /* Return number of bytes from a given address that are free */
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
-	long rgn;
+	long i, rgn;
 
 	/* check if the requested address is in the memory regions */
 	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
 	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
-			if (addr < lmb->reserved.region[i].base) {
-				/* first reserved range > requested address */
-				return lmb->reserved.region[i].base - addr;
-			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
-			}
+		i = lmb_region_find(&lmb->reserved, addr);
+		if (i >= 0 && lmb->reserved.region[i].base +
+		    lmb->reserved.region[i].size > addr) {
+			/* requested addr is in this reserved range */
+			return 0;
+		}
+		if (++i < lmb->reserved.cnt) {
+			/* first reserved range > requested address */
+			return lmb->reserved.region[i].base - addr;
 		}
 		/* if we come here: no reserved ranges above requested addr */
 		return lmb->memory.region[lmb->memory.cnt - 1].base +
@@ -554,12 +572,13 @@ phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 
 int lmb_is_reserved_flags(struct lmb *lmb, phys_addr_t addr, int flags)
 {
-	int i;
+	long i;
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
+	i = lmb_region_find(&lmb->reserved, addr);
+	if (i >= 0) {
 		phys_addr_t upper = lmb->reserved.region[i].base +
 			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
+		if (addr <= upper)
 			return (lmb->reserved.region[i].flags & flags) == flags;
 	}
 	return 0;
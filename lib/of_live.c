@@ -313,6 +313,9 @@ int unflatten_device_tree(const void *blob, struct device_node **mynodes)
 		return -ENOSPC;
 	}
 
+	/* A failure only means that phandle lookups walk the tree */
+	of_phandle_table_build(*mynodes);
+
 	debug(" <- unflatten_device_tree()\n");
 
 	return 0;
@@ -340,6 +343,7 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 
 void of_live_free(struct device_node *root)
 {
+	of_phandle_table_free(root);
 	/* the tree is stored as a contiguous block of memory */
 	free(root);
 }
@@ -7,6 +7,7 @@
 
 #ifndef USE_HOSTCC
 #include <cyclic.h>
+#include <linux/errno.h>
 #endif /* USE_HOSTCC */
 #include <string.h>
 #include <u-boot/sha256.h>
@@ -185,12 +186,245 @@ static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+/*
+ * The x86 code below is only built for 64-bit U-Boot and sandbox on a 64-bit
+ * host. The CONFIG options are also set for a 32-bit SPL, which uses the
+ * generic code.
+ */
+#if defined(__x86_64__) && !defined(USE_HOSTCC)
+#ifdef CONFIG_SHA256_X86_SHANI
+#define SHA256_X86_SHANI
+#endif
+#ifdef CONFIG_SHA256_X86_AVX2
+#define SHA256_X86_AVX2
+#endif
+#endif
+
+#if defined(SHA256_X86_SHANI) || defined(SHA256_X86_AVX2)
+#include <linux/kernel.h>
+#ifndef CONFIG_SANDBOX
+#include <asm/cpu.h>
+#include <linux/bitops.h>
+#endif
+
+static const uint32_t sha256_k[64] __aligned(16) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+#endif
+
+#ifdef SHA256_X86_SHANI
+typedef int sha256_v4si __attribute__((vector_size(16)));
+typedef int sha256_v4si_u __attribute__((vector_size(16), aligned(1)));
+typedef char sha256_v16qi __attribute__((vector_size(16)));
+
+/*
+ * Four rounds using message words @cur, which holds W[4i..4i+3]. Alongside
+ * these, finish the schedule for W[4i+4..4i+7] in @next, which has already
+ * been through sha256msg1, then start it for W[4i+12..4i+15] in @prev, which
+ * holds W[4i-4..4i-1].
+ */
+#define SHANI_ROUNDS(i, cur, next, prev) do {				\
+	sha256_v4si msg = cur + *(const sha256_v4si *)&sha256_k[4 * i];	\
+									\
+	cdgh = __builtin_ia32_sha256rnds2(cdgh, abef, msg);		\
+	if (i >= 3 && i <= 14) {					\
+		next += (sha256_v4si){ prev[1], prev[2], prev[3], cur[0] }; \
+		next = __builtin_ia32_sha256msg2(next, cur);		\
+	}								\
+	msg = (sha256_v4si){ msg[2], msg[3] };				\
+	abef = __builtin_ia32_sha256rnds2(abef, cdgh, msg);		\
+	if (i >= 1 && i <= 12)						\
+		prev = __builtin_ia32_sha256msg1(prev, cur);		\
+} while (0)
+
+/* Byte-swap each 32-bit word in a 16-byte unaligned block */
+#define SHANI_LOAD(p) \
+	((sha256_v4si)__builtin_ia32_pshufb128( \
+		(sha256_v16qi)*(const sha256_v4si_u *)(p), bswap))
+
+/*
+ * Process blocks using the SHA-NI instructions from the x86 SHA extensions.
+ * The stack is realigned since U-Boot itself does not keep it aligned for
+ * SSE.
+ */
+static __attribute__((target("sha,ssse3,sse4.1"), force_align_arg_pointer))
+void sha256_shani(uint32_t state[8], const uint8_t *data, unsigned int blocks)
+{
+	const sha256_v16qi bswap = {
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+	};
+	sha256_v4si abef, cdgh, abef_save, cdgh_save;
+	sha256_v4si m0, m1, m2, m3;
+
+	/* The instructions want the state as ABEF and CDGH, highest first */
+	abef = (sha256_v4si){ state[5], state[4], state[1], state[0] };
+	cdgh = (sha256_v4si){ state[7], state[6], state[3], state[2] };
+
+	for (; blocks; blocks--, data += 64) {
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		m0 = SHANI_LOAD(data);
+		m1 = SHANI_LOAD(data + 16);
+		m2 = SHANI_LOAD(data + 32);
+		m3 = SHANI_LOAD(data + 48);
+
+		SHANI_ROUNDS(0, m0, m1, m3);
+		SHANI_ROUNDS(1, m1, m2, m0);
+		SHANI_ROUNDS(2, m2, m3, m1);
+		SHANI_ROUNDS(3, m3, m0, m2);
+		SHANI_ROUNDS(4, m0, m1, m3);
+		SHANI_ROUNDS(5, m1, m2, m0);
+		SHANI_ROUNDS(6, m2, m3, m1);
+		SHANI_ROUNDS(7, m3, m0, m2);
+		SHANI_ROUNDS(8, m0, m1, m3);
+		SHANI_ROUNDS(9, m1, m2, m0);
+		SHANI_ROUNDS(10, m2, m3, m1);
+		SHANI_ROUNDS(11, m3, m0, m2);
+		SHANI_ROUNDS(12, m0, m1, m3);
+		SHANI_ROUNDS(13, m1, m2, m0);
+		SHANI_ROUNDS(14, m2, m3, m1);
+		SHANI_ROUNDS(15, m3, m0, m2);
+
+		abef += abef_save;
+		cdgh += cdgh_save;
+	}
+
+	state[0] = abef[3];
+	state[1] = abef[2];
+	state[2] = cdgh[3];
+	state[3] = cdgh[2];
+	state[4] = abef[1];
+	state[5] = abef[0];
+	state[6] = cdgh[1];
+	state[7] = cdgh[0];
+}
+#undef SHANI_LOAD
+#undef SHANI_ROUNDS
+#endif /* SHA256_X86_SHANI */
+
+#ifdef SHA256_X86_AVX2
+typedef uint32_t sha256_v8su __attribute__((vector_size(32)));
+
+/*
+ * Process the same number of blocks for eight separate streams, with one
+ * stream in each 32-bit lane of the AVX2 registers. The round macros used by
+ * sha256_process_one() work unchanged on these vectors.
+ */
+static __attribute__((target("avx2"), force_align_arg_pointer))
+void sha256_avx2_x8(uint32_t *state[8], const uint8_t *data[8],
+		    unsigned int blocks)
+{
+	sha256_v8su A, B, C, D, E, F, G, H, temp1, temp2;
+	sha256_v8su s[8], W[64];
+	const uint8_t *p[8];
+	uint32_t word;
+	int i, j;
+
+	for (j = 0; j < 8; j++) {
+		p[j] = data[j];
+		for (i = 0; i < 8; i++)
+			s[i][j] = state[j][i];
+	}
+
+	for (; blocks; blocks--) {
+		for (j = 0; j < 8; j++) {
+			for (i = 0; i < 16; i++) {
+				GET_UINT32_BE(word, p[j], i * 4);
+				W[i][j] = word;
+			}
+			p[j] += 64;
+		}
+		for (i = 16; i < 64; i++)
+			R(i);
+
+		A = s[0];
+		B = s[1];
+		C = s[2];
+		D = s[3];
+		E = s[4];
+		F = s[5];
+		G = s[6];
+		H = s[7];
+
+		for (i = 0; i < 64; i += 8) {
+			P(A, B, C, D, E, F, G, H, W[i + 0], sha256_k[i + 0]);
+			P(H, A, B, C, D, E, F, G, W[i + 1], sha256_k[i + 1]);
+			P(G, H, A, B, C, D, E, F, W[i + 2], sha256_k[i + 2]);
+			P(F, G, H, A, B, C, D, E, W[i + 3], sha256_k[i + 3]);
+			P(E, F, G, H, A, B, C, D, W[i + 4], sha256_k[i + 4]);
+			P(D, E, F, G, H, A, B, C, W[i + 5], sha256_k[i + 5]);
+			P(C, D, E, F, G, H, A, B, W[i + 6], sha256_k[i + 6]);
+			P(B, C, D, E, F, G, H, A, W[i + 7], sha256_k[i + 7]);
+		}
+
+		s[0] += A;
+		s[1] += B;
+		s[2] += C;
+		s[3] += D;
+		s[4] += E;
+		s[5] += F;
+		s[6] += G;
+		s[7] += H;
+	}
+
+	for (j = 0; j < 8; j++)
+		for (i = 0; i < 8; i++)
+			state[j][i] = s[i][j];
+}
+#endif /* SHA256_X86_AVX2 */
+
+#ifdef SHA256_X86_SHANI
+static bool sha256_have_shani(void)
+{
+#ifdef CONFIG_SANDBOX
+	return __builtin_cpu_supports("sha") &&
+		__builtin_cpu_supports("sse4.1");
+#else
+	return x86_simd_features() & X86_SIMD_SHA;
+#endif
+}
+#endif
+
+#ifdef SHA256_X86_AVX2
+static bool sha256_have_avx2(void)
+{
+#ifdef CONFIG_SANDBOX
+	return __builtin_cpu_supports("avx2");
+#else
+	return x86_simd_features() & X86_SIMD_AVX2;
+#endif
+}
+#endif
+
 __weak void sha256_process(sha256_context *ctx, const unsigned char *data,
 			   unsigned int blocks)
 {
 	if (!blocks)
 		return;
 
+#ifdef SHA256_X86_SHANI
+	if (sha256_have_shani()) {
+		sha256_shani(ctx->state, data, blocks);
+		return;
+	}
+#endif
+
 	while (blocks--) {
 		sha256_process_one(ctx, data);
 		data += 64;
@@ -229,6 +463,114 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 		memcpy((void *) (ctx->buffer + left), (void *) input, length);
 }
 
+#ifdef SHA256_X86_AVX2
+/*
+ * The SHA extensions are faster than eight lanes of AVX2, so these are only
+ * used on CPUs which lack them
+ */
+static bool sha256_use_lanes(void)
+{
+#ifdef SHA256_X86_SHANI
+	if (sha256_have_shani())
+		return false;
+#endif
+	return sha256_have_avx2();
+}
+
+/* Process the same number of blocks for up to eight contexts at once */
+static void sha256_process_lanes(sha256_context *ctx[], const uint8_t *data[],
+				 int count, unsigned int blocks)
+{
+	const uint8_t *lane_data[8];
+	uint32_t *lane_state[8];
+	uint32_t spare[8] = { };
+	int i;
+
+	/* Unused lanes hash the first stream again, into a spare state */
+	for (i = 0; i < 8; i++) {
+		lane_data[i] = i < count ? data[i] : data[0];
+		lane_state[i] = i < count ? ctx[i]->state : spare;
+	}
+	sha256_avx2_x8(lane_state, lane_data, blocks);
+}
+#endif
+
+void sha256_update_multi(sha256_context *ctx[], const uint8_t *input[],
+			 int count, uint32_t length)
+{
+	uint32_t done = 0;
+	int i;
+
+#ifdef SHA256_X86_AVX2
+	if (count > 1 && length >= 64 && sha256_use_lanes()) {
+		int n;
+
+		/* Partial blocks are left to sha256_update() */
+		for (i = 0; i < count; i++) {
+			if (ctx[i]->total[0] & 0x3F)
+				break;
+		}
+		if (i == count) {
+			done = length & ~0x3F;
+			for (i = 0; i < count; i += n) {
+				n = min(count - i, 8);
+				if (n == 1)
+					sha256_process(ctx[i], input[i],
+						       done / 64);
+				else
+					sha256_process_lanes(ctx + i, input + i,
+							     n, done / 64);
+			}
+			for (i = 0; i < count; i++) {
+				ctx[i]->total[0] += done;
+				if (ctx[i]->total[0] < done)
+					ctx[i]->total[1]++;
+			}
+		}
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+		sha256_update(ctx[i], input[i] + done, length - done);
+}
+
+#ifndef USE_HOSTCC
+int sha256_method_process(enum sha256_method method, sha256_context *ctx[],
+			  const uint8_t *data[], int count, unsigned int blocks)
+{
+	unsigned int block;
+	int i;
+
+	switch (method) {
+	case SHA256_METHOD_GENERIC:
+		for (i = 0; i < count; i++) {
+			for (block = 0; block < blocks; block++)
+				sha256_process_one(ctx[i], data[i] + block * 64);
+		}
+		return 0;
+#ifdef SHA256_X86_SHANI
+	case SHA256_METHOD_SHANI:
+		if (!sha256_have_shani())
+			return -ENOSYS;
+		for (i = 0; i < count; i++)
+			sha256_shani(ctx[i]->state, data[i], blocks);
+		return 0;
+#endif
+#ifdef SHA256_X86_AVX2
+	case SHA256_METHOD_AVX2:
+		if (!sha256_have_avx2())
+			return -ENOSYS;
+		for (i = 0; i < count; i += 8)
+			sha256_process_lanes(ctx + i, data + i,
+					     min(count - i, 8), blocks);
+		return 0;
+#endif
+	default:
+		return -ENOSYS;
+	}
+}
+#endif
+
 static uint8_t sha256_padding[64] = {
 	0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 	   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -12,10 +12,13 @@
 
 #ifndef USE_HOSTCC
 #include <cyclic.h>
+#include <linux/errno.h>
 #endif /* USE_HOSTCC */
 #include <compiler.h>
 #include <u-boot/sha512.h>
 
+#include <linux/compiler_attributes.h>
+
 const uint8_t sha384_der_prefix[SHA384_DER_LEN] = {
 	0x30, 0x41, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
 	0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02, 0x05,
@@ -187,9 +190,30 @@ sha512_transform(uint64_t *state, const uint8_t *input)
 	a = b = c = d = e = f = g = h = t1 = t2 = 0;
 }
 
+/**
+ * sha512_process_arch() - Process blocks using an architecture-specific engine
+ *
+ * This may be overridden by architecture code which can hash SHA-384/SHA-512
+ * blocks faster than the generic implementation, e.g. using the ARMv8.2 Crypto
+ * Extensions. The state layout is the same for SHA-384 and SHA-512.
+ *
+ * @ctx: Context to update
+ * @data: Input data, a multiple of SHA512_BLOCK_SIZE bytes
+ * @blocks: Number of blocks to process
+ * Return: 0 if the blocks were processed, -ENOSYS if no engine is available
+ */
+__weak int sha512_process_arch(sha512_context *ctx, const unsigned char *data,
+			       unsigned int blocks)
+{
+	return -ENOSYS;
+}
+
 static void sha512_block_fn(sha512_context *sst, const uint8_t *src,
 				    int blocks)
 {
+	if (!sha512_process_arch(sst, src, blocks))
+		return;
+
 	while (blocks--) {
 		sha512_transform(sst->state, src);
 		src += SHA512_BLOCK_SIZE;
@@ -6,6 +6,7 @@
 #define LOG_CATEGORY	LOGC_BOOT
 
 #include <abuf.h>
+#include <cyclic.h>
 #include <log.h>
 #include <malloc.h>
 #include <linux/errno.h>
@@ -59,3 +60,82 @@ do_free:
 	free(workspace);
 	return ret;
 }
+
+int zstd_decompress_read(void *dst, ulong dstlen, void *buf, ulong buf_size,
+			 long (*read)(void *priv, void *buf, ulong size),
+			 void *priv, ulong *lenp)
+{
+	zstd_in_buffer in = { .src = buf };
+	zstd_out_buffer out = { .dst = dst, .size = dstlen };
+	zstd_frame_header hdr;
+	zstd_dstream *ds;
+	size_t wsize, ret, in_pos, out_pos;
+	void *workspace;
+	long len;
+	int err;
+
+	*lenp = 0;
+
+	/* The window size in the frame header sets the workspace needed */
+	do {
+		len = read(priv, buf + in.size, buf_size - in.size);
+		if (len <= 0)
+			return len ? len : -EINVAL;
+		in.size += len;
+		ret = zstd_get_frame_header(&hdr, buf, in.size);
+		if (zstd_is_error(ret)) {
+			log_err("%s: failed to read frame header: %d\n",
+				__func__, zstd_get_error_code(ret));
+			return -EINVAL;
+		}
+	} while (ret);
+
+	wsize = zstd_dstream_workspace_bound(hdr.windowSize);
+	workspace = malloc(wsize);
+	if (!workspace) {
+		debug("%s: cannot allocate workspace of size %zu\n", __func__,
+		      wsize);
+		return -ENOMEM;
+	}
+
+	ds = zstd_init_dstream(hdr.windowSize, workspace, wsize);
+	if (!ds) {
+		log_err("%s: zstd_init_dstream() failed\n", __func__);
+		err = -EPERM;
+		goto do_free;
+	}
+
+	do {
+		if (in.pos == in.size) {
+			len = read(priv, buf, buf_size);
+			if (len <= 0) {
+				/* the input ended before the frame did */
+				err = len ? len : -EINVAL;
+				goto do_free;
+			}
+			in.pos = 0;
+			in.size = len;
+		}
+		in_pos = in.pos;
+		out_pos = out.pos;
+		ret = zstd_decompress_stream(ds, &out, &in);
+		if (zstd_is_error(ret)) {
+			log_err("%s: failed to decompress: %d\n", __func__,
+				zstd_get_error_code(ret));
+			err = -EINVAL;
+			goto do_free;
+		}
+		if (ret && out.pos == out.size && in.pos == in_pos &&
+		    out.pos == out_pos) {
+			err = -ENOSPC;
+			goto do_free;
+		}
+		schedule();
+	} while (ret);
+	err = 0;
+
+do_free:
+	*lenp = out.pos;
+	free(workspace);
+	return err;
+}
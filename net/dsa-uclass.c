@@ -237,8 +237,11 @@ static int dsa_port_of_to_pdata(struct udevice *pdev)
 	port_pdata->index = index;
 
 	label = ofnode_read_string(dev_ofnode(pdev), "label");
-	if (label)
+	if (label) {
+		/* the device name points to port_pdata->name */
 		strlcpy(port_pdata->name, label, DSA_PORT_NAME_LENGTH);
+		uclass_index_update(pdev);
+	}
 
 	eth_pdata = dev_get_plat(pdev);
 	eth_pdata->priv_pdata = port_pdata;
@@ -462,6 +465,7 @@ static int dsa_post_bind(struct udevice *dev)
 			port_pdata = dev_get_parent_plat(pdev);
 			strlcpy(port_pdata->name, name, DSA_PORT_NAME_LENGTH);
 			pdev->name = port_pdata->name;
+			uclass_index_update(pdev);
 		}
 
 		/* try to bind all ports but keep 1st error */
@@ -37,6 +37,10 @@ static u32 rmt_timestamp;
 static u32 tcp_seq_init;
 static u32 tcp_ack_edge;
 
+/* Window scaling: offered by the remote end, and in use on the connection */
+static bool tcp_rmt_scale;
+static bool tcp_scale_ok;
+
 static int tcp_activity_count;
 
 /*
@@ -80,6 +84,11 @@ enum tcp_state tcp_get_tcp_state(void)
 	return current_tcp_state;
 }
 
+u32 tcp_get_ack_edge(void)
+{
+	return tcp_ack_edge;
+}
+
 /**
  * tcp_set_tcp_state() - set current TCP state
  * @new_state: new TCP state
@@ -215,6 +224,7 @@ void net_set_syn_options(union tcp_build_pkt *b)
 
 	b->ip.hdr.tcp_hlen = 0xa0;
 
+	tcp_scale_ok = false;
 	b->ip.mss.kind = TCP_O_MSS;
 	b->ip.mss.len = TCP_OPT_LEN_4;
 	b->ip.mss.mss = htons(TCP_MSS);
@@ -318,7 +328,12 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	pkt_len	= pkt_hdr_len + payload_len;
 	tcp_len	= pkt_len - IP_HDR_SIZE;
 
-	tcp_ack_edge = tcp_ack_num;
+	/*
+	 * Once established, acknowledge only the data received in order, so
+	 * that packets after a lost one are not taken as covering it
+	 */
+	if (current_tcp_state != TCP_ESTABLISHED)
+		tcp_ack_edge = tcp_ack_num;
 	/* TCP Header */
 	b->ip.hdr.tcp_ack = htonl(tcp_ack_edge);
 	b->ip.hdr.tcp_src = htons(sport);
@@ -339,8 +354,14 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	 * SOCs is may not be considered a constraint to buffer space, if
 	 * it is, then the u-boot tftp or nfs kernel netboot should be
 	 * considered.
+	 *
+	 * The window is only scaled once both ends have offered the window
+	 * scale option, and never in SYN packets.
 	 */
-	b->ip.hdr.tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	if (tcp_scale_ok && !(action & TCP_SYN))
+		b->ip.hdr.tcp_win = htons(TCP_RX_WINDOW >> TCP_SCALE);
+	else
+		b->ip.hdr.tcp_win = htons(min(TCP_RX_WINDOW, 0xffff));
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -470,33 +491,39 @@ void tcp_hole(u32 tcp_seq_num, u32 len)
 void tcp_parse_options(uchar *o, int o_len)
 {
 	struct tcp_t_opt  *tsopt;
+	uchar *end = o + o_len;
 	uchar *p = o;
 
+	tcp_rmt_scale = false;
+
 	/*
 	 * NOPs are options with a zero length, and thus are special.
 	 * All other options have length fields.
 	 */
-	for (p = o; p < (o + o_len); p = p + p[1]) {
-		if (!p[1])
-			return; /* Finished processing options */
+	while (p < end) {
+		if (p[0] == TCP_O_END)
+			return;
+		if (p[0] == TCP_1_NOP) {
+			p++;
+			continue;
+		}
+		if (p + 1 >= end || p[1] < TCP_OPT_LEN_2 || p + p[1] > end)
+			return; /* Malformed option */
 
 		switch (p[0]) {
-		case TCP_O_END:
-			return;
-		case TCP_O_MSS:
 		case TCP_O_SCL:
+			tcp_rmt_scale = true;
+			break;
+		case TCP_O_MSS:
 		case TCP_P_SACK:
 		case TCP_V_SACK:
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
 			rmt_timestamp = tsopt->t_snd;
-			return;
+			break;
 		}
-
-		/* Process optional NOPs */
-		if (p[0] == TCP_O_NOP)
-			p++;
+		p += p[1];
 	}
 }
 
@@ -533,6 +560,8 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 		debug_cond(DEBUG_INT_STATE, "TCP CLOSED %x\n", tcp_flags);
 		if (tcp_syn) {
 			action = TCP_SYN | TCP_ACK;
+			/* Our SYN ACK does not offer window scaling */
+			tcp_scale_ok = false;
 			tcp_seq_init = tcp_seq_num;
 			tcp_ack_edge = tcp_seq_num + 1;
 			current_tcp_state = TCP_SYN_RECEIVED;
@@ -559,8 +588,10 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 			for (i = 0; i < TCP_SACK; i++)
 				edge_a[i].st = NOPKT;
 
-			if (tcp_syn && tcp_ack)
+			if (tcp_syn && tcp_ack) {
 				action |= TCP_PUSH;
+				tcp_scale_ok = tcp_rmt_scale;
+			}
 		} else {
 			action = TCP_DATA;
 		}
@@ -673,6 +704,7 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	tcp_hdr_len = GET_TCP_HDR_LEN_IN_BYTES(b->ip.hdr.tcp_hlen);
 	payload_len = tcp_len - tcp_hdr_len;
 
+	tcp_rmt_scale = false;
 	if (tcp_hdr_len > TCP_HDR_SIZE)
 		tcp_parse_options((uchar *)b + IP_TCP_HDR_SIZE,
 				  tcp_hdr_len - TCP_HDR_SIZE);
@@ -693,7 +725,9 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 		tcp_activity_count = 0;
 	}
 
-	if ((tcp_action & TCP_PUSH) || payload_len > 0) {
+	/* The app is told about a reset, but it is never answered */
+	if ((tcp_action & TCP_PUSH) || tcp_action == TCP_RST ||
+	    payload_len > 0) {
 		debug_cond(DEBUG_DEV_PKT,
 			   "TCP Notify (action=%x, Seq=%u,Ack=%u,Pay%d)\n",
 			   tcp_action, tcp_seq_num, tcp_ack_num, payload_len);
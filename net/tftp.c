@@ -94,10 +94,26 @@ static short	tftp_tsize_num_hash;
 #endif
 /* The window size negotiated */
 static ushort	tftp_windowsize;
+/* Window size to ask for, adapted to the packet loss seen so far */
+static ushort	tftp_window_adapt;
+/* Windows acked and windows with lost blocks in this transfer */
+static ulong	tftp_windows;
+static ulong	tftp_lost_windows;
 /* Next block to send ack to */
 static ushort	tftp_next_ack;
+/* Last block the server sends before waiting for an ack */
+static ushort	tftp_window_end;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/*
+ * Blocks received out of order, already stored: bit n is set if block
+ * tftp_cur_block + 2 + n has been received, and also set in tftp_ahead_last
+ * if that block is the last one of the file
+ */
+static u64	tftp_ahead;
+static u64	tftp_ahead_last;
+/* The UDP port of the server for a read request */
+static int	tftp_server_port;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -118,9 +134,15 @@ static int	tftp_put_final_block_sent;
 
 /* default TFTP block size */
 #define TFTP_BLOCK_SIZE		512
+/* largest TFTP block that fits in an ethernet frame */
+#define TFTP_MTU_BLOCKSIZE	1468
 #define TFTP_MTU_BLOCKSIZE6 (CONFIG_TFTP_BLOCKSIZE - 20)
 /* sequence number is 16 bit */
 #define TFTP_SEQUENCE_SIZE	((ulong)(1<<16))
+/* number of blocks which can be received ahead of a missing one */
+#define TFTP_AHEAD_BLOCKS	64
+/* blocks received after a missing one before it is taken as lost */
+#define TFTP_REORDER_BLOCKS	3
 
 #define DEFAULT_NAME_LEN	(8 + 4 + 1)
 static char default_filename[DEFAULT_NAME_LEN];
@@ -152,6 +174,9 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* tftp_window_size_option the last time tftp_window_adapt was reset */
+static unsigned short tftp_window_adapt_option;
+static int saved_tftp_block_size_option;
 
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
@@ -251,6 +276,27 @@ static void show_block_marker(void)
 	}
 }
 
+/*
+ * Choose the window size to ask for in the next read request. It is doubled,
+ * up to the configured size, after a transfer with no lost blocks, and halved
+ * when blocks were lost in more than one window out of eight.
+ */
+static void tftp_adapt_window(void)
+{
+	ushort size = tftp_window_adapt;
+
+	if (tftp_put_active || tftp_window_size_option <= 1)
+		return;
+
+	if (!tftp_lost_windows)
+		size = min_t(ulong, size * 2, tftp_window_size_option);
+	else if (tftp_lost_windows * 8 > tftp_windows)
+		size = max(size / 2, 1);
+	debug("TFTP windows %lu, lost %lu: next windowsize %d\n",
+	      tftp_windows, tftp_lost_windows, size);
+	tftp_window_adapt = size;
+}
+
 /**
  * restart the current transfer due to an error
  *
@@ -259,6 +305,8 @@ static void show_block_marker(void)
 static void restart(const char *msg)
 {
 	printf("\n%s; starting again\n", msg);
+	tftp_lost_windows++;
+	tftp_adapt_window();
 	net_start_again();
 }
 
@@ -302,6 +350,7 @@ static void tftp_complete(void)
 			time_start * 1000, "/s");
 	}
 	puts("\ndone\n");
+	tftp_adapt_window();
 	if (!tftp_put_active)
 		efi_set_bootdev("Net", "", tftp_filename,
 				map_sysmem(tftp_load_addr, 0),
@@ -360,9 +409,9 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_adapt > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_adapt, 0);
 		len = pkt - xp;
 		break;
 
@@ -375,6 +424,7 @@ static void tftp_send(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(tftp_cur_block);
 		pkt = (uchar *)(s + 2);
+		tftp_window_end = tftp_cur_block + tftp_windowsize;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			int toload = tftp_block_size;
@@ -452,6 +502,38 @@ static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 }
 #endif
 
+/*
+ * Handle a data block received ahead of the one expected, which may have been
+ * lost or just delayed. A block in the current window is stored straight away,
+ * so that it does not have to be sent again. Returns true if the missing block
+ * should be taken as lost, i.e. the server has sent all of its window or
+ * several blocks came after the missing one.
+ */
+static bool tftp_store_ahead(ushort block, uchar *src, unsigned int len)
+{
+	ushort ahead = block - (ushort)(tftp_cur_block + 2);
+	u64 bit = 1ULL << (ahead % TFTP_AHEAD_BLOCKS);
+
+	if (tftp_state != STATE_DATA || ahead >= TFTP_AHEAD_BLOCKS ||
+	    ahead >= tftp_windowsize)
+		return true;
+
+	if (!(tftp_ahead & bit)) {
+		if (store_block(tftp_cur_block + 2 + ahead, src, len)) {
+			eth_halt();
+			net_set_state(NETLOOP_FAIL);
+			return false;
+		}
+		tftp_ahead |= bit;
+		if (len < tftp_block_size)
+			tftp_ahead_last |= bit;
+	}
+	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+
+	return block == tftp_window_end || (tftp_ahead_last & bit) ||
+		generic_hweight64(tftp_ahead) >= TFTP_REORDER_BLOCKS;
+}
+
 static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
@@ -598,6 +680,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 */
 			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0)
 				break;
+			if (!tftp_store_ahead(ntohs(*(__be16 *)pkt), pkt + 2,
+					      len))
+				break;
 			/*
 			 * If one packet is dropped most likely
 			 * all other buffers in the window
@@ -609,6 +694,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				tftp_last_nack = tftp_cur_block;
 				tftp_next_ack = (ushort)(tftp_cur_block +
 							 tftp_windowsize);
+				tftp_lost_windows++;
 			}
 			break;
 		}
@@ -660,13 +746,33 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			break;
 		}
 
+		/* Move past the blocks which were received ahead of this one */
+		while (tftp_ahead & 1) {
+			bool last = tftp_ahead_last & 1;
+
+			tftp_ahead >>= 1;
+			tftp_ahead_last >>= 1;
+			tftp_cur_block++;
+			tftp_cur_block %= TFTP_SEQUENCE_SIZE;
+			update_block_number();
+			tftp_prev_block = tftp_cur_block;
+			if (last) {
+				tftp_send();
+				tftp_complete();
+				return;
+			}
+		}
+		tftp_ahead >>= 1;
+		tftp_ahead_last >>= 1;
+
 		/*
 		 *	Acknowledge the block just received, which will prompt
 		 *	the remote for the next one.
 		 */
-		if (tftp_cur_block == tftp_next_ack) {
+		if ((short)((ushort)tftp_cur_block - tftp_next_ack) >= 0) {
 			tftp_send();
-			tftp_next_ack += tftp_windowsize;
+			tftp_next_ack = tftp_cur_block + tftp_windowsize;
+			tftp_windows++;
 		}
 		break;
 
@@ -696,6 +802,35 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 }
 
 
+/*
+ * Blocks larger than TFTP_MTU_BLOCKSIZE arrive as IP fragments, which some
+ * networks drop. If the server accepted such a block size but no data
+ * arrives, send the read request again asking for blocks which fit in a
+ * frame. The old block size is restored for the next transfer.
+ */
+static bool tftp_retry_small_blocks(void)
+{
+	if (tftp_state != STATE_OACK || tftp_put_active ||
+	    tftp_block_size <= TFTP_MTU_BLOCKSIZE ||
+	    (IS_ENABLED(CONFIG_IPV6) && use_ip6))
+		return false;
+
+	printf("\nNo data with block size %d, trying %d\n", tftp_block_size,
+	       TFTP_MTU_BLOCKSIZE);
+	if (!saved_tftp_block_size_option)
+		saved_tftp_block_size_option = tftp_block_size_option;
+	tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
+	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
+	tftp_state = STATE_SEND_RRQ;
+	tftp_remote_port = tftp_server_port;
+	/* Use a new port so that packets from the old request are ignored */
+	tftp_our_port = 1024 + (get_timer(0) % 3072);
+	timeout_count = 0;
+
+	return true;
+}
+
 static void tftp_timeout_handler(void)
 {
 	if (++timeout_count > timeout_count_max) {
@@ -703,6 +838,9 @@ static void tftp_timeout_handler(void)
 	} else {
 		puts("T ");
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		if (tftp_state == STATE_DATA)
+			tftp_lost_windows++;
+		tftp_retry_small_blocks();
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
 	}
@@ -718,6 +856,7 @@ static int tftp_init_load_addr(void)
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 
 	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	lmb_uninit(&lmb);
 	if (!max_size)
 		return -1;
 
@@ -727,7 +866,6 @@ static int tftp_init_load_addr(void)
 	return 0;
 }
 
-static int saved_tftp_block_size_option;
 static void sanitize_tftp_block_size_option(enum proto_t protocol)
 {
 	int cap, max_defrag;
@@ -756,7 +894,7 @@ static void sanitize_tftp_block_size_option(enum proto_t protocol)
 		 * (and small enough that it fits net_tx_packet which
 		 * has room for PKTSIZE_ALIGN bytes).
 		 */
-		cap = 1468;
+		cap = TFTP_MTU_BLOCKSIZE;
 	}
 	if (tftp_block_size_option > cap) {
 		printf("Capping tftp block size option to %d (was %d)\n",
@@ -813,8 +951,13 @@ void tftp_start(enum proto_t protocol)
 
 	sanitize_tftp_block_size_option(protocol);
 
+	if (tftp_window_adapt_option != tftp_window_size_option) {
+		tftp_window_adapt_option = tftp_window_size_option;
+		tftp_window_adapt = tftp_window_size_option;
+	}
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
-	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+	      tftp_block_size_option, tftp_window_adapt, timeout_ms);
 
 	if (IS_ENABLED(CONFIG_IPV6))
 		tftp_remote_ip6 = net_server_ip6;
@@ -941,9 +1084,14 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_our_port = simple_strtol(ep, NULL, 10);
 #endif
+	tftp_server_port = tftp_remote_port;
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
 	tftp_last_nack = 0;
+	tftp_ahead = 0;
+	tftp_ahead_last = 0;
+	tftp_windows = 0;
+	tftp_lost_windows = 0;
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
@@ -984,6 +1132,8 @@ void tftp_start_server(void)
 	tftp_our_port = WELL_KNOWN_PORT;
 	tftp_windowsize = 1;
 	tftp_next_ack = tftp_windowsize;
+	tftp_ahead = 0;
+	tftp_ahead_last = 0;
 
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
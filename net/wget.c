@@ -22,13 +22,11 @@ DECLARE_GLOBAL_DATA_PTR;
 /* The default, change with environment variable 'httpdstp' */
 #define SERVER_PORT		80
 
-static const char bootfile1[] = "GET ";
-static const char bootfile3[] = " HTTP/1.0\r\n\r\n";
 static const char http_eom[] = "\r\n\r\n";
-static const char http_ok[] = "200";
 static const char content_len[] = "Content-Length";
 static const char linefeed[] = "\r\n";
 static struct in_addr web_server_ip;
+static const char *web_server_name;
 static int our_port;
 static int wget_timeout_count;
 
@@ -41,15 +39,37 @@ struct pkt_qd {
 /*
  * This is a control structure for out of order packets received.
  * The actual packet bufers are in the kernel space, and are
- * expected to be overwritten by the downloaded image.
+ * expected to be overwritten by the downloaded image. Up to a receive
+ * window of packets can arrive before the one holding the HTTP header.
  */
-#define PKTQ_SZ (PKTBUFSRX / 4)
+#define PKTQ_SZ ((TCP_RX_WINDOW + TCP_MSS - 1) / TCP_MSS)
 static struct pkt_qd pkt_q[PKTQ_SZ];
 static int pkt_q_idx;
 static unsigned long content_length;
 static unsigned int packets;
 
 static unsigned int initial_data_seq_num;
+/* Offset in the file of the data in the response, set by Content-Range */
+static ulong wget_data_offset;
+/* Offset to ask for with a Range header, when resuming a transfer */
+static ulong wget_range_start;
+/* Send HTTP/1.0 requests, for a server which sent a chunked response */
+static bool wget_http10;
+
+/*
+ * HTTP/1.1 persistent connection: the server allows the connection to be
+ * used for the next request, which is sent without connecting again if it
+ * is to the same server.
+ */
+static bool wget_keep_alive;		/* response allows keep-alive */
+static bool wget_conn_open;		/* connection kept for next request */
+static bool wget_conn_reused;		/* request sent on kept connection */
+static struct in_addr wget_conn_ip;
+static unsigned int wget_conn_port;
+
+/* Sequence numbers of the request, to send it again */
+static unsigned int wget_req_seq_num;
+static unsigned int wget_req_ack_num;
 
 static enum  wget_state current_wget_state;
 
@@ -79,6 +99,7 @@ static int wget_init_load_size(void)
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 
 	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	lmb_uninit(&lmb);
 	if (!max_size)
 		return -1;
 
@@ -123,6 +144,41 @@ static inline int store_block(uchar *src, unsigned int offset, unsigned int len)
 	return 0;
 }
 
+/**
+ * wget_send_request() - send the HTTP request
+ * @server_port: TCP port of the server
+ * @tcp_seq_num: TCP sequence number of the request
+ * @tcp_ack_num: TCP acknowledgment number
+ */
+static void wget_send_request(unsigned int server_port,
+			      unsigned int tcp_seq_num,
+			      unsigned int tcp_ack_num)
+{
+	char *ptr;
+	int len;
+
+	ptr = (char *)net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE +
+		TCP_TSOPT_SIZE + 2;
+
+	len = sprintf(ptr, "GET %s HTTP/1.%d\r\n", image_url, !wget_http10);
+	if (web_server_name)
+		len += sprintf(ptr + len, "Host: %s", web_server_name);
+	else
+		len += sprintf(ptr + len, "Host: %pI4", &web_server_ip);
+	if (server_port != SERVER_PORT)
+		len += sprintf(ptr + len, ":%u", server_port);
+	len += sprintf(ptr + len, "\r\n");
+	if (wget_range_start)
+		len += sprintf(ptr + len, "Range: bytes=%lu-\r\n",
+			       wget_range_start);
+	len += sprintf(ptr + len, "\r\n");
+
+	wget_req_seq_num = tcp_seq_num;
+	wget_req_ack_num = tcp_ack_num;
+	net_send_tcp_packet(len, server_port, our_port, TCP_PUSH,
+			    tcp_seq_num, tcp_ack_num);
+}
+
 /**
  * wget_send_stored() - wget response dispatcher
  *
@@ -138,7 +194,6 @@ static void wget_send_stored(void)
 	unsigned int tcp_ack_num = retry_tcp_seq_num + (len == 0 ? 1 : len);
 	unsigned int tcp_seq_num = retry_tcp_ack_num;
 	unsigned int server_port;
-	uchar *ptr, *offset;
 
 	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
 
@@ -154,21 +209,7 @@ static void wget_send_stored(void)
 		pkt_q_idx = 0;
 		net_send_tcp_packet(0, server_port, our_port, action,
 				    tcp_seq_num, tcp_ack_num);
-
-		ptr = net_tx_packet + net_eth_hdr_size() +
-			IP_TCP_HDR_SIZE + TCP_TSOPT_SIZE + 2;
-		offset = ptr;
-
-		memcpy(offset, &bootfile1, strlen(bootfile1));
-		offset += strlen(bootfile1);
-
-		memcpy(offset, image_url, strlen(image_url));
-		offset += strlen(image_url);
-
-		memcpy(offset, &bootfile3, strlen(bootfile3));
-		offset += strlen(bootfile3);
-		net_send_tcp_packet((offset - ptr), server_port, our_port,
-				    TCP_PUSH, tcp_seq_num, tcp_ack_num);
+		wget_send_request(server_port, tcp_seq_num, tcp_ack_num);
 		current_wget_state = WGET_CONNECTED;
 		break;
 	case WGET_CONNECTED:
@@ -206,33 +247,159 @@ void wget_success(u8 action, unsigned int tcp_seq_num,
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
 }
 
+static unsigned int random_port(void);
+static void wget_timeout_handler(void);
+
+/**
+ * wget_reconnect() - open a new connection and send the request again
+ */
+static void wget_reconnect(void)
+{
+	current_wget_state = WGET_CLOSED;
+	wget_conn_reused = false;
+	wget_timeout_count = 0;
+	our_port = random_port();
+	tcp_set_tcp_state(TCP_CLOSED);
+	net_set_state(NETLOOP_CONTINUE);
+	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
+	wget_send(TCP_SYN, 0, 0, 0);
+}
+
+/**
+ * wget_received() - get the number of bytes received in order
+ *
+ * Return: offset in the file up to which all data has been stored
+ */
+static ulong wget_received(void)
+{
+	return wget_data_offset + (tcp_get_ack_edge() - initial_data_seq_num);
+}
+
+/**
+ * wget_complete() - check whether all the data has been received
+ *
+ * Return: true if the response had a Content-Length which is reached
+ */
+static bool wget_complete(void)
+{
+	return content_length != -1 &&
+		wget_received() >= wget_data_offset + content_length;
+}
+
+/**
+ * wget_resume() - resume an interrupted transfer on a new connection
+ *
+ * The rest of the file is asked for with a Range header. This is only done
+ * if the file size is known and more data has been received since the last
+ * attempt.
+ *
+ * Return: true if the transfer is being resumed
+ */
+static bool wget_resume(void)
+{
+	ulong received;
+
+	if (current_wget_state != WGET_TRANSFERRING || content_length == -1)
+		return false;
+
+	received = wget_received();
+	if (received <= wget_range_start || wget_complete())
+		return false;
+
+	printf("\nConnection lost, resuming at %lu\n", received);
+	wget_range_start = received;
+	wget_reconnect();
+
+	return true;
+}
+
+/**
+ * wget_done() - end a transfer, keeping the connection for the next one
+ */
+static void wget_done(void)
+{
+	printf("Packets received %d, Transfer Successful\n", packets);
+	wget_conn_open = true;
+	wget_conn_ip = web_server_ip;
+	wget_conn_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
+	current_wget_state = WGET_TRANSFERRED;
+	net_set_timeout_handler(0, NULL);
+	net_set_state(NETLOOP_SUCCESS);
+}
+
 /*
  * Interfaces of U-BOOT
  */
 static void wget_timeout_handler(void)
 {
+	unsigned int server_port;
+
+	/* A kept connection which the server has dropped: connect again */
+	if (wget_conn_reused && current_wget_state == WGET_CONNECTED) {
+		wget_reconnect();
+		return;
+	}
+
 	if (++wget_timeout_count > WGET_RETRY_COUNT) {
+		if (current_wget_state >= WGET_CONNECTED)
+			wget_send(TCP_RST, retry_tcp_seq_num,
+				  retry_tcp_ack_num, 0);
+		if (wget_resume())
+			return;
 		puts("\nRetry count exceeded; starting again\n");
-		wget_send(TCP_RST, 0, 0, 0);
 		net_start_again();
 	} else {
 		puts("T ");
 		net_set_timeout_handler(wget_timeout +
 					WGET_TIMEOUT * wget_timeout_count,
 					wget_timeout_handler);
-		wget_send_stored();
+		if (current_wget_state == WGET_CONNECTED && !pkt_q_idx) {
+			/* No response yet, the request may have been lost */
+			server_port = env_get_ulong("httpdstp", 10,
+						    SERVER_PORT) & 0xffff;
+			wget_send_request(server_port, wget_req_seq_num,
+					  wget_req_ack_num);
+		} else {
+			wget_send_stored();
+		}
 	}
 }
 
 #define PKT_QUEUE_OFFSET 0x20000
 #define PKT_QUEUE_PACKET_SIZE 0x800
 
+/**
+ * wget_header() - find a field in the HTTP response header
+ * @hdr: response header, nul-terminated
+ * @name: field name
+ *
+ * Return: value of the field, or NULL if not found
+ */
+static char *wget_header(char *hdr, const char *name)
+{
+	int len = strlen(name);
+	char *pos;
+
+	for (pos = strstr(hdr, linefeed); pos; pos = strstr(pos, linefeed)) {
+		pos += strlen(linefeed);
+		if (!strncasecmp(pos, name, len) && pos[len] == ':') {
+			pos += len + 1;
+			while (*pos == ' ')
+				pos++;
+			return pos;
+		}
+	}
+
+	return NULL;
+}
+
 static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 			   u8 action, unsigned int tcp_ack_num, unsigned int len)
 {
 	uchar *pkt_in_q;
 	char *pos;
-	int hlen, i;
+	int hlen, i, status;
+	bool http11;
 	uchar *ptr1;
 
 	pkt[len] = '\0';
@@ -241,8 +408,8 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 	if (!pos) {
 		debug_cond(DEBUG_WGET,
 			   "wget: Connected, data before Header %p\n", pkt);
-		pkt_in_q = (void *)image_load_addr + PKT_QUEUE_OFFSET +
-			(pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
+		pkt_in_q = (void *)image_load_addr + wget_range_start +
+			PKT_QUEUE_OFFSET + (pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
 
 		ptr1 = map_sysmem((phys_addr_t)pkt_in_q, len);
 		memcpy(ptr1, pkt, len);
@@ -271,71 +438,115 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 		printf("%.*s", i,  pkt);
 
 		current_wget_state = WGET_TRANSFERRING;
+		wget_keep_alive = false;
+
+		/* Look for header fields in the header only */
+		pkt[hlen - strlen(linefeed)] = '\0';
+		status = 0;
+		http11 = false;
+		if (!strncmp((char *)pkt, "HTTP/1.", 7)) {
+			http11 = pkt[7] == '1';
+			status = simple_strtoul((char *)pkt + 9, NULL, 10);
+		}
 
-		if (strstr((char *)pkt, http_ok) == 0) {
+		if (status != 200 && status != 206) {
 			debug_cond(DEBUG_WGET,
 				   "wget: Connected Bad Xfer\n");
-			initial_data_seq_num = tcp_seq_num + hlen;
-			wget_loop_state = NETLOOP_FAIL;
-			wget_send(action, tcp_seq_num, tcp_ack_num, len);
+			/* An HTTP/1.1 server may keep the connection open */
+			wget_fail("bad HTTP status\n", tcp_seq_num, tcp_ack_num,
+				  TCP_RST);
+			net_set_state(NETLOOP_FAIL);
+			return;
+		}
+
+		pos = wget_header((char *)pkt, "Transfer-Encoding");
+		if (pos && !strncasecmp(pos, "chunked", 7) && !wget_http10) {
+			/* Chunks cannot be stored as they arrive; avoid them */
+			debug_cond(DEBUG_WGET, "wget: Chunked, using HTTP/1.0\n");
+			wget_send(TCP_RST, tcp_seq_num, tcp_ack_num, len);
+			wget_http10 = true;
+			wget_reconnect();
+			return;
+		}
+
+		debug_cond(DEBUG_WGET,
+			   "wget: Connctd pkt %p  hlen %x\n",
+			   pkt, hlen);
+		initial_data_seq_num = tcp_seq_num + hlen;
+
+		pos = wget_header((char *)pkt, content_len);
+		if (!pos) {
+			content_length = -1;
 		} else {
+			content_length = simple_strtoul(pos, NULL, 10);
 			debug_cond(DEBUG_WGET,
-				   "wget: Connctd pkt %p  hlen %x\n",
-				   pkt, hlen);
-			initial_data_seq_num = tcp_seq_num + hlen;
+				   "wget: Connected Len %lu\n",
+				   content_length);
+		}
 
-			pos = strstr((char *)pkt, content_len);
-			if (!pos) {
-				content_length = -1;
-			} else {
-				pos += sizeof(content_len) + 2;
-				strict_strtoul(pos, 10, &content_length);
-				debug_cond(DEBUG_WGET,
-					   "wget: Connected Len %lu\n",
-					   content_length);
+		/* A server which ignores Range sends the whole file again */
+		wget_data_offset = 0;
+		if (status == 206) {
+			pos = wget_header((char *)pkt, "Content-Range");
+			if (pos && !strncmp(pos, "bytes ", 6))
+				wget_data_offset = simple_strtoul(pos + 6, NULL,
+								  10);
+			if (!pos || wget_data_offset > wget_range_start) {
+				wget_fail("bad Content-Range\n", tcp_seq_num,
+					  tcp_ack_num, TCP_RST);
+				net_set_state(NETLOOP_FAIL);
+				return;
 			}
+		}
+
+		pos = wget_header((char *)pkt, "Connection");
+		wget_keep_alive = http11 && content_length != -1 &&
+			!(pos && !strncasecmp(pos, "close", 5));
 
+		if (!wget_data_offset)
 			net_boot_file_size = 0;
 
-			if (len > hlen) {
-				if (store_block(pkt + hlen, 0, len - hlen) != 0) {
-					wget_loop_state = NETLOOP_FAIL;
-					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
-					net_set_state(NETLOOP_FAIL);
-					return;
-				}
+		if (len > hlen) {
+			if (store_block(pkt + hlen, wget_data_offset,
+					len - hlen) != 0) {
+				wget_loop_state = NETLOOP_FAIL;
+				wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
+				net_set_state(NETLOOP_FAIL);
+				return;
 			}
+		}
 
-			debug_cond(DEBUG_WGET,
-				   "wget: Connected Pkt %p hlen %x\n",
-				   pkt, hlen);
+		debug_cond(DEBUG_WGET,
+			   "wget: Connected Pkt %p hlen %x\n",
+			   pkt, hlen);
 
-			for (i = 0; i < pkt_q_idx; i++) {
-				int err;
+		for (i = 0; i < pkt_q_idx; i++) {
+			int err;
 
-				ptr1 = map_sysmem(
-					(phys_addr_t)(pkt_q[i].pkt),
-					pkt_q[i].len);
-				err = store_block(ptr1,
+			ptr1 = map_sysmem((phys_addr_t)(pkt_q[i].pkt),
+					  pkt_q[i].len);
+			err = store_block(ptr1, wget_data_offset +
 					  pkt_q[i].tcp_seq_num -
 					  initial_data_seq_num,
 					  pkt_q[i].len);
-				unmap_sysmem(ptr1);
-				debug_cond(DEBUG_WGET,
-					   "wget: Connctd pkt Q %p len %x\n",
-					   pkt_q[i].pkt, pkt_q[i].len);
-				if (err) {
-					wget_loop_state = NETLOOP_FAIL;
-					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
-					net_set_state(NETLOOP_FAIL);
-					return;
-				}
+			unmap_sysmem(ptr1);
+			debug_cond(DEBUG_WGET,
+				   "wget: Connctd pkt Q %p len %x\n",
+				   pkt_q[i].pkt, pkt_q[i].len);
+			if (err) {
+				wget_loop_state = NETLOOP_FAIL;
+				wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
+				net_set_state(NETLOOP_FAIL);
+				return;
 			}
 		}
 	}
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
-}
 
+	if (current_wget_state == WGET_TRANSFERRING && wget_keep_alive &&
+	    wget_complete())
+		wget_done();
+}
 /**
  * wget_handler() - TCP handler of wget
  * @pkt: pointer to the application packet
@@ -360,6 +571,15 @@ static void wget_handler(uchar *pkt, u16 dport,
 	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
 	packets++;
 
+	if (action == TCP_RST) {
+		debug_cond(DEBUG_WGET, "wget: Connection reset\n");
+		if (wget_conn_reused && current_wget_state == WGET_CONNECTED)
+			wget_reconnect();
+		else
+			wget_resume();
+		return;
+	}
+
 	switch (current_wget_state) {
 	case WGET_CLOSED:
 		debug_cond(DEBUG_WGET, "wget: Handler: Error!, State wrong\n");
@@ -384,7 +604,10 @@ static void wget_handler(uchar *pkt, u16 dport,
 	case WGET_CONNECTED:
 		debug_cond(DEBUG_WGET, "wget: Connected seq=%u, len=%x\n",
 			   tcp_seq_num, len);
-		if (!len) {
+		if (!len && wget_conn_reused && (action & TCP_FIN)) {
+			/* The server closed the connection which was kept */
+			wget_reconnect();
+		} else if (!len) {
 			wget_fail("Image not found, no data returned\n",
 				  tcp_seq_num, tcp_ack_num, action);
 		} else {
@@ -396,9 +619,9 @@ static void wget_handler(uchar *pkt, u16 dport,
 			   "wget: Transferring, seq=%x, ack=%x,len=%x\n",
 			   tcp_seq_num, tcp_ack_num, len);
 
-		if (tcp_seq_num >= initial_data_seq_num &&
-		    store_block(pkt, tcp_seq_num - initial_data_seq_num,
-				len) != 0) {
+		if ((int)(tcp_seq_num - initial_data_seq_num) >= 0 &&
+		    store_block(pkt, wget_data_offset + tcp_seq_num -
+				initial_data_seq_num, len) != 0) {
 			wget_fail("wget: store error\n",
 				  tcp_seq_num, tcp_ack_num, action);
 			net_set_state(NETLOOP_FAIL);
@@ -420,15 +643,23 @@ static void wget_handler(uchar *pkt, u16 dport,
 			wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num,
 				  len);
 			wget_loop_state = NETLOOP_SUCCESS;
+			if (wget_keep_alive && wget_complete())
+				wget_done();
 			break;
 		case TCP_CLOSE_WAIT:     /* End of transfer */
-			current_wget_state = WGET_TRANSFERRED;
 			wget_send(action | TCP_ACK | TCP_FIN,
 				  tcp_seq_num, tcp_ack_num, len);
+			/* Closed early: ask for the rest of the file */
+			if (wget_resume())
+				break;
+			current_wget_state = WGET_TRANSFERRED;
 			break;
 		}
 		break;
 	case WGET_TRANSFERRED:
+		/* Ignore packets after the response on a kept connection */
+		if (wget_conn_open)
+			break;
 		printf("Packets received %d, Transfer Successful\n", packets);
 		net_set_state(wget_loop_state);
 		break;
@@ -455,6 +686,8 @@ static unsigned int random_port(void)
 
 void wget_start(void)
 {
+	unsigned int server_port;
+
 	image_url = strchr(net_boot_file_name, ':');
 	if (image_url > 0) {
 		web_server_ip = string_to_ip(net_boot_file_name);
@@ -505,9 +738,9 @@ void wget_start(void)
 	tcp_set_tcp_handler(wget_handler);
 
 	wget_timeout_count = 0;
-	current_wget_state = WGET_CLOSED;
-
-	our_port = random_port();
+	wget_range_start = 0;
+	wget_http10 = false;
+	wget_conn_reused = false;
 
 	/*
 	 * Zero out server ether to force arp resolution in case
@@ -517,6 +750,27 @@ void wget_start(void)
 
 	memset(net_server_ethaddr, 0, 6);
 
+	/* Send the request on the connection kept from the last one */
+	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
+	if (wget_conn_open && tcp_get_tcp_state() == TCP_ESTABLISHED &&
+	    wget_conn_ip.s_addr == web_server_ip.s_addr &&
+	    wget_conn_port == server_port) {
+		debug_cond(DEBUG_WGET, "wget: Using kept connection\n");
+		wget_conn_open = false;
+		wget_conn_reused = true;
+		current_wget_state = WGET_CONNECTED;
+		pkt_q_idx = 0;
+		packets = 0;
+		wget_send_request(server_port, retry_tcp_ack_num,
+				  tcp_get_ack_edge());
+		return;
+	}
+	wget_conn_open = false;
+
+	current_wget_state = WGET_CLOSED;
+
+	our_port = random_port();
+
 	wget_send(TCP_SYN, 0, 0, 0);
 }
 
@@ -564,7 +818,9 @@ int wget_with_dns(ulong dst_addr, char *uri)
 	strlcat(net_boot_file_name, ":/", sizeof(net_boot_file_name)); /* append '/' which is removed by strsep() */
 	strlcat(net_boot_file_name, file_name, sizeof(net_boot_file_name));
 	image_load_addr = dst_addr;
+	web_server_name = host_name;
 	ret = net_loop(WGET);
+	web_server_name = NULL;
 
 out:
 	free(str_copy);
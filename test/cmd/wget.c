@@ -13,6 +13,7 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net/tcp.h>
 #include <net/wget.h>
@@ -204,3 +205,237 @@ static int net_test_wget(struct unit_test_state *uts)
 }
 
 LIB_TEST(net_test_wget, 0);
+
+#define HTTP_TEST_SIZE		6000
+#define HTTP_TEST_SEG		1000
+#define HTTP_TEST_ISN		1000
+
+/**
+ * struct http_test_priv - state of the HTTP/1.1 test server
+ *
+ * @data: contents of the file
+ * @resp: response being sent, header and data
+ * @resp_len: length of the response
+ * @base: sequence number of the start of the response
+ * @snd_nxt: next sequence number to send
+ * @connected: a connection is open
+ * @connections: number of connections opened
+ * @requests: number of requests answered
+ * @range_start: start of the range asked for in the last request
+ * @reset_at: offset in the response at which to reset the connection, 0 for
+ *	none
+ */
+struct http_test_priv {
+	char data[HTTP_TEST_SIZE];
+	char resp[HTTP_TEST_SIZE + 200];
+	int resp_len;
+	u32 base;
+	u32 snd_nxt;
+	bool connected;
+	int connections;
+	int requests;
+	ulong range_start;
+	int reset_at;
+};
+
+static void sb_tcp_send(struct udevice *dev, void *packet, u8 flags, u32 seq,
+			u32 ack, const void *data, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_send;
+	struct ip_tcp_hdr *tcp_send;
+	int pkt_len = IP_TCP_HDR_SIZE + len;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	tcp_send = (void *)eth_send + ETHER_HDR_SIZE;
+	tcp_send->tcp_src = tcp->tcp_dst;
+	tcp_send->tcp_dst = tcp->tcp_src;
+	tcp_send->tcp_seq = htonl(seq);
+	tcp_send->tcp_ack = htonl(ack);
+	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
+	tcp_send->tcp_flags = flags;
+	tcp_send->tcp_win = htons(0xffff);
+	tcp_send->tcp_xsum = 0;
+	tcp_send->tcp_ugr = 0;
+	memcpy((void *)tcp_send + IP_TCP_HDR_SIZE, data, len);
+	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
+						   tcp->ip_src, tcp->ip_dst,
+						   pkt_len - IP_HDR_SIZE,
+						   pkt_len);
+	net_set_ip_header((uchar *)tcp_send, tcp->ip_src, tcp->ip_dst,
+			  pkt_len, IPPROTO_TCP);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE + pkt_len;
+	++priv->recv_packets;
+}
+
+/* Send more of the response, keeping at most two segments unacknowledged */
+static void sb_http11_send_data(struct udevice *dev, void *packet,
+				struct http_test_priv *hp, u32 acked, u32 ack)
+{
+	u32 end = hp->base + hp->resp_len;
+	int len;
+
+	while (hp->snd_nxt != end &&
+	       hp->snd_nxt - acked < 2 * HTTP_TEST_SEG) {
+		if (hp->reset_at && hp->snd_nxt - hp->base >= hp->reset_at) {
+			sb_tcp_send(dev, packet, TCP_RST, hp->snd_nxt, ack,
+				    NULL, 0);
+			hp->reset_at = 0;
+			hp->connected = false;
+			return;
+		}
+		len = min(end - hp->snd_nxt, (u32)HTTP_TEST_SEG);
+		sb_tcp_send(dev, packet, TCP_ACK | TCP_PUSH, hp->snd_nxt, ack,
+			    hp->resp + hp->snd_nxt - hp->base, len);
+		hp->snd_nxt += len;
+	}
+}
+
+static void sb_http11_request(struct http_test_priv *hp, char *req)
+{
+	char *range;
+	int len;
+
+	hp->requests++;
+	range = strstr(req, "Range: bytes=");
+	hp->range_start = range ? simple_strtoul(range + 13, NULL, 10) : 0;
+	len = HTTP_TEST_SIZE - hp->range_start;
+	if (range)
+		hp->resp_len = sprintf(hp->resp,
+				       "HTTP/1.1 206 Partial Content\r\n"
+				       "Content-Length: %d\r\n"
+				       "Content-Range: bytes %lu-%d/%d\r\n\r\n",
+				       len, hp->range_start,
+				       HTTP_TEST_SIZE - 1, HTTP_TEST_SIZE);
+	else
+		hp->resp_len = sprintf(hp->resp, "HTTP/1.1 200 OK\r\n"
+				       "Content-Length: %d\r\n\r\n", len);
+	memcpy(hp->resp + hp->resp_len, hp->data + hp->range_start, len);
+	hp->resp_len += len;
+	hp->base = hp->snd_nxt;
+}
+
+/*
+ * An HTTP/1.1 server which keeps connections open and supports ranges. A
+ * request on a connection which it does not know about is reset.
+ */
+static int sb_http11_handler(struct udevice *dev, void *packet,
+			     unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct http_test_priv *hp = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	u32 seq, ack;
+	int payload_len;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sb_arp_handler(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP)
+		return -EPROTONOSUPPORT;
+
+	seq = ntohl(tcp->tcp_seq);
+	payload_len = ntohs(tcp->ip_len) - IP_HDR_SIZE -
+		(tcp->tcp_hlen >> 4) * 4;
+
+	if (tcp->tcp_flags & TCP_RST)
+		return 0;
+	if (tcp->tcp_flags == TCP_SYN) {
+		hp->connected = true;
+		hp->connections++;
+		hp->snd_nxt = HTTP_TEST_ISN + 1;
+		hp->base = hp->snd_nxt;
+		hp->resp_len = 0;
+		sb_tcp_send(dev, packet, TCP_SYN | TCP_ACK, HTTP_TEST_ISN,
+			    seq + 1, NULL, 0);
+		return 0;
+	}
+
+	ack = seq + payload_len;
+	if (payload_len > 0) {
+		if (!hp->connected) {
+			sb_tcp_send(dev, packet, TCP_RST, 0, ack, NULL, 0);
+			return 0;
+		}
+		((char *)tcp)[ntohs(tcp->ip_len)] = '\0';
+		sb_http11_request(hp, (char *)tcp + ntohs(tcp->ip_len) -
+				  payload_len);
+	}
+	if (hp->connected)
+		sb_http11_send_data(dev, packet, hp, ntohl(tcp->tcp_ack), ack);
+
+	return 0;
+}
+
+static int net_test_wget_http11_load(struct unit_test_state *uts,
+				     struct http_test_priv *hp)
+{
+	memset(map_sysmem(0x20000, HTTP_TEST_SIZE), '\0', HTTP_TEST_SIZE);
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/file.bin", 0));
+	ut_asserteq(HTTP_TEST_SIZE, env_get_hex("filesize", 0));
+	ut_asserteq_mem(hp->data, map_sysmem(0x20000, HTTP_TEST_SIZE),
+			HTTP_TEST_SIZE);
+
+	return 0;
+}
+
+static int net_test_wget_http11(struct unit_test_state *uts)
+{
+	const char http11_hdr[] = "HTTP/1.1 200 OK\r\nContent-Length: 6000\r\n\r\n";
+	struct http_test_priv *hp;
+	int connections, i, ret;
+
+	hp = calloc(1, sizeof(*hp));
+	ut_assertnonnull(hp);
+	for (i = 0; i < HTTP_TEST_SIZE; i++)
+		hp->data[i] = i * 13 + (i >> 7);
+
+	sandbox_eth_set_tx_handler(0, sb_http11_handler);
+	sandbox_eth_set_priv(0, hp);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x20000");
+
+	/* The connection is reset part way: the rest is asked for by range */
+	hp->reset_at = 3000;
+	ret = net_test_wget_http11_load(uts, hp);
+	if (ret)
+		goto out;
+	ut_asserteq(2, hp->requests);
+	ut_asserteq(3000 - strlen(http11_hdr), hp->range_start);
+	connections = hp->connections;
+
+	/* The next file is fetched over the same connection */
+	ret = net_test_wget_http11_load(uts, hp);
+	if (ret)
+		goto out;
+	ut_asserteq(3, hp->requests);
+	ut_asserteq(0, hp->range_start);
+	ut_asserteq(connections, hp->connections);
+
+	/* The server dropped the connection: a new one is opened */
+	hp->connected = false;
+	ret = net_test_wget_http11_load(uts, hp);
+	if (ret)
+		goto out;
+	ut_asserteq(4, hp->requests);
+	ut_asserteq(connections + 1, hp->connections);
+
+out:
+	sandbox_eth_set_tx_handler(0, NULL);
+	free(hp);
+
+	return ret;
+}
+
+LIB_TEST(net_test_wget_http11, 0);
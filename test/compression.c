@@ -354,6 +354,60 @@ static int uncompress_using_zstd(struct unit_test_state *uts,
 	return ret;
 }
 
+/* Small enough that the data is decompressed over several reads */
+#define STREAM_BUF_SIZE		32
+
+struct stream_state {
+	const char *data;
+	unsigned long size;
+	unsigned long pos;
+};
+
+static long read_stream(void *priv, void *buf, ulong size)
+{
+	struct stream_state *st = priv;
+
+	size = min(size, st->size - st->pos);
+	memcpy(buf, st->data + st->pos, size);
+	st->pos += size;
+
+	return size;
+}
+
+static int uncompress_using_stream(int comp, void *in, unsigned long in_size,
+				   void *out, unsigned long out_max,
+				   unsigned long *out_size)
+{
+	struct stream_state st = { .data = in, .size = in_size };
+	ulong len;
+	int ret;
+
+	ret = image_decomp_stream(comp, out, out_max, STREAM_BUF_SIZE,
+				  read_stream, &st, &len);
+	if (out_size)
+		*out_size = len;
+
+	return ret;
+}
+
+static int uncompress_using_gzip_stream(struct unit_test_state *uts,
+					void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	return uncompress_using_stream(IH_COMP_GZIP, in, in_size, out, out_max,
+				       out_size);
+}
+
+static int uncompress_using_zstd_stream(struct unit_test_state *uts,
+					void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	return uncompress_using_stream(IH_COMP_ZSTD, in, in_size, out, out_max,
+				       out_size);
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -508,6 +562,20 @@ static int compression_test_zstd(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_zstd, 0);
 
+static int compression_test_gzip_stream(struct unit_test_state *uts)
+{
+	return run_test(uts, "gzip_stream", compress_using_gzip,
+			uncompress_using_gzip_stream);
+}
+COMPRESSION_TEST(compression_test_gzip_stream, 0);
+
+static int compression_test_zstd_stream(struct unit_test_state *uts)
+{
+	return run_test(uts, "zstd_stream", compress_using_zstd,
+			uncompress_using_zstd_stream);
+}
+COMPRESSION_TEST(compression_test_zstd_stream, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
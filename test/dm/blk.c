@@ -5,13 +5,17 @@
 
 #include <common.h>
 #include <blk.h>
+#include <blkmap.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <sandbox_host.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
+#include <linux/sizes.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -335,3 +339,248 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that the block cache handles full and partial hits, and evictions */
+static int dm_test_blkcache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	char buf[6 * DEFAULT_BLKSZ];
+	lbaint_t head, tail;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BLOCK_CACHE))
+		return -EAGAIN;
+
+	/* room for four blocks */
+	blkcache_configure(8, 4 * DEFAULT_BLKSZ);
+	for (i = 0; i < 4; i++)
+		memset(buf + i * DEFAULT_BLKSZ, 'a' + i, DEFAULT_BLKSZ);
+	blkcache_fill(UCLASS_HOST, 0, 10, 4, DEFAULT_BLKSZ, buf);
+
+	/* all four blocks are cached */
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 0, 10, 4, DEFAULT_BLKSZ,
+				     buf));
+	ut_asserteq('a', buf[0]);
+	ut_asserteq('d', buf[4 * DEFAULT_BLKSZ - 1]);
+
+	/* another device does not see them */
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 1, 10, 4, DEFAULT_BLKSZ,
+				     buf));
+
+	/* blocks 14 and 15 are missing, so only the head is cached */
+	memset(buf, '\0', sizeof(buf));
+	head = blkcache_read_partial(UCLASS_HOST, 0, 10, 6, DEFAULT_BLKSZ, buf,
+				     &tail);
+	ut_asserteq(4, head);
+	ut_asserteq(0, tail);
+	ut_asserteq('d', buf[3 * DEFAULT_BLKSZ]);
+	ut_asserteq('\0', buf[4 * DEFAULT_BLKSZ]);
+
+	/* blocks 8 and 9 are missing, so only the tail is cached */
+	memset(buf, '\0', sizeof(buf));
+	head = blkcache_read_partial(UCLASS_HOST, 0, 8, 6, DEFAULT_BLKSZ, buf,
+				     &tail);
+	ut_asserteq(0, head);
+	ut_asserteq(4, tail);
+	ut_asserteq('\0', buf[2 * DEFAULT_BLKSZ - 1]);
+	ut_asserteq('a', buf[2 * DEFAULT_BLKSZ]);
+
+	/* nothing cached */
+	head = blkcache_read_partial(UCLASS_HOST, 0, 20, 2, DEFAULT_BLKSZ, buf,
+				     &tail);
+	ut_asserteq(0, head);
+	ut_asserteq(0, tail);
+
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(2, stats.partial_hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(0, stats.evictions);
+	ut_asserteq(4, stats.entries);
+	ut_asserteq(4 * DEFAULT_BLKSZ, stats.size);
+
+	/* adding two more blocks drops the two least-recently used */
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 0, 12, 2, DEFAULT_BLKSZ,
+				     buf));
+	blkcache_fill(UCLASS_HOST, 0, 20, 2, DEFAULT_BLKSZ, buf);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.evictions);
+	ut_asserteq(4, stats.entries);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 10, 1, DEFAULT_BLKSZ,
+				     buf));
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 0, 12, 2, DEFAULT_BLKSZ,
+				     buf));
+
+	/* large reads are not cached */
+	blkcache_fill(UCLASS_HOST, 0, 100, 9, DEFAULT_BLKSZ, buf);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 0, 100, 1, DEFAULT_BLKSZ,
+				     buf));
+
+	blkcache_invalidate(UCLASS_HOST, 0);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.size);
+
+	blkcache_configure(CONFIG_BLOCK_CACHE_MAX_BLOCKS,
+			   CONFIG_BLOCK_CACHE_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_blkcache, 0);
+
+/* Test that sequential reads are served from the read-ahead buffer */
+static int dm_test_blk_readahead(struct unit_test_state *uts)
+{
+	const int blks = SZ_2M / DEFAULT_BLKSZ, chunk = 32;
+	struct blk_readahead_stats stats;
+	struct udevice *dev, *blk;
+	ulong max_size;
+	char *data, *buf;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BLK_READAHEAD))
+		return -EAGAIN;
+
+	data = malloc(SZ_2M);
+	ut_assertnonnull(data);
+	buf = malloc(chunk * DEFAULT_BLKSZ);
+	ut_assertnonnull(buf);
+	for (i = 0; i < blks; i++)
+		memset(data + i * DEFAULT_BLKSZ, i, DEFAULT_BLKSZ);
+
+	ut_assertok(blkmap_create("ratest", &dev));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(blkmap_map_mem(dev, 0, blks, data));
+	ut_assertok(device_probe(blk));
+	ut_assertok(blk_get_readahead(blk, &max_size, &stats));
+	ut_asserteq(CONFIG_IF_ENABLED_INT(BLK_READAHEAD, BLK_READAHEAD_SIZE),
+		    max_size);
+
+	/* read the whole device in 16KiB chunks */
+	for (i = 0; i < blks; i += chunk) {
+		ut_asserteq(chunk, blk_read(blk, i, chunk, buf));
+		ut_assertok(memcmp(buf, data + i * DEFAULT_BLKSZ,
+				   chunk * DEFAULT_BLKSZ));
+	}
+	ut_assertok(blk_get_readahead(blk, &max_size, &stats));
+	ut_asserteq(blks / chunk, stats.reads);
+	ut_assert(stats.dev_reads <= 8);
+	ut_asserteq(stats.reads - stats.dev_reads, stats.hits);
+
+	/* random reads go straight to the device */
+	ut_asserteq(chunk, blk_read(blk, 1000, chunk, buf));
+	ut_assertok(memcmp(buf, data + 1000 * DEFAULT_BLKSZ,
+			   chunk * DEFAULT_BLKSZ));
+	ut_asserteq(chunk, blk_read(blk, 100, chunk, buf));
+	ut_asserteq(chunk, blk_read(blk, 3000, chunk, buf));
+	ut_assertok(blk_get_readahead(blk, &max_size, &stats));
+	ut_asserteq(3, stats.dev_reads);
+	ut_asserteq(0, stats.hits);
+
+	/* a write must not leave stale data in the buffer */
+	for (i = 0; i < 3; i++)
+		ut_asserteq(chunk, blk_read(blk, i * chunk, chunk, buf));
+	memset(buf, 0xaa, DEFAULT_BLKSZ);
+	ut_asserteq(1, blk_write(blk, 3 * chunk, 1, buf));
+	ut_asserteq(chunk, blk_read(blk, 3 * chunk, chunk, buf));
+	ut_asserteq(0xaa, (u8)buf[0]);
+
+	/* with read-ahead disabled, each read goes to the device */
+	ut_assertok(blk_get_readahead(blk, &max_size, &stats));
+	ut_assertok(blk_set_readahead(blk, 0));
+	for (i = 0; i < 4; i++)
+		ut_asserteq(chunk, blk_read(blk, i * chunk, chunk, buf));
+	ut_assertok(blk_get_readahead(blk, &max_size, &stats));
+	ut_asserteq(0, max_size);
+	ut_asserteq(4, stats.dev_reads);
+
+	ut_assertok(blkmap_destroy(dev));
+	free(buf);
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_readahead, 0);
+
+struct blk_async_test {
+	int count;
+	int order[4];
+};
+
+static void blk_async_test_done(struct blk_request *req)
+{
+	struct blk_async_test *priv = req->priv;
+
+	priv->order[priv->count++] = req->start;
+}
+
+/* Test submitting asynchronous requests to a device without native support */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	const int blks = SZ_64K / DEFAULT_BLKSZ, chunk = 4;
+	struct blk_async_test priv = {};
+	struct blk_request req[4];
+	struct udevice *dev, *blk;
+	char *data, *buf;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BLK_ASYNC))
+		return -EAGAIN;
+
+	data = malloc(SZ_64K);
+	ut_assertnonnull(data);
+	buf = malloc(ARRAY_SIZE(req) * chunk * DEFAULT_BLKSZ);
+	ut_assertnonnull(buf);
+	for (i = 0; i < blks; i++)
+		memset(data + i * DEFAULT_BLKSZ, i, DEFAULT_BLKSZ);
+
+	ut_assertok(blkmap_create("asynctest", &dev));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(blkmap_map_mem(dev, 0, blks, data));
+	ut_assertok(device_probe(blk));
+	ut_asserteq(-EINVAL, blk_set_queue_depth(blk, 0));
+	ut_assertok(blk_set_queue_depth(blk, 2));
+
+	/* callbacks only run from blk_poll(), in completion order */
+	memset(req, '\0', sizeof(req));
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		req[i].dev = blk;
+		req[i].op = BLK_REQ_READ;
+		req[i].start = i * 10;
+		req[i].blkcnt = chunk;
+		req[i].buf = buf + i * chunk * DEFAULT_BLKSZ;
+		req[i].complete = blk_async_test_done;
+		req[i].priv = &priv;
+		ut_assertok(blk_submit(&req[i]));
+	}
+	ut_asserteq(0, priv.count);
+	ut_asserteq(false, req[0].done);
+	ut_assertok(blk_drain(blk));
+	ut_asserteq(ARRAY_SIZE(req), priv.count);
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		ut_asserteq(true, req[i].done);
+		ut_asserteq(chunk, req[i].result);
+		ut_asserteq(i * 10, priv.order[i]);
+		ut_assertok(memcmp(req[i].buf, data + i * 10 * DEFAULT_BLKSZ,
+				   chunk * DEFAULT_BLKSZ));
+	}
+
+	/* write, then check that a synchronous read sees the new data */
+	memset(buf, 0x5a, chunk * DEFAULT_BLKSZ);
+	req[0].op = BLK_REQ_WRITE;
+	req[0].start = 20;
+	req[0].complete = NULL;
+	ut_assertok(blk_submit(&req[0]));
+	ut_asserteq(chunk, blk_wait(&req[0]));
+	ut_asserteq(chunk, blk_read(blk, 20, chunk, buf + DEFAULT_BLKSZ));
+	ut_asserteq(0x5a, (u8)buf[DEFAULT_BLKSZ]);
+	ut_asserteq(0x5a, (u8)data[20 * DEFAULT_BLKSZ]);
+
+	ut_assertok(blkmap_destroy(dev));
+	free(buf);
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, 0);
@@ -13,6 +13,7 @@
 #include <malloc.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -1353,3 +1354,290 @@ static int dm_test_dev_get_mem(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dev_get_mem, UT_TESTF_SCAN_FDT);
+
+/* Test that looking up a compatible string finds the same driver as a scan */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *found_id, *scan_id;
+	struct driver *found, *scan;
+	int count = 0;
+
+	for (found = driver; found != driver + n_ents; found++) {
+		for (id = found->of_match; id && id->compatible; id++) {
+			/* The first driver with the string wins */
+			for (scan = driver; scan != found; scan++) {
+				for (scan_id = scan->of_match;
+				     scan_id && scan_id->compatible; scan_id++) {
+					if (!strcmp(scan_id->compatible,
+						    id->compatible))
+						break;
+				}
+				if (scan_id && scan_id->compatible)
+					break;
+			}
+			if (scan != found)
+				continue;
+
+			ut_asserteq_ptr(found,
+					lists_driver_lookup_compat(id->compatible,
+								   &found_id));
+			ut_asserteq_ptr(id, found_id);
+			count++;
+		}
+	}
+	ut_assert(count > 100);
+
+	ut_assertnull(lists_driver_lookup_compat("denx,u-boot-nonexistent",
+						 &found_id));
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
+
+/* Test that looking up devices in a uclass finds the same as walking it */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct udevice *dev, *first, *found;
+	struct udevice unbound = { };
+	const char *old_name;
+	struct uclass *uc;
+	char *name;
+	ofnode node;
+	int count = 0;
+	int seq;
+
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	ut_assertnonnull(uc->index_);
+#endif
+	uclass_foreach_dev(dev, uc) {
+		/* The first device with a name wins */
+		uclass_foreach_dev(first, uc) {
+			if (!strcmp(first->name, dev->name))
+				break;
+		}
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT,
+						       dev->name, &found));
+		ut_asserteq_ptr(first, found);
+
+		if (dev_seq(dev) != -1) {
+			ut_assertok(uclass_find_device_by_seq(UCLASS_TEST_FDT,
+							      dev_seq(dev),
+							      &found));
+			ut_asserteq_ptr(dev, found);
+		}
+		if (dev_has_ofnode(dev)) {
+			ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+								 dev_ofnode(dev),
+								 &found));
+			ut_asserteq_ptr(dev, found);
+		}
+		count++;
+	}
+	ut_assert(count >= 8);
+
+	/* Renaming a device */
+	ut_assertok(uclass_find_first_device(UCLASS_TEST_FDT, &dev));
+	old_name = dev->name;
+	ut_assertok(device_set_name(dev, "renamed-test"));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "renamed-test",
+					       &found));
+	ut_asserteq_ptr(dev, found);
+	ut_assertok(uclass_find_device_by_namelen(UCLASS_TEST_FDT,
+						  "renamed-test-x", 12,
+						  &found));
+	ut_asserteq_ptr(dev, found);
+	if (!uclass_find_device_by_name(UCLASS_TEST_FDT, old_name, &found))
+		ut_assert(found != dev);
+
+	/* Moving it to another node */
+	node = dev_ofnode(dev);
+	dev_set_ofnode(dev, ofnode_root());
+	uclass_index_update(dev);
+	ut_assertok(uclass_find_device_by_ofnode(UCLASS_TEST_FDT, ofnode_root(),
+						 &found));
+	ut_asserteq_ptr(dev, found);
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT, node,
+							  &found));
+	dev_set_ofnode(dev, node);
+	uclass_index_update(dev);
+
+	/* Changing the string its name points to */
+	name = (char *)dev->name;
+	strcpy(name, "renamed-TEST");
+	uclass_index_update(dev);
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "renamed-TEST",
+					       &found));
+	ut_asserteq_ptr(dev, found);
+	ut_asserteq(-ENODEV, uclass_find_device_by_name(UCLASS_TEST_FDT,
+							"renamed-test", &found));
+	strcpy(name, "renamed-test");
+	uclass_index_update(dev);
+
+	/* A device which is not bound is not indexed */
+	dev_set_ofnode(&unbound, ofnode_root());
+	uclass_index_update(&unbound);
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT,
+							  ofnode_root(),
+							  &found));
+
+	/* Unbinding it */
+	seq = dev_seq(dev);
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST_FDT, seq,
+						       &found));
+	ut_asserteq(-ENODEV, uclass_find_device_by_name(UCLASS_TEST_FDT,
+							"renamed-test",
+							&found));
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT, node,
+							  &found));
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/**
+ * struct probe_later_test_plat - Platform data for the probe_later_test driver
+ *
+ * @polls: Number of polls before the device is ready, or -1 to fail
+ */
+struct probe_later_test_plat {
+	int polls;
+};
+
+static int probe_later_test_poll(struct udevice *dev)
+{
+	struct probe_later_test_plat *plat = dev_get_plat(dev);
+
+	if (plat->polls < 0)
+		return -EIO;
+	if (plat->polls) {
+		plat->polls--;
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
+static int probe_later_test_probe(struct udevice *dev)
+{
+	return device_probe_later(dev, probe_later_test_poll, 1000);
+}
+
+U_BOOT_DRIVER(probe_later_test) = {
+	.name	= "probe_later_test",
+	.id	= UCLASS_TEST,
+	.probe	= probe_later_test_probe,
+};
+
+/*
+ * Probe devices which wait together, as at start-up. This is called between
+ * device_probe_later_begin() and device_probe_later_end(), so that the end is
+ * always reached, even if a check fails.
+ */
+static int probe_later_together(struct unit_test_state *uts,
+				struct udevice *dev1, struct udevice *dev2,
+				struct udevice *dev3, int post_probe)
+{
+	struct probe_later_test_plat *plat1 = dev_get_plat(dev1);
+	struct probe_later_test_plat *plat2 = dev_get_plat(dev2);
+	int pre_remove;
+
+	plat1->polls = 2;
+	plat2->polls = 5;
+	ut_assertok(device_probe(dev1));
+	ut_assertok(device_probe(dev2));
+	ut_assertok(device_probe(dev3));
+	ut_assert(!device_active(dev1));
+	ut_assert(dev_get_flags(dev1) & DM_FLAG_PROBE_LATER);
+	ut_assert(dev_get_flags(dev2) & DM_FLAG_PROBE_LATER);
+	ut_asserteq(post_probe, dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+
+	/* The failing device is removed when polled */
+	device_probe_later_poll();
+	ut_asserteq(1, plat1->polls);
+	ut_asserteq(4, plat2->polls);
+	ut_assert(!device_active(dev3));
+	ut_assert(!(dev_get_flags(dev3) & DM_FLAG_PROBE_LATER));
+
+	device_probe_later_poll();
+	ut_assert(dev_get_flags(dev1) & DM_FLAG_PROBE_LATER);
+	device_probe_later_poll();
+	ut_assert(!(dev_get_flags(dev1) & DM_FLAG_PROBE_LATER));
+	ut_assert(device_active(dev1));
+	ut_asserteq(post_probe + 1, dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+
+	/* Probing a waiting device waits for it */
+	ut_asserteq(2, plat2->polls);
+	ut_assertok(device_probe(dev2));
+	ut_asserteq(0, plat2->polls);
+	ut_assert(!(dev_get_flags(dev2) & DM_FLAG_PROBE_LATER));
+	ut_assert(device_active(dev2));
+	ut_asserteq(post_probe + 2, dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+
+	/* Removing a waiting device stops the wait, without the uclass */
+	ut_assertok(device_remove(dev2, DM_REMOVE_NORMAL));
+	plat2->polls = 5;
+	ut_assertok(device_probe(dev2));
+	pre_remove = dm_testdrv_op_count[DM_TEST_OP_PRE_REMOVE];
+	ut_assertok(device_remove(dev2, DM_REMOVE_NORMAL));
+	ut_assert(!device_active(dev2));
+	ut_assert(!(dev_get_flags(dev2) & DM_FLAG_PROBE_LATER));
+	ut_asserteq(pre_remove, dm_testdrv_op_count[DM_TEST_OP_PRE_REMOVE]);
+
+	/* Leave a device waiting for device_probe_later_end() */
+	plat2->polls = 3;
+	ut_assertok(device_probe(dev2));
+
+	return 0;
+}
+
+/* Test letting a device's probe finish later */
+static int dm_test_probe_later(struct unit_test_state *uts)
+{
+	static struct probe_later_test_plat plat1, plat2, plat3;
+	struct udevice *dev1, *dev2, *dev3;
+	int post_probe;
+	int ret;
+
+	/* Skip the behaviour in test_post_probe() */
+	uts->skip_post_probe = 1;
+
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(probe_later_test),
+				"later1", &plat1, ofnode_null(), &dev1));
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(probe_later_test),
+				"later2", &plat2, ofnode_null(), &dev2));
+	ut_assertok(device_bind(dm_root(), DM_DRIVER_GET(probe_later_test),
+				"later3", &plat3, ofnode_null(), &dev3));
+
+	/* Normally the probe just waits */
+	plat1.polls = 2;
+	plat3.polls = -1;
+	ut_assertok(device_probe(dev1));
+	ut_asserteq(0, plat1.polls);
+	ut_assert(device_active(dev1));
+	ut_assert(!(dev_get_flags(dev1) & DM_FLAG_PROBE_LATER));
+	ut_asserteq(-EIO, device_probe(dev3));
+	ut_assert(!device_active(dev3));
+	ut_assertok(device_remove(dev1, DM_REMOVE_NORMAL));
+
+	if (!CONFIG_IS_ENABLED(DM_PROBE_LATER))
+		return 0;
+
+	post_probe = dm_testdrv_op_count[DM_TEST_OP_POST_PROBE];
+	device_probe_later_begin();
+	ret = probe_later_together(uts, dev1, dev2, dev3, post_probe);
+	device_probe_later_end();
+	ut_assertok(ret);
+
+	/* Ending waits for everything */
+	ut_asserteq(0, plat2.polls);
+	ut_assert(!(dev_get_flags(dev2) & DM_FLAG_PROBE_LATER));
+	ut_assert(device_active(dev2));
+	ut_asserteq(post_probe + 3, dm_testdrv_op_count[DM_TEST_OP_POST_PROBE]);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_later, 0);
@@ -10,8 +10,10 @@
 #include <dm.h>
 #include <env.h>
 #include <fdtdec.h>
+#include <image.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net6.h>
 #include <asm/eth.h>
@@ -617,6 +619,222 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
 
+#define TFTP_TEST_PORT		69
+#define TFTP_TEST_TID		1234
+#define TFTP_TEST_BLKSIZE	512
+/* 8 full blocks and a short one */
+#define TFTP_TEST_SIZE		(8 * TFTP_TEST_BLKSIZE + 100)
+#define TFTP_TEST_ADDR		0x100000
+
+enum {
+	TFTP_TEST_RRQ	= 1,
+	TFTP_TEST_DATA	= 3,
+	TFTP_TEST_ACK	= 4,
+	TFTP_TEST_OACK	= 6,
+};
+
+struct tftp_test_priv {
+	struct unit_test_state *uts;
+	u8 *img;
+	int windowsize;		/* window size asked for in the last request */
+	bool faults;		/* reorder and drop blocks */
+	int acks[16];		/* acks received, in order */
+	int num_acks;
+};
+
+/* Inject a TFTP packet from the server, with @len bytes of @data */
+static void sb_tftp_reply(struct udevice *dev, struct ip_udp_hdr *ip,
+			  int opcode, const void *data, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = (void *)ip - ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_recv;
+	struct ip_udp_hdr *ipr;
+	__be16 *op;
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+
+	ipr = (void *)eth_recv + ETHER_HDR_SIZE;
+	memset(ipr, '\0', IP_UDP_HDR_SIZE);
+	ipr->ip_hl_v = 0x45;
+	ipr->ip_len = htons(IP_UDP_HDR_SIZE + 2 + len);
+	ipr->ip_ttl = 255;
+	ipr->ip_p = IPPROTO_UDP;
+	net_copy_ip(&ipr->ip_dst, &ip->ip_src);
+	net_copy_ip(&ipr->ip_src, &ip->ip_dst);
+	ipr->ip_sum = compute_ip_checksum(ipr, IP_HDR_SIZE);
+	ipr->udp_src = htons(TFTP_TEST_TID);
+	ipr->udp_dst = ip->udp_src;
+	ipr->udp_len = htons(UDP_HDR_SIZE + 2 + len);
+
+	op = (void *)ipr + IP_UDP_HDR_SIZE;
+	*op = htons(opcode);
+	memcpy(op + 1, data, len);
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + 2 + len;
+	++priv->recv_packets;
+}
+
+static void sb_tftp_send_block(struct udevice *dev, struct ip_udp_hdr *ip,
+			       struct tftp_test_priv *tp, int block)
+{
+	u8 buf[2 + TFTP_TEST_BLKSIZE];
+	int offset = (block - 1) * TFTP_TEST_BLKSIZE;
+	int len = min(TFTP_TEST_SIZE - offset, TFTP_TEST_BLKSIZE);
+
+	if (len < 0)
+		return;
+	*(__be16 *)buf = htons(block);
+	memcpy(buf + 2, tp->img + offset, len);
+	sb_tftp_reply(dev, ip, TFTP_TEST_DATA, buf, 2 + len);
+}
+
+/*
+ * A TFTP server supporting the windowsize option. With faults enabled, the
+ * second window is sent with its first two blocks swapped and the first block
+ * of the third window is lost the first time around.
+ */
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct tftp_test_priv *tp = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	u8 *tftp = (void *)ip + IP_UDP_HDR_SIZE;
+	int opcode, block, count, i;
+
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	opcode = ntohs(*(__be16 *)tftp);
+	if (ntohs(ip->udp_dst) == TFTP_TEST_PORT && opcode == TFTP_TEST_RRQ) {
+		char *opt = (char *)tftp + 2;
+		char *end = (char *)packet + len;
+		char oack[20];
+
+		tp->windowsize = 0;
+		while (opt < end) {
+			if (!strcmp(opt, "windowsize"))
+				tp->windowsize = dectoul(opt + 11, NULL);
+			opt += strlen(opt) + 1;
+		}
+		if (!tp->windowsize) {
+			sb_tftp_send_block(dev, ip, tp, 1);
+			return 0;
+		}
+		i = sprintf(oack, "windowsize%c%d", 0, tp->windowsize);
+		sb_tftp_reply(dev, ip, TFTP_TEST_OACK, oack, i + 1);
+		return 0;
+	}
+	if (ntohs(ip->udp_dst) == TFTP_TEST_PORT || opcode != TFTP_TEST_ACK)
+		return 0;
+
+	block = ntohs(*(__be16 *)(tftp + 2));
+	if (tp->num_acks < ARRAY_SIZE(tp->acks))
+		tp->acks[tp->num_acks++] = block;
+
+	count = tp->windowsize ? tp->windowsize : 1;
+	if (tp->faults && tp->num_acks == 2) {
+		sb_tftp_send_block(dev, ip, tp, block + 2);
+		sb_tftp_send_block(dev, ip, tp, block + 1);
+		i = 3;
+	} else if (tp->faults && tp->num_acks == 3) {
+		i = 2;
+	} else {
+		i = 1;
+	}
+	for (; i <= count; i++)
+		sb_tftp_send_block(dev, ip, tp, block + i);
+
+	return 0;
+}
+
+static int sb_tftp_load(struct unit_test_state *uts,
+			struct tftp_test_priv *tp)
+{
+	tp->num_acks = 0;
+	memset(map_sysmem(TFTP_TEST_ADDR, TFTP_TEST_SIZE), '\0',
+	       TFTP_TEST_SIZE);
+	image_load_addr = TFTP_TEST_ADDR;
+	ut_asserteq(TFTP_TEST_SIZE, net_loop(TFTPGET));
+	ut_asserteq_mem(tp->img, map_sysmem(TFTP_TEST_ADDR, TFTP_TEST_SIZE),
+			TFTP_TEST_SIZE);
+
+	return 0;
+}
+
+static int _dm_test_eth_tftp_window(struct unit_test_state *uts,
+				    struct tftp_test_priv *tp)
+{
+	int i;
+
+	for (i = 0; i < TFTP_TEST_SIZE; i++)
+		tp->img[i] = i * 7 + (i >> 8);
+
+	/*
+	 * Block 4 is received ahead of block 5 without a nack, while the loss
+	 * of block 7 is noticed when block 9, the last one, arrives
+	 */
+	tp->faults = true;
+	ut_assertok(sb_tftp_load(uts, tp));
+	ut_asserteq(3, tp->windowsize);
+	ut_asserteq(5, tp->num_acks);
+	ut_asserteq(0, tp->acks[0]);
+	ut_asserteq(3, tp->acks[1]);
+	ut_asserteq(6, tp->acks[2]);
+	ut_asserteq(6, tp->acks[3]);
+	ut_asserteq(9, tp->acks[4]);
+
+	/* A window out of two lost blocks, so the next request asks for less */
+	tp->faults = false;
+	ut_assertok(sb_tftp_load(uts, tp));
+	ut_asserteq(0, tp->windowsize);
+	ut_asserteq(9, tp->num_acks);
+
+	/* No loss, so the window grows again */
+	ut_assertok(sb_tftp_load(uts, tp));
+	ut_asserteq(2, tp->windowsize);
+	ut_asserteq(6, tp->num_acks);
+
+	return 0;
+}
+
+static int dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	struct tftp_test_priv tp = { .uts = uts };
+	int ret;
+
+	tp.img = malloc(TFTP_TEST_SIZE);
+	ut_assertnonnull(tp.img);
+
+	net_server_ip = string_to_ip("1.1.2.2");
+	copy_filename(net_boot_file_name, "test.img",
+		      sizeof(net_boot_file_name));
+	env_set("ethact", "eth@10002000");
+	env_set("tftpwindowsize", "3");
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	sandbox_eth_set_priv(0, &tp);
+
+	ret = _dm_test_eth_tftp_window(uts, &tp);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("tftpwindowsize", NULL);
+	free(tp.img);
+
+	return ret;
+}
+DM_TEST(dm_test_eth_tftp_window, UT_TESTF_SCAN_FDT);
+
 #if IS_ENABLED(CONFIG_IPV6_ROUTER_DISCOVERY)
 
 static u8 ip6_ra_buf[] = {0x60, 0xf, 0xc5, 0x4a, 0x0, 0x38, 0x3a, 0xff, 0xfe,
@@ -0,0 +1,730 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the state which filesystems keep between reads
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <blkmap.h>
+#include <dm.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <fat.h>
+#include <fs.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <asm/unaligned.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <linux/log2.h>
+#include <linux/stat.h>
+#include <linux/sizes.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include "../../fs/squashfs/sqfs_filesystem.h"
+
+/* Size of each test filesystem and of the file in it */
+#define FS_TEST_IMG_SIZE	SZ_64K
+#define FS_TEST_FILE_SIZE	(32 * DEFAULT_BLKSZ - 100)
+#define FS_TEST_SMALL_SIZE	64
+
+/* Fill @data with a pattern which differs in every block and for each @seed */
+static void fs_test_fill(char *data, int size, int seed)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		data[i] = seed + i / DEFAULT_BLKSZ * 3 + i;
+}
+
+/**
+ * fs_test_create_fat() - Create a FAT32 filesystem holding /TEST.BIN
+ *
+ * Budget mkfs.fat, as in test/image/spl_load_fs.c, with one-sector clusters
+ * and a single one-sector FAT. The file is either contiguous or has each of
+ * its clusters in a separate run, in the reverse order.
+ *
+ * @dst: Buffer of FS_TEST_IMG_SIZE bytes
+ * @data: Contents of the file
+ * @size: Size of the file, at most FS_TEST_FILE_SIZE
+ * @frag: true to fragment the file
+ */
+static void fs_test_create_fat(void *dst, const char *data, int size,
+			       bool frag)
+{
+	const int sector_size = DEFAULT_BLKSZ, root_sector = 2;
+	int clusters = DIV_ROUND_UP(size, sector_size);
+	struct boot_sector *bs = dst;
+	struct volume_info *vi = (void *)(bs + 1);
+	__le32 *fat = dst + sector_size;
+	struct dir_entry *dirent = dst + root_sector * sector_size;
+	int i, clust, prev = 0;
+
+	memset(dst, '\0', FS_TEST_IMG_SIZE);
+	bs->sector_size[0] = sector_size & 0xff;
+	bs->sector_size[1] = sector_size >> 8;
+	bs->cluster_size = 1;
+	bs->reserved = cpu_to_le16(1);
+	bs->fats = 1;
+	bs->media = 0xf8;
+	bs->total_sect = cpu_to_le32(FS_TEST_IMG_SIZE / sector_size);
+	bs->fat32_length = cpu_to_le32(1);
+	bs->root_cluster = cpu_to_le32(root_sector);
+	vi->ext_boot_sign = 0x29;
+	memcpy(vi->fs_type, "FAT32   ", sizeof(vi->fs_type));
+	memcpy(dst + 0x1fe, "\x55\xAA", 2);
+
+	fat[0] = cpu_to_le32(0x0ffffff8);
+	fat[1] = cpu_to_le32(0x0fffffff);
+	fat[root_sector] = cpu_to_le32(0x0ffffff8);
+
+	/* cluster n is sector n, since the data area starts at sector 2 */
+	for (i = 0; i < clusters; i++) {
+		clust = frag ? root_sector + 1 + 2 * (clusters - 1 - i) :
+			root_sector + 1 + i;
+		memcpy(dst + clust * sector_size, data + i * sector_size,
+		       min(size - i * sector_size, sector_size));
+		if (prev)
+			fat[prev] = cpu_to_le32(clust);
+		else
+			dirent->start = cpu_to_le16(clust);
+		prev = clust;
+	}
+	fat[prev] = cpu_to_le32(0x0ffffff8);
+
+	memcpy(dirent->nameext.name, "TEST    ", sizeof(dirent->nameext.name));
+	memcpy(dirent->nameext.ext, "BIN", sizeof(dirent->nameext.ext));
+	dirent->size = cpu_to_le32(size);
+}
+
+/**
+ * fs_test_create_ext() - Create an ext2 filesystem holding /test.bin
+ *
+ * Budget mke2fs, as in test/image/spl_load_fs.c, with 1KiB blocks, a single
+ * block group and every block and inode marked as in use. The file uses
+ * extents. It is either one extent held in the inode, or has each block in a
+ * separate extent, in the reverse order, held in a leaf block below the
+ * inode. The inode size also changes, so that a stale mount cannot read the
+ * file.
+ *
+ * @dst: Buffer of FS_TEST_IMG_SIZE bytes
+ * @data: Contents of the file
+ * @size: Size of the file, at most FS_TEST_FILE_SIZE
+ * @frag: true to fragment the file
+ */
+static void fs_test_create_ext(void *dst, const char *data, int size,
+			       bool frag)
+{
+	const int block_size = EXT2_MIN_BLOCK_SIZE, inode_table = 3;
+	const int root_block = 7, leaf_block = 8, file_block = 9;
+	int inode_size = frag ? 256 : sizeof(struct ext2_inode);
+	int blocks = DIV_ROUND_UP(size, block_size);
+	struct ext2_sblock *sblock = dst + block_size;
+	struct ext2_block_group *bg = dst + 2 * block_size;
+	struct ext2_inode *root_inode = dst + inode_table * block_size +
+		(EXT2_ROOT_INO - 1) * inode_size;
+	struct ext2_inode *file_inode = dst + inode_table * block_size +
+		(EXT2_BOOT_LOADER_INO - 1) * inode_size;
+	struct ext4_extent_header *ext_block = (void *)&file_inode->b;
+	struct ext4_extent_header *leaf = dst + leaf_block * block_size;
+	struct ext4_extent_idx *index = (void *)(ext_block + 1);
+	struct ext4_extent *extent;
+	struct ext2_dirent *dirent = dst + root_block * block_size;
+	int i, blk;
+
+	memset(dst, '\0', FS_TEST_IMG_SIZE);
+	sblock->total_inodes = cpu_to_le32(8);
+	sblock->total_blocks = cpu_to_le32(FS_TEST_IMG_SIZE / block_size);
+	sblock->first_data_block = cpu_to_le32(1);
+	sblock->blocks_per_group = sblock->total_blocks;
+	sblock->fragments_per_group = sblock->total_blocks;
+	sblock->inodes_per_group = sblock->total_inodes;
+	sblock->magic = cpu_to_le16(EXT2_MAGIC);
+	sblock->revision_level = cpu_to_le32(EXT2_DYNAMIC_REV);
+	sblock->first_inode = cpu_to_le32(EXT2_GOOD_OLD_FIRST_INO);
+	sblock->inode_size = cpu_to_le16(inode_size);
+	sblock->feature_incompat = cpu_to_le32(EXT4_FEATURE_INCOMPAT_EXTENTS);
+
+	bg->block_id = cpu_to_le32(5);
+	bg->inode_id = cpu_to_le32(6);
+	bg->inode_table_id = cpu_to_le32(inode_table);
+	memset(dst + 5 * block_size, 0xff, 2 * block_size);
+
+	root_inode->mode = cpu_to_le16(S_IFDIR | 0755);
+	root_inode->size = cpu_to_le32(block_size);
+	root_inode->nlinks = cpu_to_le16(2);
+	root_inode->blockcnt = cpu_to_le32(block_size / 512);
+	root_inode->b.blocks.dir_blocks[0] = cpu_to_le32(root_block);
+
+	dirent->inode = cpu_to_le32(EXT2_BOOT_LOADER_INO);
+	dirent->direntlen = cpu_to_le16(block_size);
+	dirent->namelen = strlen("test.bin");
+	dirent->filetype = FILETYPE_REG;
+	memcpy(dirent + 1, "test.bin", dirent->namelen);
+
+	file_inode->mode = cpu_to_le16(S_IFREG | 0644);
+	file_inode->size = cpu_to_le32(size);
+	file_inode->nlinks = cpu_to_le16(1);
+	file_inode->flags = cpu_to_le32(EXT4_EXTENTS_FL);
+	ext_block->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+	ext_block->eh_entries = cpu_to_le16(1);
+	ext_block->eh_max = cpu_to_le16(sizeof(file_inode->b) /
+					sizeof(*ext_block) - 1);
+	if (frag) {
+		ext_block->eh_depth = cpu_to_le16(1);
+		index->ei_leaf_lo = cpu_to_le32(leaf_block);
+		leaf->eh_magic = cpu_to_le16(EXT4_EXT_MAGIC);
+		leaf->eh_entries = cpu_to_le16(blocks);
+		leaf->eh_max = cpu_to_le16((block_size - sizeof(*leaf)) /
+					   sizeof(*extent));
+		extent = (void *)(leaf + 1);
+	} else {
+		extent = (void *)index;
+	}
+
+	for (i = 0; i < blocks; i++) {
+		blk = frag ? file_block + 2 * (blocks - 1 - i) : file_block + i;
+		memcpy(dst + blk * block_size, data + i * block_size,
+		       min(size - i * block_size, block_size));
+		if (frag || !i) {
+			extent->ee_block = cpu_to_le32(i);
+			extent->ee_len = cpu_to_le16(frag ? 1 : blocks);
+			extent->ee_start_lo = cpu_to_le32(blk);
+			extent++;
+		}
+	}
+	file_inode->blockcnt = cpu_to_le32((blocks + frag) * block_size / 512);
+}
+
+/* Add an uncompressed SquashFS metadata block at @pos, returning the end */
+static int fs_test_sqfs_meta(char *dst, int pos, const void *src, int len)
+{
+	put_unaligned_le16(len | BIT(15), dst + pos);
+	memcpy(dst + pos + SQFS_HEADER_SIZE, src, len);
+
+	return pos + SQFS_HEADER_SIZE + len;
+}
+
+/**
+ * fs_test_create_sqfs() - Create a SquashFS filesystem
+ *
+ * Budget mksquashfs, with nothing compressed and 4KiB blocks. The root
+ * directory holds /test.bin, whose tail is in a fragment, and /small.bin,
+ * which is the first FS_TEST_SMALL_SIZE bytes of @data and is entirely in the
+ * same fragment. So reading both only needs the fragment block once.
+ *
+ * @dst: Buffer of FS_TEST_IMG_SIZE bytes
+ * @data: Contents of /test.bin
+ * @size: Size of /test.bin, which must not be a multiple of the block size,
+ *	nor leave too little space in its last block for /small.bin
+ */
+static void fs_test_create_sqfs(char *dst, const char *data, int size)
+{
+	const int block_size = SZ_4K, data_start = DEFAULT_BLKSZ;
+	struct squashfs_super_block *sblk = (void *)dst;
+	int blocks = size / block_size, tail = size % block_size;
+	struct squashfs_fragment_block_entry frag = {};
+	struct squashfs_directory_header dir_hdr = {};
+	struct squashfs_directory_entry *entry;
+	struct squashfs_reg_inode *reg;
+	struct squashfs_dir_inode *dir;
+	char inodes[256] = {}, dirs[64] = {};
+	int ipos = 0, dpos = 0, pos, frag_pos, i;
+	u32 zero = 0;
+	u64 ptr;
+
+	memset(dst, '\0', FS_TEST_IMG_SIZE);
+
+	/* the full blocks of test.bin, then the fragment holding both tails */
+	memcpy(dst + data_start, data, size);
+	frag_pos = data_start + blocks * block_size;
+	memcpy(dst + frag_pos + tail, data, FS_TEST_SMALL_SIZE);
+	frag.start = frag_pos;
+	frag.size = (tail + FS_TEST_SMALL_SIZE) | BIT(24);
+
+	/* inode 1 is test.bin, inode 2 is small.bin and inode 3 is the root */
+	for (i = 0; i < 2; i++) {
+		reg = (void *)inodes + ipos;
+		reg->inode_type = cpu_to_le16(SQFS_REG_TYPE);
+		reg->mode = cpu_to_le16(0644);
+		reg->inode_number = cpu_to_le32(i + 1);
+		reg->start_block = cpu_to_le32(i ? 0 : data_start);
+		reg->fragment = 0;
+		reg->offset = cpu_to_le32(i ? tail : 0);
+		reg->file_size = cpu_to_le32(i ? FS_TEST_SMALL_SIZE : size);
+		ipos += sizeof(*reg);
+		for (; !i && blocks--; ipos += sizeof(u32))
+			put_unaligned_le32(block_size | BIT(24), inodes + ipos);
+	}
+
+	/* the root listing, in name order */
+	dir_hdr.count = 1;
+	dir_hdr.inode_number = 1;
+	memcpy(dirs, &dir_hdr, sizeof(dir_hdr));
+	dpos = sizeof(dir_hdr);
+	for (i = 0; i < 2; i++) {
+		const char *name = i ? "test.bin" : "small.bin";
+
+		entry = (void *)dirs + dpos;
+		entry->offset = i ? 0 : ipos - sizeof(*reg);
+		entry->inode_offset = !i;
+		entry->type = SQFS_REG_TYPE;
+		entry->name_size = strlen(name) - 1;
+		memcpy(entry->name, name, strlen(name));
+		dpos += sizeof(*entry) + strlen(name);
+	}
+
+	dir = (void *)inodes + ipos;
+	dir->inode_type = cpu_to_le16(SQFS_DIR_TYPE);
+	dir->mode = cpu_to_le16(0755);
+	dir->inode_number = cpu_to_le32(3);
+	dir->nlink = cpu_to_le32(2);
+	dir->file_size = cpu_to_le16(dpos + SQFS_EMPTY_FILE_SIZE);
+	dir->parent_inode = cpu_to_le32(4);
+	put_unaligned_le64(ipos, &sblk->root_inode);
+	ipos += sizeof(*dir);
+
+	/* then the tables, each metadata block followed by its index */
+	pos = frag_pos + tail + FS_TEST_SMALL_SIZE;
+	put_unaligned_le64(pos, &sblk->inode_table_start);
+	pos = fs_test_sqfs_meta(dst, pos, inodes, ipos);
+	put_unaligned_le64(pos, &sblk->directory_table_start);
+	pos = fs_test_sqfs_meta(dst, pos, dirs, dpos);
+	ptr = pos;
+	pos = fs_test_sqfs_meta(dst, pos, &frag, sizeof(frag));
+	put_unaligned_le64(pos, &sblk->fragment_table_start);
+	put_unaligned_le64(ptr, dst + pos);
+	ptr = pos + sizeof(ptr);
+	pos = fs_test_sqfs_meta(dst, ptr, &zero, sizeof(zero));
+	put_unaligned_le64(pos, &sblk->id_table_start);
+	put_unaligned_le64(ptr, dst + pos);
+	put_unaligned_le64(pos + sizeof(ptr), &sblk->bytes_used);
+
+	sblk->s_magic = cpu_to_le32(SQFS_MAGIC_NUMBER);
+	sblk->inodes = cpu_to_le32(3);
+	sblk->block_size = cpu_to_le32(block_size);
+	sblk->fragments = cpu_to_le32(1);
+	sblk->compression = cpu_to_le16(1);	/* zlib, but nothing is compressed */
+	sblk->block_log = cpu_to_le16(ilog2(block_size));
+	sblk->no_ids = cpu_to_le16(1);
+	sblk->s_major = cpu_to_le16(4);
+	put_unaligned_le64(~0ULL, &sblk->xattr_id_table_start);
+	put_unaligned_le64(~0ULL, &sblk->export_table_start);
+}
+
+/*
+ * Create a disk with an MBR and two partitions, each FS_TEST_IMG_SIZE bytes,
+ * with the contents of @img0 and @img1. @dst is 3 * FS_TEST_IMG_SIZE bytes.
+ */
+static void fs_test_create_disk(char *dst, const char *img0, const char *img1)
+{
+	const int blks = FS_TEST_IMG_SIZE / DEFAULT_BLKSZ;
+	char *entry;
+	int i;
+
+	memset(dst, '\0', DEFAULT_BLKSZ);
+	for (i = 0; i < 2; i++) {
+		entry = dst + 0x1be + i * 16;
+		entry[4] = 0x83;	/* the type is not checked */
+		put_unaligned_le32((i + 1) * blks, entry + 8);
+		put_unaligned_le32(blks, entry + 12);
+	}
+	memcpy(dst + 0x1fe, "\x55\xAA", 2);
+	memcpy(dst + FS_TEST_IMG_SIZE, img0, FS_TEST_IMG_SIZE);
+	memcpy(dst + 2 * FS_TEST_IMG_SIZE, img1, FS_TEST_IMG_SIZE);
+}
+
+/* Create a block device called @label whose @size bytes are at @img */
+static int fs_test_dev(struct unit_test_state *uts, const char *label,
+		       void *img, int size, struct udevice **devp,
+		       struct blk_desc **descp)
+{
+	struct udevice *blk;
+
+	ut_assertok(blkmap_create(label, devp));
+	ut_assertok(blk_get_from_parent(*devp, &blk));
+	ut_assertok(blkmap_map_mem(*devp, 0, size / DEFAULT_BLKSZ, img));
+	ut_assertok(device_probe(blk));
+	*descp = dev_get_uclass_plat(blk);
+
+	return 0;
+}
+
+/*
+ * Check that /test.bin in partition @part of @desc holds @data, reading it
+ * whole and in part
+ */
+static int fs_test_check_part(struct unit_test_state *uts,
+			      struct blk_desc *desc, int part,
+			      const char *data, int size, char *buf)
+{
+	loff_t actual;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, part));
+	ut_assertok(fs_size("/test.bin", &actual));
+	ut_asserteq(size, actual);
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, part));
+	memset(buf, '\0', size);
+	ut_assertok(fs_read("/test.bin", map_to_sysmem(buf), 0, 0, &actual));
+	ut_asserteq(size, actual);
+	ut_asserteq_mem(data, buf, size);
+
+	/* this starts part-way along the cluster chain or extent list */
+	ut_assertok(fs_set_blk_dev_with_part(desc, part));
+	ut_assertok(fs_read("/test.bin", map_to_sysmem(buf), 5000, 3000,
+			    &actual));
+	ut_asserteq(3000, actual);
+	ut_asserteq_mem(data + 5000, buf, 3000);
+
+	return 0;
+}
+
+/* Check that /test.bin on the whole of @desc holds @data */
+static int fs_test_check(struct unit_test_state *uts, struct blk_desc *desc,
+			 const char *data, int size, char *buf)
+{
+	return fs_test_check_part(uts, desc, 0, data, size, buf);
+}
+
+/* Test that FAT does not use its cached state after a write or a change */
+static int dm_test_fs_fat_cache(struct unit_test_state *uts)
+{
+	const int size = FS_TEST_FILE_SIZE, blks = FS_TEST_IMG_SIZE /
+		DEFAULT_BLKSZ;
+	char *img[2], *data[2], *alt, *disk, *buf;
+	struct blk_desc *desc[2], *disk_desc;
+	struct udevice *dev[2], *disk_dev;
+	loff_t actual;
+	ulong mem;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(FS_FAT))
+		return -EAGAIN;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	alt = malloc(FS_TEST_IMG_SIZE);
+	ut_assertnonnull(alt);
+	for (i = 0; i < 2; i++) {
+		img[i] = malloc(FS_TEST_IMG_SIZE);
+		ut_assertnonnull(img[i]);
+		data[i] = malloc(size);
+		ut_assertnonnull(data[i]);
+		fs_test_fill(data[i], size, 0x10 + i * 0x40);
+		fs_test_create_fat(img[i], data[i], size, i);
+	}
+	disk = malloc(3 * FS_TEST_IMG_SIZE);
+	ut_assertnonnull(disk);
+	fs_test_create_disk(disk, img[0], img[1]);
+	ut_assertok(fs_test_dev(uts, "fat0", img[0], FS_TEST_IMG_SIZE, &dev[0],
+				&desc[0]));
+	ut_assertok(fs_test_dev(uts, "fat1", img[1], FS_TEST_IMG_SIZE, &dev[1],
+				&desc[1]));
+	ut_assertok(fs_test_dev(uts, "fatdisk", disk, 3 * FS_TEST_IMG_SIZE,
+				&disk_dev, &disk_desc));
+
+	/* switch between the two, with different layouts of the file */
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	ut_assertok(fs_test_check(uts, desc[1], data[1], size, buf));
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+
+	/* the cache memory is reused, not allocated again */
+	mem = ut_check_free();
+	ut_assertok(fs_test_check(uts, desc[1], data[1], size, buf));
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	ut_assertok(ut_check_delta(mem));
+
+	/* and between two partitions on one device */
+	ut_assertok(fs_test_check_part(uts, disk_desc, 1, data[0], size, buf));
+	ut_assertok(fs_test_check_part(uts, disk_desc, 2, data[1], size, buf));
+	ut_assertok(fs_test_check_part(uts, disk_desc, 1, data[0], size, buf));
+
+	/* rewrite the first with the file fragmented, then unfragmented */
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	fs_test_create_fat(alt, data[1], size, true);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check(uts, desc[0], data[1], size, buf));
+	fs_test_create_fat(alt, data[0], size - 2000, false);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size - 2000, buf));
+
+	/* change the file through the filesystem */
+	if (IS_ENABLED(CONFIG_FAT_WRITE)) {
+		ut_assertok(fs_set_blk_dev_with_part(desc[1], 0));
+		ut_assertok(fs_write("/test.bin", map_to_sysmem(data[0]), 0,
+				     size, &actual));
+		ut_asserteq(size, actual);
+		ut_assertok(fs_test_check(uts, desc[1], data[0], size, buf));
+	}
+
+	fs_drop_mount();
+	ut_assertok(blkmap_destroy(disk_dev));
+	ut_assertok(blkmap_destroy(dev[1]));
+	ut_assertok(blkmap_destroy(dev[0]));
+	for (i = 0; i < 2; i++) {
+		free(data[i]);
+		free(img[i]);
+	}
+	free(disk);
+	free(alt);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_fat_cache, 0);
+
+/*
+ * Change the first block of the device at @img behind the back of the block
+ * layer, so that filesystems only see it if they read it again
+ */
+static void fs_test_poke(struct blk_desc *desc, char *img, const char *block)
+{
+	memcpy(img, block, DEFAULT_BLKSZ);
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+}
+
+/* Test that the mount is kept between commands, but not used when stale */
+static int dm_test_fs_mount_cache(struct unit_test_state *uts)
+{
+	const int size = FS_TEST_FILE_SIZE, blks = FS_TEST_IMG_SIZE /
+		DEFAULT_BLKSZ;
+	char *img[2], *data[2], *alt, *buf;
+	char zero[DEFAULT_BLKSZ] = { };
+	struct blk_desc *desc[2];
+	struct udevice *dev[2];
+	int i;
+
+	if (!CONFIG_IS_ENABLED(FS_MOUNT_CACHE) || !CONFIG_IS_ENABLED(FS_FAT))
+		return -EAGAIN;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	alt = malloc(FS_TEST_IMG_SIZE);
+	ut_assertnonnull(alt);
+	for (i = 0; i < 2; i++) {
+		img[i] = malloc(FS_TEST_IMG_SIZE);
+		ut_assertnonnull(img[i]);
+		data[i] = malloc(size);
+		ut_assertnonnull(data[i]);
+		fs_test_fill(data[i], size, 0x20 + i * 0x40);
+		fs_test_create_fat(img[i], data[i], size, i);
+	}
+	ut_assertok(fs_test_dev(uts, "mnt0", img[0], FS_TEST_IMG_SIZE, &dev[0],
+				&desc[0]));
+	ut_assertok(fs_test_dev(uts, "mnt1", img[1], FS_TEST_IMG_SIZE, &dev[1],
+				&desc[1]));
+	fs_test_create_fat(alt, data[0], size, false);
+
+	/* with the mount kept, the boot sector is not read again */
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	fs_test_poke(desc[0], img[0], zero);
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+
+	/* selecting another device drops it */
+	ut_assertok(fs_test_check(uts, desc[1], data[1], size, buf));
+	ut_asserteq(-1, fs_set_blk_dev_with_part(desc[0], 0));
+
+	/* so does a write to any device, and the new contents are seen */
+	fs_test_poke(desc[0], img[0], alt);
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	fs_test_create_fat(alt, data[1], size, true);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check(uts, desc[0], data[1], size, buf));
+	fs_test_poke(desc[0], img[0], zero);
+	ut_assertok(fs_set_blk_dev_with_part(desc[0], 0));
+	fs_close();
+	ut_asserteq(1, blk_dwrite(desc[1], 0, 1, img[1]));
+	ut_asserteq(-1, fs_set_blk_dev_with_part(desc[0], 0));
+
+	/* and so does fs_drop_mount() */
+	fs_test_poke(desc[0], img[0], alt);
+	ut_assertok(fs_test_check(uts, desc[0], data[1], size, buf));
+	fs_test_poke(desc[0], img[0], zero);
+	fs_drop_mount();
+	ut_asserteq(-1, fs_set_blk_dev_with_part(desc[0], 0));
+
+	ut_assertok(blkmap_destroy(dev[1]));
+	ut_assertok(blkmap_destroy(dev[0]));
+	for (i = 0; i < 2; i++) {
+		free(data[i]);
+		free(img[i]);
+	}
+	free(alt);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_mount_cache, 0);
+
+/* Test that ext4 does not use cached extent blocks after a write or a change */
+static int dm_test_fs_ext4_extents(struct unit_test_state *uts)
+{
+	const int size = FS_TEST_FILE_SIZE, blks = FS_TEST_IMG_SIZE /
+		DEFAULT_BLKSZ;
+	char *img[2], *data[2], *alt, *disk, *buf;
+	struct blk_desc *desc[2], *disk_desc;
+	struct udevice *dev[2], *disk_dev;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(FS_EXT4))
+		return -EAGAIN;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	alt = malloc(FS_TEST_IMG_SIZE);
+	ut_assertnonnull(alt);
+	for (i = 0; i < 2; i++) {
+		img[i] = malloc(FS_TEST_IMG_SIZE);
+		ut_assertnonnull(img[i]);
+		data[i] = malloc(size);
+		ut_assertnonnull(data[i]);
+		fs_test_fill(data[i], size, 0x30 + i * 0x40);
+		fs_test_create_ext(img[i], data[i], size, !i);
+	}
+	disk = malloc(3 * FS_TEST_IMG_SIZE);
+	ut_assertnonnull(disk);
+	fs_test_create_disk(disk, img[1], img[0]);
+	ut_assertok(fs_test_dev(uts, "ext0", img[0], FS_TEST_IMG_SIZE, &dev[0],
+				&desc[0]));
+	ut_assertok(fs_test_dev(uts, "ext1", img[1], FS_TEST_IMG_SIZE, &dev[1],
+				&desc[1]));
+	ut_assertok(fs_test_dev(uts, "extdisk", disk, 3 * FS_TEST_IMG_SIZE,
+				&disk_dev, &disk_desc));
+
+	/* switch between the two, one with a leaf block and one without */
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	ut_assertok(fs_test_check(uts, desc[1], data[1], size, buf));
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+
+	/* and between two partitions on one device */
+	ut_assertok(fs_test_check_part(uts, disk_desc, 1, data[1], size, buf));
+	ut_assertok(fs_test_check_part(uts, disk_desc, 2, data[0], size, buf));
+	ut_assertok(fs_test_check_part(uts, disk_desc, 1, data[1], size, buf));
+
+	/* rewrite the device, dropping and then changing the leaf block */
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size, buf));
+	fs_test_create_ext(alt, data[1], size, false);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check(uts, desc[0], data[1], size, buf));
+	fs_test_create_ext(alt, data[0], size - 2000, true);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check(uts, desc[0], data[0], size - 2000, buf));
+
+	fs_drop_mount();
+	ut_assertok(blkmap_destroy(disk_dev));
+	ut_assertok(blkmap_destroy(dev[1]));
+	ut_assertok(blkmap_destroy(dev[0]));
+	for (i = 0; i < 2; i++) {
+		free(data[i]);
+		free(img[i]);
+	}
+	free(disk);
+	free(alt);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_ext4_extents, 0);
+
+/*
+ * Check that /test.bin in partition @part of @desc holds @data and that
+ * /small.bin holds its start
+ */
+static int fs_test_check_sqfs(struct unit_test_state *uts,
+			      struct blk_desc *desc, int part,
+			      const char *data, int size, char *buf)
+{
+	loff_t actual;
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, part));
+	ut_assertok(fs_size("/test.bin", &actual));
+	ut_asserteq(size, actual);
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, part));
+	memset(buf, '\0', size);
+	ut_assertok(fs_read("/test.bin", map_to_sysmem(buf), 0, 0, &actual));
+	ut_asserteq(size, actual);
+	ut_asserteq_mem(data, buf, size);
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, part));
+	memset(buf, '\0', FS_TEST_SMALL_SIZE);
+	ut_assertok(fs_read("/small.bin", map_to_sysmem(buf), 0, 0, &actual));
+	ut_asserteq(FS_TEST_SMALL_SIZE, actual);
+	ut_asserteq_mem(data, buf, FS_TEST_SMALL_SIZE);
+
+	return 0;
+}
+
+/* Test that SquashFS does not use its cached tables and fragments when stale */
+static int dm_test_fs_squashfs_cache(struct unit_test_state *uts)
+{
+	const int size = FS_TEST_FILE_SIZE - 1000, blks = FS_TEST_IMG_SIZE /
+		DEFAULT_BLKSZ;
+	char *img[2], *data[2], *alt, *disk, *buf;
+	struct blk_desc *desc[2], *disk_desc;
+	struct udevice *dev[2], *disk_dev;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(FS_SQUASHFS))
+		return -EAGAIN;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	alt = malloc(FS_TEST_IMG_SIZE);
+	ut_assertnonnull(alt);
+	for (i = 0; i < 2; i++) {
+		img[i] = malloc(FS_TEST_IMG_SIZE);
+		ut_assertnonnull(img[i]);
+		data[i] = malloc(size);
+		ut_assertnonnull(data[i]);
+		fs_test_fill(data[i], size, 0x40 + i * 0x40);
+		fs_test_create_sqfs(img[i], data[i], size - i * 2000);
+	}
+	disk = malloc(3 * FS_TEST_IMG_SIZE);
+	ut_assertnonnull(disk);
+	fs_test_create_disk(disk, img[0], img[1]);
+	ut_assertok(fs_test_dev(uts, "sqfs0", img[0], FS_TEST_IMG_SIZE,
+				&dev[0], &desc[0]));
+	ut_assertok(fs_test_dev(uts, "sqfs1", img[1], FS_TEST_IMG_SIZE,
+				&dev[1], &desc[1]));
+	ut_assertok(fs_test_dev(uts, "sqfsdisk", disk, 3 * FS_TEST_IMG_SIZE,
+				&disk_dev, &disk_desc));
+
+	/* switch between the two, which have tables in different places */
+	ut_assertok(fs_test_check_sqfs(uts, desc[0], 0, data[0], size, buf));
+	ut_assertok(fs_test_check_sqfs(uts, desc[1], 0, data[1], size - 2000,
+				       buf));
+	ut_assertok(fs_test_check_sqfs(uts, desc[0], 0, data[0], size, buf));
+
+	/* and between two partitions on one device */
+	ut_assertok(fs_test_check_sqfs(uts, disk_desc, 1, data[0], size, buf));
+	ut_assertok(fs_test_check_sqfs(uts, disk_desc, 2, data[1],
+				       size - 2000, buf));
+	ut_assertok(fs_test_check_sqfs(uts, disk_desc, 1, data[0], size, buf));
+
+	/* rewrite the device with the fragment in the same place, then not */
+	ut_assertok(fs_test_check_sqfs(uts, desc[0], 0, data[0], size, buf));
+	fs_test_create_sqfs(alt, data[1], size);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check_sqfs(uts, desc[0], 0, data[1], size, buf));
+	fs_test_create_sqfs(alt, data[0], size - 2000);
+	ut_asserteq(blks, blk_dwrite(desc[0], 0, blks, alt));
+	ut_assertok(fs_test_check_sqfs(uts, desc[0], 0, data[0], size - 2000,
+				       buf));
+
+	fs_drop_mount();
+	ut_assertok(blkmap_destroy(disk_dev));
+	ut_assertok(blkmap_destroy(dev[1]));
+	ut_assertok(blkmap_destroy(dev[0]));
+	for (i = 0; i < 2; i++) {
+		free(data[i]);
+		free(img[i]);
+	}
+	free(disk);
+	free(alt);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_fs_squashfs_cache, 0);
@@ -5,11 +5,20 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <mmc.h>
 #include <part.h>
+#include <asm/test.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
+#include <dm/root.h>
 #include <dm/test.h>
+#include <linux/delay.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <u-boot/crc.h>
+#include "../../drivers/mmc/mmc_private.h"
 
 /*
  * Basic test of the mmc uclass. We could expand this by implementing an MMC
@@ -52,3 +61,248 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Bind and probe the emulated eMMC, which is disabled in the device tree */
+static __maybe_unused int probe_emmc(struct unit_test_state *uts,
+				     struct udevice **devp)
+{
+	struct udevice *dev;
+	ofnode node;
+
+	node = ofnode_path("/mmc7");
+	ut_assert(ofnode_valid(node));
+	ut_assertok(lists_bind_fdt(dm_root(), node, &dev, NULL, false));
+	ut_assertok(device_probe(dev));
+	*devp = dev;
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(MMC_CQE)
+/* Test that large transfers to an eMMC use the command queue */
+static int dm_test_mmc_cqe(struct unit_test_state *uts)
+{
+	const int count = 1000;	/* 16 tasks of up to 64 blocks */
+	int requests, tasks, entries, i;
+	struct blk_desc *dev_desc;
+	char *write, *read;
+	struct udevice *dev, *blk;
+	struct mmc *mmc;
+
+	ut_assertok(probe_emmc(uts, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(!IS_SD(mmc));
+	ut_asserteq(MMC_VERSION_5_1, mmc->version);
+	ut_asserteq(8, mmc->cmdq_depth);
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	dev_desc = dev_get_uclass_plat(blk);
+	ut_asserteq(512, dev_desc->blksz);
+
+	write = malloc(count * 512);
+	read = malloc(count * 512);
+	ut_assertnonnull(write);
+	ut_assertnonnull(read);
+	for (i = 0; i < count * 512; i++)
+		write[i] = i * 7 + i / 512;
+
+	/*
+	 * Each direction needs two requests of eight tasks. The card stays in
+	 * command queue mode from one transfer to the next.
+	 */
+	ut_asserteq(count, blk_dwrite(dev_desc, 0, count, write));
+	sandbox_mmc_get_cqe_stats(dev, &requests, &tasks, &entries);
+	ut_asserteq(2, requests);
+	ut_asserteq(16, tasks);
+	ut_asserteq(1, entries);
+	ut_assert(mmc->cmdq_en);
+
+	memset(read, '\0', count * 512);
+	ut_asserteq(count, blk_dread(dev_desc, 0, count, read));
+	ut_asserteq_mem(write, read, count * 512);
+	sandbox_mmc_get_cqe_stats(dev, &requests, &tasks, &entries);
+	ut_asserteq(4, requests);
+	ut_asserteq(32, tasks);
+	ut_asserteq(1, entries);
+
+	/*
+	 * Small transfers use normal commands, which the emulator rejects
+	 * unless the card has been taken out of command queue mode again
+	 */
+	memset(read, '\0', 4 * 512);
+	ut_asserteq(4, blk_dread(dev_desc, 8, 4, read));
+	ut_asserteq_mem(&write[8 * 512], read, 4 * 512);
+	sandbox_mmc_get_cqe_stats(dev, &requests, &tasks, &entries);
+	ut_asserteq(4, requests);
+	ut_assert(!mmc->cmdq_en);
+
+	/* A failed request is retried with normal commands */
+	sandbox_mmc_set_cqe_fail(dev, false, true);
+	memset(read, '\0', count * 512);
+	ut_asserteq(count, blk_dread(dev_desc, 0, count, read));
+	ut_asserteq_mem(write, read, count * 512);
+	sandbox_mmc_get_cqe_stats(dev, &requests, &tasks, &entries);
+	ut_asserteq(4, requests);
+	ut_asserteq(2, entries);
+	ut_assert(!mmc->cmdq_en);
+	ut_asserteq(8, mmc->cmdq_depth);
+
+	/* If the queue cannot be enabled, it is not tried again */
+	sandbox_mmc_set_cqe_fail(dev, true, false);
+	for (i = 0; i < count * 512; i++)
+		write[i] = i * 3 + i / 512;
+	ut_asserteq(count, blk_dwrite(dev_desc, 0, count, write));
+	ut_asserteq(0, mmc->cmdq_depth);
+	sandbox_mmc_set_cqe_fail(dev, false, false);
+	memset(read, '\0', count * 512);
+	ut_asserteq(count, blk_dread(dev_desc, 0, count, read));
+	ut_asserteq_mem(write, read, count * 512);
+	sandbox_mmc_get_cqe_stats(dev, &requests, &tasks, &entries);
+	ut_asserteq(4, requests);
+	ut_asserteq(3, entries);
+
+	free(read);
+	free(write);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cqe, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_MODE_CACHE)
+/* Write a bus mode record to the eMMC and start it again */
+static int mode_cache_restart(struct unit_test_state *uts, struct mmc *mmc,
+			      struct mmc_mode_rec *rec)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, MMC_MAX_BLOCK_LEN);
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+
+	memset(buf, '\0', MMC_MAX_BLOCK_LEN);
+	memcpy(buf, rec, sizeof(*rec));
+	ut_asserteq(1, blk_dwrite(desc, CONFIG_MMC_MODE_CACHE_SECTOR, 1, buf));
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+
+	return 0;
+}
+
+/* Read the bus mode record from the eMMC */
+static int mode_cache_read(struct unit_test_state *uts, struct mmc *mmc,
+			   struct mmc_mode_rec *rec)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, MMC_MAX_BLOCK_LEN);
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+
+	ut_asserteq(1, blk_dread(desc, CONFIG_MMC_MODE_CACHE_SECTOR, 1, buf));
+	memcpy(rec, buf, sizeof(*rec));
+
+	return 0;
+}
+
+static void mode_cache_fill(struct mmc_mode_rec *rec, uint caps,
+			    enum bus_mode mode, uint width)
+{
+	memset(rec, '\0', sizeof(*rec));
+	rec->magic = cpu_to_le32(MMC_MODE_REC_MAGIC);
+	rec->caps = cpu_to_le32(caps);
+	rec->mode = mode;
+	rec->width = width;
+	rec->crc = cpu_to_le32(crc32(0, (const uchar *)rec,
+				     offsetof(struct mmc_mode_rec, crc)));
+}
+
+/* Test that the eMMC bus mode which worked last time is tried first */
+static int dm_test_mmc_mode_cache(struct unit_test_state *uts)
+{
+	struct mmc_mode_rec rec, expect;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint caps;
+
+	/* the full search picks the fastest mode and records it on the card */
+	ut_assertok(probe_emmc(uts, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_asserteq(MMC_HS_52, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+
+	caps = mmc->card_caps & mmc->host_caps;
+	mode_cache_fill(&expect, caps, MMC_HS_52, 8);
+	ut_assertok(mode_cache_read(uts, mmc, &rec));
+	ut_asserteq_mem(&expect, &rec, sizeof(rec));
+
+	/* a slower mode which is recorded is used, since it works */
+	mode_cache_fill(&expect, caps, MMC_HS, 1);
+	ut_assertok(mode_cache_restart(uts, mmc, &expect));
+	ut_asserteq(MMC_HS, mmc->selected_mode);
+	ut_asserteq(1, mmc->bus_width);
+	ut_assertok(mode_cache_read(uts, mmc, &rec));
+	ut_asserteq_mem(&expect, &rec, sizeof(rec));
+
+	/* a record made with different capabilities is ignored */
+	mode_cache_fill(&rec, caps & ~(uint)MMC_MODE_8BIT, MMC_HS, 1);
+	ut_assertok(mode_cache_restart(uts, mmc, &rec));
+	ut_asserteq(MMC_HS_52, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+	mode_cache_fill(&expect, caps, MMC_HS_52, 8);
+	ut_assertok(mode_cache_read(uts, mmc, &rec));
+	ut_asserteq_mem(&expect, &rec, sizeof(rec));
+
+	/* so is a corrupted one */
+	mode_cache_fill(&rec, caps, MMC_HS, 1);
+	rec.width = 4;
+	ut_assertok(mode_cache_restart(uts, mmc, &rec));
+	ut_asserteq(MMC_HS_52, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_mode_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_INIT_CYCLIC)
+/* Test that an eMMC can power up in the background */
+static int dm_test_mmc_init_cyclic(struct unit_test_state *uts)
+{
+	struct mmc *mmc, *sd;
+	struct udevice *dev;
+	int i;
+
+	ut_assertok(probe_emmc(uts, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+
+	/* the emulated card stays busy for a few polls after a reset */
+	mmc->has_init = 0;
+	ut_assertok(mmc_start_init_cyclic(mmc));
+	ut_assertnonnull(mmc->init_cyclic);
+	ut_asserteq(1, mmc->init_in_progress);
+	ut_asserteq(1, mmc->op_cond_pending);
+	ut_assert(!(mmc->ocr & OCR_BUSY));
+
+	/* the cyclic function polls it while other work is done */
+	for (i = 0; i < 100 && !(mmc->ocr & OCR_BUSY); i++)
+		udelay(2000);
+	ut_assert(mmc->ocr & OCR_BUSY);
+	ut_asserteq(0, mmc->has_init);
+
+	ut_assertok(mmc_init(mmc));
+	ut_assertnull(mmc->init_cyclic);
+	ut_asserteq(1, mmc->has_init);
+	ut_asserteq(0, mmc->init_in_progress);
+	ut_asserteq(MMC_VERSION_5_1, mmc->version);
+
+	/* only the eMMC is started early, not the removable card */
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc0", &dev));
+	sd = mmc_get_mmc_dev(dev);
+	sd->has_init = 0;
+	mmc->has_init = 0;
+	mmc_do_preinit();
+	ut_assertnonnull(mmc->init_cyclic);
+	ut_asserteq(1, mmc->init_in_progress);
+	ut_assertnull(sd->init_cyclic);
+	ut_asserteq(0, sd->init_in_progress);
+	ut_assertok(mmc_init(mmc));
+	ut_assertnull(mmc->init_cyclic);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_init_cyclic, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
@@ -350,6 +350,78 @@ static int dm_test_ofnode_phandle(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_ofnode_phandle, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* test that phandles are found through the phandle table */
+static int dm_test_ofnode_phandle_table(struct unit_test_state *uts)
+{
+	struct ofnode_phandle_args args;
+	struct dm_stats before, after;
+	char buf[64];
+	ofnode node;
+
+	/* An earlier test may have left the table out of date, so update it */
+	node = ofnode_path("/a-test");
+	ut_assertok(ofnode_parse_phandle_with_args(node, "phandle-value", NULL,
+						   1, 0, &args));
+
+	dm_get_mem(&before);
+	ut_assertok(ofnode_parse_phandle_with_args(node, "phandle-value", NULL,
+						   1, 0, &args));
+	ut_asserteq_str("pinmux-gpios", ofnode_get_name(args.node));
+	dm_get_mem(&after);
+	ut_asserteq(before.phandle_lookups + 1, after.phandle_lookups);
+	ut_asserteq(before.phandle_hits + 1, after.phandle_hits);
+
+	/* Adding a property moves all the nodes in a flat tree */
+	memset(buf, '\xff', sizeof(buf));
+	ut_assertok(ofnode_write_prop(ofnode_root(), "padding", buf,
+				      sizeof(buf), true));
+	node = ofnode_path("/a-test");
+	ut_assertok(ofnode_parse_phandle_with_args(node, "phandle-value", NULL,
+						   1, 0, &args));
+	ut_asserteq_str("pinmux-gpios", ofnode_get_name(args.node));
+	ut_assertok(ofnode_parse_phandle_with_args(node, "phandle-value", NULL,
+						   1, 0, &args));
+	ut_asserteq_str("pinmux-gpios", ofnode_get_name(args.node));
+
+	/* The first lookup in a flat tree must search, then update the table */
+	dm_get_mem(&before);
+	ut_asserteq(after.phandle_lookups + 2, before.phandle_lookups);
+	ut_asserteq(after.phandle_hits + (of_live_active() ? 2 : 1),
+		    before.phandle_hits);
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_table, UT_TESTF_SCAN_FDT);
+
+/* test that deleted nodes cannot be found by phandle, using the 'other' tree */
+static int dm_test_ofnode_phandle_delete_ot(struct unit_test_state *uts)
+{
+	oftree otree = get_other_oftree(uts);
+	u32 target_phandle, sub_phandle;
+	ofnode node;
+
+	node = oftree_path(otree, "/target");
+	ut_assertok(ofnode_read_u32(node, "phandle", &target_phandle));
+	ut_assert(ofnode_equal(node,
+			       oftree_get_by_phandle(otree, target_phandle)));
+	node = oftree_path(otree, "/node/subnode");
+	ut_assertok(ofnode_read_u32(node, "phandle", &sub_phandle));
+	ut_assert(ofnode_equal(node,
+			       oftree_get_by_phandle(otree, sub_phandle)));
+
+	node = oftree_path(otree, "/target");
+	ut_assertok(ofnode_delete(&node));
+	ut_assert(!ofnode_valid(oftree_get_by_phandle(otree, target_phandle)));
+
+	/* the nodes below a deleted node go too */
+	node = oftree_path(otree, "/node");
+	ut_assertok(ofnode_delete(&node));
+	ut_assert(!ofnode_valid(oftree_get_by_phandle(otree, sub_phandle)));
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_delete_ot, UT_TESTF_OTHER_FDT);
+
 /* test ofnode_count_/parse_phandle_with_args() with 'other' tree */
 static int dm_test_ofnode_phandle_ot(struct unit_test_state *uts)
 {
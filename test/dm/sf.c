@@ -5,6 +5,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <console.h>
 #include <dm.h>
 #include <fdtdec.h>
 #include <mapmem.h>
@@ -13,6 +14,8 @@
 #include <spi_flash.h>
 #include <asm/state.h>
 #include <asm/test.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/test.h>
 #include <dm/util.h>
 #include <test/test.h>
@@ -75,6 +78,184 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_spi_flash, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+#if CONFIG_IS_ENABLED(SPI_FLASH_READ_CACHE)
+/* Test that small SPI flash reads are served from the read cache */
+static int dm_test_spi_flash_read_cache(struct unit_test_state *uts)
+{
+	struct udevice *dev, *emul;
+	struct spi_flash *flash;
+	int full_size = 0x200000;
+	u8 *src, *dst, buf[0x40];
+	uint count;
+	int i;
+
+	src = map_sysmem(0x20000, full_size);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_EMUL, &emul));
+	flash = dev_get_uclass_priv(dev);
+
+	/* The first small read fills a line, which serves the next one */
+	count = sandbox_sf_get_read_count(emul);
+	ut_assertok(spi_flash_read_dm(dev, 0x10, 0x20, buf));
+	ut_asserteq_mem(src + 0x10, buf, 0x20);
+	ut_asserteq(count + 1, sandbox_sf_get_read_count(emul));
+	ut_assertok(spi_flash_read_dm(dev, 0xc0, 0x40, buf));
+	ut_asserteq_mem(src + 0xc0, buf, 0x40);
+	ut_asserteq(count + 1, sandbox_sf_get_read_count(emul));
+
+	/* A read crossing into the next line only fetches that line */
+	ut_assertok(spi_flash_read_dm(dev, 0xf0, 0x20, buf));
+	ut_asserteq_mem(src + 0xf0, buf, 0x20);
+	ut_asserteq(count + 2, sandbox_sf_get_read_count(emul));
+
+	/* Large reads go straight to the flash */
+	dst = map_sysmem(0x20000 + full_size, full_size);
+	ut_assertok(spi_flash_read_dm(dev, 0, 0x1000, dst));
+	ut_asserteq_mem(src, dst, 0x1000);
+	ut_assert(sandbox_sf_get_read_count(emul) > count + 2);
+
+	/* Erasing and writing drop the cached data */
+	ut_assertok(spi_flash_erase_dm(dev, 0, flash->erase_size));
+	ut_assertok(spi_flash_read_dm(dev, 0x10, 0x20, buf));
+	for (i = 0; i < 0x20; i++)
+		ut_asserteq(0xff, buf[i]);
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i;
+	ut_assertok(spi_flash_write_dm(dev, 0x10, 0x20, buf));
+	memset(buf, '\0', sizeof(buf));
+	ut_assertok(spi_flash_read_dm(dev, 0x10, 0x20, buf));
+	for (i = 0; i < 0x20; i++)
+		ut_asserteq(i, buf[i]);
+
+	/*
+	 * Since we are about to destroy all devices, we must tell sandbox
+	 * to forget the emulation device
+	 */
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_read_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
+#if IS_ENABLED(CONFIG_SPI_FLASH_SFDP_SUPPORT) && \
+	IS_ENABLED(CONFIG_SPI_FLASH_SOFT_RESET)
+/* Check what the flash holds, then erase it and write it again */
+static int check_octal_flash(struct unit_test_state *uts, struct udevice *dev,
+			     u8 *src, u8 *dst, int size, u8 seed)
+{
+	int i;
+
+	ut_assertok(spi_flash_read_dm(dev, 0, size, dst));
+	ut_asserteq_mem(src, dst, size);
+
+	ut_assertok(spi_flash_erase_dm(dev, 0, size));
+	ut_assertok(spi_flash_read_dm(dev, 0, size, dst));
+	for (i = 0; i < size; i++)
+		ut_asserteq(0xff, dst[i]);
+
+	for (i = 0; i < size; i++)
+		src[i] = i + seed;
+	ut_assertok(spi_flash_write_dm(dev, 0, size, src));
+	ut_assertok(spi_flash_read_dm(dev, 0, size, dst));
+	ut_asserteq_mem(src, dst, size);
+
+	return 0;
+}
+
+/* Test that an octal flash is used in 8D-8D-8D mode, or 1S-1S-1S if it can't be */
+static int dm_test_spi_flash_octal_dtr(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	struct udevice *bus, *dev, *emul;
+	struct spi_flash *flash;
+	int full_size = 0x200000;
+	int size = 0x2000;
+	u8 *src, *dst;
+	ofnode node;
+
+	src = map_sysmem(0x20000, full_size);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	dst = map_sysmem(0x20000 + full_size, full_size);
+
+	/* Put the octal flash on chip select 1, with its emulation */
+	ut_assertok(spi_find_bus_and_cs(0, 1, &bus, &dev));
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+	node = dev_read_subnode(bus, "spi.octal@1");
+	ut_assert(ofnode_valid(node));
+	ut_assertok(sandbox_sf_bind_emul(state, 0, 1, bus, node, "octal"));
+	emul = state->spi[0][1].emul;
+	ut_assertok(device_probe(emul));
+
+	/* SFDP tells us the flash supports 8D-8D-8D, and so does the bus */
+	ut_assertok(device_bind_driver_to_node(bus, "jedec_spi_nor", "octal",
+					       node, &dev));
+	ut_assertok(device_probe(dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_8_8_8_DTR, flash->read_proto);
+	ut_asserteq(SNOR_PROTO_8_8_8_DTR, flash->write_proto);
+	ut_asserteq(SNOR_PROTO_8_8_8_DTR, flash->reg_proto);
+	ut_assert(sandbox_sf_get_octal_dtr(emul));
+	ut_assertok(check_octal_flash(uts, dev, src, dst, size, 0));
+
+	/* Removing the flash resets it to 1S-1S-1S */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assert(!sandbox_sf_get_octal_dtr(emul));
+	ut_assertok(device_unbind(dev));
+
+	/* If the flash does not switch, we carry on in 1S-1S-1S */
+	sandbox_sf_refuse_octal_dtr(emul, true);
+	ut_assertok(device_bind_driver_to_node(bus, "jedec_spi_nor", "octal",
+					       node, &dev));
+	ut_assertok(device_probe(dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_1_1_1, flash->read_proto);
+	ut_asserteq(SNOR_PROTO_1_1_1, flash->write_proto);
+	ut_asserteq(SNOR_PROTO_1_1_1, flash->reg_proto);
+	ut_assert(!sandbox_sf_get_octal_dtr(emul));
+	ut_assertok(check_octal_flash(uts, dev, src, dst, size, 0x55));
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+
+	/* ...unless it might be left in 8D-8D-8D with no way to reset it */
+	sandbox_sf_set_octal_sfdp(emul, false, true);
+	ut_assertok(device_bind_driver_to_node(bus, "jedec_spi_nor", "octal",
+					       node, &dev));
+	ut_asserteq(-EOPNOTSUPP, device_probe(dev));
+	ut_assertok(device_unbind(dev));
+
+	/* A flash with no volatile enable bit is not asked to switch at all */
+	sandbox_sf_refuse_octal_dtr(emul, false);
+	sandbox_sf_set_octal_sfdp(emul, true, false);
+	ut_assertok(device_bind_driver_to_node(bus, "jedec_spi_nor", "octal",
+					       node, &dev));
+	console_record_reset_enable();
+	ut_assertok(device_probe(dev));
+	ut_assert_nextlinen("SF: Detected");
+	ut_assert_console_end();
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SNOR_PROTO_1_1_1, flash->read_proto);
+	ut_asserteq(SNOR_PROTO_1_1_1, flash->write_proto);
+	ut_asserteq(SNOR_PROTO_1_1_1, flash->reg_proto);
+	ut_assert(!sandbox_sf_get_octal_dtr(emul));
+	ut_assertok(check_octal_flash(uts, dev, src, dst, size, 0xaa));
+
+	/*
+	 * Removing the flash talks to it, so do that before telling sandbox
+	 * to forget the emulation device
+	 */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	sandbox_sf_unbind_emul(state, 0, 1);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_octal_dtr, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT |
+	UT_TESTF_CONSOLE_REC);
+#endif
+
 /* Functional test that sandbox SPI flash works correctly */
 static int dm_test_spi_flash_func(struct unit_test_state *uts)
 {
@@ -469,6 +469,79 @@ static int lib_test_lmb_overlapping_reserve(struct unit_test_state *uts)
 }
 LIB_TEST(lib_test_lmb_overlapping_reserve, 0);
 
+/* Check that the regions are sorted and never overlap or touch */
+static int check_lmb_disjoint(struct unit_test_state *uts,
+			      struct lmb_region *rgn)
+{
+	struct lmb_property *r;
+	int i;
+
+	for (i = 1; i < rgn->cnt; i++) {
+		r = &rgn->region[i - 1];
+		ut_assert(r->base + r->size <= rgn->region[i].base);
+		if (r->base + r->size == rgn->region[i].base)
+			ut_assert(r->flags != rgn->region[i].flags);
+	}
+
+	return 0;
+}
+
+/* Check that reservations which overlap others never leave overlaps behind */
+static int lib_test_lmb_disjoint(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x20000000;
+	struct lmb lmb;
+	phys_addr_t base;
+	phys_size_t size;
+	u32 seed = 1;
+	int i;
+
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, ram_size));
+
+	/* follows on from one region, overlaps one with other flags */
+	ut_assertok(lmb_reserve_flags(&lmb, 0x40010000, 0x10000, LMB_NOMAP));
+	ut_assertok(lmb_reserve(&lmb, 0x40030000, 0x10000));
+	ut_asserteq(-1, lmb_reserve_flags(&lmb, 0x40020000, 0x18000,
+					  LMB_NOMAP));
+	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40010000, 0x10000,
+		   0x40030000, 0x10000, 0, 0);
+
+	/* follows on from a region with other flags, overlaps another */
+	ut_asserteq(-1, lmb_reserve(&lmb, 0x40020000, 0x18000));
+	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40010000, 0x10000,
+		   0x40030000, 0x10000, 0, 0);
+
+	/* follows on from one region, covers another and overlaps a third */
+	ut_assertok(lmb_reserve(&lmb, 0x40050000, 0x8000));
+	ut_assertok(lmb_reserve(&lmb, 0x40060000, 0x10000));
+	ut_asserteq(3, lmb_reserve(&lmb, 0x40040000, 0x28000));
+	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40010000, 0x10000,
+		   0x40030000, 0x40000, 0, 0);
+	lmb_uninit(&lmb);
+
+	/* reserve and free at random, checking the regions each time */
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, ram_size));
+	for (i = 0; i < 2000; i++) {
+		seed = seed * 1103515245 + 12345;
+		base = ram + (seed >> 8) % 0x400 * 0x1000;
+		seed = seed * 1103515245 + 12345;
+		size = ((seed >> 8) % 0x10 + 1) * 0x1000;
+		if (seed & 0x100)
+			lmb_free(&lmb, base, size);
+		else
+			lmb_reserve_flags(&lmb, base, size,
+					  seed & 0x200 ? LMB_NOMAP : LMB_NONE);
+		ut_assertok(check_lmb_disjoint(uts, &lmb.reserved));
+	}
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_disjoint, 0);
+
 /*
  * Simulate 512 MiB RAM, reserve 3 blocks, allocate addresses in between.
  * Expect addresses outside the memory range to fail.
@@ -700,12 +773,13 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
-	/*  error for the (CONFIG_LMB_MAX_REGIONS + 1) memory regions */
+	/*  the (CONFIG_LMB_MAX_REGIONS + 1) memory region grows the array */
 	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * ram_size;
 	ret = lmb_add(&lmb, offset, ram_size);
-	ut_asserteq(ret, -1);
+	ut_asserteq(ret, 0);
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	ut_assert(lmb.memory.max > CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
 	/*  reserve CONFIG_LMB_MAX_REGIONS regions */
@@ -715,29 +789,120 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 		ut_asserteq(ret, 0);
 	}
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
 	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.reserved.max, CONFIG_LMB_MAX_REGIONS);
 
-	/*  error for the 9th reserved blocks */
+	/*  the (CONFIG_LMB_MAX_REGIONS + 1) reserved block grows the array */
 	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * blk_size;
 	ret = lmb_reserve(&lmb, offset, blk_size);
-	ut_asserteq(ret, -1);
+	ut_asserteq(ret, 0);
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
-	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	ut_assert(lmb.reserved.max > CONFIG_LMB_MAX_REGIONS);
 
 	/*  check each regions */
 	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
 		ut_asserteq(lmb.memory.region[i].base, ram + 2 * i * ram_size);
+	ut_asserteq(lmb.memory.region[i].base, ram + 2 * (i + 1) * ram_size);
 
 	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
 		ut_asserteq(lmb.reserved.region[i].base, ram + 2 * i * blk_size);
+	ut_asserteq(lmb.reserved.region[i].base, ram + 2 * (i + 1) * blk_size);
+
+	lmb_uninit(&lmb);
 
 	return 0;
 }
 LIB_TEST(lib_test_lmb_max_regions, 0);
 #endif
 
+/* Reserve, look up, allocate and coalesce thousands of regions */
+static int lib_test_lmb_many_regions(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x10000000;
+	const phys_size_t stride = 0x10000;
+	const phys_size_t blk_size = 0x1000;
+	const int count = ram_size / stride;
+	phys_addr_t addr;
+	struct lmb lmb;
+	long ret;
+	int i, j;
+
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, ram_size));
+
+	/* reserve a block at the start of each stride, in a scrambled order */
+	for (i = 0; i < count; i++) {
+		j = (i * 0x9e5) % count;
+		ret = lmb_reserve(&lmb, ram + j * stride, blk_size);
+		ut_asserteq(0, ret);
+	}
+	ut_asserteq(count, lmb.reserved.cnt);
+	for (i = 0; i < count; i++) {
+		ut_asserteq(ram + i * stride, lmb.reserved.region[i].base);
+		ut_asserteq(blk_size, lmb.reserved.region[i].size);
+	}
+
+	/* overlapping reservations are refused */
+	ut_asserteq(-1, lmb_reserve(&lmb, ram + 5 * stride - 0x10, 0x20));
+	ut_asserteq(count, lmb.reserved.cnt);
+
+	for (i = 0; i < count; i += 37) {
+		addr = ram + i * stride;
+		ut_asserteq(1, lmb_is_reserved(&lmb, addr + blk_size - 1));
+		ut_asserteq(0, lmb_is_reserved(&lmb, addr + blk_size));
+		ut_asserteq(0, lmb_get_free_size(&lmb, addr));
+		ut_asserteq(stride - blk_size,
+			    lmb_get_free_size(&lmb, addr + blk_size));
+		ut_asserteq(0, lmb_alloc_addr(&lmb, addr + 0x800, blk_size));
+	}
+
+	/* no gap is big enough for this */
+	ut_asserteq(0, __lmb_alloc_base(&lmb, stride, blk_size, 0));
+
+	/* this fits at the top of the highest gap */
+	addr = lmb_alloc(&lmb, blk_size, blk_size);
+	ut_asserteq(ram + ram_size - blk_size, addr);
+	ut_asserteq(count + 1, lmb.reserved.cnt);
+
+	/* this fits below the reserved block under 0x48000000 */
+	addr = lmb_alloc_base(&lmb, blk_size, blk_size, 0x48000800);
+	ut_asserteq(0x48000000 - blk_size, addr);
+	ut_asserteq(count + 1, lmb.reserved.cnt);
+
+	/* fill in all the gaps, which coalesces everything into one region */
+	for (i = 0; i < count; i++) {
+		j = (i * 0x9e5) % count;
+		addr = ram + j * stride + blk_size;
+		if (lmb_is_reserved(&lmb, addr))
+			continue;
+		ret = lmb_reserve(&lmb, addr,
+				  lmb_get_free_size(&lmb, addr));
+		ut_assert(ret > 0);
+	}
+	ut_asserteq(1, lmb.reserved.cnt);
+	ut_asserteq(ram, lmb.reserved.region[0].base);
+	ut_asserteq(ram_size, lmb.reserved.region[0].size);
+
+	/* split it up again */
+	for (i = 0; i < count; i++) {
+		j = (i * 0x9e5) % count;
+		ut_assertok(lmb_free(&lmb, ram + j * stride + blk_size,
+				     stride - blk_size));
+	}
+	ut_asserteq(count, lmb.reserved.cnt);
+	for (i = 0; i < count; i++)
+		ut_asserteq(ram + i * stride, lmb.reserved.region[i].base);
+
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_many_regions, 0);
+
 static int lib_test_lmb_flags(struct unit_test_state *uts)
 {
 	const phys_addr_t ram = 0x40000000;
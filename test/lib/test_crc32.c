@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit test for the ways of calculating CRC32 and CRC32C
+ */
+
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define CRC32_TEST_SIZE	4096
+
+/* Bit-reflected polynomials for CRC32 and CRC32C */
+#define CRC32_POLY	0xedb88320
+#define CRC32C_POLY	0x82f63b78
+
+static uint8_t *crc32_test_data(struct unit_test_state *uts)
+{
+	uint8_t *buf;
+	int i;
+
+	buf = malloc(CRC32_TEST_SIZE + 8);
+	if (buf) {
+		for (i = 0; i < CRC32_TEST_SIZE + 8; i++)
+			buf[i] = i * 73 + (i >> 7);
+	}
+
+	return buf;
+}
+
+/* Bit-at-a-time reference CRC with no pre- or post-inversion */
+static uint32_t crc32_ref(uint32_t poly, uint32_t crc, const uint8_t *buf,
+			  uint len)
+{
+	int bit;
+
+	while (len--) {
+		crc ^= *buf++;
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ (crc & 1 ? poly : 0);
+	}
+
+	return crc;
+}
+
+/* Check that every available CRC32 method agrees with the reference */
+static int lib_crc32_methods(struct unit_test_state *uts)
+{
+	static const uint lens[] = { 0, 1, 7, 15, 16, 63, 64, 65, 100, 128,
+				     1000, CRC32_TEST_SIZE };
+	uint32_t expect, crc;
+	int method, start, i;
+	int found = 0;
+	uint8_t *buf;
+
+	buf = crc32_test_data(uts);
+	ut_assertnonnull(buf);
+
+	ut_asserteq(0xcbf43926, crc32(0, (uint8_t *)"123456789", 9));
+	for (method = 0; method < CRC32_METHOD_COUNT; method++) {
+		if (crc32_method_calc(method, 0, buf, 0, &crc))
+			continue;
+		found++;
+		for (start = 0; start < 8; start++) {
+			for (i = 0; i < ARRAY_SIZE(lens); i++) {
+				expect = crc32_ref(CRC32_POLY, 0x12345678,
+						   buf + start, lens[i]);
+				ut_assertok(crc32_method_calc(method, 0x12345678,
+							      buf + start,
+							      lens[i], &crc));
+				ut_asserteq(expect, crc);
+				ut_asserteq(expect,
+					    crc32_no_comp(0x12345678,
+							  buf + start,
+							  lens[i]));
+			}
+		}
+	}
+	ut_assert(found);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_crc32_methods, 0);
+
+#if CONFIG_IS_ENABLED(CRC32C)
+/* Check that CRC32C agrees with a lookup table */
+static int lib_crc32c(struct unit_test_state *uts)
+{
+	uint32_t table[256], expect;
+	int start, len;
+	uint8_t *buf;
+
+	buf = crc32_test_data(uts);
+	ut_assertnonnull(buf);
+	crc32c_init(table, CRC32C_POLY);
+
+	ut_asserteq(0xe3069283, ~crc32c_cal(~0, "123456789", 9, table));
+	for (start = 0; start < 8; start++) {
+		for (len = 0; len < CRC32_TEST_SIZE; len = len * 2 + 1) {
+			expect = crc32_ref(CRC32C_POLY, ~0, buf + start, len);
+			ut_asserteq(expect, crc32c_cal(~0,
+						       (char *)buf + start,
+						       len, table));
+		}
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_crc32c, 0);
+#endif
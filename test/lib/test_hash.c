@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit test for calculating several hashes together
+ */
+
+#include <command.h>
+#include <hash.h>
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+#define TEST_HASH_SIZE	SZ_256K
+
+static int lib_hash_jobs(struct unit_test_state *uts)
+{
+	static const char *const algos[] = {
+		"sha256", "sha1", "crc32", "sha512", "sha256", "md5", "none",
+	};
+	struct hash_job jobs[ARRAY_SIZE(algos)];
+	uint8_t expect[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	int expect_size;
+	uint8_t *buf;
+	int i;
+
+	buf = malloc(TEST_HASH_SIZE);
+	ut_assertnonnull(buf);
+	for (i = 0; i < TEST_HASH_SIZE; i++)
+		buf[i] = i * 7 + (i >> 9);
+
+	for (i = 0; i < ARRAY_SIZE(algos); i++) {
+		jobs[i].algo_name = algos[i];
+		jobs[i].data = buf + i * 17;
+		jobs[i].size = TEST_HASH_SIZE - i * 1000;
+	}
+	hash_calculate_jobs(jobs, ARRAY_SIZE(algos));
+
+	for (i = 0; i < ARRAY_SIZE(algos); i++) {
+		if (hash_progressive_lookup_algo(algos[i], &algo)) {
+			ut_asserteq(-EPROTONOSUPPORT, jobs[i].ret);
+			continue;
+		}
+		ut_assertok(jobs[i].ret);
+		expect_size = sizeof(expect);
+		ut_assertok(hash_block(algos[i], jobs[i].data, jobs[i].size,
+				       expect, &expect_size));
+		ut_asserteq(expect_size, jobs[i].output_size);
+		ut_asserteq_mem(expect, jobs[i].output, expect_size);
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_hash_jobs, 0);
+
+/* Test that progressive CRCs give the same bytes as hash_block() */
+static int lib_hash_crc_order(struct unit_test_state *uts)
+{
+	static const char data[] = "123456789";
+	static const struct {
+		const char *name;
+		uint8_t value[4];
+		int size;
+	} crcs[] = {
+		{ "crc16-ccitt", { 0x31, 0xc3 }, 2 },
+		{ "crc32", { 0xcb, 0xf4, 0x39, 0x26 }, 4 },
+	};
+	uint8_t value[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	int value_size;
+	void *ctx;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(crcs); i++) {
+		value_size = sizeof(value);
+		ut_assertok(hash_block(crcs[i].name, data, strlen(data), value,
+				       &value_size));
+		ut_asserteq(crcs[i].size, value_size);
+		ut_asserteq_mem(crcs[i].value, value, value_size);
+
+		memset(value, '\0', sizeof(value));
+		ut_assertok(hash_progressive_lookup_algo(crcs[i].name, &algo));
+		ut_assertok(algo->hash_init(algo, &ctx));
+		ut_assertok(algo->hash_update(algo, ctx, data, 4, 0));
+		ut_assertok(algo->hash_update(algo, ctx, data + 4,
+					      strlen(data) - 4, 1));
+		ut_assertok(algo->hash_finish(algo, ctx, value, sizeof(value)));
+		ut_asserteq_mem(crcs[i].value, value, crcs[i].size);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_hash_crc_order, 0);
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit test for SHA-256
+ *
+ * Blocks may be processed with instructions provided by the CPU, or for
+ * several streams at once, so check each way against the generic code.
+ */
+
+#include <malloc.h>
+#include <test/lib.h>
+#include <test/ut.h>
+#include <u-boot/sha256.h>
+
+/* Number of streams to use, enough for more than one group of AVX2 lanes */
+#define SHA256_TEST_STREAMS	9
+#define SHA256_TEST_BLOCKS	5
+
+/* Two-block message from FIPS 180-2, appendix B.2 */
+static const char sha256_msg[] =
+	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+static const uint8_t sha256_expect[SHA256_SUM_LEN] = {
+	0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+	0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+	0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+	0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1,
+};
+
+/* One million 'a' characters, from FIPS 180-2, appendix B.3 */
+static const uint8_t sha256_million_expect[SHA256_SUM_LEN] = {
+	0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92,
+	0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+	0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e,
+	0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0,
+};
+
+static int lib_sha256(struct unit_test_state *uts)
+{
+	const int million = 1000000;
+	uint8_t out[SHA256_SUM_LEN];
+	uint8_t *buf;
+
+	sha256_csum_wd((const uint8_t *)sha256_msg, sizeof(sha256_msg) - 1,
+		       out, CHUNKSZ_SHA256);
+	ut_asserteq_mem(sha256_expect, out, SHA256_SUM_LEN);
+
+	/* many blocks at once, from an unaligned buffer */
+	buf = malloc(million + 1);
+	ut_assertnonnull(buf);
+	memset(buf + 1, 'a', million);
+	sha256_csum_wd(buf + 1, million, out, CHUNKSZ_SHA256);
+	free(buf);
+	ut_asserteq_mem(sha256_million_expect, out, SHA256_SUM_LEN);
+
+	return 0;
+}
+LIB_TEST(lib_sha256, 0);
+
+/*
+ * Set up a different, unaligned stream of data for each context, starting
+ * from a state which is not the initial one
+ */
+static void sha256_test_setup(sha256_context ctx[], sha256_context *ctxp[],
+			      const uint8_t *data[], uint8_t *buf)
+{
+	int i, j;
+
+	for (i = 0; i < SHA256_TEST_STREAMS; i++) {
+		sha256_starts(&ctx[i]);
+		ctx[i].state[i % 8] ^= i * 0x01010101;
+		ctxp[i] = &ctx[i];
+		data[i] = buf + i * (SHA256_TEST_BLOCKS * 64 + 1) + 1;
+	}
+	for (j = 0; j < SHA256_TEST_STREAMS * (SHA256_TEST_BLOCKS * 64 + 1);
+	     j++)
+		buf[j] = j * 13 + (j >> 6);
+}
+
+/* Check that every available way of processing blocks gives the same state */
+static int lib_sha256_methods(struct unit_test_state *uts)
+{
+	static const int counts[] = { 1, 2, 7, 8, SHA256_TEST_STREAMS };
+	sha256_context expect[SHA256_TEST_STREAMS], ctx[SHA256_TEST_STREAMS];
+	sha256_context *expectp[SHA256_TEST_STREAMS];
+	sha256_context *ctxp[SHA256_TEST_STREAMS];
+	const uint8_t *data[SHA256_TEST_STREAMS];
+	int method, blocks, i, j;
+	int found = 0;
+	uint8_t *buf;
+
+	buf = malloc(SHA256_TEST_STREAMS * (SHA256_TEST_BLOCKS * 64 + 1));
+	ut_assertnonnull(buf);
+
+	for (method = 0; method < SHA256_METHOD_COUNT; method++) {
+		if (sha256_method_process(method, ctxp, data, 0, 0))
+			continue;
+		found++;
+		for (i = 0; i < ARRAY_SIZE(counts); i++) {
+			for (blocks = 0; blocks <= SHA256_TEST_BLOCKS;
+			     blocks += 2) {
+				sha256_test_setup(expect, expectp, data, buf);
+				sha256_test_setup(ctx, ctxp, data, buf);
+				ut_assertok(sha256_method_process(
+						SHA256_METHOD_GENERIC, expectp,
+						data, counts[i], blocks));
+				ut_assertok(sha256_method_process(method, ctxp,
+								  data,
+								  counts[i],
+								  blocks));
+				for (j = 0; j < SHA256_TEST_STREAMS; j++)
+					ut_asserteq_mem(expect[j].state,
+							ctx[j].state,
+							sizeof(ctx[j].state));
+			}
+		}
+	}
+	ut_assert(found);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_sha256_methods, 0);
+
+/* Check that updating several contexts together gives the right digests */
+static int lib_sha256_multi(struct unit_test_state *uts)
+{
+	static const int lens[] = { 0, 1, 64, 65, 191, SHA256_TEST_BLOCKS * 64 };
+	uint8_t expect[SHA256_SUM_LEN], out[SHA256_SUM_LEN];
+	sha256_context ctx[SHA256_TEST_STREAMS], single;
+	sha256_context *ctxp[SHA256_TEST_STREAMS];
+	const uint8_t *data[SHA256_TEST_STREAMS];
+	int pre, len, i;
+	uint8_t *buf;
+
+	buf = malloc(SHA256_TEST_STREAMS * (SHA256_TEST_BLOCKS * 64 + 1));
+	ut_assertnonnull(buf);
+
+	/* Some data already in a context means the multi path is not used */
+	for (pre = 0; pre < 2; pre++) {
+		for (len = 0; len < ARRAY_SIZE(lens); len++) {
+			sha256_test_setup(ctx, ctxp, data, buf);
+			for (i = 0; i < SHA256_TEST_STREAMS; i++) {
+				sha256_starts(&ctx[i]);
+				if (pre && i == SHA256_TEST_STREAMS - 1)
+					sha256_update(&ctx[i], buf, 3);
+			}
+			sha256_update_multi(ctxp, data, SHA256_TEST_STREAMS,
+					    lens[len]);
+
+			for (i = 0; i < SHA256_TEST_STREAMS; i++) {
+				sha256_starts(&single);
+				if (pre && i == SHA256_TEST_STREAMS - 1)
+					sha256_update(&single, buf, 3);
+				sha256_update(&single, data[i], lens[len]);
+				sha256_finish(&single, expect);
+				sha256_finish(&ctx[i], out);
+				ut_asserteq_mem(expect, out, SHA256_SUM_LEN);
+			}
+		}
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_sha256_multi, 0);
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit test for SHA-384 and SHA-512
+ *
+ * The block function may be provided by an architecture-specific engine, so
+ * check it against known answers and with input split at awkward places.
+ */
+
+#include <test/lib.h>
+#include <test/ut.h>
+#include <u-boot/sha512.h>
+
+/* Two-block message from FIPS 180-2, appendix C.2 */
+static const char sha512_msg[] =
+	"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+
+static const uint8_t sha512_expect[SHA512_SUM_LEN] = {
+	0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda,
+	0x8c, 0xf4, 0xf7, 0x28, 0x14, 0xfc, 0x14, 0x3f,
+	0x8f, 0x77, 0x79, 0xc6, 0xeb, 0x9f, 0x7f, 0xa1,
+	0x72, 0x99, 0xae, 0xad, 0xb6, 0x88, 0x90, 0x18,
+	0x50, 0x1d, 0x28, 0x9e, 0x49, 0x00, 0xf7, 0xe4,
+	0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a,
+	0xc7, 0xd3, 0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54,
+	0x5e, 0x96, 0xe5, 0x5b, 0x87, 0x4b, 0xe9, 0x09,
+};
+
+static const uint8_t sha384_expect[SHA384_SUM_LEN] = {
+	0x09, 0x33, 0x0c, 0x33, 0xf7, 0x11, 0x47, 0xe8,
+	0x3d, 0x19, 0x2f, 0xc7, 0x82, 0xcd, 0x1b, 0x47,
+	0x53, 0x11, 0x1b, 0x17, 0x3b, 0x3b, 0x05, 0xd2,
+	0x2f, 0xa0, 0x80, 0x86, 0xe3, 0xb0, 0xf7, 0x12,
+	0xfc, 0xc7, 0xc7, 0x1a, 0x55, 0x7e, 0x2d, 0xb9,
+	0x66, 0xc3, 0xe9, 0xfa, 0x91, 0x74, 0x60, 0x39,
+};
+
+static int lib_sha512(struct unit_test_state *uts)
+{
+	const int len = sizeof(sha512_msg) - 1;
+	uint8_t out[SHA512_SUM_LEN];
+	sha512_context ctx;
+	int i;
+
+	sha512_csum_wd((const uint8_t *)sha512_msg, len, out, CHUNKSZ_SHA512);
+	ut_asserteq_mem(sha512_expect, out, SHA512_SUM_LEN);
+
+	/* feed the message in pieces which straddle the block boundary */
+	for (i = 1; i < len; i += 37) {
+		sha512_starts(&ctx);
+		sha512_update(&ctx, (const uint8_t *)sha512_msg, i);
+		sha512_update(&ctx, (const uint8_t *)sha512_msg + i, len - i);
+		sha512_finish(&ctx, out);
+		ut_asserteq_mem(sha512_expect, out, SHA512_SUM_LEN);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_sha512, 0);
+
+static int lib_sha384(struct unit_test_state *uts)
+{
+	const int len = sizeof(sha512_msg) - 1;
+	uint8_t out[SHA384_SUM_LEN];
+	sha512_context ctx;
+	int i;
+
+	sha384_csum_wd((const uint8_t *)sha512_msg, len, out, CHUNKSZ_SHA384);
+	ut_asserteq_mem(sha384_expect, out, SHA384_SUM_LEN);
+
+	for (i = 1; i < len; i += 37) {
+		sha384_starts(&ctx);
+		sha384_update(&ctx, (const uint8_t *)sha512_msg, i);
+		sha384_update(&ctx, (const uint8_t *)sha512_msg + i, len - i);
+		sha384_finish(&ctx, out);
+		ut_asserteq_mem(sha384_expect, out, SHA384_SUM_LEN);
+	}
+
+	return 0;
+}
+LIB_TEST(lib_sha384, 0);
@@ -362,7 +362,8 @@ static int test_post_run(struct unit_test_state *uts, struct unit_test *test)
 	ut_assertok(cyclic_unregister_all());
 	ut_assertok(event_uninit());
 
-	free(uts->of_other);
+	if (CONFIG_IS_ENABLED(OF_LIVE) && uts->of_other)
+		of_live_free(uts->of_other);
 	uts->of_other = NULL;
 
 	blkcache_free();